@@ -13,7 +13,7 @@ macx {
 
 SOURCES += \
 	src/accesscontrolwidget.cpp \
-	src/accesslogtreeitem.cpp \
+	src/accesslogmodel.cpp \
 	src/accesslogwidget.cpp \
 	src/application.cpp \
 	src/eqassert.cpp \
@@ -23,6 +23,29 @@ SOURCES += \
 	src/counterlabel.cpp \
 	src/directorylistingsortordercombo.cpp \
 	src/display_strings.cpp \
+	src/fastcgiconnection.cpp \
+	src/fastcgiconnectionpool.cpp \
+	src/fastcgiresponse.cpp \
+	src/cgiprocess.cpp \
+	src/cgiworkerpool.cpp \
+	src/cgienvironment.cpp \
+	src/cancellationtoken.cpp \
+	src/responsewriter.cpp \
+	src/cgiconcurrencylimiter.cpp \
+	src/cgiresponsecache.cpp \
+	src/connectsocket.cpp \
+	src/proxyconnection.cpp \
+	src/proxyconnectionpool.cpp \
+	src/moduleloader.cpp \
+	src/configurationwatcher.cpp \
+	src/routingtable.cpp \
+	src/ipconnectionpolicytrie.cpp \
+	src/commandline.cpp \
+	src/requesteventchannel.cpp \
+	src/accesslogwriter.cpp \
+	src/metrics.cpp \
+	src/requesttracewriter.cpp \
+	src/logger.cpp \
 	src/fileassociationsitemdelegate.cpp \
 	src/fileassociationsmodel.cpp \
 	src/fileassociationswidget.cpp \
@@ -64,7 +87,7 @@ FORMS += \
  
 HEADERS += \
 	src/accesscontrolwidget.h \
-	src/accesslogtreeitem.h \
+	src/accesslogmodel.h \
 	src/accesslogwidget.h \
 	src/application.h \
 	src/eqassert.h \
@@ -76,6 +99,32 @@ HEADERS += \
 	src/deflatecontentencoder.h \
 	src/directorylistingsortordercombo.h \
 	src/display_strings.h \
+	src/fastcgiconnection.h \
+	src/fastcgiconnectionpool.h \
+	src/fastcgiresponse.h \
+	src/cgiprocess.h \
+	src/cgiworkerpool.h \
+	src/cgienvironment.h \
+	src/cancellationtoken.h \
+	src/responsewriter.h \
+	src/cgiconcurrencylimiter.h \
+	src/cgiresponsecache.h \
+	src/connectsocket.h \
+	src/proxyconnection.h \
+	src/proxyconnectionpool.h \
+	src/handlermodule.h \
+	src/moduleloader.h \
+	src/configurationwatcher.h \
+	src/routingtable.h \
+	src/ipconnectionpolicytrie.h \
+	src/commandline.h \
+	src/requesteventchannel.h \
+	src/accesslogwriter.h \
+	src/metrics.h \
+	src/requesttrace.h \
+	src/requesttracewriter.h \
+	src/logger.h \
+	src/servercounters.h \
 	src/fileassociationsitemdelegate.h \
 	src/fileassociationsmodel.h \
 	src/fileassociationswidget.h \
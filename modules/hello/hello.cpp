@@ -0,0 +1,69 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file hello.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief A sample handler module for Anansi.
+///
+/// Responds with a short plain-text greeting. hellocgi.cpp produces exactly the same
+/// response as a CGI program, so the two can be benchmarked against each other with
+/// tools/benchmark_module.sh.
+///
+/// \dep
+/// - <string>
+/// - handlermodule.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include <string>
+
+#include "handlermodule.h"
+
+
+namespace {
+
+
+	class HelloHandler final : public Anansi::Module::Handler {
+	public:
+		void handle(Anansi::Module::Request & request, Anansi::Module::Response & response) override {
+			static const std::string greeting = "Hello, world!\n";
+
+			if("GET" != request.method() && "HEAD" != request.method()) {
+				response.setStatus(405);
+				response.setHeader("Allow", "GET, HEAD");
+				return;
+			}
+
+			response.setHeader("Content-Type", "text/plain");
+			response.setHeader("Content-Length", std::to_string(greeting.size()));
+			response.setHeader("Cache-Control", "no-store");
+			response.write(greeting);
+		}
+	};
+
+
+}  // namespace
+
+
+ANANSI_MODULE(HelloHandler)
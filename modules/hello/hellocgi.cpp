@@ -0,0 +1,53 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file hellocgi.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief The sample hello module as a CGI program.
+///
+/// Produces the same response as hello.cpp, for comparison in benchmarks.
+///
+/// \dep
+/// - <cstdio>
+/// - <cstdlib>
+/// - <cstring>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+int main() {
+	const char * method = std::getenv("REQUEST_METHOD");
+
+	if(!method || (0 != std::strcmp(method, "GET") && 0 != std::strcmp(method, "HEAD"))) {
+		std::fputs("Status: 405\r\nAllow: GET, HEAD\r\n\r\n", stdout);
+		return 0;
+	}
+
+	std::fputs("Content-Type: text/plain\r\nContent-Length: 14\r\nCache-Control: no-store\r\n\r\nHello, world!\n", stdout);
+	return 0;
+}
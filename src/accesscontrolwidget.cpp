@@ -29,6 +29,7 @@
 /// - accesscontrolwidget.ui
 /// - <array>
 /// - <iostream>
+/// - <utility>
 /// - <QMenu>
 /// - <QPushButton>
 /// - <QLineEdit>
@@ -53,6 +54,7 @@
 
 #include <array>
 #include <iostream>
+#include <utility>
 
 #include <QMenu>
 #include <QPushButton>
@@ -134,6 +136,7 @@ namespace Anansi {
 			}
 
 			m_server->configuration().setDefaultConnectionPolicy(policy);
+			m_server->configurationChanged();
 			Q_EMIT defaultConnectionPolicyChanged(policy);
 		});
 
@@ -158,7 +161,7 @@ namespace Anansi {
 		}
 		else {
 			m_model = std::make_unique<IpConnectionPolicyModel>(server);
-			m_ui->defaultPolicy->setConnectionPolicy(server->configuration().defaultConnectionPolicy());
+			m_ui->defaultPolicy->setConnectionPolicy(std::as_const(*server).configuration().defaultConnectionPolicy());
 
 			connect(m_model.get(), &IpConnectionPolicyModel::policyChanged, this, &AccessControlWidget::ipAddressConnectionPolicySet);
 		}
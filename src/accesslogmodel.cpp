@@ -0,0 +1,304 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file accesslogmodel.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the AccessLogModel class.
+///
+/// \dep
+/// - accesslogmodel.h
+/// - <algorithm>
+/// - <iostream>
+/// - <QDateTime>
+/// - <QStringBuilder>
+/// - macros.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "accesslogmodel.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <QDateTime>
+#include <QStringBuilder>
+
+#include "macros.h"
+
+
+namespace Anansi {
+
+
+	AccessLogModel::AccessLogModel(int capacity, QObject * parent)
+	: QAbstractTableModel(parent),
+	  m_entries(static_cast<std::size_t>(std::max(1, capacity))),
+	  m_first(0),
+	  m_count(0),
+	  m_noPolicyIcon(QStringLiteral(":/icons/connectionpolicies/nopolicy")),
+	  m_rejectIcon(QIcon::fromTheme(QStringLiteral("cards-block"), QIcon(QStringLiteral(":/icons/connectionpolicies/reject")))),
+	  m_acceptIcon(QIcon::fromTheme(QStringLiteral("dialog-ok-accept"), QIcon(QStringLiteral(":/icons/connectionpolicies/accept")))) {
+	}
+
+
+	void AccessLogModel::addPolicyEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, ConnectionPolicy policy) {
+		append({{timestamp.toMSecsSinceEpoch(), addr, {}, port, true, static_cast<uint8_t>(policy)}});
+	}
+
+
+	void AccessLogModel::addActionEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, const QString & resource, WebServerAction action) {
+		append({{timestamp.toMSecsSinceEpoch(), addr, resource, port, false, static_cast<uint8_t>(action)}});
+	}
+
+
+	void AccessLogModel::addEntries(const RequestEventBatch & events) {
+		std::vector<Entry> entries;
+		entries.reserve(events.size());
+
+		for(const auto & event : events) {
+			switch(event.type) {
+				case RequestEvent::Type::PolicyDetermined:
+					entries.push_back({event.time.toMSecsSinceEpoch(), event.address, {}, event.port, true, static_cast<uint8_t>(event.policy)});
+					break;
+
+				case RequestEvent::Type::ActionTaken:
+					entries.push_back({event.time.toMSecsSinceEpoch(), event.address, event.resource, event.port, false, static_cast<uint8_t>(event.action)});
+					break;
+
+				default:
+					break;
+			}
+		}
+
+		append(entries);
+	}
+
+
+	void AccessLogModel::append(const std::vector<Entry> & entries) {
+		if(entries.empty()) {
+			return;
+		}
+
+		const auto capacity = this->capacity();
+		const auto count = static_cast<int>(entries.size());
+
+		if(capacity <= count) {
+			// the new entries alone fill the log
+			beginResetModel();
+			std::copy(entries.cend() - capacity, entries.cend(), m_entries.begin());
+			m_first = 0;
+			m_count = capacity;
+			endResetModel();
+			return;
+		}
+
+		if(const auto evict = m_count + count - capacity; 0 < evict) {
+			beginRemoveRows({}, 0, evict - 1);
+			m_first = (m_first + evict) % capacity;
+			m_count -= evict;
+			endRemoveRows();
+		}
+
+		beginInsertRows({}, m_count, m_count + count - 1);
+
+		for(const auto & entry : entries) {
+			m_entries[static_cast<std::size_t>((m_first + m_count) % capacity)] = entry;
+			++m_count;
+		}
+
+		endInsertRows();
+	}
+
+
+	void AccessLogModel::clear() {
+		beginResetModel();
+		std::fill(m_entries.begin(), m_entries.end(), Entry{});
+		m_first = 0;
+		m_count = 0;
+		endResetModel();
+	}
+
+
+	QString AccessLogModel::displayText(const Entry & entry, int column) const {
+		switch(column) {
+			case TimestampColumnIndex:
+				return QDateTime::fromMSecsSinceEpoch(entry.time).toString(Qt::RFC2822Date);
+
+			case IpAddressColumnIndex:
+				return entry.address;
+
+			case IpPortColumnIndex:
+				return QString::number(entry.port);
+
+			case ResourceColumnIndex:
+				if(entry.isPolicy) {
+					return tr("[http connection]");
+				}
+
+				return entry.resource;
+
+			case ActionColumnIndex:
+				if(entry.isPolicy) {
+					switch(static_cast<ConnectionPolicy>(entry.outcome)) {
+						case ConnectionPolicy::None:
+							return tr("No Connection Policy");
+
+						case ConnectionPolicy::Reject:
+							return tr("Rejected");
+
+						case ConnectionPolicy::Accept:
+							return tr("Accepted");
+					}
+
+					break;
+				}
+
+				switch(static_cast<WebServerAction>(entry.outcome)) {
+					case WebServerAction::Ignore:
+						return tr("Ignored");
+
+					case WebServerAction::Serve:
+						return tr("Served");
+
+					case WebServerAction::Forbid:
+						return tr("Forbidden, not found, or CGI failed");
+
+					case WebServerAction::CGI:
+						return tr("Executed through CGI");
+
+					case WebServerAction::Proxy:
+						return tr("Forwarded to upstream server");
+
+					case WebServerAction::Module:
+						return tr("Handled by module");
+				}
+
+				break;
+		}
+
+		return {};
+	}
+
+
+	QString AccessLogModel::entryText(int row) const {
+		if(0 > row || m_count <= row) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid row (" << row << ")\n";
+			return {};
+		}
+
+		const auto & logEntry = entry(row);
+		return displayText(logEntry, TimestampColumnIndex) % QStringLiteral(" - ") % logEntry.address % ':' % QString::number(logEntry.port) % ' ' % displayText(logEntry, ResourceColumnIndex) % ' ' % displayText(logEntry, ActionColumnIndex);
+	}
+
+
+	int AccessLogModel::rowCount(const QModelIndex & parent) const {
+		if(parent.isValid()) {
+			return 0;
+		}
+
+		return m_count;
+	}
+
+
+	int AccessLogModel::columnCount(const QModelIndex & parent) const {
+		if(parent.isValid()) {
+			return 0;
+		}
+
+		return 1 + ActionColumnIndex;
+	}
+
+
+	QVariant AccessLogModel::headerData(int section, Qt::Orientation orientation, int role) const {
+		if(Qt::Horizontal != orientation || Qt::DisplayRole != role) {
+			return QAbstractTableModel::headerData(section, orientation, role);
+		}
+
+		switch(section) {
+			case TimestampColumnIndex:
+				return tr("Time");
+
+			case IpAddressColumnIndex:
+				return tr("Remote IP");
+
+			case IpPortColumnIndex:
+				return tr("Remote Port");
+
+			case ResourceColumnIndex:
+				return tr("Resource Requested");
+
+			case ActionColumnIndex:
+				return tr("Response/Action");
+		}
+
+		return {};
+	}
+
+
+	QVariant AccessLogModel::data(const QModelIndex & idx, int role) const {
+		if(Qt::DisplayRole != role && Qt::DecorationRole != role) {
+			return {};
+		}
+
+		if(!idx.isValid() || 0 > idx.row() || m_count <= idx.row()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: index is not valid\n";
+			return {};
+		}
+
+		const auto & logEntry = entry(idx.row());
+
+		if(Qt::DisplayRole == role) {
+			return displayText(logEntry, idx.column());
+		}
+
+		if(ActionColumnIndex != idx.column() || !logEntry.isPolicy) {
+			return {};
+		}
+
+		switch(static_cast<ConnectionPolicy>(logEntry.outcome)) {
+			case ConnectionPolicy::None:
+				return m_noPolicyIcon;
+
+			case ConnectionPolicy::Reject:
+				return m_rejectIcon;
+
+			case ConnectionPolicy::Accept:
+				return m_acceptIcon;
+		}
+
+		return {};
+	}
+
+
+	Qt::ItemFlags AccessLogModel::flags(const QModelIndex & idx) const {
+		auto ret = QAbstractTableModel::flags(idx);
+
+		if(idx.isValid()) {
+			ret |= Qt::ItemNeverHasChildren;
+		}
+
+		return ret;
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file accesslogmodel.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the AccessLogModel class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <vector>
+/// - <QAbstractTableModel>
+/// - <QDateTime>
+/// - <QIcon>
+/// - <QModelIndex>
+/// - <QString>
+/// - <QVariant>
+/// - types.h
+/// - requesteventchannel.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_ACCESSLOGMODEL_H
+#define ANANSI_ACCESSLOGMODEL_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QDateTime>
+#include <QIcon>
+#include <QModelIndex>
+#include <QString>
+#include <QVariant>
+
+#include "types.h"
+#include "requesteventchannel.h"
+
+namespace Anansi {
+
+	// the most recent entries in the access log. the entries are held unformatted in a
+	// ring of fixed capacity; the text for each cell is only produced when a view asks
+	// for it. once the log is full, adding entries evicts the oldest
+	class AccessLogModel final : public QAbstractTableModel {
+		Q_OBJECT
+
+	public:
+		static constexpr const int TimestampColumnIndex = 0;
+		static constexpr const int IpAddressColumnIndex = 1;
+		static constexpr const int IpPortColumnIndex = 2;
+		static constexpr const int ResourceColumnIndex = 3;
+		static constexpr const int ActionColumnIndex = 4;
+
+		static constexpr const int DefaultCapacity = 10000;
+
+		explicit AccessLogModel(int capacity = DefaultCapacity, QObject * parent = nullptr);
+		AccessLogModel(const AccessLogModel &) = delete;
+		AccessLogModel(AccessLogModel &&) = delete;
+		void operator=(const AccessLogModel &) = delete;
+		void operator=(AccessLogModel &&) = delete;
+
+		inline int capacity() const noexcept {
+			return static_cast<int>(m_entries.size());
+		}
+
+		void addPolicyEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, ConnectionPolicy policy);
+		void addActionEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, const QString & resource, WebServerAction action);
+
+		// adds the policy and action events in the batch as one insertion
+		void addEntries(const RequestEventBatch & events);
+
+		void clear();
+
+		// the entry on the row as a line of plain text, for saving
+		QString entryText(int row) const;
+
+		int rowCount(const QModelIndex & parent = {}) const override;
+		int columnCount(const QModelIndex & parent = {}) const override;
+		QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+		QVariant data(const QModelIndex & idx, int role = Qt::DisplayRole) const override;
+		Qt::ItemFlags flags(const QModelIndex & idx) const override;
+
+	private:
+		// the strings are implicitly shared with the events they came from; the address is
+		// the same string for every entry from a connection
+		struct Entry {
+			qint64 time;
+			QString address;
+			QString resource;
+			uint16_t port;
+			bool isPolicy;
+			uint8_t outcome;
+		};
+
+		inline const Entry & entry(int row) const {
+			return m_entries[static_cast<std::size_t>((m_first + row) % capacity())];
+		}
+
+		// evicts as many of the oldest entries as necessary to make room
+		void append(const std::vector<Entry> & entries);
+
+		QString displayText(const Entry & entry, int column) const;
+
+		std::vector<Entry> m_entries;
+		int m_first;
+		int m_count;
+		QIcon m_noPolicyIcon;
+		QIcon m_rejectIcon;
+		QIcon m_acceptIcon;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_ACCESSLOGMODEL_H
@@ -29,12 +29,11 @@
 /// - accesslogwidget.ui
 /// - <iostream>
 /// - <QString>
-/// - <QTreeWidgetItem>
 /// - <QFileDialog>
 /// - <QMessageBox>
 /// - <QFile>
 /// - <QTextStream>
-/// - accesslogwidgetitem.h
+/// - accesslogmodel.h
 /// - windowbase.h
 /// - notifications.h
 ///
@@ -46,13 +45,12 @@
 
 #include <iostream>
 #include <QString>
-#include <QTreeWidgetItem>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
 
-#include "accesslogtreeitem.h"
+#include "accesslogmodel.h"
 #include "windowbase.h"
 #include "notifications.h"
 
@@ -62,16 +60,10 @@ namespace Anansi {
 
 	AccessLogWidget::AccessLogWidget(QWidget * parent)
 	: QWidget(parent),
-	  m_ui(std::make_unique<Ui::AccessLogWidget>()) {
+	  m_ui(std::make_unique<Ui::AccessLogWidget>()),
+	  m_model(std::make_unique<AccessLogModel>()) {
 		m_ui->setupUi(this);
-		auto * accessLogHeader = new QTreeWidgetItem;
-		accessLogHeader->setText(0, tr("Time"));
-		accessLogHeader->setText(1, tr("Remote IP"));
-		accessLogHeader->setText(2, tr("Remote Port"));
-		accessLogHeader->setText(3, tr("Resource Requested"));
-		accessLogHeader->setText(4, tr("Response/Action"));
-		// QTreeWidget takes ownership
-		m_ui->log->setHeaderItem(accessLogHeader);
+		m_ui->log->setModel(m_model.get());
 
 		connect(m_ui->save, &QPushButton::clicked, this, &AccessLogWidget::save);
 		connect(m_ui->clear, &QPushButton::clicked, this, &AccessLogWidget::clear);
@@ -108,11 +100,10 @@ namespace Anansi {
 		}
 
 		QTextStream outStream(&outFile);
-		auto itemCount = m_ui->log->topLevelItemCount();
+		const auto entryCount = m_model->rowCount();
 
-		for(int idx = 0; idx < itemCount; ++idx) {
-			auto * logEntry = m_ui->log->topLevelItem(idx);
-			outStream << logEntry->text(0) << QByteArrayLiteral(" - ") << logEntry->text(1) << ':' << logEntry->text(2) << ' ' << logEntry->text(3) << ' ' << logEntry->text(4) << '\n';
+		for(int row = 0; row < entryCount; ++row) {
+			outStream << m_model->entryText(row) << '\n';
 		}
 
 		outStream.flush();
@@ -121,17 +112,22 @@ namespace Anansi {
 
 
 	void AccessLogWidget::clear() {
-		m_ui->log->clear();
+		m_model->clear();
 	}
 
 
 	void AccessLogWidget::addPolicyEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, ConnectionPolicy policy) {
-		m_ui->log->addTopLevelItem(new AccessLogTreeItem(timestamp, addr, port, policy));
+		m_model->addPolicyEntry(timestamp, addr, port, policy);
 	}
 
 
 	void AccessLogWidget::addActionEntry(const QDateTime & timestamp, const QString & addr, uint16_t port, const QString & resource, WebServerAction action) {
-		m_ui->log->addTopLevelItem(new AccessLogTreeItem(timestamp, addr, port, resource, action));
+		m_model->addActionEntry(timestamp, addr, port, resource, action);
+	}
+
+
+	void AccessLogWidget::addEntries(const RequestEventBatch & events) {
+		m_model->addEntries(events);
 	}
 
 
@@ -30,6 +30,7 @@
 /// - <QWidget>
 /// - <QDateTime>
 /// - types.h
+/// - requesteventchannel.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -44,11 +45,14 @@
 #include <QDateTime>
 
 #include "types.h"
+#include "requesteventchannel.h"
 
 class QString;
 
 namespace Anansi {
 
+	class AccessLogModel;
+
 	namespace Ui {
 		class AccessLogWidget;
 	}
@@ -77,8 +81,12 @@ namespace Anansi {
 			addActionEntry(QDateTime::currentDateTime(), addr, port, resource, action);
 		}
 
+		// adds the policy and action events in the batch all at once
+		void addEntries(const RequestEventBatch & events);
+
 	private:
 		std::unique_ptr<Ui::AccessLogWidget> m_ui;
+		std::unique_ptr<AccessLogModel> m_model;
 	};
 
 }  // namespace Anansi
@@ -0,0 +1,449 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file accesslogwriter.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the AccessLogWriter class for Anansi.
+///
+/// The queue is a bounded multi-producer, single-consumer ring in which each cell
+/// carries a sequence number: a producer claims a cell by advancing the enqueue
+/// position, fills in the record and then publishes it by bumping the cell's
+/// sequence. Producers never wait for the background thread - a full ring just means
+/// the record is dropped.
+///
+/// Lines follow the Apache Common Log Format, with the referer and user agent
+/// appended for the Combined format. Quotes, backslashes and control characters in
+/// the request line and headers are escaped.
+///
+/// \dep
+/// - accesslogwriter.h
+/// - <algorithm>
+/// - <chrono>
+/// - <cstdlib>
+/// - <cstring>
+/// - <QDateTime>
+/// - <QLocale>
+/// - logger.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "accesslogwriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <QDateTime>
+#include <QLocale>
+
+#include "logger.h"
+
+
+namespace Anansi {
+
+
+	// set from a signal handler, so must be a lock-free atomic
+	static std::atomic<bool> reopenRequested(false);
+
+
+	static uint16_t copyField(char * dest, std::size_t capacity, const std::string & str) noexcept {
+		const auto length = std::min(capacity, str.size());
+		std::memcpy(dest, str.data(), length);
+		return static_cast<uint16_t>(length);
+	}
+
+
+	static void appendQuoted(QByteArray & out, const char * str, uint16_t length) {
+		static constexpr const char * HexDigits = "0123456789abcdef";
+		out.append('"');
+
+		if(0 == length) {
+			out.append('-');
+		}
+		else {
+			for(const auto * ch = str; ch < str + length; ++ch) {
+				const auto byte = static_cast<unsigned char>(*ch);
+
+				if('"' == byte || '\\' == byte) {
+					out.append('\\');
+					out.append(*ch);
+				}
+				else if(0x20 > byte || 0x7f == byte) {
+					out.append("\\x", 2);
+					out.append(HexDigits[byte >> 4]);
+					out.append(HexDigits[byte & 0x0f]);
+				}
+				else {
+					out.append(*ch);
+				}
+			}
+		}
+
+		out.append('"');
+	}
+
+
+	AccessLogWriter::AccessLogWriter()
+	: m_enqueuePosition(0),
+	  m_dequeuePosition(0),
+	  m_written(0),
+	  m_dropped(0),
+	  m_rotations(0),
+	  m_enabled(false),
+	  m_optionsChanged(false),
+	  m_stopping(false),
+	  m_openedAt(0),
+	  m_openFailed(false),
+	  m_cachedSecond(-1) {
+		static_assert(std::atomic<bool>::is_always_lock_free, "reopen() relies on a lock-free atomic<bool>");
+	}
+
+
+	AccessLogWriter::~AccessLogWriter() {
+		m_enabled.store(false, std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stopping = true;
+		}
+
+		m_wake.notify_one();
+
+		if(m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+
+	AccessLogWriter & AccessLogWriter::instance() {
+		static AccessLogWriter writer;
+		return writer;
+	}
+
+
+	void AccessLogWriter::setOptions(const Options & options) {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		if(options.fileName.isEmpty()) {
+			m_enabled.store(false, std::memory_order_release);
+
+			if(m_thread.joinable()) {
+				// the thread writes out whatever is still queued to the current file before it
+				// finishes
+				m_stopping = true;
+				lock.unlock();
+				m_wake.notify_one();
+				m_thread.join();
+				lock.lock();
+				m_stopping = false;
+			}
+
+			return;
+		}
+
+		if(!m_cells) {
+			m_cells = std::make_unique<std::array<Cell, QueueCapacity>>();
+
+			for(std::size_t idx = 0; idx < QueueCapacity; ++idx) {
+				(*m_cells)[idx].sequence.store(idx, std::memory_order_relaxed);
+			}
+		}
+
+		m_options = options;
+		m_optionsChanged = true;
+
+		if(!m_thread.joinable()) {
+			m_thread = std::thread(&AccessLogWriter::run, this);
+		}
+
+		m_enabled.store(true, std::memory_order_release);
+		lock.unlock();
+		m_wake.notify_one();
+	}
+
+
+	bool AccessLogWriter::log(const QHostAddress & client, qint64 time, int status, qint64 bytes, const std::string & request, const std::string & referer, const std::string & userAgent) noexcept {
+		if(!m_enabled.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		auto position = m_enqueuePosition.load(std::memory_order_relaxed);
+		Cell * cell;
+
+		while(true) {
+			cell = &(*m_cells)[position % QueueCapacity];
+			const auto sequence = cell->sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+			if(0 == diff) {
+				if(m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if(0 > diff) {
+				// the background thread hasn't caught up - don't make the client wait for it
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else {
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		auto & record = cell->record;
+		bool isIpv4 = false;
+		record.ipv4Address = client.toIPv4Address(&isIpv4);
+		record.isIpv4 = isIpv4;
+
+		if(!isIpv4) {
+			record.ipv6Address = client.toIPv6Address();
+		}
+
+		record.time = time;
+		record.bytes = bytes;
+		record.status = static_cast<uint16_t>(std::max(0, status));
+		record.requestLength = copyField(record.request, MaxRequestLength, request);
+		record.refererLength = copyField(record.referer, MaxHeaderLength, referer);
+		record.userAgentLength = copyField(record.userAgent, MaxHeaderLength, userAgent);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+
+	void AccessLogWriter::reopen() noexcept {
+		reopenRequested.store(true, std::memory_order_relaxed);
+	}
+
+
+	AccessLogWriter::Statistics AccessLogWriter::statistics() const noexcept {
+		Statistics statistics;
+		statistics.written = m_written.load(std::memory_order_relaxed);
+		statistics.dropped = m_dropped.load(std::memory_order_relaxed);
+		statistics.rotations = m_rotations.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+
+	void AccessLogWriter::run() {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		while(true) {
+			if(m_optionsChanged) {
+				m_optionsChanged = false;
+				const auto options = m_options;
+				lock.unlock();
+
+				if(options.fileName != m_activeOptions.fileName) {
+					m_file.close();
+					m_activeOptions = options;
+					m_openFailed = false;
+				}
+				else {
+					m_activeOptions = options;
+				}
+
+				lock.lock();
+			}
+
+			if(m_stopping) {
+				break;
+			}
+
+			lock.unlock();
+			flush();
+			lock.lock();
+
+			m_wake.wait_for(lock, std::chrono::milliseconds(FlushInterval), [this]() {
+				return m_stopping || m_optionsChanged;
+			});
+		}
+
+		lock.unlock();
+		flush();
+		m_file.close();
+		m_activeOptions = {};
+	}
+
+
+	void AccessLogWriter::flush() {
+		if(reopenRequested.exchange(false, std::memory_order_relaxed)) {
+			m_file.close();
+			m_openFailed = false;
+		}
+
+		QByteArray out;
+		uint64_t count = 0;
+
+		if(m_cells) {
+			while(true) {
+				auto & cell = (*m_cells)[m_dequeuePosition % QueueCapacity];
+
+				if(cell.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+					break;
+				}
+
+				appendLine(out, cell.record);
+				cell.sequence.store(m_dequeuePosition + QueueCapacity, std::memory_order_release);
+				++m_dequeuePosition;
+				++count;
+			}
+		}
+
+		if(0 == count) {
+			return;
+		}
+
+		if(!m_file.isOpen() && !openFile()) {
+			m_dropped.fetch_add(count, std::memory_order_relaxed);
+			return;
+		}
+
+		if(out.size() != m_file.write(out)) {
+			anansiLog(Error, "failed to write to access log \"" << qPrintable(m_activeOptions.fileName) << "\": " << qPrintable(m_file.errorString()));
+			m_dropped.fetch_add(count, std::memory_order_relaxed);
+		}
+		else {
+			m_written.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		if(0 >= m_file.size()) {
+			return;
+		}
+
+		if((0 < m_activeOptions.rotateSize && m_activeOptions.rotateSize <= m_file.size()) || (0 < m_activeOptions.rotateInterval && static_cast<qint64>(m_activeOptions.rotateInterval) * 1000 <= QDateTime::currentMSecsSinceEpoch() - m_openedAt)) {
+			rotate();
+		}
+	}
+
+
+	bool AccessLogWriter::openFile() {
+		m_file.setFileName(m_activeOptions.fileName);
+
+		if(!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+			// only report it once, not on every flush until it comes good
+			if(!m_openFailed) {
+				anansiLog(Error, "failed to open access log \"" << qPrintable(m_activeOptions.fileName) << "\": " << qPrintable(m_file.errorString()));
+				m_openFailed = true;
+			}
+
+			return false;
+		}
+
+		m_openFailed = false;
+		m_openedAt = QDateTime::currentMSecsSinceEpoch();
+		return true;
+	}
+
+
+	void AccessLogWriter::rotate() {
+		const auto & fileName = m_activeOptions.fileName;
+		m_file.close();
+
+		// file.1 is the most recent; the oldest falls off the end
+		for(auto idx = m_activeOptions.rotateCount - 1; 0 < idx; --idx) {
+			const auto source = fileName + '.' + QString::number(idx);
+
+			if(QFile::exists(source)) {
+				const auto destination = fileName + '.' + QString::number(idx + 1);
+				QFile::remove(destination);
+				QFile::rename(source, destination);
+			}
+		}
+
+		const auto rotated = fileName + QStringLiteral(".1");
+		QFile::remove(rotated);
+
+		if(!QFile::rename(fileName, rotated)) {
+			anansiLog(Error, "failed to rotate access log \"" << qPrintable(fileName) << "\"");
+		}
+		else {
+			m_rotations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		openFile();
+	}
+
+
+	void AccessLogWriter::appendLine(QByteArray & out, const Record & record) {
+		// most lines land within the same second as the previous one
+		if(const auto second = record.time / 1000; second != m_cachedSecond) {
+			const auto time = QDateTime::fromMSecsSinceEpoch(second * 1000);
+			const auto offset = time.offsetFromUtc() / 60;
+			const auto absOffset = std::abs(offset);
+			const char zone[] = {
+				' ',
+				(0 > offset ? '-' : '+'),
+				static_cast<char>('0' + absOffset / 600),
+				static_cast<char>('0' + (absOffset / 60) % 10),
+				static_cast<char>('0' + (absOffset % 60) / 10),
+				static_cast<char>('0' + absOffset % 10),
+			};
+
+			m_cachedTime = QLocale::c().toString(time, QStringLiteral("dd/MMM/yyyy:HH:mm:ss")).toLatin1();
+			m_cachedTime.append(zone, sizeof(zone));
+			m_cachedSecond = second;
+		}
+
+		if(record.isIpv4) {
+			out.append(QHostAddress(record.ipv4Address).toString().toLatin1());
+		}
+		else {
+			out.append(QHostAddress(record.ipv6Address).toString().toLatin1());
+		}
+
+		out.append(" - - [", 6);
+		out.append(m_cachedTime);
+		out.append("] ", 2);
+		appendQuoted(out, record.request, record.requestLength);
+		out.append(' ');
+
+		if(0 == record.status) {
+			out.append('-');
+		}
+		else {
+			out.append(QByteArray::number(record.status));
+		}
+
+		out.append(' ');
+
+		if(0 >= record.bytes) {
+			out.append('-');
+		}
+		else {
+			out.append(QByteArray::number(record.bytes));
+		}
+
+		if(AccessLogFormat::Combined == m_activeOptions.format) {
+			out.append(' ');
+			appendQuoted(out, record.referer, record.refererLength);
+			out.append(' ');
+			appendQuoted(out, record.userAgent, record.userAgentLength);
+		}
+
+		out.append('\n');
+	}
+
+
+}  // namespace Anansi
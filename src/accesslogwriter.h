@@ -0,0 +1,174 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file accesslogwriter.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the AccessLogWriter class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <atomic>
+/// - <condition_variable>
+/// - <cstdint>
+/// - <memory>
+/// - <mutex>
+/// - <string>
+/// - <thread>
+/// - <QFile>
+/// - <QHostAddress>
+/// - <QString>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_ACCESSLOGWRITER_H
+#define ANANSI_ACCESSLOGWRITER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <QFile>
+#include <QHostAddress>
+#include <QString>
+
+#include "types.h"
+
+namespace Anansi {
+
+	// writes the on-disk access log in Common or Combined Log Format. request handlers
+	// hand over fixed-size records through a bounded lock-free queue and a background
+	// thread formats and writes them in batches. when the queue is full - for example
+	// because the disk is slow - records are dropped and counted, so logging never holds
+	// up a request
+	class AccessLogWriter final {
+	public:
+		struct Options {
+			QString fileName;
+			AccessLogFormat format = AccessLogFormat::Combined;
+			int rotateSize = 0;
+			int rotateInterval = 0;
+			int rotateCount = 1;
+		};
+
+		struct Statistics {
+			uint64_t written = 0;
+			uint64_t dropped = 0;
+			uint64_t rotations = 0;
+		};
+
+		// the most records waiting to be written
+		static constexpr const std::size_t QueueCapacity = 4096;
+
+		// how often the background thread writes out what has been logged, in msec
+		static constexpr const int FlushInterval = 100;
+
+		AccessLogWriter(const AccessLogWriter &) = delete;
+		AccessLogWriter(AccessLogWriter &&) = delete;
+		void operator=(const AccessLogWriter &) = delete;
+		void operator=(AccessLogWriter &&) = delete;
+		~AccessLogWriter();
+
+		static AccessLogWriter & instance();
+
+		// an empty file name stops logging and closes the file
+		void setOptions(const Options & options);
+
+		// time is when the request was received, in msec since the epoch. status is 0 if no
+		// response was sent. long strings are truncated. safe to call from any thread
+		bool log(const QHostAddress & client, qint64 time, int status, qint64 bytes, const std::string & request, const std::string & referer = {}, const std::string & userAgent = {}) noexcept;
+
+		// asks the background thread to close and reopen the file, for when it has been moved
+		// aside by an external log rotation tool. safe to call from a signal handler
+		static void reopen() noexcept;
+
+		Statistics statistics() const noexcept;
+
+	private:
+		static constexpr const std::size_t MaxRequestLength = 512;
+		static constexpr const std::size_t MaxHeaderLength = 256;
+
+		struct Record {
+			qint64 time;
+			qint64 bytes;
+			Q_IPV6ADDR ipv6Address;
+			quint32 ipv4Address;
+			bool isIpv4;
+			uint16_t status;
+			uint16_t requestLength;
+			uint16_t refererLength;
+			uint16_t userAgentLength;
+			char request[MaxRequestLength];
+			char referer[MaxHeaderLength];
+			char userAgent[MaxHeaderLength];
+		};
+
+		struct Cell {
+			std::atomic<std::size_t> sequence;
+			Record record;
+		};
+
+		AccessLogWriter();
+
+		void run();
+		void flush();
+		bool openFile();
+		void rotate();
+		void appendLine(QByteArray & out, const Record & record);
+
+		// the queue: any thread enqueues, only the background thread dequeues. it is only
+		// allocated once logging is first enabled
+		std::unique_ptr<std::array<Cell, QueueCapacity>> m_cells;
+		std::atomic<std::size_t> m_enqueuePosition;
+		std::size_t m_dequeuePosition;
+		std::atomic<uint64_t> m_written;
+		std::atomic<uint64_t> m_dropped;
+		std::atomic<uint64_t> m_rotations;
+		std::atomic<bool> m_enabled;
+
+		// guards the options and the thread's lifetime; never taken by log()
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		Options m_options;
+		bool m_optionsChanged;
+		bool m_stopping;
+		std::thread m_thread;
+
+		// only touched by the background thread
+		QFile m_file;
+		Options m_activeOptions;
+		qint64 m_openedAt;
+		bool m_openFailed;
+		qint64 m_cachedSecond;
+		QByteArray m_cachedTime;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_ACCESSLOGWRITER_H
@@ -26,43 +26,34 @@
 ///
 /// \dep
 /// - application.h
-/// - <iostream>
 /// - <QDir>
 /// - <QStandardPaths>
 /// - <QString>
-/// - macros.h
 /// - configuration.h
 /// - server.h
 /// - mainwindow.h
 /// - qtmetatypes.h
-/// - strings.h
+/// - commandline.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
 
 #include "application.h"
 
-#include <iostream>
-
 #include <QDir>
 #include <QStandardPaths>
 #include <QString>
 
-#include "macros.h"
 #include "configuration.h"
 #include "server.h"
 #include "mainwindow.h"
 #include "qtmetatypes.h"
-#include "strings.h"
+#include "commandline.h"
 
 
 namespace Anansi {
 
 
-	using Equit::parse_uint;
-	using Equit::starts_with;
-
-
 	Application::Application(int & argc, char ** argv)
 	: QApplication(argc, argv),
 	  m_mainWindow(std::make_unique<MainWindow>(nullptr)) {
@@ -76,92 +67,28 @@ namespace Anansi {
 		qRegisterMetaType<Anansi::ConnectionPolicy>();
 		qRegisterMetaType<Anansi::WebServerAction>();
 
-		bool autoStart = false;
+		const auto options = parseCommandLine(argc, argv);
 
-		QString configFile = QDir(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)).absoluteFilePath("defaultsettings.awcx");
-		auto config = Configuration::loadFrom(configFile);
+		if(!options) {
+			exit(EXIT_FAILURE);
+		}
+
+		QString watchFile;
+		auto config = startupConfiguration(*options, watchFile);
 
 		if(!config) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to load user default configuration from \"" << qPrintable(configFile) << ".\n";
-			configFile = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation)).absoluteFilePath("equitwebserversettings.awcx");
-			config = Configuration::loadFrom(configFile);
-
-			if(!config) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to load system default configuration from \"" << qPrintable(configFile) << "\".\n";
-				config = std::make_optional<Configuration>();
-			}
+			exit(EXIT_FAILURE);
 		}
 
-		for(int i = 1; i < argc; i++) {
-			std::string arg = argv[i];
-
-			if(starts_with(arg, "-a") || "--address" == arg) {
-				if(2 < arg.size() && arg != "--address") {
-					config->setListenAddress(argv[i] + 2);
-				}
-				else {
-					++i;
-
-					if(i >= argc) {
-						std::cerr << arg << " provided without a listen ip address.\n";
-						exit(EXIT_FAILURE);
-					}
-
-					config->setListenAddress(argv[i]);
-				}
-			}
-			else if(starts_with(arg, "-p") || "--port" == arg) {
-				if(2 < arg.size() && arg != "--port") {
-					auto port = parse_uint<uint16_t>(argv[i] + 2);
-
-					if(!port) {
-						std::cerr << "invalid port provided to -p: " << (argv[i] + 2) << "\n";
-						exit(EXIT_FAILURE);
-					}
-
-					config->setPort(QString(argv[i] + 2).toInt());
-				}
-				else {
-					++i;
-
-					if(i >= argc) {
-						std::cerr << arg << " provided without a listen port.";
-						exit(EXIT_FAILURE);
-					}
-
-					auto port = parse_uint<uint16_t>(argv[i]);
-
-					if(!port) {
-						std::cerr << "invalid port provided to " << arg << ": " << argv[i] << "\n";
-						exit(EXIT_FAILURE);
-					}
-
-					config->setPort(*port);
-				}
-			}
-			else if(starts_with(arg, "-d") || "--docroot" == arg) {
-				if(2 < arg.size() && "--docroot" != arg) {
-					config->setDocumentRoot(argv[i] + 2);
-				}
-				else {
-					++i;
-
-					if(i >= argc) {
-						std::cerr << arg << " provided without a document root.";
-						exit(EXIT_FAILURE);
-					}
-
-					config->setDocumentRoot(argv[i]);
-				}
-			}
-			else if("-s" == arg || "--start" == arg) {
-				autoStart = true;
-			}
+		auto server = std::make_unique<Server>(std::move(*config));
+
+		if(!watchFile.isEmpty()) {
+			server->watchConfigurationFile(watchFile);
 		}
 
-		m_mainWindow = std::make_unique<MainWindow>(std::make_unique<Server>(std::move(*config)));
+		m_mainWindow = std::make_unique<MainWindow>(std::move(server));
 
-		if(autoStart) {
+		if(options->start) {
 			m_mainWindow->startServer();
 		}
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cancellationtoken.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CancellationToken class for Anansi.
+///
+/// Disconnection is always detected with POLLHUP, POLLERR and POLLNVAL. A client that
+/// closes its connection only sends a FIN, though, which shows up as POLLRDHUP (or a
+/// zero-byte read), not POLLHUP. Until the request has been received that just means
+/// the client has finished sending, so it is only treated as disconnection once the
+/// request body has been read in full. This is when the handler waits without writing
+/// (on a CGI process, a FastCGI responder or the CGI concurrency limiter). Where
+/// POLLRDHUP is not available, isCancelled() peeks at the socket instead; callers
+/// that poll() the socket themselves only see POLLHUP and POLLERR.
+///
+/// \dep
+/// - cancellationtoken.h
+/// - <cerrno>
+/// - <poll.h>, <sys/socket.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cancellationtoken.h"
+
+#include <cerrno>
+
+#if defined(Q_OS_UNIX)
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+
+namespace Anansi {
+
+
+	CancellationToken::CancellationToken(qintptr socketDescriptor)
+	: m_socketDescriptor(socketDescriptor),
+	  m_cancelled(false),
+	  m_requestReceived(false) {
+	}
+
+
+#if defined(Q_OS_UNIX)
+
+
+	short CancellationToken::pollEvents() const noexcept {
+		// POLLHUP, POLLERR and POLLNVAL are always reported
+#if defined(POLLRDHUP)
+		return static_cast<short>(m_requestReceived ? POLLRDHUP : 0);
+#else
+		return 0;
+#endif
+	}
+
+
+	bool CancellationToken::checkPollResult(short revents) noexcept {
+		static constexpr const short DisconnectedEvents = POLLHUP | POLLERR | POLLNVAL;
+
+		if(0 != (revents & DisconnectedEvents)) {
+			m_cancelled = true;
+		}
+#if defined(POLLRDHUP)
+		else if(m_requestReceived && 0 != (revents & POLLRDHUP)) {
+			m_cancelled = true;
+		}
+#endif
+
+		return m_cancelled;
+	}
+
+
+	bool CancellationToken::isCancelled() {
+		if(m_cancelled || -1 == m_socketDescriptor) {
+			return m_cancelled;
+		}
+
+#if defined(POLLRDHUP)
+		pollfd pfd = {static_cast<int>(m_socketDescriptor), pollEvents(), 0};
+#else
+		pollfd pfd = {static_cast<int>(m_socketDescriptor), static_cast<short>(m_requestReceived ? POLLIN : 0), 0};
+#endif
+		int ready;
+
+		do {
+			ready = ::poll(&pfd, 1, 0);
+		} while(-1 == ready && EINTR == errno);
+
+		if(1 != ready) {
+			return m_cancelled;
+		}
+
+#if !defined(POLLRDHUP)
+		if(m_requestReceived && 0 != (pfd.revents & POLLIN)) {
+			char byte;
+			ssize_t peeked;
+
+			do {
+				peeked = ::recv(static_cast<int>(m_socketDescriptor), &byte, 1, MSG_PEEK);
+			} while(-1 == peeked && EINTR == errno);
+
+			if(0 == peeked) {
+				m_cancelled = true;
+			}
+		}
+#endif
+
+		return checkPollResult(pfd.revents);
+	}
+
+
+#else
+
+
+	short CancellationToken::pollEvents() const noexcept {
+		return 0;
+	}
+
+
+	bool CancellationToken::checkPollResult(short) noexcept {
+		return m_cancelled;
+	}
+
+
+	bool CancellationToken::isCancelled() {
+		// without poll() the only signal is a failed write, which cancels explicitly
+		return m_cancelled;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cancellationtoken.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CancellationToken class for Anansi.
+///
+/// \dep
+/// - <atomic>
+/// - <QtGlobal>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CANCELLATIONTOKEN_H
+#define ANANSI_CANCELLATIONTOKEN_H
+
+#include <atomic>
+
+#include <QtGlobal>
+
+namespace Anansi {
+
+	// tells long-running response work that the client it is for has gone away. the
+	// token is cancelled explicitly (e.g. on a write error) or when the client's socket
+	// is found to have been hung up or to be in error. once the whole request has been
+	// received, the client closing its end of the connection also cancels: the
+	// connection is not kept alive, so the client has nothing more to send
+	class CancellationToken final {
+	public:
+		// how often blocking waits that can't watch the socket directly should check
+		static constexpr const int CheckInterval = 250;
+
+		explicit CancellationToken(qintptr socketDescriptor = -1);
+		CancellationToken(const CancellationToken &) = delete;
+		CancellationToken(CancellationToken &&) = delete;
+		void operator=(const CancellationToken &) = delete;
+		void operator=(CancellationToken &&) = delete;
+
+		// polls the socket if the token has not already been cancelled. this is a system
+		// call, so hot paths should use wasCancelled() and only poll when they would block
+		bool isCancelled();
+
+		// the request, body included, has been read from the socket
+		inline void requestReceived() noexcept {
+			m_requestReceived = true;
+		}
+
+		// the current state, without checking the socket
+		inline bool wasCancelled() const noexcept {
+			return m_cancelled;
+		}
+
+		inline void cancel() noexcept {
+			m_cancelled = true;
+		}
+
+		// for including in a caller's own poll() set, along with pollEvents(); -1 if there
+		// is no socket to watch
+		inline qintptr socketDescriptor() const noexcept {
+			return m_socketDescriptor;
+		}
+
+		short pollEvents() const noexcept;
+
+		// whether revents from a poll() including socketDescriptor() indicate disconnection;
+		// cancels the token if so
+		bool checkPollResult(short revents) noexcept;
+
+	private:
+		qintptr m_socketDescriptor;
+		std::atomic<bool> m_cancelled;
+		bool m_requestReceived;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CANCELLATIONTOKEN_H
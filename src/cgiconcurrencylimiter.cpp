@@ -0,0 +1,236 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiconcurrencylimiter.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CgiConcurrencyLimiter class for Anansi.
+///
+/// Waiting requests are admitted in arrival order. A waiter whose script is at its
+/// own limit does not hold up waiters for other scripts behind it, so one busy
+/// script can't starve the rest while global capacity remains.
+///
+/// \dep
+/// - cgiconcurrencylimiter.h
+/// - <chrono>
+/// - <algorithm>
+/// - cancellationtoken.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cgiconcurrencylimiter.h"
+
+#include <chrono>
+#include <algorithm>
+
+#include "cancellationtoken.h"
+
+
+namespace Anansi {
+
+
+	CgiConcurrencyLimiter::Slot::Slot(CgiConcurrencyLimiter * limiter, QString script)
+	: m_limiter(limiter),
+	  m_script(std::move(script)) {
+	}
+
+
+	CgiConcurrencyLimiter::Slot::Slot(Slot && other) noexcept
+	: m_limiter(other.m_limiter),
+	  m_script(std::move(other.m_script)) {
+		other.m_limiter = nullptr;
+	}
+
+
+	CgiConcurrencyLimiter::Slot & CgiConcurrencyLimiter::Slot::operator=(Slot && other) noexcept {
+		release();
+		m_limiter = other.m_limiter;
+		m_script = std::move(other.m_script);
+		other.m_limiter = nullptr;
+		return *this;
+	}
+
+
+	CgiConcurrencyLimiter::Slot::~Slot() {
+		release();
+	}
+
+
+	void CgiConcurrencyLimiter::Slot::release() {
+		if(m_limiter) {
+			m_limiter->release(m_script);
+		}
+
+		m_limiter = nullptr;
+	}
+
+
+	CgiConcurrencyLimiter & CgiConcurrencyLimiter::instance() {
+		static CgiConcurrencyLimiter limiter;
+		return limiter;
+	}
+
+
+	bool CgiConcurrencyLimiter::canAdmit(const QString & script, int perScriptLimit) const {
+		if(0 < m_globalLimit && m_globalLimit <= m_statistics.running) {
+			return false;
+		}
+
+		if(0 >= perScriptLimit) {
+			return true;
+		}
+
+		const auto running = m_running.find(script);
+		return running == m_running.cend() || running->second < perScriptLimit;
+	}
+
+
+	void CgiConcurrencyLimiter::admit(const QString & script) {
+		++m_running[script];
+		++m_statistics.running;
+		++m_statistics.admitted;
+	}
+
+
+	void CgiConcurrencyLimiter::admitWaiters() {
+		bool admittedAny = false;
+		auto waiter = m_queue.begin();
+
+		while(waiter != m_queue.end() && (0 >= m_globalLimit || m_statistics.running < m_globalLimit)) {
+			if(!canAdmit((*waiter)->script, (*waiter)->perScriptLimit)) {
+				++waiter;
+				continue;
+			}
+
+			admit((*waiter)->script);
+			(*waiter)->admitted = true;
+			waiter = m_queue.erase(waiter);
+			admittedAny = true;
+		}
+
+		if(admittedAny) {
+			m_statistics.queued = static_cast<int>(m_queue.size());
+			m_admitted.notify_all();
+		}
+	}
+
+
+	CgiConcurrencyLimiter::Slot CgiConcurrencyLimiter::acquire(const QString & script, const Limits & limits, CancellationToken * cancellation) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_globalLimit = limits.global;
+
+		// requests already waiting go first
+		if(m_queue.empty() && canAdmit(script, limits.perScript)) {
+			admit(script);
+			return {this, script};
+		}
+
+		if(limits.queueLength <= static_cast<int>(m_queue.size())) {
+			++m_statistics.rejected;
+			return {};
+		}
+
+		Waiter waiter = {script, limits.perScript, false};
+		m_queue.push_back(&waiter);
+		m_statistics.queued = static_cast<int>(m_queue.size());
+		m_statistics.peakQueued = std::max(m_statistics.peakQueued, m_statistics.queued);
+		++m_statistics.waited;
+
+		// the limits may have been raised since the queue was last looked at
+		admitWaiters();
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto deadline = start + std::chrono::milliseconds(limits.queueTimeout);
+
+		bool cancelled = false;
+
+		while(!waiter.admitted) {
+			const auto now = std::chrono::steady_clock::now();
+
+			if(deadline <= now) {
+				break;
+			}
+
+			if(cancellation) {
+				// checking the client's socket is a system call, so don't hold up everyone
+				// else while it's done
+				lock.unlock();
+				cancelled = cancellation->isCancelled();
+				lock.lock();
+
+				if(cancelled) {
+					break;
+				}
+			}
+
+			// wake periodically to notice a client that has given up waiting
+			m_admitted.wait_until(lock, std::min(deadline, now + std::chrono::milliseconds(CancellationToken::CheckInterval)), [&waiter]() {
+				return waiter.admitted;
+			});
+		}
+
+		const auto waitTime = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+		if(!waiter.admitted) {
+			m_queue.remove(&waiter);
+			m_statistics.queued = static_cast<int>(m_queue.size());
+
+			if(cancelled) {
+				++m_statistics.cancelled;
+			}
+			else {
+				++m_statistics.timedOut;
+			}
+
+			return {};
+		}
+
+		m_statistics.totalWaitTime += static_cast<uint64_t>(waitTime);
+		m_statistics.maxWaitTime = std::max(m_statistics.maxWaitTime, waitTime);
+		return {this, script};
+	}
+
+
+	void CgiConcurrencyLimiter::release(const QString & script) {
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if(const auto running = m_running.find(script); running != m_running.end()) {
+			if(1 >= running->second) {
+				m_running.erase(running);
+			}
+			else {
+				--running->second;
+			}
+		}
+
+		--m_statistics.running;
+		admitWaiters();
+	}
+
+
+	CgiConcurrencyLimiter::Statistics CgiConcurrencyLimiter::statistics() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_statistics;
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiconcurrencylimiter.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CgiConcurrencyLimiter class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <mutex>
+/// - <condition_variable>
+/// - <list>
+/// - <unordered_map>
+/// - <QString>
+/// - qtstdhash.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CGICONCURRENCYLIMITER_H
+#define ANANSI_CGICONCURRENCYLIMITER_H
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <unordered_map>
+
+#include <QString>
+
+#include "qtstdhash.h"
+
+namespace Anansi {
+
+	class CancellationToken;
+
+	// bounds how many CGI processes run at once, both in total and for each script.
+	// requests over the limit wait their turn in a bounded FIFO queue
+	class CgiConcurrencyLimiter final {
+	public:
+		// a global or per-script limit of 0 means unlimited. a queue length of 0 means
+		// there is no queue: requests over the limits are turned away straight away
+		struct Limits {
+			int global = 0;
+			int perScript = 0;
+			int queueLength = 0;
+			int queueTimeout = 0;
+		};
+
+		struct Statistics {
+			int running = 0;
+			int queued = 0;
+			int peakQueued = 0;
+			uint64_t admitted = 0;
+			uint64_t waited = 0;
+			uint64_t rejected = 0;
+			uint64_t timedOut = 0;
+			// gave up waiting because the client disconnected
+			uint64_t cancelled = 0;
+			// msec, for requests that were admitted after waiting
+			uint64_t totalWaitTime = 0;
+			int maxWaitTime = 0;
+		};
+
+		// permission to run one CGI process; the slot is given up when this is destroyed
+		class Slot final {
+		public:
+			Slot() = default;
+			Slot(const Slot &) = delete;
+			Slot(Slot && other) noexcept;
+			Slot & operator=(const Slot &) = delete;
+			Slot & operator=(Slot && other) noexcept;
+			~Slot();
+
+			inline explicit operator bool() const noexcept {
+				return nullptr != m_limiter;
+			}
+
+		private:
+			friend class CgiConcurrencyLimiter;
+			Slot(CgiConcurrencyLimiter * limiter, QString script);
+			void release();
+
+			CgiConcurrencyLimiter * m_limiter = nullptr;
+			QString m_script;
+		};
+
+		CgiConcurrencyLimiter(const CgiConcurrencyLimiter &) = delete;
+		CgiConcurrencyLimiter(CgiConcurrencyLimiter &&) = delete;
+		void operator=(const CgiConcurrencyLimiter &) = delete;
+		void operator=(CgiConcurrencyLimiter &&) = delete;
+
+		static CgiConcurrencyLimiter & instance();
+
+		// returns an empty slot if the queue is full, the wait times out or the token is
+		// cancelled while waiting
+		Slot acquire(const QString & script, const Limits & limits, CancellationToken * cancellation = nullptr);
+
+		Statistics statistics() const;
+
+	private:
+		struct Waiter {
+			const QString & script;
+			int perScriptLimit;
+			bool admitted;
+		};
+
+		CgiConcurrencyLimiter() = default;
+		bool canAdmit(const QString & script, int perScriptLimit) const;
+		void admit(const QString & script);
+		void admitWaiters();
+		void release(const QString & script);
+
+		mutable std::mutex m_lock;
+		std::condition_variable m_admitted;
+		std::unordered_map<QString, int, Equit::QtHash<QString>> m_running;
+		std::list<Waiter *> m_queue;
+		int m_globalLimit = 0;
+		Statistics m_statistics;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CGICONCURRENCYLIMITER_H
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgienvironment.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CgiEnvironment class for Anansi.
+///
+/// \dep
+/// - cgienvironment.h
+/// - <cstring>
+/// - <QString>
+/// - <QStringBuilder>
+/// - <QCoreApplication>
+/// - <QFileInfo>
+/// - configuration.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cgienvironment.h"
+
+#include <cstring>
+
+#include <QString>
+#include <QStringBuilder>
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#include "configuration.h"
+
+
+namespace Anansi {
+
+
+	static void appendEntryPointers(std::vector<const char *> & out, const QByteArray & block) {
+		const char * entry = block.constData();
+		const char * end = entry + block.size();
+
+		while(entry < end) {
+			out.push_back(entry);
+			entry += std::strlen(entry) + 1;
+		}
+	}
+
+
+	CgiEnvironment::CgiEnvironment(std::shared_ptr<const QByteArray> fixedEntries)
+	: m_fixedEntries(std::move(fixedEntries)) {
+	}
+
+
+	void CgiEnvironment::appendEntry(QByteArray & block, const char * name, const QByteArray & value) {
+		block.append(name);
+		block.append('=');
+		block.append(value);
+		block.append('\0');
+	}
+
+
+	QByteArray CgiEnvironment::fixedEntries(const Configuration & config) {
+		const auto listenAddress = config.listenAddress().toLocal8Bit();
+		const auto port = QByteArray::number(config.port());
+		QByteArray entries;
+		appendEntry(entries, "GATEWAY_INTERFACE", QByteArrayLiteral("CGI/1.1"));
+		appendEntry(entries, "REDIRECT_STATUS", QByteArrayLiteral("1"));  // non-standard, but since 5.3 is required to make PHP happy
+		appendEntry(entries, "SERVER_NAME", listenAddress);
+		appendEntry(entries, "SERVER_ADDR", listenAddress);
+		appendEntry(entries, "SERVER_PORT", port);
+		appendEntry(entries, "DOCUMENT_ROOT", QFileInfo(config.documentRoot()).absoluteFilePath().toLocal8Bit());
+		appendEntry(entries, "SERVER_SOFTWARE", QString(qApp->applicationName() % QStringLiteral(" v") % qApp->applicationVersion()).toLocal8Bit());
+		appendEntry(entries, "SERVER_SIGNATURE", QByteArrayLiteral("AnansiRequestHandler on ") % listenAddress % QByteArrayLiteral(" port ") % port);
+		appendEntry(entries, "SERVER_ADMIN", config.administratorEmail().toLocal8Bit());
+		return entries;
+	}
+
+
+	void CgiEnvironment::add(const char * name, const QByteArray & value) {
+		appendEntry(m_entries, name, value);
+	}
+
+
+	void CgiEnvironment::addHttpHeader(const std::string & name, const std::string & value) {
+		m_entries.reserve(m_entries.size() + static_cast<int>(name.size() + value.size()) + 7);
+		m_entries.append("HTTP_", 5);
+
+		// header names are already lower-case ASCII so this is all the conversion needed
+		for(const auto ch : name) {
+			m_entries.append('-' == ch ? '_' : ('a' <= ch && 'z' >= ch ? static_cast<char>(ch - 'a' + 'A') : ch));
+		}
+
+		m_entries.append('=');
+		m_entries.append(value.data(), static_cast<int>(value.size()));
+		m_entries.append('\0');
+	}
+
+
+	std::vector<const char *> CgiEnvironment::entries() const {
+		std::vector<const char *> ret;
+
+		if(m_fixedEntries) {
+			appendEntryPointers(ret, *m_fixedEntries);
+		}
+
+		appendEntryPointers(ret, m_entries);
+		ret.push_back(nullptr);
+		return ret;
+	}
+
+
+	QStringList CgiEnvironment::toStringList() const {
+		QStringList ret;
+
+		for(const auto * entry : entries()) {
+			if(entry) {
+				ret.push_back(QString::fromLocal8Bit(entry));
+			}
+		}
+
+		return ret;
+	}
+
+
+}  // namespace Anansi
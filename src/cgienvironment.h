@@ -0,0 +1,79 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgienvironment.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CgiEnvironment class for Anansi.
+///
+/// \dep
+/// - <memory>
+/// - <string>
+/// - <vector>
+/// - <QByteArray>
+/// - <QStringList>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CGIENVIRONMENT_H
+#define ANANSI_CGIENVIRONMENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QStringList>
+
+namespace Anansi {
+
+	class Configuration;
+
+	// the environment for a CGI process, held as a block of NUL-terminated NAME=value
+	// entries that can be handed to execve() without conversion. the part that only
+	// depends on the server configuration is shared between requests
+	class CgiEnvironment final {
+	public:
+		CgiEnvironment() = default;
+		explicit CgiEnvironment(std::shared_ptr<const QByteArray> fixedEntries);
+
+		void add(const char * name, const QByteArray & value);
+		void addHttpHeader(const std::string & name, const std::string & value);
+
+		// pointers to each entry, followed by nullptr; valid until the environment is
+		// modified or destroyed
+		std::vector<const char *> entries() const;
+		QStringList toStringList() const;
+
+		static void appendEntry(QByteArray & block, const char * name, const QByteArray & value);
+
+		// the entries that only depend on the configuration
+		static QByteArray fixedEntries(const Configuration &);
+
+	private:
+		std::shared_ptr<const QByteArray> m_fixedEntries;
+		QByteArray m_entries;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CGIENVIRONMENT_H
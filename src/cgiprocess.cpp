@@ -0,0 +1,609 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiprocess.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CgiProcess class for Anansi.
+///
+/// \dep
+/// - cgiprocess.h
+/// - <array>
+/// - <chrono>
+/// - <cstring>
+/// - <QtGlobal>
+/// - <vector>
+/// - logger.h
+/// - cancellationtoken.h
+/// - <sys/wait.h>, <poll.h>, <signal.h>, <unistd.h>, <limits.h>, <fcntl.h>, <spawn.h> (unix only)
+///
+/// On unix, processes are started with posix_spawn() where the C library can change
+/// the child's working directory as a spawn action (glibc 2.29 or later), and with
+/// vfork() otherwise. Either way the server's address space is not copied.
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cgiprocess.h"
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "logger.h"
+#include "cancellationtoken.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <spawn.h>
+
+#if defined(__GLIBC__) && (2 < __GLIBC__ || (2 == __GLIBC__ && 29 <= __GLIBC_MINOR__))
+#define ANANSI_CGIPROCESS_SPAWN_CHDIR
+#endif
+#endif
+
+
+namespace Anansi {
+
+
+	static constexpr const int DefaultReadTimeout = 30000;
+	static constexpr const std::size_t ReadChunkSize = 16384;
+
+	// stderr is only logged, so anything the child writes past this is read and dropped
+	static constexpr const int MaxStderrSize = 65536;
+
+	// stdout is read while the request body is written so that a child that replies as
+	// it reads doesn't block on a full pipe, but only this much is buffered. a child that
+	// writes more than this before it has read all of its input stalls until the write
+	// times out
+	static constexpr const int MaxPendingStdoutSize = 1048576;
+
+
+	CgiProcess::CgiProcess(qint64 pid, int stdinFd, int stdoutFd, int stderrFd)
+	: m_pid(pid),
+	  m_stdinFd(stdinFd),
+	  m_stdoutFd(stdoutFd),
+	  m_stderrFd(stderrFd),
+	  m_readTimeout(DefaultReadTimeout),
+	  m_finished(false),
+	  m_exitCode(0),
+	  m_error(QProcess::UnknownError),
+	  m_cancellation(nullptr) {
+		open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+	}
+
+
+	bool CgiProcess::isSequential() const {
+		return true;
+	}
+
+
+	bool CgiProcess::atEnd() const {
+		return -1 == m_stdoutFd && m_stdout.isEmpty();
+	}
+
+
+	qint64 CgiProcess::bytesAvailable() const {
+		return m_stdout.size() + QIODevice::bytesAvailable();
+	}
+
+
+	bool CgiProcess::canReadLine() const {
+		return m_stdout.contains('\n') || QIODevice::canReadLine();
+	}
+
+
+	QByteArray CgiProcess::readAllStandardError() {
+		QByteArray ret;
+		ret.swap(m_stderr);
+		return ret;
+	}
+
+
+	bool CgiProcess::waitForReadyRead(int msecs) {
+		const auto bufferedSize = m_stdout.size();
+
+		while(bufferedSize == m_stdout.size() && -1 != m_stdoutFd) {
+			if(!readAvailable(msecs)) {
+				return false;
+			}
+		}
+
+		return bufferedSize < m_stdout.size();
+	}
+
+
+	bool CgiProcess::waitForBytesWritten(int) {
+		// writes go straight to the pipe so there is never anything pending
+		return -1 != m_stdinFd;
+	}
+
+
+	qint64 CgiProcess::readData(char * data, qint64 maxSize) {
+		while(m_stdout.isEmpty() && -1 != m_stdoutFd) {
+			if(!readAvailable(m_readTimeout)) {
+				return -1;
+			}
+		}
+
+		const auto size = qMin(maxSize, static_cast<qint64>(m_stdout.size()));
+		std::memcpy(data, m_stdout.constData(), static_cast<std::size_t>(size));
+		m_stdout.remove(0, static_cast<int>(size));
+		return size;
+	}
+
+
+#if defined(Q_OS_UNIX)
+
+
+	static void closeFd(int & fd) {
+		if(-1 != fd) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+
+	static bool makePipe(int fds[2]) {
+#if defined(Q_OS_LINUX)
+		return 0 == ::pipe2(fds, O_CLOEXEC);
+#else
+		if(0 != ::pipe(fds)) {
+			return false;
+		}
+
+		::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+		::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+		return true;
+#endif
+	}
+
+
+	bool CgiProcess::createPipes(int stdinPipe[2], int stdoutPipe[2], int stderrPipe[2]) {
+		if(!makePipe(stdinPipe)) {
+			return false;
+		}
+
+		if(!makePipe(stdoutPipe)) {
+			::close(stdinPipe[0]);
+			::close(stdinPipe[1]);
+			return false;
+		}
+
+		if(!makePipe(stderrPipe)) {
+			::close(stdinPipe[0]);
+			::close(stdinPipe[1]);
+			::close(stdoutPipe[0]);
+			::close(stdoutPipe[1]);
+			return false;
+		}
+
+		return true;
+	}
+
+
+	std::unique_ptr<CgiProcess> CgiProcess::start(const QString & program, const QStringList & args, const CgiEnvironment & env, const QString & workingDir) {
+		// everything the child needs is prepared up front: after vfork() it must not allocate
+		std::vector<QByteArray> argStrings;
+		argStrings.reserve(static_cast<std::size_t>(args.size()) + 1);
+		argStrings.push_back(program.toLocal8Bit());
+
+		for(const auto & arg : args) {
+			argStrings.push_back(arg.toLocal8Bit());
+		}
+
+		std::vector<char *> argv;
+		argv.reserve(argStrings.size() + 1);
+
+		for(auto & arg : argStrings) {
+			argv.push_back(arg.data());
+		}
+
+		argv.push_back(nullptr);
+		const auto envp = env.entries();
+		const auto workingDirPath = workingDir.toLocal8Bit();
+		int stdinPipe[2];
+		int stdoutPipe[2];
+		int stderrPipe[2];
+
+		if(!createPipes(stdinPipe, stdoutPipe, stderrPipe)) {
+			anansiLog(Error, "failed to create pipes for CGI process: " << std::strerror(errno));
+			return nullptr;
+		}
+
+		pid_t pid = -1;
+		int result = 0;
+
+#if defined(ANANSI_CGIPROCESS_SPAWN_CHDIR)
+		posix_spawn_file_actions_t actions;
+		posix_spawnattr_t attributes;
+		sigset_t noSignals;
+		sigset_t defaultSignals;
+		::sigemptyset(&noSignals);
+		::sigemptyset(&defaultSignals);
+		::sigaddset(&defaultSignals, SIGPIPE);
+		::posix_spawn_file_actions_init(&actions);
+		::posix_spawn_file_actions_adddup2(&actions, stdinPipe[0], STDIN_FILENO);
+		::posix_spawn_file_actions_adddup2(&actions, stdoutPipe[1], STDOUT_FILENO);
+		::posix_spawn_file_actions_adddup2(&actions, stderrPipe[1], STDERR_FILENO);
+
+		if(!workingDirPath.isEmpty()) {
+			::posix_spawn_file_actions_addchdir_np(&actions, workingDirPath.constData());
+		}
+
+		::posix_spawnattr_init(&attributes);
+		::posix_spawnattr_setsigmask(&attributes, &noSignals);
+		::posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+		::posix_spawnattr_setpgroup(&attributes, 0);
+		::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+		result = ::posix_spawn(&pid, argv[0], &actions, &attributes, argv.data(), const_cast<char * const *>(envp.data()));
+		::posix_spawnattr_destroy(&attributes);
+		::posix_spawn_file_actions_destroy(&actions);
+#else
+		// no handler of ours may run in the child while it shares our memory, so everything
+		// is blocked across vfork() and the child's handlers are reset before it unblocks
+		sigset_t allSignals;
+		sigset_t savedSignals;
+		::sigfillset(&allSignals);
+		::pthread_sigmask(SIG_SETMASK, &allSignals, &savedSignals);
+		pid = ::vfork();
+
+		if(0 == pid) {
+			// the child shares our memory until it execs, so only async-signal-safe calls here
+			struct sigaction action;
+
+			for(int sig = 1; sig < NSIG; ++sig) {
+				if(0 == ::sigaction(sig, nullptr, &action) && SIG_IGN != action.sa_handler && SIG_DFL != action.sa_handler) {
+					action.sa_handler = SIG_DFL;
+					action.sa_flags = 0;
+					::sigemptyset(&action.sa_mask);
+					::sigaction(sig, &action, nullptr);
+				}
+			}
+
+			// ignored dispositions survive execve(), and the script should get the default
+			::signal(SIGPIPE, SIG_DFL);
+			::setpgid(0, 0);
+
+			if(-1 == ::dup2(stdinPipe[0], STDIN_FILENO) || -1 == ::dup2(stdoutPipe[1], STDOUT_FILENO) || -1 == ::dup2(stderrPipe[1], STDERR_FILENO) || (!workingDirPath.isEmpty() && -1 == ::chdir(workingDirPath.constData()))) {
+				::_exit(127);
+			}
+
+			::pthread_sigmask(SIG_SETMASK, &savedSignals, nullptr);
+			::execve(argv[0], argv.data(), const_cast<char * const *>(envp.data()));
+			::_exit(127);
+		}
+
+		if(-1 == pid) {
+			result = errno;
+		}
+
+		::pthread_sigmask(SIG_SETMASK, &savedSignals, nullptr);
+#endif
+
+		// the child has its own copies of these
+		::close(stdinPipe[0]);
+		::close(stdoutPipe[1]);
+		::close(stderrPipe[1]);
+
+		if(0 != result) {
+			anansiLog(Error, "failed to start CGI process \"" << argv[0] << "\": " << std::strerror(result));
+			::close(stdinPipe[1]);
+			::close(stdoutPipe[0]);
+			::close(stderrPipe[0]);
+			return nullptr;
+		}
+
+		return std::make_unique<CgiProcess>(pid, stdinPipe[1], stdoutPipe[0], stderrPipe[0]);
+	}
+
+
+	CgiProcess::~CgiProcess() {
+		closeFd(m_stdinFd);
+		closeFd(m_stdoutFd);
+		closeFd(m_stderrFd);
+
+		if(!m_finished) {
+			kill();
+			reap(true);
+		}
+	}
+
+
+	void CgiProcess::closeWriteChannel() {
+		closeFd(m_stdinFd);
+	}
+
+
+	void CgiProcess::kill() {
+		if(!m_finished) {
+			// the child leads its own process group, so this catches anything it has started.
+			// if the group can't be signalled, at least kill the child so that reaping it
+			// doesn't block
+			if(-1 == ::kill(-static_cast<pid_t>(m_pid), SIGKILL)) {
+				::kill(static_cast<pid_t>(m_pid), SIGKILL);
+			}
+		}
+	}
+
+
+	bool CgiProcess::clientDisconnected(short revents) {
+		if(!m_cancellation || !m_cancellation->checkPollResult(revents)) {
+			return false;
+		}
+
+		setErrorString(QStringLiteral("client has disconnected"));
+		return true;
+	}
+
+
+	bool CgiProcess::readAvailable(int msecs, bool readStdout) {
+		std::array<pollfd, 3> pfds = {{{readStdout ? m_stdoutFd : -1, POLLIN, 0}, {m_stderrFd, POLLIN, 0}, {cancellationFd(), cancellationEvents(), 0}}};
+
+		if(-1 == pfds[0].fd && -1 == m_stderrFd) {
+			return false;
+		}
+
+		int ready;
+
+		do {
+			// poll() ignores entries with negative fds
+			ready = ::poll(pfds.data(), pfds.size(), msecs);
+		} while(-1 == ready && EINTR == errno);
+
+		if(clientDisconnected(pfds[2].revents)) {
+			return false;
+		}
+
+		if(0 == ready) {
+			m_error = QProcess::Timedout;
+			setErrorString(QStringLiteral("timed out reading from CGI process"));
+			return false;
+		}
+
+		if(-1 == ready) {
+			m_error = QProcess::ReadError;
+			setErrorString(QString::fromLocal8Bit(std::strerror(errno)));
+			return false;
+		}
+
+		std::array<char, ReadChunkSize> buffer;
+
+		for(auto pfd = pfds.begin(); pfd != pfds.begin() + 2; ++pfd) {
+			if(-1 == pfd->fd || 0 == pfd->revents) {
+				continue;
+			}
+
+			const auto bytesRead = ::read(pfd->fd, buffer.data(), buffer.size());
+
+			if(0 < bytesRead) {
+				if(pfd->fd == m_stdoutFd) {
+					m_stdout.append(buffer.data(), static_cast<int>(bytesRead));
+				}
+				else if(MaxStderrSize > m_stderr.size()) {
+					m_stderr.append(buffer.data(), qMin(static_cast<int>(bytesRead), MaxStderrSize - m_stderr.size()));
+				}
+			}
+			else if(0 == bytesRead || EINTR != errno) {
+				closeFd(pfd->fd == m_stdoutFd ? m_stdoutFd : m_stderrFd);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool CgiProcess::reap(bool block) {
+		if(m_finished) {
+			return true;
+		}
+
+		int status;
+		pid_t result;
+
+		do {
+			result = ::waitpid(static_cast<pid_t>(m_pid), &status, block ? 0 : WNOHANG);
+		} while(-1 == result && EINTR == errno);
+
+		if(0 == result) {
+			return false;
+		}
+
+		m_finished = true;
+
+		if(-1 == result) {
+			// already reaped elsewhere, exit status is lost
+			m_exitCode = -1;
+		}
+		else if(WIFEXITED(status)) {
+			m_exitCode = WEXITSTATUS(status);
+		}
+		else {
+			m_exitCode = -1;
+			m_error = QProcess::Crashed;
+		}
+
+		return true;
+	}
+
+
+	bool CgiProcess::waitForFinished(int msecs) {
+		using Clock = std::chrono::steady_clock;
+		const auto deadline = Clock::now() + std::chrono::milliseconds(msecs);
+
+		const auto remaining = [&deadline]() -> int {
+			return static_cast<int>(qMax<qint64>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count()));
+		};
+
+		// drain both pipes so that the child can't block on a full one
+		while(-1 != m_stdoutFd || -1 != m_stderrFd) {
+			if(!readAvailable(remaining())) {
+				return false;
+			}
+		}
+
+		while(!reap(false)) {
+			if(m_cancellation && m_cancellation->isCancelled()) {
+				setErrorString(QStringLiteral("client has disconnected"));
+				return false;
+			}
+
+			if(0 == remaining()) {
+				m_error = QProcess::Timedout;
+				setErrorString(QStringLiteral("timed out waiting for CGI process to exit"));
+				return false;
+			}
+
+			::poll(nullptr, 0, 10);
+		}
+
+		return true;
+	}
+
+
+	qint64 CgiProcess::writeData(const char * data, qint64 size) {
+		if(-1 == m_stdinFd) {
+			m_error = QProcess::WriteError;
+			setErrorString(QStringLiteral("CGI process write channel is closed"));
+			return -1;
+		}
+
+		qint64 written = 0;
+
+		while(written < size) {
+			// keep reading while waiting for the child to accept input, otherwise a child that
+			// writes before it has consumed all of its input would deadlock on a full pipe
+			const bool readStdout = (MaxPendingStdoutSize > m_stdout.size());
+			std::array<pollfd, 4> pfds = {{{m_stdinFd, POLLOUT, 0}, {readStdout ? m_stdoutFd : -1, POLLIN, 0}, {m_stderrFd, POLLIN, 0}, {cancellationFd(), cancellationEvents(), 0}}};
+			int ready;
+
+			do {
+				ready = ::poll(pfds.data(), pfds.size(), m_readTimeout);
+			} while(-1 == ready && EINTR == errno);
+
+			if(clientDisconnected(pfds[3].revents)) {
+				m_error = QProcess::WriteError;
+				return 0 < written ? written : -1;
+			}
+
+			if(0 == ready) {
+				m_error = QProcess::Timedout;
+				setErrorString(QStringLiteral("timed out writing to CGI process"));
+				return 0 < written ? written : -1;
+			}
+
+			if(-1 == ready) {
+				m_error = QProcess::WriteError;
+				setErrorString(QString::fromLocal8Bit(std::strerror(errno)));
+				return 0 < written ? written : -1;
+			}
+
+			if(0 != pfds[1].revents || 0 != pfds[2].revents) {
+				readAvailable(0, readStdout);
+			}
+
+			if(0 == pfds[0].revents) {
+				continue;
+			}
+
+			// POLLOUT guarantees room for PIPE_BUF bytes, so a write of that size can't block
+			const auto result = ::write(m_stdinFd, data + written, static_cast<std::size_t>(qMin<qint64>(size - written, PIPE_BUF)));
+
+			if(-1 == result) {
+				if(EINTR == errno) {
+					continue;
+				}
+
+				m_error = QProcess::WriteError;
+				setErrorString(QString::fromLocal8Bit(std::strerror(errno)));
+				return 0 < written ? written : -1;
+			}
+
+			written += result;
+		}
+
+		return written;
+	}
+
+
+#else
+
+
+	bool CgiProcess::createPipes(int[2], int[2], int[2]) {
+		return false;
+	}
+
+
+	std::unique_ptr<CgiProcess> CgiProcess::start(const QString &, const QStringList &, const CgiEnvironment &, const QString &) {
+		// callers start a QProcess instead on other platforms
+		return nullptr;
+	}
+
+
+	CgiProcess::~CgiProcess() = default;
+
+
+	void CgiProcess::closeWriteChannel() {
+	}
+
+
+	void CgiProcess::kill() {
+	}
+
+
+	bool CgiProcess::clientDisconnected(short) {
+		return false;
+	}
+
+
+	bool CgiProcess::readAvailable(int, bool) {
+		return false;
+	}
+
+
+	bool CgiProcess::reap(bool) {
+		return true;
+	}
+
+
+	bool CgiProcess::waitForFinished(int) {
+		return false;
+	}
+
+
+	qint64 CgiProcess::writeData(const char *, qint64) {
+		return -1;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
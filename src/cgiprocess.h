@@ -0,0 +1,140 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiprocess.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CgiProcess class for Anansi.
+///
+/// \dep
+/// - <memory>
+/// - <QIODevice>
+/// - <QByteArray>
+/// - <QProcess>
+/// - <QString>
+/// - <QStringList>
+/// - cgienvironment.h
+/// - cancellationtoken.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CGIPROCESS_H
+#define ANANSI_CGIPROCESS_H
+
+#include <memory>
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+#include "cgienvironment.h"
+#include "cancellationtoken.h"
+
+namespace Anansi {
+
+	// a running CGI child process that was not started by QProcess; reading the device
+	// reads the child's stdout, writing writes to its stdin. the API mirrors the parts
+	// of QProcess that the request handler uses
+	class CgiProcess final : public QIODevice {
+	public:
+		// takes ownership of the file descriptors
+		CgiProcess(qint64 pid, int stdinFd, int stdoutFd, int stderrFd);
+		~CgiProcess() override;
+
+		// starts program directly, without a shell, as the leader of a new process group;
+		// returns nullptr if it can't be started
+		static std::unique_ptr<CgiProcess> start(const QString & program, const QStringList & args, const CgiEnvironment & env, const QString & workingDir);
+
+		// creates close-on-exec pipes for a child's standard streams. the child reads from
+		// stdinPipe[0] and writes to stdoutPipe[1] and stderrPipe[1]
+		static bool createPipes(int stdinPipe[2], int stdoutPipe[2], int stderrPipe[2]);
+
+		inline qint64 processId() const noexcept {
+			return m_pid;
+		}
+
+		// timeout for blocking reads of the child's stdout through read()/readLine()
+		inline void setReadTimeout(int msecs) noexcept {
+			m_readTimeout = msecs;
+		}
+
+		// blocking reads and writes give up as soon as the token's client disconnects
+		inline void setCancellationToken(CancellationToken * cancellation) noexcept {
+			m_cancellation = cancellation;
+		}
+
+		bool waitForFinished(int msecs);
+		void closeWriteChannel();
+		void kill();
+
+		inline int exitCode() const noexcept {
+			return m_exitCode;
+		}
+
+		inline QProcess::ProcessError error() const noexcept {
+			return m_error;
+		}
+
+		QByteArray readAllStandardError();
+
+		bool isSequential() const override;
+		bool atEnd() const override;
+		qint64 bytesAvailable() const override;
+		bool canReadLine() const override;
+		bool waitForReadyRead(int msecs) override;
+		bool waitForBytesWritten(int msecs) override;
+
+	protected:
+		qint64 readData(char * data, qint64 maxSize) override;
+		qint64 writeData(const char * data, qint64 size) override;
+
+	private:
+		inline int cancellationFd() const noexcept {
+			return m_cancellation ? static_cast<int>(m_cancellation->socketDescriptor()) : -1;
+		}
+
+		inline short cancellationEvents() const noexcept {
+			return m_cancellation ? m_cancellation->pollEvents() : 0;
+		}
+
+		bool clientDisconnected(short revents);
+		bool readAvailable(int msecs, bool readStdout = true);
+		bool reap(bool block);
+
+		qint64 m_pid;
+		int m_stdinFd;
+		int m_stdoutFd;
+		int m_stderrFd;
+		QByteArray m_stdout;
+		QByteArray m_stderr;
+		int m_readTimeout;
+		bool m_finished;
+		int m_exitCode;
+		QProcess::ProcessError m_error;
+		CancellationToken * m_cancellation;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CGIPROCESS_H
@@ -0,0 +1,427 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiresponsecache.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CgiResponseCache class for Anansi.
+///
+/// Freshness comes from the script's `Cache-Control` (s-maxage, then max-age) or,
+/// failing that, its `Expires` header. Output with a non-200 status, a `Set-Cookie`
+/// header, `Vary: *` or Cache-Control no-store, no-cache or private is never cached.
+/// A `stale-while-revalidate` directive lets an expired entry be served for that
+/// much longer while it is refreshed in the background.
+///
+/// \dep
+/// - cgiresponsecache.h
+/// - <algorithm>
+/// - <QDateTime>
+/// - <QLocale>
+/// - <QList>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cgiresponsecache.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QLocale>
+#include <QList>
+
+
+namespace Anansi {
+
+
+	// no single response may take more than this fraction of the cache
+	static constexpr const int MaxEntryFraction = 8;
+
+
+	CgiResponseCache::Lookup::Lookup(QByteArray output)
+	: m_hit(true),
+	  m_output(std::move(output)) {
+	}
+
+
+	CgiResponseCache::Lookup::Lookup(CgiResponseCache * cache, std::string baseKey, std::string key, HttpHeaders requestHeaders, int maxSize)
+	: m_cache(cache),
+	  m_baseKey(std::move(baseKey)),
+	  m_key(std::move(key)),
+	  m_requestHeaders(std::move(requestHeaders)),
+	  m_maxSize(maxSize) {
+	}
+
+
+	CgiResponseCache::Lookup::Lookup(Lookup && other) noexcept
+	: m_hit(other.m_hit),
+	  m_output(std::move(other.m_output)),
+	  m_cache(other.m_cache),
+	  m_baseKey(std::move(other.m_baseKey)),
+	  m_key(std::move(other.m_key)),
+	  m_requestHeaders(std::move(other.m_requestHeaders)),
+	  m_maxSize(other.m_maxSize) {
+		other.m_cache = nullptr;
+	}
+
+
+	CgiResponseCache::Lookup & CgiResponseCache::Lookup::operator=(Lookup && other) noexcept {
+		abandon();
+		m_hit = other.m_hit;
+		m_output = std::move(other.m_output);
+		m_cache = other.m_cache;
+		m_baseKey = std::move(other.m_baseKey);
+		m_key = std::move(other.m_key);
+		m_requestHeaders = std::move(other.m_requestHeaders);
+		m_maxSize = other.m_maxSize;
+		other.m_cache = nullptr;
+		return *this;
+	}
+
+
+	CgiResponseCache::Lookup::~Lookup() {
+		abandon();
+	}
+
+
+	void CgiResponseCache::Lookup::fill(const QByteArray & output) {
+		if(!m_cache) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_cache->m_lock);
+		m_cache->store(m_baseKey, m_requestHeaders, output);
+		m_cache->finishFill(m_key);
+		m_cache = nullptr;
+	}
+
+
+	void CgiResponseCache::Lookup::abandon() {
+		if(!m_cache) {
+			return;
+		}
+
+		// let a waiting lookup have a go at running the script instead
+		std::lock_guard<std::mutex> lock(m_cache->m_lock);
+		m_cache->finishFill(m_key);
+		m_cache = nullptr;
+	}
+
+
+	CgiResponseCache::CgiResponseCache()
+	: m_capacity(0),
+	  m_stopping(false) {
+	}
+
+
+	CgiResponseCache::~CgiResponseCache() {
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stopping = true;
+		}
+
+		m_wake.notify_one();
+
+		if(m_revalidator.joinable()) {
+			m_revalidator.join();
+		}
+	}
+
+
+	CgiResponseCache & CgiResponseCache::instance() {
+		static CgiResponseCache cache;
+		return cache;
+	}
+
+
+	std::optional<CgiResponseCache::Policy> CgiResponseCache::cachePolicy(const QByteArray & output) {
+		auto headerEnd = output.indexOf("\r\n\r\n");
+
+		if(-1 == headerEnd) {
+			headerEnd = output.indexOf("\n\n");
+
+			if(-1 == headerEnd) {
+				return {};
+			}
+		}
+
+		Policy policy;
+		std::optional<int> maxAge;
+		std::optional<int> sharedMaxAge;
+		std::optional<qint64> expires;
+
+		for(const auto & line : output.left(headerEnd).split('\n')) {
+			const auto colon = line.indexOf(':');
+
+			if(0 >= colon) {
+				continue;
+			}
+
+			const auto name = line.left(colon).trimmed().toLower();
+			const auto value = line.mid(colon + 1).trimmed();
+
+			if("status" == name) {
+				if(!value.startsWith("200")) {
+					return {};
+				}
+			}
+			else if("set-cookie" == name) {
+				// never hand one client's cookies to another
+				return {};
+			}
+			else if("cache-control" == name) {
+				for(const auto & rawDirective : value.split(',')) {
+					const auto directive = rawDirective.trimmed().toLower();
+					bool ok;
+
+					if("no-store" == directive || "private" == directive || directive.startsWith("no-cache")) {
+						return {};
+					}
+					else if(directive.startsWith("s-maxage=")) {
+						if(const auto seconds = directive.mid(9).toInt(&ok); ok) {
+							sharedMaxAge = seconds;
+						}
+					}
+					else if(directive.startsWith("max-age=")) {
+						if(const auto seconds = directive.mid(8).toInt(&ok); ok) {
+							maxAge = seconds;
+						}
+					}
+					else if(directive.startsWith("stale-while-revalidate=")) {
+						if(const auto seconds = directive.mid(23).toInt(&ok); ok && 0 < seconds) {
+							policy.staleFor = std::chrono::seconds(seconds);
+						}
+					}
+				}
+			}
+			else if("expires" == name) {
+				auto expiry = QLocale::c().toDateTime(QString::fromLatin1(value), QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT'"));
+
+				// an invalid date means "already expired"
+				if(!expiry.isValid()) {
+					expires = 0;
+				}
+				else {
+					expiry.setTimeSpec(Qt::UTC);
+					expires = QDateTime::currentDateTimeUtc().secsTo(expiry);
+				}
+			}
+			else if("vary" == name) {
+				for(const auto & rawHeader : value.split(',')) {
+					const auto header = rawHeader.trimmed().toLower();
+
+					if("*" == header) {
+						return {};
+					}
+
+					if(!header.isEmpty()) {
+						policy.vary.push_back(header.toStdString());
+					}
+				}
+			}
+		}
+
+		if(sharedMaxAge) {
+			policy.freshFor = std::chrono::seconds(*sharedMaxAge);
+		}
+		else if(maxAge) {
+			policy.freshFor = std::chrono::seconds(*maxAge);
+		}
+		else if(expires) {
+			policy.freshFor = std::chrono::seconds(*expires);
+		}
+
+		if(0 >= policy.freshFor.count()) {
+			return {};
+		}
+
+		// the order the script lists them in doesn't change which response applies
+		std::sort(policy.vary.begin(), policy.vary.end());
+		return policy;
+	}
+
+
+	std::string CgiResponseCache::variantKey(const std::string & baseKey, const std::vector<std::string> & vary, const HttpHeaders & requestHeaders) {
+		auto key = baseKey;
+
+		for(const auto & header : vary) {
+			key.push_back('\n');
+			key.append(header);
+			key.push_back(':');
+
+			if(const auto value = requestHeaders.find(header); value != requestHeaders.cend()) {
+				key.append(value->second);
+			}
+		}
+
+		return key;
+	}
+
+
+	CgiResponseCache::Lookup CgiResponseCache::lookup(const QString & script, const std::string & queryString, const HttpHeaders & requestHeaders, int capacity, int timeout, Fetch revalidate) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_capacity = capacity;
+		const auto baseKey = script.toStdString() + '\n' + queryString;
+		const auto deadline = Clock::now() + std::chrono::milliseconds(timeout);
+		bool waited = false;
+		std::string key;
+
+		while(true) {
+			// until the script has responded once it isn't known which headers it varies on
+			const auto vary = m_vary.find(baseKey);
+			key = (vary == m_vary.cend() ? baseKey : variantKey(baseKey, vary->second, requestHeaders));
+			const auto entry = m_entries.find(key);
+			const auto now = Clock::now();
+
+			if(entry != m_entries.end()) {
+				if(now < entry->second.freshUntil) {
+					++m_statistics.hits;
+					return Lookup(entry->second.output);
+				}
+
+				if(now < entry->second.staleUntil) {
+					++m_statistics.staleHits;
+
+					if(revalidate && m_revalidating.insert(key).second) {
+						m_revalidations.push_back({baseKey, key, requestHeaders, std::move(revalidate)});
+
+						if(!m_revalidator.joinable()) {
+							m_revalidator = std::thread(&CgiResponseCache::runRevalidations, this);
+						}
+
+						m_wake.notify_one();
+					}
+
+					return Lookup(entry->second.output);
+				}
+
+				remove(entry);
+			}
+
+			if(0 == m_filling.count(key)) {
+				break;
+			}
+
+			// another request is already running the script for this response
+			if(!waited) {
+				++m_statistics.coalesced;
+				waited = true;
+			}
+
+			if(std::cv_status::timeout == m_filled.wait_until(lock, deadline)) {
+				// run the script without the cache rather than keep the client waiting
+				return {};
+			}
+		}
+
+		++m_statistics.misses;
+		m_filling.insert(key);
+		return {this, baseKey, key, requestHeaders, capacity / MaxEntryFraction};
+	}
+
+
+	void CgiResponseCache::store(const std::string & baseKey, const HttpHeaders & requestHeaders, const QByteArray & output) {
+		const auto policy = cachePolicy(output);
+
+		if(!policy || m_capacity / MaxEntryFraction < output.size()) {
+			return;
+		}
+
+		m_vary[baseKey] = policy->vary;
+		const auto key = variantKey(baseKey, policy->vary, requestHeaders);
+
+		if(const auto existing = m_entries.find(key); existing != m_entries.end()) {
+			remove(existing);
+		}
+
+		// oldest entries make way first
+		while(!m_age.empty() && m_capacity < m_statistics.size + output.size()) {
+			remove(m_entries.find(m_age.front()));
+		}
+
+		const auto now = Clock::now();
+		m_age.push_back(key);
+		m_entries.emplace(key, Entry{output, now + policy->freshFor, now + policy->freshFor + policy->staleFor, std::prev(m_age.end())});
+		m_statistics.size += output.size();
+		m_statistics.entries = static_cast<int>(m_entries.size());
+	}
+
+
+	void CgiResponseCache::remove(std::unordered_map<std::string, Entry>::iterator entry) {
+		m_statistics.size -= entry->second.output.size();
+		m_age.erase(entry->second.age);
+		m_entries.erase(entry);
+		m_statistics.entries = static_cast<int>(m_entries.size());
+	}
+
+
+	void CgiResponseCache::finishFill(const std::string & key) {
+		m_filling.erase(key);
+		m_filled.notify_all();
+	}
+
+
+	void CgiResponseCache::runRevalidations() {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		// one at a time - revalidation is never urgent since the stale entry is being served
+		while(true) {
+			m_wake.wait(lock, [this]() {
+				return m_stopping || !m_revalidations.empty();
+			});
+
+			if(m_stopping) {
+				return;
+			}
+
+			auto revalidation = std::move(m_revalidations.front());
+			m_revalidations.pop_front();
+			++m_statistics.revalidations;
+			lock.unlock();
+			const auto output = revalidation.fetch();
+			lock.lock();
+
+			if(output) {
+				store(revalidation.baseKey, revalidation.requestHeaders, *output);
+			}
+
+			m_revalidating.erase(revalidation.key);
+		}
+	}
+
+
+	CgiResponseCache::Statistics CgiResponseCache::statistics() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_statistics;
+	}
+
+
+	void CgiResponseCache::clear() {
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_entries.clear();
+		m_age.clear();
+		m_vary.clear();
+		m_statistics.entries = 0;
+		m_statistics.size = 0;
+	}
+
+
+}  // namespace Anansi
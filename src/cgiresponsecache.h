@@ -0,0 +1,205 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiresponsecache.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CgiResponseCache class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <chrono>
+/// - <functional>
+/// - <list>
+/// - <mutex>
+/// - <condition_variable>
+/// - <optional>
+/// - <string>
+/// - <thread>
+/// - <unordered_map>
+/// - <unordered_set>
+/// - <deque>
+/// - <vector>
+/// - <QByteArray>
+/// - <QString>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CGIRESPONSECACHE_H
+#define ANANSI_CGIRESPONSECACHE_H
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "types.h"
+
+namespace Anansi {
+
+	// shared cache of complete CGI output (headers and body) for GET requests. only
+	// output that the script marks as cacheable with Cache-Control or Expires is kept.
+	// entries are keyed on the script, the query string and the request headers named
+	// in the script's Vary header
+	class CgiResponseCache final {
+	public:
+		// runs the script again and provides its complete output, for refreshing a stale
+		// entry in the background
+		using Fetch = std::function<std::optional<QByteArray>()>;
+
+		struct Statistics {
+			uint64_t hits = 0;
+			uint64_t staleHits = 0;
+			uint64_t misses = 0;
+			uint64_t coalesced = 0;
+			uint64_t revalidations = 0;
+			int entries = 0;
+			int size = 0;
+		};
+
+		// the outcome of a lookup. on a hit, output() is the cached CGI output. on a miss,
+		// the caller may be made responsible for providing the output with fill() - other
+		// lookups for the same response wait for it rather than all running the script
+		class Lookup final {
+		public:
+			Lookup() = default;
+			Lookup(const Lookup &) = delete;
+			Lookup(Lookup && other) noexcept;
+			Lookup & operator=(const Lookup &) = delete;
+			Lookup & operator=(Lookup && other) noexcept;
+			~Lookup();
+
+			inline bool isHit() const noexcept {
+				return m_hit;
+			}
+
+			inline const QByteArray & output() const noexcept {
+				return m_output;
+			}
+
+			inline bool mustFill() const noexcept {
+				return nullptr != m_cache;
+			}
+
+			// larger output can't be cached
+			inline int maxSize() const noexcept {
+				return m_maxSize;
+			}
+
+			// stores the output if it is cacheable; either way lookups waiting on this one
+			// are released
+			void fill(const QByteArray & output);
+
+		private:
+			friend class CgiResponseCache;
+			explicit Lookup(QByteArray output);
+			Lookup(CgiResponseCache * cache, std::string baseKey, std::string key, HttpHeaders requestHeaders, int maxSize);
+			void abandon();
+
+			bool m_hit = false;
+			QByteArray m_output;
+			CgiResponseCache * m_cache = nullptr;
+			std::string m_baseKey;
+			std::string m_key;
+			HttpHeaders m_requestHeaders;
+			int m_maxSize = 0;
+		};
+
+		CgiResponseCache(const CgiResponseCache &) = delete;
+		CgiResponseCache(CgiResponseCache &&) = delete;
+		void operator=(const CgiResponseCache &) = delete;
+		void operator=(CgiResponseCache &&) = delete;
+		~CgiResponseCache();
+
+		static CgiResponseCache & instance();
+
+		// capacity is the most output to hold in total, in bytes. a lookup that finds
+		// another request already running the script waits up to timeout msec for it
+		Lookup lookup(const QString & script, const std::string & queryString, const HttpHeaders & requestHeaders, int capacity, int timeout, Fetch revalidate);
+
+		Statistics statistics() const;
+
+		void clear();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Entry {
+			QByteArray output;
+			Clock::time_point freshUntil;
+			Clock::time_point staleUntil;
+			std::list<std::string>::iterator age;
+		};
+
+		struct Policy {
+			std::chrono::seconds freshFor{0};
+			std::chrono::seconds staleFor{0};
+			std::vector<std::string> vary;
+		};
+
+		struct Revalidation {
+			std::string baseKey;
+			std::string key;
+			HttpHeaders requestHeaders;
+			Fetch fetch;
+		};
+
+		CgiResponseCache();
+
+		static std::optional<Policy> cachePolicy(const QByteArray & output);
+		static std::string variantKey(const std::string & baseKey, const std::vector<std::string> & vary, const HttpHeaders & requestHeaders);
+		void store(const std::string & baseKey, const HttpHeaders & requestHeaders, const QByteArray & output);
+		void remove(std::unordered_map<std::string, Entry>::iterator entry);
+		void finishFill(const std::string & key);
+		void runRevalidations();
+
+		mutable std::mutex m_lock;
+		std::condition_variable m_filled;
+		std::condition_variable m_wake;
+		std::unordered_map<std::string, std::vector<std::string>> m_vary;
+		std::unordered_map<std::string, Entry> m_entries;
+		std::list<std::string> m_age;
+		std::unordered_set<std::string> m_filling;
+		std::unordered_set<std::string> m_revalidating;
+		std::deque<Revalidation> m_revalidations;
+		int m_capacity;
+		bool m_stopping;
+		Statistics m_statistics;
+		std::thread m_revalidator;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CGIRESPONSECACHE_H
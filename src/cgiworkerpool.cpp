@@ -0,0 +1,507 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiworkerpool.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the CgiWorkerPool class for Anansi.
+///
+/// Helpers are forked from a multi-threaded process, so between fork() and execve()
+/// a helper must only make async-signal-safe calls. In particular it must not
+/// allocate: launch requests are parsed in place into static buffers, which each
+/// helper gets its own copy of when it is forked.
+///
+/// \dep
+/// - cgiworkerpool.h
+/// - <cstdint>
+/// - <cstring>
+/// - <QByteArray>
+/// - logger.h
+/// - <sys/socket.h>, <sys/wait.h>, <sys/resource.h>, <signal.h>, <fcntl.h>, <unistd.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "cgiworkerpool.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <QByteArray>
+
+#include "logger.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace Anansi {
+
+
+	static constexpr const std::chrono::seconds MaintenanceInterval(1);
+	static constexpr const std::size_t MaxLaunchRequestSize = 131072;
+	static constexpr const std::size_t MaxLaunchArguments = 64;
+	static constexpr const std::size_t MaxLaunchEnvironment = 512;
+	static constexpr const int MaxInheritedFd = 65536;
+
+
+	CgiWorkerPool::CgiWorkerPool()
+	: m_stopping(false),
+	  m_changed(false) {
+	}
+
+
+	CgiWorkerPool::~CgiWorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stopping = true;
+		}
+
+		m_wake.notify_one();
+
+		if(m_maintainer.joinable()) {
+			m_maintainer.join();
+		}
+
+		for(auto & pool : m_pools) {
+			for(const auto & worker : pool.second.idle) {
+				destroyWorker(worker);
+			}
+		}
+	}
+
+
+	CgiWorkerPool & CgiWorkerPool::instance() {
+		static CgiWorkerPool pool;
+		return pool;
+	}
+
+
+	void CgiWorkerPool::maintain() {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		while(!m_stopping) {
+			std::vector<Worker> surplus;
+			std::vector<QString> deficit;
+			const auto now = Clock::now();
+			m_changed = false;
+
+			for(auto & entry : m_pools) {
+				auto & pool = entry.second;
+
+				// shrink back towards the minimum one helper at a time while unused
+				if(pool.target > pool.limits.minimum && now - pool.lastUsed > pool.idleTimeout) {
+					--pool.target;
+					pool.lastUsed = now;
+				}
+
+				while(static_cast<int>(pool.idle.size()) > pool.target) {
+					surplus.push_back(pool.idle.back());
+					pool.idle.pop_back();
+				}
+
+				for(auto count = static_cast<int>(pool.idle.size()); count < pool.target; ++count) {
+					deficit.push_back(entry.first);
+				}
+			}
+
+			lock.unlock();
+
+			for(const auto & worker : surplus) {
+				destroyWorker(worker);
+			}
+
+			for(const auto & program : deficit) {
+				if(auto worker = spawnWorker(); worker) {
+					lock.lock();
+					m_pools[program].idle.push_back(*worker);
+					lock.unlock();
+				}
+			}
+
+			lock.lock();
+			m_wake.wait_for(lock, MaintenanceInterval, [this]() {
+				return m_stopping || m_changed;
+			});
+		}
+	}
+
+
+#if defined(Q_OS_UNIX)
+
+
+	// only ever used in helper processes after fork(); each helper has its own copy
+	static char launchRequest[MaxLaunchRequestSize];
+	static char * launchArguments[MaxLaunchArguments + 1];
+	static char * launchEnvironment[MaxLaunchEnvironment + 1];
+
+
+	static bool readFully(int fd, char * data, std::size_t length) {
+		while(0 < length) {
+			const auto bytesRead = ::read(fd, data, length);
+
+			if(0 == bytesRead || (-1 == bytesRead && EINTR != errno)) {
+				return false;
+			}
+
+			if(0 < bytesRead) {
+				data += bytesRead;
+				length -= static_cast<std::size_t>(bytesRead);
+			}
+		}
+
+		return true;
+	}
+
+
+	// points each entry of list at the next of count nul-terminated strings in
+	// [*pos, end), advancing *pos. no allocation, no libc calls
+	static bool parseStrings(char ** pos, const char * end, char ** list, std::size_t count) {
+		for(std::size_t idx = 0; idx < count; ++idx) {
+			list[idx] = *pos;
+
+			while(*pos < end && '\0' != **pos) {
+				++(*pos);
+			}
+
+			if(*pos == end) {
+				return false;
+			}
+
+			++(*pos);
+		}
+
+		list[count] = nullptr;
+		return true;
+	}
+
+
+	[[noreturn]] static void runWorker(int controlFd, int maxFd) {
+		// lead a new process group so that the script and anything it starts can be killed
+		// together. the parent does this too, so that the group exists whichever of us
+		// runs first
+		::setpgid(0, 0);
+
+		// don't hold on to the server's sockets or any other helper's control socket
+		for(int fd = 3; fd < maxFd; ++fd) {
+			if(fd != controlFd) {
+				::close(fd);
+			}
+		}
+
+		uint32_t header[3];
+		iovec iov = {header, sizeof(header)};
+
+		union {
+			char buffer[CMSG_SPACE(sizeof(int) * 3)];
+			cmsghdr align;
+		} control;
+
+		msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+		ssize_t received;
+
+		do {
+			received = ::recvmsg(controlFd, &msg, 0);
+		} while(-1 == received && EINTR == errno);
+
+		// EOF - the pool has retired this helper
+		if(0 >= received) {
+			::_exit(0);
+		}
+
+		if(static_cast<std::size_t>(received) < sizeof(header) && !readFully(controlFd, reinterpret_cast<char *>(header) + received, sizeof(header) - static_cast<std::size_t>(received))) {
+			::_exit(127);
+		}
+
+		cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+
+		if(!cmsg || SOL_SOCKET != cmsg->cmsg_level || SCM_RIGHTS != cmsg->cmsg_type || CMSG_LEN(sizeof(int) * 3) != cmsg->cmsg_len) {
+			::_exit(127);
+		}
+
+		int stdFds[3];
+		std::memcpy(stdFds, CMSG_DATA(cmsg), sizeof(stdFds));
+		const auto argc = header[0];
+		const auto envc = header[1];
+		const auto size = header[2];
+
+		if(MaxLaunchArguments < argc || 0 == argc || MaxLaunchEnvironment < envc || MaxLaunchRequestSize < size || !readFully(controlFd, launchRequest, size)) {
+			::_exit(127);
+		}
+
+		char * pos = launchRequest;
+		const char * end = launchRequest + size;
+		char * workingDir[2];
+
+		if(!parseStrings(&pos, end, workingDir, 1) || !parseStrings(&pos, end, launchArguments, argc) || !parseStrings(&pos, end, launchEnvironment, envc)) {
+			::_exit(127);
+		}
+
+		for(int fd = 0; fd < 3; ++fd) {
+			if(-1 == ::dup2(stdFds[fd], fd)) {
+				::_exit(127);
+			}
+		}
+
+		for(int fd : stdFds) {
+			if(2 < fd) {
+				::close(fd);
+			}
+		}
+
+		::close(controlFd);
+
+		// the script gets a clean signal state, not whatever the server thread had
+		sigset_t noSignals;
+		::sigemptyset(&noSignals);
+		::sigprocmask(SIG_SETMASK, &noSignals, nullptr);
+		struct sigaction defaultAction;
+		std::memset(&defaultAction, 0, sizeof(defaultAction));
+		defaultAction.sa_handler = SIG_DFL;
+		::sigaction(SIGPIPE, &defaultAction, nullptr);
+
+		if('\0' != *workingDir[0] && -1 == ::chdir(workingDir[0])) {
+			::_exit(127);
+		}
+
+		::execve(launchArguments[0], launchArguments, launchEnvironment);
+		::_exit(127);
+	}
+
+
+	static bool setCloseOnExec(int fd) {
+		return -1 != ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+
+	static void appendStrings(QByteArray & out, const QStringList & strings) {
+		for(const auto & str : strings) {
+			out.append(str.toLocal8Bit());
+			out.append('\0');
+		}
+	}
+
+
+	std::optional<CgiWorkerPool::Worker> CgiWorkerPool::spawnWorker() {
+		int control[2];
+
+		if(0 != ::socketpair(AF_UNIX, SOCK_STREAM, 0, control)) {
+			anansiLog(Error, "failed to create CGI worker control socket: " << std::strerror(errno));
+			return {};
+		}
+
+		setCloseOnExec(control[0]);
+		setCloseOnExec(control[1]);
+		rlimit fdLimit;
+		int maxFd = MaxInheritedFd;
+
+		if(0 == ::getrlimit(RLIMIT_NOFILE, &fdLimit) && RLIM_INFINITY != fdLimit.rlim_cur && static_cast<rlim_t>(MaxInheritedFd) > fdLimit.rlim_cur) {
+			maxFd = static_cast<int>(fdLimit.rlim_cur);
+		}
+
+		const auto pid = ::fork();
+
+		if(-1 == pid) {
+			anansiLog(Error, "failed to fork CGI worker: " << std::strerror(errno));
+			::close(control[0]);
+			::close(control[1]);
+			return {};
+		}
+
+		if(0 == pid) {
+			runWorker(control[1], maxFd);
+		}
+
+		// the group must exist before the helper is handed to a CgiProcess, which kills it
+		// by group. this fails harmlessly if the helper got there first
+		::setpgid(pid, pid);
+		::close(control[1]);
+		return Worker{pid, control[0]};
+	}
+
+
+	void CgiWorkerPool::destroyWorker(const Worker & worker) {
+		::kill(static_cast<pid_t>(worker.pid), SIGKILL);
+		::close(worker.controlFd);
+
+		while(-1 == ::waitpid(static_cast<pid_t>(worker.pid), nullptr, 0) && EINTR == errno) {
+		}
+	}
+
+
+	std::unique_ptr<CgiProcess> CgiWorkerPool::launch(const QString & program, const QStringList & args, const CgiEnvironment & env, const QString & workingDir, const Configuration::CgiWorkerLimits & limits, int idleTimeout) {
+		const auto envEntries = env.entries();
+
+		// entries() includes the terminating nullptr
+		if(static_cast<std::size_t>(args.size()) + 1 > MaxLaunchArguments || envEntries.size() - 1 > MaxLaunchEnvironment) {
+			return nullptr;
+		}
+
+		QByteArray request;
+		request.append(workingDir.toLocal8Bit());
+		request.append('\0');
+		appendStrings(request, QStringList() << program << args);
+
+		for(const auto * entry : envEntries) {
+			if(entry) {
+				// include the NUL
+				request.append(entry, static_cast<int>(std::strlen(entry)) + 1);
+			}
+		}
+
+		if(static_cast<std::size_t>(request.size()) > MaxLaunchRequestSize) {
+			return nullptr;
+		}
+
+		std::optional<Worker> worker;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			if(!m_maintainer.joinable()) {
+				m_maintainer = std::thread(&CgiWorkerPool::maintain, this);
+			}
+
+			auto & pool = m_pools[program];
+			pool.limits = limits;
+			pool.idleTimeout = std::chrono::milliseconds(idleTimeout);
+			pool.lastUsed = Clock::now();
+			pool.target = qBound(limits.minimum, pool.target, limits.maximum);
+
+			if(!pool.idle.empty()) {
+				worker = pool.idle.back();
+				pool.idle.pop_back();
+			}
+			else if(pool.target < limits.maximum) {
+				// demand has outstripped the warm helpers
+				++pool.target;
+			}
+
+			m_changed = true;
+		}
+
+		// the maintainer replaces the helper we're about to consume
+		m_wake.notify_one();
+
+		if(!worker) {
+			return nullptr;
+		}
+
+		int stdinPipe[2];
+		int stdoutPipe[2];
+		int stderrPipe[2];
+
+		if(!CgiProcess::createPipes(stdinPipe, stdoutPipe, stderrPipe)) {
+			destroyWorker(*worker);
+			return nullptr;
+		}
+
+		const int childFds[3] = {stdinPipe[0], stdoutPipe[1], stderrPipe[1]};
+		uint32_t header[3] = {static_cast<uint32_t>(args.size() + 1), static_cast<uint32_t>(envEntries.size() - 1), static_cast<uint32_t>(request.size())};
+		iovec iov = {header, sizeof(header)};
+
+		union {
+			char buffer[CMSG_SPACE(sizeof(childFds))];
+			cmsghdr align;
+		} control;
+
+		std::memset(&control, 0, sizeof(control));
+		msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+		cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(childFds));
+		std::memcpy(CMSG_DATA(cmsg), childFds, sizeof(childFds));
+		bool sent = (static_cast<ssize_t>(sizeof(header)) == ::sendmsg(worker->controlFd, &msg, 0));
+		const char * data = request.constData();
+		std::size_t remaining = static_cast<std::size_t>(request.size());
+
+		while(sent && 0 < remaining) {
+			const auto written = ::write(worker->controlFd, data, remaining);
+
+			if(-1 == written) {
+				sent = (EINTR == errno);
+				continue;
+			}
+
+			data += written;
+			remaining -= static_cast<std::size_t>(written);
+		}
+
+		// the helper has its own copies of these now
+		for(int fd : childFds) {
+			::close(fd);
+		}
+
+		if(!sent) {
+			anansiLog(Warning, "failed to send launch request to CGI worker " << worker->pid << ": " << std::strerror(errno));
+			::close(stdinPipe[1]);
+			::close(stdoutPipe[0]);
+			::close(stderrPipe[0]);
+			destroyWorker(*worker);
+			return nullptr;
+		}
+
+		// closing our end doesn't discard anything the helper hasn't read yet
+		::close(worker->controlFd);
+		return std::make_unique<CgiProcess>(worker->pid, stdinPipe[1], stdoutPipe[0], stderrPipe[0]);
+	}
+
+
+#else
+
+
+	std::optional<CgiWorkerPool::Worker> CgiWorkerPool::spawnWorker() {
+		return {};
+	}
+
+
+	void CgiWorkerPool::destroyWorker(const Worker &) {
+	}
+
+
+	std::unique_ptr<CgiProcess> CgiWorkerPool::launch(const QString &, const QStringList &, const CgiEnvironment &, const QString &, const Configuration::CgiWorkerLimits &, int) {
+		// pre-forked helpers are a unix-only optimisation
+		return nullptr;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
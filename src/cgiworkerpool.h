@@ -0,0 +1,115 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file cgiworkerpool.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the CgiWorkerPool class for Anansi.
+///
+/// \dep
+/// - <memory>
+/// - <mutex>
+/// - <condition_variable>
+/// - <thread>
+/// - <chrono>
+/// - <optional>
+/// - <unordered_map>
+/// - <vector>
+/// - <QString>
+/// - <QStringList>
+/// - configuration.h
+/// - cgiprocess.h
+/// - cgienvironment.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CGIWORKERPOOL_H
+#define ANANSI_CGIWORKERPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "configuration.h"
+#include "cgiprocess.h"
+#include "cgienvironment.h"
+
+namespace Anansi {
+
+	// keeps warm, pre-forked helper processes for each pooled CGI interpreter. a helper
+	// waits for a launch request, then execs the interpreter in place with the request's
+	// arguments, environment and pipes, so the fork happens off the request path
+	class CgiWorkerPool final {
+	public:
+		CgiWorkerPool(const CgiWorkerPool &) = delete;
+		CgiWorkerPool(CgiWorkerPool &&) = delete;
+		void operator=(const CgiWorkerPool &) = delete;
+		void operator=(CgiWorkerPool &&) = delete;
+		~CgiWorkerPool();
+
+		static CgiWorkerPool & instance();
+
+		// returns nullptr if no warm helper is available, in which case the caller should
+		// start the process some other way
+		std::unique_ptr<CgiProcess> launch(const QString & program, const QStringList & args, const CgiEnvironment & env, const QString & workingDir, const Configuration::CgiWorkerLimits & limits, int idleTimeout);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Worker {
+			qint64 pid;
+			int controlFd;
+		};
+
+		struct Pool {
+			std::vector<Worker> idle;
+			Configuration::CgiWorkerLimits limits;
+			int target = 0;
+			std::chrono::milliseconds idleTimeout{0};
+			Clock::time_point lastUsed;
+		};
+
+		CgiWorkerPool();
+
+		void maintain();
+		static std::optional<Worker> spawnWorker();
+		static void destroyWorker(const Worker & worker);
+
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		bool m_stopping;
+		bool m_changed;
+		std::unordered_map<QString, Pool, Equit::QtHash<QString>> m_pools;
+		std::thread m_maintainer;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CGIWORKERPOOL_H
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file commandline.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of command-line handling shared by Anansi's executables.
+///
+/// \dep
+/// - commandline.h
+/// - <iostream>
+/// - <string>
+/// - <QDir>
+/// - <QFileInfo>
+/// - <QStandardPaths>
+/// - macros.h
+/// - strings.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "commandline.h"
+
+#include <iostream>
+#include <string>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include "macros.h"
+#include "strings.h"
+
+
+namespace Anansi {
+
+
+	using Equit::parse_uint;
+	using Equit::starts_with;
+
+
+	// the value of an option given either as "-xvalue" or as "-x value"/"--long value".
+	// nullptr if the value is missing
+	static const char * optionValue(int argc, char ** argv, int & idx, const std::string & longOption) {
+		const std::string arg = argv[idx];
+
+		if(2 < arg.size() && longOption != arg) {
+			return argv[idx] + 2;
+		}
+
+		++idx;
+
+		if(idx >= argc) {
+			return nullptr;
+		}
+
+		return argv[idx];
+	}
+
+
+	std::optional<CommandLineOptions> parseCommandLine(int argc, char ** argv) {
+		CommandLineOptions options;
+
+		for(int idx = 1; idx < argc; ++idx) {
+			const std::string arg = argv[idx];
+
+			if(starts_with(arg, "-a") || "--address" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--address");
+
+				if(!value) {
+					std::cerr << arg << " provided without a listen ip address.\n";
+					return {};
+				}
+
+				options.listenAddress = QString::fromLocal8Bit(value);
+			}
+			else if(starts_with(arg, "-p") || "--port" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--port");
+
+				if(!value) {
+					std::cerr << arg << " provided without a listen port.\n";
+					return {};
+				}
+
+				options.port = parse_uint<uint16_t>(value);
+
+				if(!options.port) {
+					std::cerr << "invalid port provided to " << arg << ": " << value << "\n";
+					return {};
+				}
+			}
+			else if(starts_with(arg, "-d") || "--docroot" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--docroot");
+
+				if(!value) {
+					std::cerr << arg << " provided without a document root.\n";
+					return {};
+				}
+
+				options.documentRoot = QString::fromLocal8Bit(value);
+			}
+			else if(starts_with(arg, "-c") || "--config" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--config");
+
+				if(!value) {
+					std::cerr << arg << " provided without a configuration file.\n";
+					return {};
+				}
+
+				options.configurationFile = QString::fromLocal8Bit(value);
+			}
+			else if("-s" == arg || "--start" == arg) {
+				options.start = true;
+			}
+		}
+
+		return options;
+	}
+
+
+	std::optional<Configuration> startupConfiguration(const CommandLineOptions & options, QString & watchFile) {
+		std::optional<Configuration> config;
+
+		if(options.configurationFile) {
+			watchFile = QFileInfo(*options.configurationFile).absoluteFilePath();
+			config = Configuration::loadFrom(watchFile);
+
+			if(!config) {
+				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to load configuration from \"" << qPrintable(watchFile) << "\"\n";
+				watchFile.clear();
+				return {};
+			}
+		}
+		else {
+			watchFile = QDir(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)).absoluteFilePath("defaultsettings.awcx");
+			config = Configuration::loadFrom(watchFile);
+
+			if(!config) {
+				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to load user default configuration from \"" << qPrintable(watchFile) << ".\n";
+				watchFile = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation)).absoluteFilePath("equitwebserversettings.awcx");
+				config = Configuration::loadFrom(watchFile);
+
+				if(!config) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to load system default configuration from \"" << qPrintable(watchFile) << "\".\n";
+					config = std::make_optional<Configuration>();
+					watchFile.clear();
+				}
+			}
+		}
+
+		if(options.listenAddress) {
+			config->setListenAddress(*options.listenAddress);
+			watchFile.clear();
+		}
+
+		if(options.port) {
+			config->setPort(*options.port);
+			watchFile.clear();
+		}
+
+		if(options.documentRoot) {
+			config->setDocumentRoot(*options.documentRoot);
+			watchFile.clear();
+		}
+
+		return config;
+	}
+
+
+}  // namespace Anansi
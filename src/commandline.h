@@ -0,0 +1,70 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file commandline.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of command-line handling shared by Anansi's executables.
+///
+/// \dep
+/// - <cstdint>
+/// - <optional>
+/// - <QString>
+/// - configuration.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_COMMANDLINE_H
+#define ANANSI_COMMANDLINE_H
+
+#include <cstdint>
+#include <optional>
+
+#include <QString>
+
+#include "configuration.h"
+
+namespace Anansi {
+
+	struct CommandLineOptions {
+		std::optional<QString> listenAddress;
+		std::optional<uint16_t> port;
+		std::optional<QString> documentRoot;
+		std::optional<QString> configurationFile;
+		bool start = false;
+	};
+
+	// -a/--address, -p/--port, -d/--docroot, -c/--config and -s/--start. returns an
+	// empty optional, having said why, if the command line is not valid
+	std::optional<CommandLineOptions> parseCommandLine(int argc, char ** argv);
+
+	// the configuration file named on the command line, or failing that the user's or the
+	// system's default one, with the settings given on the command line applied. watchFile
+	// is set to the file to reload when it changes, which is only the case when no
+	// settings were given on the command line since a reload would lose them. returns an
+	// empty optional if a file was named on the command line and could not be loaded
+	std::optional<Configuration> startupConfiguration(const CommandLineOptions & options, QString & watchFile);
+
+}  // namespace Anansi
+
+#endif  // ANANSI_COMMANDLINE_H
@@ -28,6 +28,7 @@
 /// - configuration.h
 /// - <optional>
 /// - <iostream>
+/// - <algorithm>
 /// - <QtGlobal>
 /// - <QFile>
 /// - <QDir>
@@ -45,6 +46,7 @@
 
 #include <optional>
 #include <iostream>
+#include <algorithm>
 
 #include <QtGlobal>
 #include <QFile>
@@ -94,6 +96,24 @@ namespace Anansi {
 	static const QString BuiltInDefaultMediaType = QStringLiteral("application/octet-stream");
 	static constexpr const WebServerAction BuiltInDefaultAction = WebServerAction::Forbid;
 	static constexpr const int DefaultCgiTimeout = 30000;
+	static constexpr const int DefaultFastCgiConnectionLimit = 8;
+	static constexpr const int DefaultCgiWorkerIdleTimeout = 60000;
+	static constexpr const int DefaultRequestBodyMemoryLimit = 1048576;
+	static constexpr const int DefaultCgiConcurrencyLimit = 32;
+	static constexpr const int DefaultCgiScriptConcurrencyLimit = 8;
+	static constexpr const int DefaultCgiQueueLength = 64;
+	static constexpr const int DefaultCgiQueueTimeout = 10000;
+	static constexpr const int DefaultCgiResponseCacheSize = 0;
+	static constexpr const int DefaultProxyConnectionLimit = 16;
+	static constexpr const int DefaultProxyTimeout = 30000;
+	static constexpr const AccessLogFormat DefaultAccessLogFormat = AccessLogFormat::Combined;
+	static constexpr const int DefaultAccessLogRotateSize = 0;
+	static constexpr const int DefaultAccessLogRotateInterval = 0;
+	static constexpr const int DefaultAccessLogRotateCount = 5;
+	static constexpr bool DefaultStatusEndpointEnabled = false;
+	static constexpr const int DefaultRequestTraceSampleRate = 0;
+	static constexpr const int DefaultRequestTraceThreshold = 0;
+	static constexpr const LogLevel DefaultLogLevel = LogLevel::Warning;
 	static const QString DefaultBindAddress = QStringLiteral("127.0.0.1");
 	static constexpr bool DefaultAllowDirLists = true;
 	static constexpr const DirectoryListingSortOrder DefaultDirListSortOrder = DirectoryListingSortOrder::AscendingDirectoriesFirst;
@@ -151,11 +171,62 @@ namespace Anansi {
 			return WebServerAction::Ignore;
 		}
 
+		if(StringType("Proxy") == action) {
+			return WebServerAction::Proxy;
+		}
+
+		if(StringType("Module") == action) {
+			return WebServerAction::Module;
+		}
+
 		std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid web server action string\n";
 		return {};
 	}
 
 
+	template<class StringType>
+	static std::optional<AccessLogFormat> parseAccessLogFormatText(const StringType & format) {
+		if(StringType("Common") == format) {
+			return AccessLogFormat::Common;
+		}
+
+		if(StringType("Combined") == format) {
+			return AccessLogFormat::Combined;
+		}
+
+		std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid access log format string\n";
+		return {};
+	}
+
+
+	template<class StringType>
+	static std::optional<LogLevel> parseLogLevelText(const StringType & level) {
+		for(const auto candidate : {LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error}) {
+			if(enumeratorString<StringType>(candidate) == level) {
+				return candidate;
+			}
+		}
+
+		std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid log level string\n";
+		return {};
+	}
+
+
+	template<class StringType>
+	static std::optional<CgiTransport> parseCgiTransportText(const StringType & transport) {
+		if(StringType("Process") == transport) {
+			return CgiTransport::Process;
+		}
+
+		if(StringType("FastCGI") == transport) {
+			return CgiTransport::FastCgi;
+		}
+
+		std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI transport string\n";
+		return {};
+	}
+
+
 	template<class StringType>
 	static std::optional<DirectoryListingSortOrder> parseDirectoryListingSortOrder(const StringType & order) {
 		if(StringType("AscendingDirectoriesFirst") == order) {
@@ -242,9 +313,12 @@ namespace Anansi {
 		config.m_documentRoot.clear();
 		config.m_cgiBin.clear();
 		config.m_ipConnectionPolicies.clear();
+		config.m_ipConnectionPolicyTrie.clear();
 		config.m_extensionMediaTypes.clear();
 		config.m_mediaTypeActions.clear();
 		config.m_mediaTypeCgiExecutables.clear();
+		config.m_mediaTypeCgiTransports.clear();
+		config.m_mediaTypeCgiWorkers.clear();
 
 		while(!xml.atEnd()) {
 			xml.readNext();
@@ -259,6 +333,12 @@ namespace Anansi {
 			}
 		}
 
+		// a file caught part way through being written is rejected rather than half-read
+		if(xml.hasError()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error in \"" << qPrintable(fileName) << "\" at line " << xml.lineNumber() << " (" << qPrintable(xml.errorString()) << ")\n";
+			return {};
+		}
+
 		return {std::move(config)};
 	}
 
@@ -322,6 +402,57 @@ namespace Anansi {
 			else if(xml.name() == QStringLiteral("mediatypecgilist") || xml.name() == QStringLiteral("mimetypecgilist")) {
 				ret = readMediaTypeCgiExecutablesXml(xml);
 			}
+			else if(xml.name() == QStringLiteral("fastcgiconnectionlimit")) {
+				ret = readFastCgiConnectionLimitXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiworkeridletimeout")) {
+				ret = readCgiWorkerIdleTimeoutXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("requestbodymemorylimit")) {
+				ret = readRequestBodyMemoryLimitXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiconcurrencylimit")) {
+				ret = readCgiConcurrencyLimitXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiscriptconcurrencylimit")) {
+				ret = readCgiScriptConcurrencyLimitXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiqueuelength")) {
+				ret = readCgiQueueLengthXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiqueuetimeout")) {
+				ret = readCgiQueueTimeoutXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("cgiresponsecachesize")) {
+				ret = readCgiResponseCacheSizeXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("mediatypeproxylist")) {
+				ret = readMediaTypeProxiesXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("proxyroutelist")) {
+				ret = readProxyRoutesXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("proxyconnectionlimit")) {
+				ret = readProxyConnectionLimitXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("proxytimeout")) {
+				ret = readProxyTimeoutXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("accesslog")) {
+				ret = readAccessLogXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("statusendpoint")) {
+				ret = readStatusEndpointXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("requesttrace")) {
+				ret = readRequestTraceXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("loglevel")) {
+				ret = readLogLevelXml(xml);
+			}
+			else if(xml.name() == QStringLiteral("mediatypemodulelist")) {
+				ret = readMediaTypeModulesXml(xml);
+			}
 			else if(xml.name() == QStringLiteral("allowdirectorylistings")) {
 				ret = readAllowDirectoryListingsXml(xml);
 			}
@@ -889,6 +1020,8 @@ namespace Anansi {
 		eqAssert(xml.isStartElement() && (xml.name() == QStringLiteral("mediatypecgi") || xml.name() == QStringLiteral("mimetypecgi")), R"(expecting start element "mediatypecgi" at line )" << xml.lineNumber());
 		QString mediaType;
 		QString cgiExe;
+		CgiTransport transport = CgiTransport::Process;
+		CgiWorkerLimits workers;
 
 		while(!xml.atEnd()) {
 			xml.readNext();
@@ -912,6 +1045,31 @@ namespace Anansi {
 			else if(xml.name() == QStringLiteral("cgiexecutable")) {
 				cgiExe = xml.readElementText();
 			}
+			else if(xml.name() == QStringLiteral("cgitransport")) {
+				auto parsedTransport = parseCgiTransportText(xml.readElementText());
+
+				if(!parsedTransport) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: invalid "cgitransport" element content at line )" << xml.lineNumber() << " (expecting \"Process\" or \"FastCGI\")\n";
+				}
+				else {
+					transport = *parsedTransport;
+				}
+			}
+			else if(xml.name() == QStringLiteral("minworkers") || xml.name() == QStringLiteral("maxworkers")) {
+				const bool isMinimum = (xml.name() == QStringLiteral("minworkers"));
+				bool ok;
+				const auto count = xml.readElementText().toInt(&ok);
+
+				if(!ok || 0 > count) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI worker count at line " << xml.lineNumber() << "\n";
+				}
+				else if(isMinimum) {
+					workers.minimum = count;
+				}
+				else {
+					workers.maximum = count;
+				}
+			}
 			else {
 				readUnknownElementXml(xml);
 			}
@@ -922,234 +1080,945 @@ namespace Anansi {
 			return false;
 		}
 
-		setMediaTypeCgi(mediaType, cgiExe);
+		if(setMediaTypeCgi(mediaType, cgiExe) && !cgiExe.trimmed().isEmpty()) {
+			setMediaTypeCgiTransport(mediaType, transport);
+
+			if(0 < workers.maximum && !setMediaTypeCgiWorkers(mediaType, workers.minimum, workers.maximum)) {
+				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI worker limits for \"" << qPrintable(mediaType) << "\" at line " << xml.lineNumber() << "\n";
+			}
+		}
+
 		return true;
 	}
 
 
-	bool Configuration::saveAs(const QString & fileName) const {
-		eqAssert(!fileName.isEmpty(), "file name must not be empty");
-		QFile xmlFile(fileName);
+	bool Configuration::readFastCgiConnectionLimitXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("fastcgiconnectionlimit"), "expecting start element \"fastcgiconnectionlimit\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto limit = xml.readElementText().toInt(&ok);
 
-		if(!xmlFile.open(QIODevice::WriteOnly)) {
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for FastCGI connection limit on line " << xml.lineNumber() << "\n";
 			return false;
 		}
 
-		QXmlStreamWriter xml(&xmlFile);
-		xml.setAutoFormatting(true);
-		bool ret = writeStartXml(xml) && writeWebserverXml(xml) && writeEndXml(xml);
-		xmlFile.close();
-		return ret;
-	}
-
+		if(!setFastCgiConnectionLimit(limit)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid FastCGI connection limit " << limit << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeStartXml(QXmlStreamWriter & xml) const {
-		xml.writeStartDocument();
 		return true;
 	}
 
 
-	bool Configuration::writeEndXml(QXmlStreamWriter & xml) const {
-		xml.writeEndDocument();
-		return true;
-	}
+	bool Configuration::readCgiWorkerIdleTimeoutXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiworkeridletimeout"), "expecting start element \"cgiworkeridletimeout\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto timeout = xml.readElementText().toInt(&ok);
 
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for CGI worker idle timeout on line " << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		if(!setCgiWorkerIdleTimeout(timeout)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI worker idle timeout " << timeout << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeWebserverXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("webserver"));
-		writeDocumentRootXml(xml);
-		writeListenAddressXml(xml);
-		writeListenPortXml(xml);
-		writeCgiBinXml(xml);
-		writeAllowServingFilesFromCgiBinXml(xml);
-		writeAdministratorEmailXml(xml);
-		writeDefaultConnectionPolicyXml(xml);
-		writeDefaultMediaTypeXml(xml);
-		writeDefaultActionXml(xml);
-		writeAllowDirectoryListingsXml(xml);
-		writeShowHiddenFilesInDirectoryListingsXml(xml);
-		writeDirectoryListingSortOrderXml(xml);
-		writeIpConnectionPoliciesXml(xml);
-		writeFileExtensionMediaTypesXml(xml);
-		writeMediaTypeActionsXml(xml);
-		writeMediaTypeCgiExecutablesXml(xml);
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeDocumentRootXml(QXmlStreamWriter & xml) const {
-		for(const auto & platformDocRoot : m_documentRoot) {
-			xml.writeStartElement(QStringLiteral("documentroot"));
-			xml.writeAttribute(QStringLiteral("platform"), platformDocRoot.first);
-			xml.writeCharacters(platformDocRoot.second);
-			xml.writeEndElement();
-		}
+	bool Configuration::readRequestBodyMemoryLimitXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("requestbodymemorylimit"), "expecting start element \"requestbodymemorylimit\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto limit = xml.readElementText().toInt(&ok);
 
-		return true;
-	}
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for request body memory limit on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
+		if(!setRequestBodyMemoryLimit(limit)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid request body memory limit " << limit << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeListenAddressXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("bindaddress"));
-		xml.writeCharacters(m_listenAddress);
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeListenPortXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("bindport"));
-		xml.writeCharacters(QString::number(m_listenPort));
-		xml.writeEndElement();
-		return true;
-	}
+	bool Configuration::readCgiConcurrencyLimitXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiconcurrencylimit"), "expecting start element \"cgiconcurrencylimit\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto limit = xml.readElementText().toInt(&ok);
 
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for CGI concurrency limit on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeCgiBinXml(QXmlStreamWriter & xml) const {
-		for(const auto & platformCgiBin : m_cgiBin) {
-			xml.writeStartElement(QStringLiteral("cgibin"));
-			xml.writeAttribute(QStringLiteral("platform"), platformCgiBin.first);
-			xml.writeCharacters(platformCgiBin.second);
-			xml.writeEndElement();
+		if(!setCgiConcurrencyLimit(limit)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI concurrency limit " << limit << " on line " << xml.lineNumber() << "\n";
+			return false;
 		}
 
 		return true;
 	}
 
 
-	bool Configuration::writeAllowServingFilesFromCgiBinXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("servefromcgibin"));
-		xml.writeCharacters(m_allowServingFromCgiBin ? QStringLiteral("true") : QStringLiteral("false"));
-		xml.writeEndElement();
-		return true;
-	}
-
+	bool Configuration::readCgiScriptConcurrencyLimitXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiscriptconcurrencylimit"), "expecting start element \"cgiscriptconcurrencylimit\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto limit = xml.readElementText().toInt(&ok);
 
-	bool Configuration::writeAdministratorEmailXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("adminemail"));
-		xml.writeCharacters(m_adminEmail);
-		xml.writeEndElement();
-		return true;
-	}
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for per-script CGI concurrency limit on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
+		if(!setCgiScriptConcurrencyLimit(limit)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid per-script CGI concurrency limit " << limit << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeDefaultConnectionPolicyXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("defaultconnectionpolicy"));
-		xml.writeStartElement(QStringLiteral("connectionpolicy"));
-		xml.writeCharacters(enumeratorString<QString>(m_defaultConnectionPolicy));
-		xml.writeEndElement();
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeDefaultMediaTypeXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("defaultmediatype"));
-		xml.writeStartElement(QStringLiteral("mediatype"));
-		xml.writeCharacters(m_defaultMediaType);
-		xml.writeEndElement();
-		xml.writeEndElement();
-		return true;
-	}
-
+	bool Configuration::readCgiQueueLengthXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiqueuelength"), "expecting start element \"cgiqueuelength\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto length = xml.readElementText().toInt(&ok);
 
-	bool Configuration::writeAllowDirectoryListingsXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("allowdirectorylistings"));
-		xml.writeCharacters(m_allowDirectoryListings ? "true" : "false");
-		xml.writeEndElement();
-		return true;
-	}
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for CGI queue length on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
+		if(!setCgiQueueLength(length)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI queue length " << length << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-	bool Configuration::writeShowHiddenFilesInDirectoryListingsXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("showhiddenfiles"));
-		xml.writeCharacters(m_showHiddenFilesInDirectoryListings ? "true" : "false");
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeDirectoryListingSortOrderXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("directorylistingsortorder"));
-		xml.writeCharacters(enumeratorString<QString>(m_directoryListingSortOrder));
-		xml.writeEndElement();
-		return true;
-	}
-
+	bool Configuration::readCgiQueueTimeoutXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiqueuetimeout"), "expecting start element \"cgiqueuetimeout\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto timeout = xml.readElementText().toInt(&ok);
 
-	bool Configuration::writeIpConnectionPoliciesXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("ipconnectionpolicylist"));
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for CGI queue timeout on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-		for(const auto & ip : m_ipConnectionPolicies) {
-			xml.writeStartElement(QStringLiteral("ipconnectionpolicy"));
-			xml.writeStartElement(QStringLiteral("ipaddress"));
-			xml.writeCharacters(ip.first);
-			xml.writeEndElement();
-			xml.writeStartElement(QStringLiteral("connectionpolicy"));
-			xml.writeCharacters(enumeratorString<QString>(ip.second));
-			xml.writeEndElement();
-			xml.writeEndElement();
+		if(!setCgiQueueTimeout(timeout)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI queue timeout " << timeout << " on line " << xml.lineNumber() << "\n";
+			return false;
 		}
 
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeFileExtensionMediaTypesXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("extensionmediatypelist"));
-
-		for(const auto & entry : m_extensionMediaTypes) {
-			xml.writeStartElement(QStringLiteral("extensionmediatype"));
-			xml.writeStartElement(QStringLiteral("extension"));
-			xml.writeCharacters(entry.first);
-			xml.writeEndElement();
+	bool Configuration::readCgiResponseCacheSizeXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("cgiresponsecachesize"), "expecting start element \"cgiresponsecachesize\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto size = xml.readElementText().toInt(&ok);
 
-			for(const auto & mediaType : entry.second) {
-				xml.writeStartElement(QStringLiteral("mediatype"));
-				xml.writeCharacters(mediaType);
-				xml.writeEndElement();
-			}
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for CGI response cache size on line " << xml.lineNumber() << "\n";
+			return false;
+		}
 
-			xml.writeEndElement();
+		if(!setCgiResponseCacheSize(size)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI response cache size " << size << " on line " << xml.lineNumber() << "\n";
+			return false;
 		}
 
-		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeMediaTypeActionsXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("mediatypeactionlist"));
+	bool Configuration::readMediaTypeProxiesXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("mediatypeproxylist"), R"(expecting start element "mediatypeproxylist" in configuration at line )" << xml.lineNumber());
 
-		for(const auto & mediaType : m_mediaTypeActions) {
-			xml.writeStartElement(QStringLiteral("mediatypeaction"));
-			xml.writeStartElement(QStringLiteral("mediatype"));
-			xml.writeCharacters(mediaType.first);
-			xml.writeEndElement();
-			xml.writeStartElement(QStringLiteral("webserveraction"));
-			xml.writeCharacters(enumeratorString<QString>(mediaType.second));
-			xml.writeEndElement();
-			xml.writeEndElement();
-		}
+		while(!xml.atEnd()) {
+			xml.readNext();
 
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("mediatypeproxy")) {
+				readMediaTypeProxyXml(xml);
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readMediaTypeProxyXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("mediatypeproxy"), R"(expecting start element "mediatypeproxy" at line )" << xml.lineNumber());
+		QString mediaType;
+		ProxyUpstreamList upstreams;
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("mediatype")) {
+				mediaType = xml.readElementText();
+			}
+			else if(xml.name() == QStringLiteral("upstream")) {
+				upstreams.push_back(xml.readElementText().trimmed());
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: missing "mediatype" element for "mediatypeproxy" at line )" << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		return setMediaTypeProxyUpstreams(mediaType, upstreams);
+	}
+
+
+	bool Configuration::readProxyRoutesXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("proxyroutelist"), R"(expecting start element "proxyroutelist" in configuration at line )" << xml.lineNumber());
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("proxyroute")) {
+				readProxyRouteXml(xml);
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readProxyRouteXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("proxyroute"), R"(expecting start element "proxyroute" at line )" << xml.lineNumber());
+		QString pathPrefix;
+		ProxyUpstreamList upstreams;
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("pathprefix")) {
+				pathPrefix = xml.readElementText();
+			}
+			else if(xml.name() == QStringLiteral("upstream")) {
+				upstreams.push_back(xml.readElementText().trimmed());
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		if(!setProxyRoute(pathPrefix, upstreams)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: invalid "proxyroute" at line )" << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readProxyConnectionLimitXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("proxyconnectionlimit"), "expecting start element \"proxyconnectionlimit\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto limit = xml.readElementText().toInt(&ok);
+
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for proxy connection limit on line " << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		if(!setProxyConnectionLimit(limit)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid proxy connection limit " << limit << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readProxyTimeoutXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("proxytimeout"), "expecting start element \"proxytimeout\" in configuration at line " << xml.lineNumber());
+		bool ok;
+		auto timeout = xml.readElementText().toInt(&ok);
+
+		if(!ok) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid integer string representation for proxy timeout on line " << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		if(!setProxyTimeout(timeout)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid proxy timeout " << timeout << " on line " << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readStatusEndpointXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("statusendpoint"), "expecting start element \"statusendpoint\" in configuration at line " << xml.lineNumber());
+		auto enabled = parseBooleanText(xml.readElementText());
+
+		if(!enabled) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid \"statusendpoint\" element content in XML stream at line " << xml.lineNumber() << " (expecting \"true\" or \"false\")\n";
+			return false;
+		}
+
+		setStatusEndpointEnabled(*enabled);
+		return true;
+	}
+
+
+	bool Configuration::readAccessLogXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("accesslog"), R"(expecting start element "accesslog" at line )" << xml.lineNumber());
+
+		// reads an integer setting, reporting it if it's not valid
+		const auto readNumber = [&xml](const char * description, auto setter) {
+			bool ok;
+			const auto value = xml.readElementText().toInt(&ok);
+
+			if(!ok || !setter(value)) {
+				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid access log " << description << " at line " << xml.lineNumber() << "\n";
+			}
+		};
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("file")) {
+				setAccessLogFile(xml.readElementText().trimmed());
+			}
+			else if(xml.name() == QStringLiteral("format")) {
+				const auto format = parseAccessLogFormatText(xml.readElementText());
+
+				if(!format) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: invalid "format" element content at line )" << xml.lineNumber() << " (expecting \"Common\" or \"Combined\")\n";
+				}
+				else {
+					setAccessLogFormat(*format);
+				}
+			}
+			else if(xml.name() == QStringLiteral("rotatesize")) {
+				readNumber("rotation size", [this](int bytes) {
+					return setAccessLogRotateSize(bytes);
+				});
+			}
+			else if(xml.name() == QStringLiteral("rotateinterval")) {
+				readNumber("rotation interval", [this](int seconds) {
+					return setAccessLogRotateInterval(seconds);
+				});
+			}
+			else if(xml.name() == QStringLiteral("rotatecount")) {
+				readNumber("rotation count", [this](int count) {
+					return setAccessLogRotateCount(count);
+				});
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readRequestTraceXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("requesttrace"), R"(expecting start element "requesttrace" at line )" << xml.lineNumber());
+
+		// reads an integer setting, reporting it if it's not valid
+		const auto readNumber = [&xml](const char * description, auto setter) {
+			bool ok;
+			const auto value = xml.readElementText().toInt(&ok);
+
+			if(!ok || !setter(value)) {
+				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid request trace " << description << " at line " << xml.lineNumber() << "\n";
+			}
+		};
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("file")) {
+				setRequestTraceFile(xml.readElementText().trimmed());
+			}
+			else if(xml.name() == QStringLiteral("samplerate")) {
+				readNumber("sample rate", [this](int rate) {
+					return setRequestTraceSampleRate(rate);
+				});
+			}
+			else if(xml.name() == QStringLiteral("threshold")) {
+				readNumber("threshold", [this](int msec) {
+					return setRequestTraceThreshold(msec);
+				});
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readLogLevelXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("loglevel"), R"(expecting start element "loglevel" in configuration at line )" << xml.lineNumber());
+		const auto level = parseLogLevelText(xml.readElementText().trimmed());
+
+		if(!level) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: invalid "loglevel" element content in XML stream at line )" << xml.lineNumber() << " (expecting \"Debug\", \"Info\", \"Warning\" or \"Error\")\n";
+			return false;
+		}
+
+		setLogLevel(*level);
+		return true;
+	}
+
+
+	bool Configuration::readMediaTypeModulesXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("mediatypemodulelist"), R"(expecting start element "mediatypemodulelist" in configuration at line )" << xml.lineNumber());
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("mediatypemodule")) {
+				readMediaTypeModuleXml(xml);
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::readMediaTypeModuleXml(QXmlStreamReader & xml) {
+		eqAssert(xml.isStartElement() && xml.name() == QStringLiteral("mediatypemodule"), R"(expecting start element "mediatypemodule" at line )" << xml.lineNumber());
+		QString mediaType;
+		QString modulePath;
+
+		while(!xml.atEnd()) {
+			xml.readNext();
+
+			if(xml.isEndElement()) {
+				break;
+			}
+
+			if(xml.isCharacters()) {
+				if(!xml.isWhitespace()) {
+					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: ignoring extraneous non-whitespace content at line " << xml.lineNumber() << "\n";
+				}
+
+				// ignore extraneous characters
+				continue;
+			}
+
+			if(xml.name() == QStringLiteral("mediatype")) {
+				mediaType = xml.readElementText();
+			}
+			else if(xml.name() == QStringLiteral("module")) {
+				modulePath = xml.readElementText().trimmed();
+			}
+			else {
+				readUnknownElementXml(xml);
+			}
+		}
+
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << R"(]: missing "mediatype" element for "mediatypemodule" at line )" << xml.lineNumber() << "\n";
+			return false;
+		}
+
+		return setMediaTypeModule(mediaType, modulePath);
+	}
+
+
+	bool Configuration::saveAs(const QString & fileName) const {
+		eqAssert(!fileName.isEmpty(), "file name must not be empty");
+		QFile xmlFile(fileName);
+
+		if(!xmlFile.open(QIODevice::WriteOnly)) {
+			return false;
+		}
+
+		QXmlStreamWriter xml(&xmlFile);
+		xml.setAutoFormatting(true);
+		bool ret = writeStartXml(xml) && writeWebserverXml(xml) && writeEndXml(xml);
+		xmlFile.close();
+		return ret;
+	}
+
+
+	bool Configuration::writeStartXml(QXmlStreamWriter & xml) const {
+		xml.writeStartDocument();
+		return true;
+	}
+
+
+	bool Configuration::writeEndXml(QXmlStreamWriter & xml) const {
+		xml.writeEndDocument();
+		return true;
+	}
+
+
+	bool Configuration::writeWebserverXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("webserver"));
+		writeDocumentRootXml(xml);
+		writeListenAddressXml(xml);
+		writeListenPortXml(xml);
+		writeCgiBinXml(xml);
+		writeAllowServingFilesFromCgiBinXml(xml);
+		writeAdministratorEmailXml(xml);
+		writeDefaultConnectionPolicyXml(xml);
+		writeDefaultMediaTypeXml(xml);
+		writeDefaultActionXml(xml);
+		writeAllowDirectoryListingsXml(xml);
+		writeShowHiddenFilesInDirectoryListingsXml(xml);
+		writeDirectoryListingSortOrderXml(xml);
+		writeIpConnectionPoliciesXml(xml);
+		writeFileExtensionMediaTypesXml(xml);
+		writeMediaTypeActionsXml(xml);
+		writeMediaTypeCgiExecutablesXml(xml);
+		writeFastCgiConnectionLimitXml(xml);
+		writeCgiWorkerIdleTimeoutXml(xml);
+		writeRequestBodyMemoryLimitXml(xml);
+		writeCgiConcurrencyLimitXml(xml);
+		writeCgiScriptConcurrencyLimitXml(xml);
+		writeCgiQueueLengthXml(xml);
+		writeCgiQueueTimeoutXml(xml);
+		writeCgiResponseCacheSizeXml(xml);
+		writeMediaTypeProxiesXml(xml);
+		writeProxyRoutesXml(xml);
+		writeProxyConnectionLimitXml(xml);
+		writeProxyTimeoutXml(xml);
+		writeAccessLogXml(xml);
+		writeStatusEndpointXml(xml);
+		writeRequestTraceXml(xml);
+		writeLogLevelXml(xml);
+		writeMediaTypeModulesXml(xml);
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeDocumentRootXml(QXmlStreamWriter & xml) const {
+		for(const auto & platformDocRoot : m_documentRoot) {
+			xml.writeStartElement(QStringLiteral("documentroot"));
+			xml.writeAttribute(QStringLiteral("platform"), platformDocRoot.first);
+			xml.writeCharacters(platformDocRoot.second);
+			xml.writeEndElement();
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::writeListenAddressXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("bindaddress"));
+		xml.writeCharacters(m_listenAddress);
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeListenPortXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("bindport"));
+		xml.writeCharacters(QString::number(m_listenPort));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeCgiBinXml(QXmlStreamWriter & xml) const {
+		for(const auto & platformCgiBin : m_cgiBin) {
+			xml.writeStartElement(QStringLiteral("cgibin"));
+			xml.writeAttribute(QStringLiteral("platform"), platformCgiBin.first);
+			xml.writeCharacters(platformCgiBin.second);
+			xml.writeEndElement();
+		}
+
+		return true;
+	}
+
+
+	bool Configuration::writeAllowServingFilesFromCgiBinXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("servefromcgibin"));
+		xml.writeCharacters(m_allowServingFromCgiBin ? QStringLiteral("true") : QStringLiteral("false"));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeAdministratorEmailXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("adminemail"));
+		xml.writeCharacters(m_adminEmail);
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeDefaultConnectionPolicyXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("defaultconnectionpolicy"));
+		xml.writeStartElement(QStringLiteral("connectionpolicy"));
+		xml.writeCharacters(enumeratorString<QString>(m_defaultConnectionPolicy));
+		xml.writeEndElement();
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeDefaultMediaTypeXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("defaultmediatype"));
+		xml.writeStartElement(QStringLiteral("mediatype"));
+		xml.writeCharacters(m_defaultMediaType);
+		xml.writeEndElement();
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeAllowDirectoryListingsXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("allowdirectorylistings"));
+		xml.writeCharacters(m_allowDirectoryListings ? "true" : "false");
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeShowHiddenFilesInDirectoryListingsXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("showhiddenfiles"));
+		xml.writeCharacters(m_showHiddenFilesInDirectoryListings ? "true" : "false");
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeDirectoryListingSortOrderXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("directorylistingsortorder"));
+		xml.writeCharacters(enumeratorString<QString>(m_directoryListingSortOrder));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeIpConnectionPoliciesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("ipconnectionpolicylist"));
+
+		for(const auto & ip : m_ipConnectionPolicies) {
+			xml.writeStartElement(QStringLiteral("ipconnectionpolicy"));
+			xml.writeStartElement(QStringLiteral("ipaddress"));
+			xml.writeCharacters(ip.first);
+			xml.writeEndElement();
+			xml.writeStartElement(QStringLiteral("connectionpolicy"));
+			xml.writeCharacters(enumeratorString<QString>(ip.second));
+			xml.writeEndElement();
+			xml.writeEndElement();
+		}
+
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeFileExtensionMediaTypesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("extensionmediatypelist"));
+
+		for(const auto & entry : m_extensionMediaTypes) {
+			xml.writeStartElement(QStringLiteral("extensionmediatype"));
+			xml.writeStartElement(QStringLiteral("extension"));
+			xml.writeCharacters(entry.first);
+			xml.writeEndElement();
+
+			for(const auto & mediaType : entry.second) {
+				xml.writeStartElement(QStringLiteral("mediatype"));
+				xml.writeCharacters(mediaType);
+				xml.writeEndElement();
+			}
+
+			xml.writeEndElement();
+		}
+
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeMediaTypeActionsXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("mediatypeactionlist"));
+
+		for(const auto & mediaType : m_mediaTypeActions) {
+			xml.writeStartElement(QStringLiteral("mediatypeaction"));
+			xml.writeStartElement(QStringLiteral("mediatype"));
+			xml.writeCharacters(mediaType.first);
+			xml.writeEndElement();
+			xml.writeStartElement(QStringLiteral("webserveraction"));
+			xml.writeCharacters(enumeratorString<QString>(mediaType.second));
+			xml.writeEndElement();
+			xml.writeEndElement();
+		}
+
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeMediaTypeCgiExecutablesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("mediatypecgilist"));
+
+		for(const auto & mediaType : m_mediaTypeCgiExecutables) {
+			xml.writeStartElement(QStringLiteral("mediatypecgi"));
+			xml.writeStartElement(QStringLiteral("mediatype"));
+			xml.writeCharacters(mediaType.first);
+			xml.writeEndElement();
+			xml.writeStartElement(QStringLiteral("cgiexecutable"));
+			xml.writeCharacters(mediaType.second);
+			xml.writeEndElement();
+
+			if(auto transport = mediaTypeCgiTransport(mediaType.first); CgiTransport::Process != transport) {
+				xml.writeStartElement(QStringLiteral("cgitransport"));
+				xml.writeCharacters(enumeratorString<QString>(transport));
+				xml.writeEndElement();
+			}
+
+			if(auto workers = mediaTypeCgiWorkers(mediaType.first); 0 < workers.maximum) {
+				xml.writeStartElement(QStringLiteral("minworkers"));
+				xml.writeCharacters(QString::number(workers.minimum));
+				xml.writeEndElement();
+				xml.writeStartElement(QStringLiteral("maxworkers"));
+				xml.writeCharacters(QString::number(workers.maximum));
+				xml.writeEndElement();
+			}
+
+			xml.writeEndElement();
+		}
+
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeFastCgiConnectionLimitXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("fastcgiconnectionlimit"));
+		xml.writeCharacters(QString::number(m_fastCgiConnectionLimit));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeDefaultActionXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("defaultmediatypeaction"));
+		xml.writeStartElement(QStringLiteral("webserveraction"));
+		xml.writeCharacters(enumeratorString<QString>(m_defaultAction));
+		xml.writeEndElement();
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeCgiWorkerIdleTimeoutXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiworkeridletimeout"));
+		xml.writeCharacters(QString::number(m_cgiWorkerIdleTimeout));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeRequestBodyMemoryLimitXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("requestbodymemorylimit"));
+		xml.writeCharacters(QString::number(m_requestBodyMemoryLimit));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeCgiConcurrencyLimitXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiconcurrencylimit"));
+		xml.writeCharacters(QString::number(m_cgiConcurrencyLimit));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeCgiScriptConcurrencyLimitXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiscriptconcurrencylimit"));
+		xml.writeCharacters(QString::number(m_cgiScriptConcurrencyLimit));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeCgiQueueLengthXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiqueuelength"));
+		xml.writeCharacters(QString::number(m_cgiQueueLength));
 		xml.writeEndElement();
 		return true;
 	}
 
 
-	bool Configuration::writeMediaTypeCgiExecutablesXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("mediatypecgilist"));
+	bool Configuration::writeCgiQueueTimeoutXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiqueuetimeout"));
+		xml.writeCharacters(QString::number(m_cgiQueueTimeout));
+		xml.writeEndElement();
+		return true;
+	}
 
-		for(const auto & mediaType : m_mediaTypeCgiExecutables) {
-			xml.writeStartElement(QStringLiteral("mediatypecgi"));
+
+	bool Configuration::writeCgiResponseCacheSizeXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("cgiresponsecachesize"));
+		xml.writeCharacters(QString::number(m_cgiResponseCacheSize));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeMediaTypeProxiesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("mediatypeproxylist"));
+
+		for(const auto & mediaType : m_mediaTypeProxyUpstreams) {
+			xml.writeStartElement(QStringLiteral("mediatypeproxy"));
 			xml.writeStartElement(QStringLiteral("mediatype"));
 			xml.writeCharacters(mediaType.first);
 			xml.writeEndElement();
-			xml.writeStartElement(QStringLiteral("cgiexecutable"));
-			xml.writeCharacters(mediaType.second);
+
+			for(const auto & upstream : mediaType.second) {
+				xml.writeStartElement(QStringLiteral("upstream"));
+				xml.writeCharacters(upstream);
+				xml.writeEndElement();
+			}
+
+			xml.writeEndElement();
+		}
+
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeProxyRoutesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("proxyroutelist"));
+
+		for(const auto & route : m_proxyRoutes) {
+			xml.writeStartElement(QStringLiteral("proxyroute"));
+			xml.writeStartElement(QStringLiteral("pathprefix"));
+			xml.writeCharacters(route.first);
 			xml.writeEndElement();
+
+			for(const auto & upstream : route.second) {
+				xml.writeStartElement(QStringLiteral("upstream"));
+				xml.writeCharacters(upstream);
+				xml.writeEndElement();
+			}
+
 			xml.writeEndElement();
 		}
 
@@ -1158,11 +2027,90 @@ namespace Anansi {
 	}
 
 
-	bool Configuration::writeDefaultActionXml(QXmlStreamWriter & xml) const {
-		xml.writeStartElement(QStringLiteral("defaultmediatypeaction"));
-		xml.writeStartElement(QStringLiteral("webserveraction"));
-		xml.writeCharacters(enumeratorString<QString>(m_defaultAction));
+	bool Configuration::writeProxyConnectionLimitXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("proxyconnectionlimit"));
+		xml.writeCharacters(QString::number(m_proxyConnectionLimit));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeProxyTimeoutXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("proxytimeout"));
+		xml.writeCharacters(QString::number(m_proxyTimeout));
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeAccessLogXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("accesslog"));
+		xml.writeStartElement(QStringLiteral("file"));
+		xml.writeCharacters(m_accessLogFile);
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("format"));
+		xml.writeCharacters(enumeratorString<QString>(m_accessLogFormat));
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("rotatesize"));
+		xml.writeCharacters(QString::number(m_accessLogRotateSize));
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("rotateinterval"));
+		xml.writeCharacters(QString::number(m_accessLogRotateInterval));
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("rotatecount"));
+		xml.writeCharacters(QString::number(m_accessLogRotateCount));
+		xml.writeEndElement();
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeStatusEndpointXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("statusendpoint"));
+		xml.writeCharacters(m_statusEndpointEnabled ? "true" : "false");
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeRequestTraceXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("requesttrace"));
+		xml.writeStartElement(QStringLiteral("file"));
+		xml.writeCharacters(m_requestTraceFile);
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("samplerate"));
+		xml.writeCharacters(QString::number(m_requestTraceSampleRate));
+		xml.writeEndElement();
+		xml.writeStartElement(QStringLiteral("threshold"));
+		xml.writeCharacters(QString::number(m_requestTraceThreshold));
+		xml.writeEndElement();
+		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeLogLevelXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("loglevel"));
+		xml.writeCharacters(enumeratorString<QString>(m_logLevel));
 		xml.writeEndElement();
+		return true;
+	}
+
+
+	bool Configuration::writeMediaTypeModulesXml(QXmlStreamWriter & xml) const {
+		xml.writeStartElement(QStringLiteral("mediatypemodulelist"));
+
+		for(const auto & mediaType : m_mediaTypeModules) {
+			xml.writeStartElement(QStringLiteral("mediatypemodule"));
+			xml.writeStartElement(QStringLiteral("mediatype"));
+			xml.writeCharacters(mediaType.first);
+			xml.writeEndElement();
+			xml.writeStartElement(QStringLiteral("module"));
+			xml.writeCharacters(mediaType.second);
+			xml.writeEndElement();
+			xml.writeEndElement();
+		}
+
 		xml.writeEndElement();
 		return true;
 	}
@@ -1172,9 +2120,15 @@ namespace Anansi {
 		m_documentRoot.clear();
 		m_cgiBin.clear();
 		m_ipConnectionPolicies.clear();
+		m_ipConnectionPolicyTrie.clear();
 		m_extensionMediaTypes.clear();
 		m_mediaTypeActions.clear();
 		m_mediaTypeCgiExecutables.clear();
+		m_mediaTypeCgiTransports.clear();
+		m_mediaTypeCgiWorkers.clear();
+		m_mediaTypeProxyUpstreams.clear();
+		m_proxyRoutes.clear();
+		m_mediaTypeModules.clear();
 
 		m_documentRoot.insert({RuntimePlatformString, DefaultDocumentRoot});
 		m_listenAddress = DefaultBindAddress;
@@ -1186,6 +2140,26 @@ namespace Anansi {
 		m_showHiddenFilesInDirectoryListings = DefaultShowHiddenFiles;
 		m_directoryListingSortOrder = DefaultDirListSortOrder;
 		m_cgiTimeout = DefaultCgiTimeout;
+		m_fastCgiConnectionLimit = DefaultFastCgiConnectionLimit;
+		m_cgiWorkerIdleTimeout = DefaultCgiWorkerIdleTimeout;
+		m_requestBodyMemoryLimit = DefaultRequestBodyMemoryLimit;
+		m_cgiConcurrencyLimit = DefaultCgiConcurrencyLimit;
+		m_cgiScriptConcurrencyLimit = DefaultCgiScriptConcurrencyLimit;
+		m_cgiQueueLength = DefaultCgiQueueLength;
+		m_cgiQueueTimeout = DefaultCgiQueueTimeout;
+		m_cgiResponseCacheSize = DefaultCgiResponseCacheSize;
+		m_proxyConnectionLimit = DefaultProxyConnectionLimit;
+		m_proxyTimeout = DefaultProxyTimeout;
+		m_accessLogFile.clear();
+		m_accessLogFormat = DefaultAccessLogFormat;
+		m_accessLogRotateSize = DefaultAccessLogRotateSize;
+		m_accessLogRotateInterval = DefaultAccessLogRotateInterval;
+		m_accessLogRotateCount = DefaultAccessLogRotateCount;
+		m_statusEndpointEnabled = DefaultStatusEndpointEnabled;
+		m_requestTraceFile.clear();
+		m_requestTraceSampleRate = DefaultRequestTraceSampleRate;
+		m_requestTraceThreshold = DefaultRequestTraceThreshold;
+		m_logLevel = DefaultLogLevel;
 		m_allowServingFromCgiBin = DefaultAllowServeFromCgiBin;
 
 		addFileExtensionMediaType(QStringLiteral("html"), QStringLiteral("text/html"));
@@ -1657,24 +2631,265 @@ namespace Anansi {
 			m_mediaTypeCgiExecutables.erase(mediaType);
 		}
 
+		m_mediaTypeCgiTransports.erase(mediaType);
+		m_mediaTypeCgiWorkers.erase(mediaType);
+		return true;
+	}
+
+
+	CgiTransport Configuration::mediaTypeCgiTransport(const QString & mediaType) const {
+		auto transportIt = m_mediaTypeCgiTransports.find(mediaType);
+
+		if(m_mediaTypeCgiTransports.cend() == transportIt) {
+			return CgiTransport::Process;
+		}
+
+		return transportIt->second;
+	}
+
+
+	bool Configuration::setMediaTypeCgiTransport(const QString & mediaType, CgiTransport transport) {
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set CGI transport for an empty media type\n";
+			return false;
+		}
+
+		if(CgiTransport::Process == transport) {
+			// Process is the default so there's no need to store it
+			m_mediaTypeCgiTransports.erase(mediaType);
+		}
+		else {
+			m_mediaTypeCgiTransports.insert_or_assign(mediaType, transport);
+		}
+
+		return true;
+	}
+
+
+	Configuration::CgiWorkerLimits Configuration::mediaTypeCgiWorkers(const QString & mediaType) const {
+		auto workersIt = m_mediaTypeCgiWorkers.find(mediaType);
+
+		if(m_mediaTypeCgiWorkers.cend() == workersIt) {
+			return {};
+		}
+
+		return workersIt->second;
+	}
+
+
+	bool Configuration::setMediaTypeCgiWorkers(const QString & mediaType, int minimum, int maximum) {
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set CGI workers for an empty media type\n";
+			return false;
+		}
+
+		if(0 > minimum || minimum > maximum) {
+			return false;
+		}
+
+		if(0 == maximum) {
+			m_mediaTypeCgiWorkers.erase(mediaType);
+		}
+		else {
+			m_mediaTypeCgiWorkers.insert_or_assign(mediaType, CgiWorkerLimits{minimum, maximum});
+		}
+
+		return true;
+	}
+
+
+	Configuration::ProxyUpstreamList Configuration::mediaTypeProxyUpstreams(const QString & mediaType) const {
+		auto upstreamsIt = m_mediaTypeProxyUpstreams.find(mediaType);
+
+		if(m_mediaTypeProxyUpstreams.cend() == upstreamsIt) {
+			return {};
+		}
+
+		return upstreamsIt->second;
+	}
+
+
+	bool Configuration::setMediaTypeProxyUpstreams(const QString & mediaType, const ProxyUpstreamList & upstreams) {
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set proxy upstreams for an empty media type\n";
+			return false;
+		}
+
+		if(upstreams.empty()) {
+			return unsetMediaTypeProxyUpstreams(mediaType);
+		}
+
+		const auto isEmpty = [](const QString & upstream) {
+			return upstream.trimmed().isEmpty();
+		};
+
+		if(std::any_of(upstreams.cbegin(), upstreams.cend(), isEmpty)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set an empty proxy upstream for media type \"" << qPrintable(mediaType) << "\"\n";
+			return false;
+		}
+
+		m_mediaTypeProxyUpstreams.insert_or_assign(mediaType, upstreams);
+		return true;
+	}
+
+
+	bool Configuration::unsetMediaTypeProxyUpstreams(const QString & mediaType) {
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't unset proxy upstreams for an empty media type\n";
+			return false;
+		}
+
+		m_mediaTypeProxyUpstreams.erase(mediaType);
+		return true;
+	}
+
+
+	std::vector<QString> Configuration::proxyRoutePrefixes() const {
+		std::vector<QString> ret;
+		ret.reserve(m_proxyRoutes.size());
+
+		for(const auto & route : m_proxyRoutes) {
+			ret.push_back(route.first);
+		}
+
+		return ret;
+	}
+
+
+	Configuration::ProxyUpstreamList Configuration::proxyRouteUpstreams(const QString & pathPrefix) const {
+		auto routeIt = m_proxyRoutes.find(pathPrefix);
+
+		if(m_proxyRoutes.cend() == routeIt) {
+			return {};
+		}
+
+		return routeIt->second;
+	}
+
+
+	Configuration::ProxyUpstreamList Configuration::proxyUpstreamsForPath(const QString & path) const {
+		// routes are sorted, so any longer prefix of the path comes after a shorter one
+		const ProxyUpstreamList * upstreams = nullptr;
+
+		for(const auto & route : m_proxyRoutes) {
+			if(path.startsWith(route.first)) {
+				upstreams = &route.second;
+			}
+		}
+
+		if(!upstreams) {
+			return {};
+		}
+
+		return *upstreams;
+	}
+
+
+	bool Configuration::setProxyRoute(const QString & pathPrefix, const ProxyUpstreamList & upstreams) {
+		if(!pathPrefix.startsWith('/')) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: proxy route path prefix \"" << qPrintable(pathPrefix) << "\" must start with '/'\n";
+			return false;
+		}
+
+		if(upstreams.empty()) {
+			return unsetProxyRoute(pathPrefix);
+		}
+
+		const auto isEmpty = [](const QString & upstream) {
+			return upstream.trimmed().isEmpty();
+		};
+
+		if(std::any_of(upstreams.cbegin(), upstreams.cend(), isEmpty)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set an empty proxy upstream for path prefix \"" << qPrintable(pathPrefix) << "\"\n";
+			return false;
+		}
+
+		m_proxyRoutes.insert_or_assign(pathPrefix, upstreams);
+		return true;
+	}
+
+
+	bool Configuration::unsetProxyRoute(const QString & pathPrefix) {
+		m_proxyRoutes.erase(pathPrefix);
+		return true;
+	}
+
+
+	QString Configuration::mediaTypeModule(const QString & mediaType) const {
+		auto moduleIt = m_mediaTypeModules.find(mediaType);
+
+		if(m_mediaTypeModules.cend() == moduleIt) {
+			return {};
+		}
+
+		return moduleIt->second;
+	}
+
+
+	bool Configuration::setMediaTypeModule(const QString & mediaType, const QString & modulePath) {
+		if(modulePath.trimmed().isEmpty()) {
+			return unsetMediaTypeModule(mediaType);
+		}
+
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't set a handler module for an empty media type\n";
+			return false;
+		}
+
+		m_mediaTypeModules.insert_or_assign(mediaType, modulePath);
+		return true;
+	}
+
+
+	bool Configuration::unsetMediaTypeModule(const QString & mediaType) {
+		if(mediaType.isEmpty()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: can't unset the handler module for an empty media type\n";
+			return false;
+		}
+
+		m_mediaTypeModules.erase(mediaType);
 		return true;
 	}
 
 
+	bool Configuration::statusEndpointAllowed(const QHostAddress & addr) const {
+		if(addr.isLoopback()) {
+			return true;
+		}
+
+		const auto policy = m_ipConnectionPolicyTrie.find(addr);
+		return policy && ConnectionPolicy::Accept == *policy;
+	}
+
+
 	bool Configuration::ipAddressIsRegistered(const QString & addr) const {
 		return m_ipConnectionPolicies.cend() != m_ipConnectionPolicies.find(addr);
 	}
 
 
+	ConnectionPolicy Configuration::registeredIpAddressConnectionPolicy(const QString & addr) const {
+		if(const auto policyIt = m_ipConnectionPolicies.find(addr); m_ipConnectionPolicies.cend() != policyIt) {
+			return policyIt->second;
+		}
+
+		return ConnectionPolicy::None;
+	}
+
+
 	ConnectionPolicy Configuration::ipAddressConnectionPolicy(const QString & addr) const {
-		if(!isValidIpAddress(addr)) {
+		const QHostAddress hostAddr(addr);
+
+		if(hostAddr.isNull()) {
 			return ConnectionPolicy::None;
 		}
 
-		auto policyIt = m_ipConnectionPolicies.find(addr);
+		return ipAddressConnectionPolicy(hostAddr);
+	}
 
-		if(m_ipConnectionPolicies.cend() != policyIt) {
-			return policyIt->second;
+
+	ConnectionPolicy Configuration::ipAddressConnectionPolicy(const QHostAddress & addr) const {
+		if(const auto policy = m_ipConnectionPolicyTrie.find(addr); policy) {
+			return *policy;
 		}
 
 		return defaultConnectionPolicy();
@@ -1683,34 +2898,60 @@ namespace Anansi {
 
 	void Configuration::clearAllIpAddressConnectionPolicies() {
 		m_ipConnectionPolicies.clear();
+		m_ipConnectionPolicyTrie.clear();
 	}
 
 
 	bool Configuration::setIpAddressConnectionPolicy(const QString & addr, ConnectionPolicy policy) {
-		if(!isValidIpAddress(addr)) {
+		const auto prefix = IpConnectionPolicyTrie::parsePrefix(addr);
+
+		if(!prefix) {
 			return false;
 		}
 
 		m_ipConnectionPolicies.insert_or_assign(addr, policy);
+
+		// "no policy" entries defer to less specific ones and ultimately the default policy
+		if(ConnectionPolicy::None == policy) {
+			rebuildIpConnectionPolicyTrie();
+		}
+		else {
+			m_ipConnectionPolicyTrie.insert(prefix->first, prefix->second, policy);
+		}
+
 		return true;
 	}
 
 
 	bool Configuration::unsetIpAddressConnectionPolicy(const QString & addr) {
-		if(!isValidIpAddress(addr)) {
+		if(!IpConnectionPolicyTrie::parsePrefix(addr)) {
 			return false;
 		}
 
-		auto policyIt = m_ipConnectionPolicies.find(addr);
-
-		if(m_ipConnectionPolicies.cend() != policyIt) {
-			m_ipConnectionPolicies.erase(policyIt);
+		if(0 < m_ipConnectionPolicies.erase(addr)) {
+			rebuildIpConnectionPolicyTrie();
 		}
 
 		return true;
 	}
 
 
+	void Configuration::rebuildIpConnectionPolicyTrie() {
+		m_ipConnectionPolicyTrie.clear();
+
+		for(const auto & entry : m_ipConnectionPolicies) {
+			if(ConnectionPolicy::None == entry.second) {
+				continue;
+			}
+
+			if(const auto prefix = IpConnectionPolicyTrie::parsePrefix(entry.first); prefix) {
+				m_ipConnectionPolicyTrie.insert(prefix->first, prefix->second, entry.second);
+			}
+		}
+	}
+
+
+
 #if !defined(NDEBUG)
 	void Configuration::dumpFileAssociationMediaTypes() {
 		for(const auto & ext : m_extensionMediaTypes) {
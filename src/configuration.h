@@ -33,6 +33,7 @@
 /// - <QString>
 /// - types.h
 /// - qtstdhash.h
+/// - ipconnectionpolicytrie.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -50,6 +51,7 @@
 
 #include "types.h"
 #include "qtstdhash.h"
+#include "ipconnectionpolicytrie.h"
 
 class QXmlStreamWriter;
 class QXmlStreamReader;
@@ -69,6 +71,18 @@ namespace Anansi {
 		using MediaTypeExtensionMap = std::map<QString, MediaTypeList>;
 		using MediaTypeActionMap = std::unordered_map<QString, WebServerAction>;
 		using MediaTypeCgiMap = std::unordered_map<QString, QString>;
+		using MediaTypeCgiTransportMap = std::unordered_map<QString, CgiTransport>;
+
+		struct CgiWorkerLimits {
+			int minimum = 0;
+			int maximum = 0;
+		};
+
+		using MediaTypeCgiWorkersMap = std::unordered_map<QString, CgiWorkerLimits>;
+		using ProxyUpstreamList = std::vector<QString>;
+		using MediaTypeProxyMap = std::unordered_map<QString, ProxyUpstreamList>;
+		using ProxyRouteMap = std::map<QString, ProxyUpstreamList>;
+		using MediaTypeModuleMap = std::unordered_map<QString, QString>;
 		using IpConnectionPolicyMap = std::unordered_map<QString, ConnectionPolicy>;
 
 		static constexpr const uint16_t DefaultPort = 80;
@@ -143,6 +157,263 @@ namespace Anansi {
 			return false;
 		}
 
+		inline int fastCgiConnectionLimit() const noexcept {
+			return m_fastCgiConnectionLimit;
+		}
+
+		inline bool setFastCgiConnectionLimit(int limit) noexcept {
+			if(0 < limit) {
+				m_fastCgiConnectionLimit = limit;
+				return true;
+			}
+
+			return false;
+		}
+
+		inline int cgiWorkerIdleTimeout() const noexcept {
+			return m_cgiWorkerIdleTimeout;
+		}
+
+		inline bool setCgiWorkerIdleTimeout(int msec) noexcept {
+			if(0 < msec) {
+				m_cgiWorkerIdleTimeout = msec;
+				return true;
+			}
+
+			return false;
+		}
+
+		// how many CGI processes may run at once, in total and for any one script; 0 means
+		// unlimited
+		inline int cgiConcurrencyLimit() const noexcept {
+			return m_cgiConcurrencyLimit;
+		}
+
+		inline bool setCgiConcurrencyLimit(int limit) noexcept {
+			if(0 <= limit) {
+				m_cgiConcurrencyLimit = limit;
+				return true;
+			}
+
+			return false;
+		}
+
+		inline int cgiScriptConcurrencyLimit() const noexcept {
+			return m_cgiScriptConcurrencyLimit;
+		}
+
+		inline bool setCgiScriptConcurrencyLimit(int limit) noexcept {
+			if(0 <= limit) {
+				m_cgiScriptConcurrencyLimit = limit;
+				return true;
+			}
+
+			return false;
+		}
+
+		// CGI requests over the concurrency limits wait in a queue this long for up to
+		// cgiQueueTimeout() msec; beyond that they are turned away
+		inline int cgiQueueLength() const noexcept {
+			return m_cgiQueueLength;
+		}
+
+		inline bool setCgiQueueLength(int length) noexcept {
+			if(0 <= length) {
+				m_cgiQueueLength = length;
+				return true;
+			}
+
+			return false;
+		}
+
+		inline int cgiQueueTimeout() const noexcept {
+			return m_cgiQueueTimeout;
+		}
+
+		inline bool setCgiQueueTimeout(int msec) noexcept {
+			if(0 < msec) {
+				m_cgiQueueTimeout = msec;
+				return true;
+			}
+
+			return false;
+		}
+
+		// how much CGI output to keep for reuse by later GET requests; 0 disables the cache
+		inline int cgiResponseCacheSize() const noexcept {
+			return m_cgiResponseCacheSize;
+		}
+
+		inline bool setCgiResponseCacheSize(int bytes) noexcept {
+			if(0 <= bytes) {
+				m_cgiResponseCacheSize = bytes;
+				return true;
+			}
+
+			return false;
+		}
+
+		// how many connections to keep open to each upstream server for proxied requests
+		inline int proxyConnectionLimit() const noexcept {
+			return m_proxyConnectionLimit;
+		}
+
+		inline bool setProxyConnectionLimit(int limit) noexcept {
+			if(0 < limit) {
+				m_proxyConnectionLimit = limit;
+				return true;
+			}
+
+			return false;
+		}
+
+		// how long to wait for an upstream server to connect, or to send more of its response
+		inline int proxyTimeout() const noexcept {
+			return m_proxyTimeout;
+		}
+
+		inline bool setProxyTimeout(int msec) noexcept {
+			if(0 < msec) {
+				m_proxyTimeout = msec;
+				return true;
+			}
+
+			return false;
+		}
+
+		// where to write the access log; empty for no on-disk log
+		inline const QString & accessLogFile() const noexcept {
+			return m_accessLogFile;
+		}
+
+		inline void setAccessLogFile(const QString & fileName) {
+			m_accessLogFile = fileName;
+		}
+
+		inline AccessLogFormat accessLogFormat() const noexcept {
+			return m_accessLogFormat;
+		}
+
+		inline void setAccessLogFormat(AccessLogFormat format) noexcept {
+			m_accessLogFormat = format;
+		}
+
+		// the access log is rotated once it grows past this many bytes, or once it has been
+		// open this many seconds; 0 turns either off
+		inline int accessLogRotateSize() const noexcept {
+			return m_accessLogRotateSize;
+		}
+
+		inline bool setAccessLogRotateSize(int bytes) noexcept {
+			if(0 <= bytes) {
+				m_accessLogRotateSize = bytes;
+				return true;
+			}
+
+			return false;
+		}
+
+		inline int accessLogRotateInterval() const noexcept {
+			return m_accessLogRotateInterval;
+		}
+
+		inline bool setAccessLogRotateInterval(int seconds) noexcept {
+			if(0 <= seconds) {
+				m_accessLogRotateInterval = seconds;
+				return true;
+			}
+
+			return false;
+		}
+
+		// how many rotated logs to keep
+		inline int accessLogRotateCount() const noexcept {
+			return m_accessLogRotateCount;
+		}
+
+		inline bool setAccessLogRotateCount(int count) noexcept {
+			if(0 < count) {
+				m_accessLogRotateCount = count;
+				return true;
+			}
+
+			return false;
+		}
+
+		// the built-in status report at /.anansi/status
+		inline bool statusEndpointEnabled() const noexcept {
+			return m_statusEndpointEnabled;
+		}
+
+		inline void setStatusEndpointEnabled(bool enabled) noexcept {
+			m_statusEndpointEnabled = enabled;
+		}
+
+		// only loopback addresses and those covered by an explicit Accept entry in the IP
+		// connection policies may see the status report - the default policy never applies
+		bool statusEndpointAllowed(const QHostAddress & addr) const;
+
+		// the least severe diagnostic messages to write to stderr
+		inline LogLevel logLevel() const noexcept {
+			return m_logLevel;
+		}
+
+		inline void setLogLevel(LogLevel level) noexcept {
+			m_logLevel = level;
+		}
+
+		// where to write sampled request traces; empty for no tracing
+		inline const QString & requestTraceFile() const noexcept {
+			return m_requestTraceFile;
+		}
+
+		inline void setRequestTraceFile(const QString & fileName) {
+			m_requestTraceFile = fileName;
+		}
+
+		// one in this many requests is traced; 0 to trace only slow requests
+		inline int requestTraceSampleRate() const noexcept {
+			return m_requestTraceSampleRate;
+		}
+
+		inline bool setRequestTraceSampleRate(int rate) noexcept {
+			if(0 <= rate) {
+				m_requestTraceSampleRate = rate;
+				return true;
+			}
+
+			return false;
+		}
+
+		// every request taking at least this many msec is traced; 0 to trace only the sample
+		inline int requestTraceThreshold() const noexcept {
+			return m_requestTraceThreshold;
+		}
+
+		inline bool setRequestTraceThreshold(int msec) noexcept {
+			if(0 <= msec) {
+				m_requestTraceThreshold = msec;
+				return true;
+			}
+
+			return false;
+		}
+
+		// request bodies larger than this that have to be held in full are kept in a
+		// temporary file rather than in memory
+		inline int requestBodyMemoryLimit() const noexcept {
+			return m_requestBodyMemoryLimit;
+		}
+
+		inline bool setRequestBodyMemoryLimit(int bytes) noexcept {
+			if(0 <= bytes) {
+				m_requestBodyMemoryLimit = bytes;
+				return true;
+			}
+
+			return false;
+		}
+
 		// if cgi-bin is inside document root and a request resolves to serving a file from
 		// inside cgi-bin, is it actually served? (this is a security leak)
 		inline bool allowServingFilesFromCgiBin() const noexcept {
@@ -179,8 +450,15 @@ namespace Anansi {
 			m_defaultConnectionPolicy = policy;
 		}
 
+		// policies can be set for single addresses or for CIDR blocks (e.g. "10.0.0.0/8").
+		// looking up an address gives the policy of the most specific entry that contains it
+		// and has a policy, or the default policy if there is none. the string overload
+		// parses the address and gives None if it isn't one. the policy an entry was set up
+		// with, None included, is given by registeredIpAddressConnectionPolicy()
 		bool ipAddressIsRegistered(const QString & addr) const;
+		ConnectionPolicy registeredIpAddressConnectionPolicy(const QString & addr) const;
 		ConnectionPolicy ipAddressConnectionPolicy(const QString & addr) const;
+		ConnectionPolicy ipAddressConnectionPolicy(const QHostAddress & addr) const;
 		bool setIpAddressConnectionPolicy(const QString & addr, ConnectionPolicy p);
 		bool unsetIpAddressConnectionPolicy(const QString & addr);
 		void clearAllIpAddressConnectionPolicies();
@@ -226,6 +504,35 @@ namespace Anansi {
 		bool setMediaTypeCgi(const QString & mediaType, const QString & cgiExe);
 		bool unsetMediaTypeCgi(const QString & mediaType);
 
+		// for FastCGI media types the CGI "executable" is the responder address,
+		// either "unix:/path/to/socket" or "host:port"
+		CgiTransport mediaTypeCgiTransport(const QString & mediaType) const;
+		bool setMediaTypeCgiTransport(const QString & mediaType, CgiTransport transport);
+
+		// pre-forked worker processes kept ready to run the CGI interpreter for a media
+		// type; a maximum of 0 means no workers are used
+		CgiWorkerLimits mediaTypeCgiWorkers(const QString & mediaType) const;
+		bool setMediaTypeCgiWorkers(const QString & mediaType, int minimum, int maximum);
+
+		// upstream servers for media types whose action is Proxy, each either "host:port"
+		// or "unix:/path/to/socket"
+		ProxyUpstreamList mediaTypeProxyUpstreams(const QString & mediaType) const;
+		bool setMediaTypeProxyUpstreams(const QString & mediaType, const ProxyUpstreamList & upstreams);
+		bool unsetMediaTypeProxyUpstreams(const QString & mediaType);
+
+		// requests whose path starts with a route's prefix are proxied to its upstream
+		// servers whatever their media type; the longest matching prefix wins
+		std::vector<QString> proxyRoutePrefixes() const;
+		ProxyUpstreamList proxyRouteUpstreams(const QString & pathPrefix) const;
+		ProxyUpstreamList proxyUpstreamsForPath(const QString & path) const;
+		bool setProxyRoute(const QString & pathPrefix, const ProxyUpstreamList & upstreams);
+		bool unsetProxyRoute(const QString & pathPrefix);
+
+		// the shared-object handler module for media types whose action is Module
+		QString mediaTypeModule(const QString & mediaType) const;
+		bool setMediaTypeModule(const QString & mediaType, const QString & modulePath);
+		bool unsetMediaTypeModule(const QString & mediaType);
+
 #if !defined(NDEBUG)
 		void dumpFileAssociationMediaTypes();
 		void dumpFileAssociationMediaTypes(const QString & ext);
@@ -233,6 +540,7 @@ namespace Anansi {
 
 	private:
 		void setDefaults();
+		void rebuildIpConnectionPolicyTrie();
 
 		bool readWebserverXml(QXmlStreamReader &);
 		bool writeWebserverXml(QXmlStreamWriter &) const;
@@ -257,6 +565,26 @@ namespace Anansi {
 		bool readMediaTypeActionXml(QXmlStreamReader &);
 		bool readMediaTypeCgiExecutablesXml(QXmlStreamReader &);
 		bool readMediaTypeCgiExecutableXml(QXmlStreamReader &);
+		bool readFastCgiConnectionLimitXml(QXmlStreamReader &);
+		bool readCgiWorkerIdleTimeoutXml(QXmlStreamReader &);
+		bool readRequestBodyMemoryLimitXml(QXmlStreamReader &);
+		bool readCgiConcurrencyLimitXml(QXmlStreamReader &);
+		bool readCgiScriptConcurrencyLimitXml(QXmlStreamReader &);
+		bool readCgiQueueLengthXml(QXmlStreamReader &);
+		bool readCgiQueueTimeoutXml(QXmlStreamReader &);
+		bool readCgiResponseCacheSizeXml(QXmlStreamReader &);
+		bool readMediaTypeProxiesXml(QXmlStreamReader &);
+		bool readMediaTypeProxyXml(QXmlStreamReader &);
+		bool readProxyRoutesXml(QXmlStreamReader &);
+		bool readProxyRouteXml(QXmlStreamReader &);
+		bool readProxyConnectionLimitXml(QXmlStreamReader &);
+		bool readProxyTimeoutXml(QXmlStreamReader &);
+		bool readAccessLogXml(QXmlStreamReader &);
+		bool readStatusEndpointXml(QXmlStreamReader &);
+		bool readRequestTraceXml(QXmlStreamReader &);
+		bool readLogLevelXml(QXmlStreamReader &);
+		bool readMediaTypeModulesXml(QXmlStreamReader &);
+		bool readMediaTypeModuleXml(QXmlStreamReader &);
 
 		bool writeStartXml(QXmlStreamWriter &) const;
 		bool writeEndXml(QXmlStreamWriter &) const;
@@ -275,6 +603,23 @@ namespace Anansi {
 		bool writeFileExtensionMediaTypesXml(QXmlStreamWriter &) const;
 		bool writeMediaTypeActionsXml(QXmlStreamWriter &) const;
 		bool writeMediaTypeCgiExecutablesXml(QXmlStreamWriter &) const;
+		bool writeFastCgiConnectionLimitXml(QXmlStreamWriter &) const;
+		bool writeCgiWorkerIdleTimeoutXml(QXmlStreamWriter &) const;
+		bool writeRequestBodyMemoryLimitXml(QXmlStreamWriter &) const;
+		bool writeCgiConcurrencyLimitXml(QXmlStreamWriter &) const;
+		bool writeCgiScriptConcurrencyLimitXml(QXmlStreamWriter &) const;
+		bool writeCgiQueueLengthXml(QXmlStreamWriter &) const;
+		bool writeCgiQueueTimeoutXml(QXmlStreamWriter &) const;
+		bool writeCgiResponseCacheSizeXml(QXmlStreamWriter &) const;
+		bool writeMediaTypeProxiesXml(QXmlStreamWriter &) const;
+		bool writeProxyRoutesXml(QXmlStreamWriter &) const;
+		bool writeProxyConnectionLimitXml(QXmlStreamWriter &) const;
+		bool writeProxyTimeoutXml(QXmlStreamWriter &) const;
+		bool writeAccessLogXml(QXmlStreamWriter &) const;
+		bool writeStatusEndpointXml(QXmlStreamWriter &) const;
+		bool writeRequestTraceXml(QXmlStreamWriter &) const;
+		bool writeLogLevelXml(QXmlStreamWriter &) const;
+		bool writeMediaTypeModulesXml(QXmlStreamWriter &) const;
 		bool writeDefaultActionXml(QXmlStreamWriter &) const;
 
 		QString m_listenAddress;
@@ -283,9 +628,15 @@ namespace Anansi {
 		QString m_adminEmail;
 
 		IpConnectionPolicyMap m_ipConnectionPolicies;
+		IpConnectionPolicyTrie m_ipConnectionPolicyTrie;
 		MediaTypeExtensionMap m_extensionMediaTypes;
 		MediaTypeActionMap m_mediaTypeActions;
 		MediaTypeCgiMap m_mediaTypeCgiExecutables;
+		MediaTypeCgiTransportMap m_mediaTypeCgiTransports;
+		MediaTypeCgiWorkersMap m_mediaTypeCgiWorkers;
+		MediaTypeProxyMap m_mediaTypeProxyUpstreams;
+		ProxyRouteMap m_proxyRoutes;
+		MediaTypeModuleMap m_mediaTypeModules;
 		std::unordered_map<QString, QString> m_cgiBin;
 		bool m_allowServingFromCgiBin;
 
@@ -293,6 +644,26 @@ namespace Anansi {
 		QString m_defaultMediaType;
 		WebServerAction m_defaultAction;
 		int m_cgiTimeout;
+		int m_fastCgiConnectionLimit;
+		int m_cgiWorkerIdleTimeout;
+		int m_requestBodyMemoryLimit;
+		int m_cgiConcurrencyLimit;
+		int m_cgiScriptConcurrencyLimit;
+		int m_cgiQueueLength;
+		int m_cgiQueueTimeout;
+		int m_cgiResponseCacheSize;
+		int m_proxyConnectionLimit;
+		int m_proxyTimeout;
+		QString m_accessLogFile;
+		AccessLogFormat m_accessLogFormat;
+		int m_accessLogRotateSize;
+		int m_accessLogRotateInterval;
+		int m_accessLogRotateCount;
+		bool m_statusEndpointEnabled;
+		QString m_requestTraceFile;
+		int m_requestTraceSampleRate;
+		int m_requestTraceThreshold;
+		LogLevel m_logLevel;
 
 		bool m_allowDirectoryListings;
 		bool m_showHiddenFilesInDirectoryListings;
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file configurationwatcher.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the ConfigurationWatcher class for Anansi.
+///
+/// QFileSystemWatcher uses inotify on Linux. Editors that save by writing a new file
+/// and renaming it over the old one end the watch on the old file, so the file is
+/// added to the watcher again after every change.
+///
+/// \dep
+/// - configurationwatcher.h
+/// - <iostream>
+/// - <QFileInfo>
+/// - macros.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "configurationwatcher.h"
+
+#include <iostream>
+
+#include <QFileInfo>
+
+#include "macros.h"
+
+
+namespace Anansi {
+
+
+	ConfigurationWatcher::ConfigurationWatcher(const QString & fileName, QObject * parent)
+	: QObject(parent),
+	  m_fileName(QFileInfo(fileName).absoluteFilePath()),
+	  m_loading(false),
+	  m_changedWhileLoading(false) {
+		m_settleTimer.setSingleShot(true);
+		m_settleTimer.setInterval(SettleTime);
+		connect(&m_settleTimer, &QTimer::timeout, this, &ConfigurationWatcher::startLoad);
+		connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ConfigurationWatcher::fileChanged);
+
+		if(!m_watcher.addPath(m_fileName)) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to watch configuration file \"" << qPrintable(m_fileName) << "\"\n";
+		}
+	}
+
+
+	ConfigurationWatcher::~ConfigurationWatcher() {
+		if(m_loader.joinable()) {
+			m_loader.join();
+		}
+	}
+
+
+	void ConfigurationWatcher::fileChanged() {
+		// each further change restarts the wait
+		m_settleTimer.start();
+	}
+
+
+	std::optional<Configuration> ConfigurationWatcher::loadValidConfiguration(const QString & fileName) {
+		auto config = Configuration::loadFrom(fileName);
+
+		if(!config) {
+			return {};
+		}
+
+		// most likely a document root that is still being set up - carry on with the old
+		// configuration rather than serve nothing
+		if(!QFileInfo(config->documentRoot()).isDir()) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: document root \"" << qPrintable(config->documentRoot()) << "\" in \"" << qPrintable(fileName) << "\" is not a directory\n";
+			return {};
+		}
+
+		return config;
+	}
+
+
+	void ConfigurationWatcher::startLoad() {
+		if(m_loading) {
+			m_changedWhileLoading = true;
+			return;
+		}
+
+		if(!m_watcher.files().contains(m_fileName)) {
+			if(!QFileInfo::exists(m_fileName)) {
+				// removed, or not yet renamed into place; look again shortly
+				m_settleTimer.start();
+				return;
+			}
+
+			m_watcher.addPath(m_fileName);
+		}
+
+		if(m_loader.joinable()) {
+			m_loader.join();
+		}
+
+		m_loading = true;
+		m_changedWhileLoading = false;
+
+		m_loader = std::thread([this, fileName = m_fileName]() {
+			auto config = loadValidConfiguration(fileName);
+
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_loaded = std::move(config);
+			}
+
+			QMetaObject::invokeMethod(this, "finishLoad", Qt::QueuedConnection);
+		});
+	}
+
+
+	void ConfigurationWatcher::finishLoad() {
+		std::optional<Configuration> config;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			config.swap(m_loaded);
+		}
+
+		m_loading = false;
+
+		if(m_changedWhileLoading) {
+			// what was loaded is already out of date
+			startLoad();
+			return;
+		}
+
+		if(!config) {
+			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: configuration in \"" << qPrintable(m_fileName) << "\" is not valid - keeping the current configuration\n";
+			Q_EMIT configurationRejected(m_fileName);
+			return;
+		}
+
+		Q_EMIT configurationLoaded(*config);
+	}
+
+
+}  // namespace Anansi
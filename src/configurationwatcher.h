@@ -0,0 +1,99 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file configurationwatcher.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the ConfigurationWatcher class for Anansi.
+///
+/// \dep
+/// - <mutex>
+/// - <optional>
+/// - <thread>
+/// - <QObject>
+/// - <QString>
+/// - <QFileSystemWatcher>
+/// - <QTimer>
+/// - configuration.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CONFIGURATIONWATCHER_H
+#define ANANSI_CONFIGURATIONWATCHER_H
+
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <QObject>
+#include <QString>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include "configuration.h"
+
+namespace Anansi {
+
+	// watches a configuration file and loads it again whenever it changes. loading
+	// happens on a background thread; the result is delivered on the watcher's own
+	// thread, and only if the file parsed and passed validation
+	class ConfigurationWatcher final : public QObject {
+		Q_OBJECT
+
+	public:
+		// how long the file must be left alone before it is loaded, so that a save made
+		// in several writes is only loaded once it is complete
+		static constexpr const int SettleTime = 250;
+
+		explicit ConfigurationWatcher(const QString & fileName, QObject * parent = nullptr);
+		~ConfigurationWatcher() override;
+
+		inline const QString & fileName() const noexcept {
+			return m_fileName;
+		}
+
+	Q_SIGNALS:
+		void configurationLoaded(const Configuration & config) const;
+		void configurationRejected(const QString & fileName) const;
+
+	private Q_SLOTS:
+		void finishLoad();
+
+	private:
+		void fileChanged();
+		void startLoad();
+		static std::optional<Configuration> loadValidConfiguration(const QString & fileName);
+
+		QString m_fileName;
+		QFileSystemWatcher m_watcher;
+		QTimer m_settleTimer;
+		std::thread m_loader;
+		std::mutex m_lock;
+		std::optional<Configuration> m_loaded;
+		bool m_loading;
+		bool m_changedWhileLoading;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CONFIGURATIONWATCHER_H
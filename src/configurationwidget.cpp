@@ -29,6 +29,7 @@
 /// - configurationwidget.ui
 /// - <cstdint>
 /// - <array>
+/// - <utility>
 /// - <Qt>
 /// - <QString>
 /// - <QFileInfo>
@@ -50,6 +51,7 @@
 
 #include <cstdint>
 #include <array>
+#include <utility>
 
 #include <Qt>
 #include <QString>
@@ -119,6 +121,7 @@ namespace Anansi {
 		connect(m_ui->allowServingCgiBin, &QCheckBox::toggled, [this](bool allow) {
 			eqAssert(m_server, "server must not be null");
 			m_server->configuration().setAllowServingFilesFromCgiBin(allow);
+			m_server->configurationChanged();
 
 			if(allow) {
 				showTransientNotification(this, tr("<p>Allowing direct access to files inside your CGI bin directory is considered a security risk. This option should be used sparingly and with caution.</p><p><small>This option only has any effect if your CGI bin directory is inside your document root. If it is outside your document root, files in your CGI bin directory are not directly accessible.</small></p>"), NotificationType::Warning);
@@ -131,16 +134,19 @@ namespace Anansi {
 			m_ui->sortOrderLabel->setEnabled(allow);
 			m_ui->showHiddenFiles->setEnabled(allow);
 			m_server->configuration().setDirectoryListingsAllowed(allow);
+			m_server->configurationChanged();
 		});
 
 		connect(m_ui->showHiddenFiles, &QCheckBox::toggled, [this](bool show) {
 			eqAssert(m_server, "server must not be null");
 			m_server->configuration().setShowHiddenFilesInDirectoryListings(show);
+			m_server->configurationChanged();
 		});
 
 		connect(m_ui->sortOrder, &DirectoryListingSortOrderCombo::sortOrderChanged, [this](DirectoryListingSortOrder order) {
 			eqAssert(m_server, "server must not be null");
 			m_server->configuration().setDirectoryListingSortOrder(order);
+			m_server->configurationChanged();
 		});
 	}
 
@@ -163,7 +169,7 @@ namespace Anansi {
 		m_server = server;
 
 		if(m_server) {
-			for(const auto & mediaType : m_server->configuration().registeredMediaTypes()) {
+			for(const auto & mediaType : std::as_const(*m_server).configuration().registeredMediaTypes()) {
 				m_ui->fileAssociations->addAvailableMediaType(mediaType);
 			}
 
@@ -171,11 +177,7 @@ namespace Anansi {
 
 			// prevent editing of listen address/port while server is listening
 			connect(m_server, &Server::listeningStateChanged, m_ui->serverDetails, &QWidget::setDisabled);
-
-            // can't use qOverload() with MSVC because it doesn't implement SD-6 (feature
-            // detection macros)
-            connect(m_server, &Server::requestConnectionPolicyDetermined, m_ui->accessLog, QOverload<const QString &, uint16_t, ConnectionPolicy>::of(&AccessLogWidget::addPolicyEntry), Qt::QueuedConnection);
-            connect(m_server, &Server::requestActionTaken, m_ui->accessLog, QOverload<const QString &, uint16_t, const QString &, WebServerAction>::of(&AccessLogWidget::addActionEntry), Qt::QueuedConnection);
+			connect(m_server, &Server::requestEventsReceived, m_ui->accessLog, &AccessLogWidget::addEntries);
 		}
 		else {
 			setEnabled(false);
@@ -199,7 +201,7 @@ namespace Anansi {
 			 QSignalBlocker(m_ui->accessLog),
 		  }};
 
-		const Configuration & opts = m_server->configuration();
+		const Configuration & opts = std::as_const(*m_server).configuration();
 		m_ui->serverDetails->setDocumentRoot(opts.documentRoot());
 		m_ui->serverDetails->setListenAddress(opts.listenAddress());
 		m_ui->serverDetails->setCgiBin(opts.cgiBin());
@@ -261,6 +263,7 @@ namespace Anansi {
 		}
 
 		m_server->configuration().setListenAddress(addr);
+		m_server->configurationChanged();
 	}
 
 
@@ -324,6 +327,7 @@ namespace Anansi {
 		eqAssert(m_server, "server must not be null");
 		m_ui->accessControl->clearAllConnectionPolicies();
 		m_server->configuration().clearAllIpAddressConnectionPolicies();
+		m_server->configurationChanged();
 	}
 
 
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file connectsocket.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the connectSocket() function for Anansi.
+///
+/// Plain blocking sockets are used by connections that outlive the RequestHandler
+/// thread that opened them, since Qt sockets can't be used from other threads. Only
+/// unix-like platforms are currently supported.
+///
+/// \dep
+/// - connectsocket.h
+/// - <cerrno>
+/// - <cstring>
+/// - <QtGlobal>
+/// - logger.h
+/// - <sys/socket.h>, <sys/un.h>, <netdb.h>, <poll.h>, <fcntl.h>, <unistd.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "connectsocket.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "logger.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace Anansi {
+
+
+#if defined(Q_OS_UNIX)
+
+
+	static bool setNonBlocking(int fd, bool nonBlocking) {
+		const auto flags = ::fcntl(fd, F_GETFL);
+
+		if(-1 == flags) {
+			return false;
+		}
+
+		return -1 != ::fcntl(fd, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+	}
+
+
+	static bool connectWithTimeout(int fd, const sockaddr * addr, socklen_t addrLength, int timeout) {
+		if(!setNonBlocking(fd, true)) {
+			return false;
+		}
+
+		if(-1 == ::connect(fd, addr, addrLength)) {
+			if(EINPROGRESS != errno) {
+				return false;
+			}
+
+			pollfd pfd = {fd, POLLOUT, 0};
+			int result;
+
+			do {
+				result = ::poll(&pfd, 1, timeout);
+			} while(-1 == result && EINTR == errno);
+
+			if(1 != result) {
+				return false;
+			}
+
+			int error = 0;
+			socklen_t errorLength = sizeof(error);
+
+			if(-1 == ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) || 0 != error) {
+				return false;
+			}
+		}
+
+		return setNonBlocking(fd, false);
+	}
+
+
+	static int openSocket(int domain) {
+		const int fd = ::socket(domain, SOCK_STREAM, 0);
+
+		if(-1 == fd) {
+			return -1;
+		}
+
+		// connections must not leak into spawned CGI processes
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+#if defined(SO_NOSIGPIPE)
+		int noSigPipe = 1;
+		::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+		return fd;
+	}
+
+
+	int connectSocket(const QString & address, int timeout) {
+		if(address.startsWith(QStringLiteral("unix:"))) {
+			const auto path = address.mid(5).toLocal8Bit();
+			sockaddr_un addr;
+			std::memset(&addr, 0, sizeof(addr));
+
+			if(path.isEmpty() || static_cast<std::size_t>(path.size()) >= sizeof(addr.sun_path)) {
+				anansiLog(Warning, "invalid socket path in \"" << qPrintable(address) << "\"");
+				return -1;
+			}
+
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, path.constData(), static_cast<std::size_t>(path.size()));
+			const int fd = openSocket(AF_UNIX);
+
+			if(-1 == fd) {
+				anansiLog(Warning, "failed to create socket for \"" << qPrintable(address) << "\": " << std::strerror(errno));
+				return -1;
+			}
+
+			if(!connectWithTimeout(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr), timeout)) {
+				anansiLog(Warning, "failed to connect to \"" << qPrintable(address) << "\": " << std::strerror(errno));
+				::close(fd);
+				return -1;
+			}
+
+			return fd;
+		}
+
+		const auto colonIdx = address.lastIndexOf(':');
+
+		if(0 >= colonIdx) {
+			anansiLog(Warning, "invalid address \"" << qPrintable(address) << "\" (expecting \"unix:/path\" or \"host:port\")");
+			return -1;
+		}
+
+		auto host = address.left(colonIdx);
+
+		// IPv6 literal in the form [::1]:9000
+		if(host.startsWith('[') && host.endsWith(']')) {
+			host = host.mid(1, host.size() - 2);
+		}
+
+		const auto hostData = host.toUtf8();
+		const auto portData = address.mid(colonIdx + 1).toUtf8();
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo * addresses = nullptr;
+
+		if(0 != ::getaddrinfo(hostData.constData(), portData.constData(), &hints, &addresses)) {
+			anansiLog(Warning, "failed to resolve address \"" << qPrintable(address) << "\"");
+			return -1;
+		}
+
+		for(auto * addr = addresses; addr; addr = addr->ai_next) {
+			const int fd = openSocket(addr->ai_family);
+
+			if(-1 == fd) {
+				continue;
+			}
+
+			if(connectWithTimeout(fd, addr->ai_addr, addr->ai_addrlen, timeout)) {
+				::freeaddrinfo(addresses);
+				return fd;
+			}
+
+			::close(fd);
+		}
+
+		::freeaddrinfo(addresses);
+		anansiLog(Warning, "failed to connect to \"" << qPrintable(address) << "\"");
+		return -1;
+	}
+
+
+#else
+
+
+	int connectSocket(const QString & address, int) {
+		anansiLog(Error, "outgoing connections are not supported on this platform (address \"" << qPrintable(address) << "\")");
+		return -1;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
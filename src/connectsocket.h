@@ -0,0 +1,47 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file connectsocket.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the connectSocket() function for Anansi.
+///
+/// \dep
+/// - <QString>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_CONNECTSOCKET_H
+#define ANANSI_CONNECTSOCKET_H
+
+#include <QString>
+
+namespace Anansi {
+
+	// opens a blocking stream socket to address, which is either "unix:/path/to/socket"
+	// or "host:port". returns the file descriptor, or -1 if no connection could be made
+	// within timeout msec
+	int connectSocket(const QString & address, int timeout);
+
+}  // namespace Anansi
+
+#endif  // ANANSI_CONNECTSOCKET_H
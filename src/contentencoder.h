@@ -27,12 +27,11 @@
 /// \dep
 /// - <optional>
 /// - <array>
-/// - <iostream>
 /// - <QByteArray>
 /// - <QIODevice>
 /// - <QBuffer>
-/// - macros.h
 /// - types.h
+/// - logger.h
 ///
 /// NEXTRELEASE Review for performance.
 ///
@@ -45,14 +44,13 @@
 
 #include <optional>
 #include <array>
-#include <iostream>
 
 #include <QByteArray>
 #include <QIODevice>
 #include <QBuffer>
 
-#include "macros.h"
 #include "types.h"
+#include "logger.h"
 
 namespace Anansi {
 
@@ -96,7 +94,7 @@ namespace Anansi {
 				const auto bytesRead = in.read(&readBuffer[0], size ? qMin(BufferSize, *size - bytesWritten) : BufferSize);
 
 				if(-1 == bytesRead) {
-					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error reading data to encode (\"" << qPrintable(in.errorString()) << "\")\n";
+					anansiLog(Warning, "error reading data to encode (\"" << qPrintable(in.errorString()) << "\")");
 					return false;
 				}
 
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file daemon.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the Daemon class.
+///
+/// On unix-like platforms, SIGUSR1 makes the daemon close and reopen its access log
+/// so that external log rotation tools can move the file aside.
+///
+/// \dep
+/// - daemon.h
+/// - <iostream>
+/// - <utility>
+/// - <QString>
+/// - configuration.h
+/// - server.h
+/// - qtmetatypes.h
+/// - commandline.h
+/// - accesslogwriter.h
+/// - <signal.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "daemon.h"
+
+#include <iostream>
+#include <utility>
+
+#include <QString>
+
+#include "configuration.h"
+#include "server.h"
+#include "qtmetatypes.h"
+#include "commandline.h"
+#include "accesslogwriter.h"
+
+#if defined(Q_OS_UNIX)
+#include <signal.h>
+#endif
+
+
+namespace Anansi {
+
+
+#if defined(Q_OS_UNIX)
+	static void reopenAccessLog(int) {
+		AccessLogWriter::reopen();
+	}
+#endif
+
+
+	Daemon::Daemon(int & argc, char ** argv)
+	: QCoreApplication(argc, argv) {
+		// same names as the GUI so that both find the same default configuration
+		setOrganizationName(QStringLiteral("Equit"));
+		setOrganizationDomain(QStringLiteral("www.equituk.net"));
+		setApplicationName(QStringLiteral("anansi"));
+		setApplicationVersion("1.0.0");
+
+		// enable these types to be used in queued signal/slot connections
+		qRegisterMetaType<Anansi::ConnectionPolicy>();
+		qRegisterMetaType<Anansi::WebServerAction>();
+	}
+
+
+	bool Daemon::start(int argc, char ** argv) {
+		// -s is accepted for compatibility with the GUI; the daemon always starts listening
+		const auto options = parseCommandLine(argc, argv);
+
+		if(!options) {
+			return false;
+		}
+
+		QString watchFile;
+		auto config = startupConfiguration(*options, watchFile);
+
+		if(!config) {
+			return false;
+		}
+
+		m_server = std::make_unique<Server>(std::move(*config));
+
+#if defined(Q_OS_UNIX)
+		struct sigaction reopenAction = {};
+		reopenAction.sa_handler = reopenAccessLog;
+		reopenAction.sa_flags = SA_RESTART;
+		sigemptyset(&reopenAction.sa_mask);
+		::sigaction(SIGUSR1, &reopenAction, nullptr);
+#endif
+
+		if(!watchFile.isEmpty()) {
+			m_server->watchConfigurationFile(watchFile);
+
+			connect(m_server.get(), &Server::configurationReloaded, this, [watchFile]() {
+				std::cout << "reloaded configuration from \"" << qPrintable(watchFile) << "\"\n"
+							 << std::flush;
+			});
+		}
+
+		if(!m_server->listen()) {
+			return false;
+		}
+
+		const auto & serverConfig = std::as_const(*m_server).configuration();
+		std::cout << "listening on " << qPrintable(serverConfig.listenAddress()) << ":" << serverConfig.port() << "\n"
+					 << std::flush;
+		return true;
+	}
+
+
+	// required in impl. file due to use of std::unique_ptr with forward-declared class.
+	Daemon::~Daemon() = default;
+
+
+}  // namespace Anansi
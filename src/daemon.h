@@ -17,47 +17,49 @@
  * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/// \file accesslogtreeitem.h
+
+/// \file daemon.h
 /// \author Darren Edale
 /// \version 1.0.0
 /// \date March 2018
 ///
-/// \brief Declaration of the AccessLogTreeItem class for Anansi.
+/// \brief Declaration of the Daemon class for Anansi.
 ///
 /// \dep
-/// - <cstdint>
-/// - <QTreeWidgetItem>
-/// - types.h
+/// - <memory>
+/// - <QCoreApplication>
 ///
 /// \par Changes
 /// - (2018-03) First release.
 
-#ifndef ANANSI_ACCESSLOGTREEITEM_H
-#define ANANSI_ACCESSLOGTREEITEM_H
+#ifndef ANANSI_DAEMON_H
+#define ANANSI_DAEMON_H
 
-#include <cstdint>
+#include <memory>
 
-#include <QTreeWidgetItem>
+#include <QCoreApplication>
 
-#include "types.h"
+namespace Anansi {
 
-class QString;
-class QDateTime;
+	class Server;
 
-namespace Anansi {
+	// the headless server: no widgets, icons or stylesheets are loaded, and the server
+	// starts listening straight away
+	class Daemon : public QCoreApplication {
+		Q_OBJECT
 
-	class AccessLogTreeItem : public QTreeWidgetItem {
 	public:
-		explicit AccessLogTreeItem(const QDateTime & timestamp, const QString & addr, uint16_t port, const QString & resource, WebServerAction action);
-		explicit AccessLogTreeItem(const QDateTime & timestamp, const QString & addr, uint16_t port, ConnectionPolicy policy);
-
-		void setIpAddress(const QString & addr);
-		void setPort(uint16_t port);
-		void setResource(const QString & resource);
-		void setAction(WebServerAction action);
-		void setConnectionPolicy(ConnectionPolicy policy);
+		Daemon(int & argc, char ** argv);
+		~Daemon() override;
+
+		// reads the command line and configuration and starts the server listening. if this
+		// fails the reason has been reported and the daemon must not be exec()'d
+		bool start(int argc, char ** argv);
+
+	private:
+		std::unique_ptr<Server> m_server;
 	};
 
 }  // namespace Anansi
 
-#endif  // ANANSI_ACCESSLOGTREEITEM_H
+#endif  // ANANSI_DAEMON_H
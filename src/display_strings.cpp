@@ -71,6 +71,12 @@ namespace Anansi {
 
 			case WebServerAction::Ignore:
 				return QApplication::tr("Ignore");
+
+			case WebServerAction::Proxy:
+				return QApplication::tr("Proxy");
+
+			case WebServerAction::Module:
+				return QApplication::tr("Module");
 		}
 
 		eqAssert(false, "unhandled enumerator value " << static_cast<int>(action));
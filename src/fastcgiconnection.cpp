@@ -0,0 +1,411 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiconnection.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the FastCgiConnection class for Anansi.
+///
+/// The connection uses plain sockets rather than QTcpSocket/QLocalSocket because
+/// connections outlive the RequestHandler thread that opened them (see
+/// connectSocket()). The socket is non-blocking and every read and write waits in
+/// poll() with a timeout, so a responder that stops reading or writing can't hold up
+/// the request handler indefinitely. Only unix-like platforms are currently
+/// supported.
+///
+/// \dep
+/// - fastcgiconnection.h
+/// - <array>
+/// - <QtGlobal>
+/// - logger.h
+/// - connectsocket.h
+/// - cancellationtoken.h
+/// - <sys/socket.h>, <poll.h>, <fcntl.h>, <unistd.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "fastcgiconnection.h"
+
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "logger.h"
+#include "connectsocket.h"
+#include "cancellationtoken.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace Anansi {
+
+
+	static constexpr const uint8_t FastCgiVersion = 1;
+	static constexpr const uint8_t FastCgiKeepConnection = 1;
+	static constexpr const std::size_t RecordHeaderSize = 8;
+	static constexpr const int MaxRecordContentLength = 0xffff;
+
+
+	static void appendParamLength(QByteArray & out, int length) {
+		if(0x80 > length) {
+			out.append(static_cast<char>(length));
+		}
+		else {
+			out.append(static_cast<char>(((length >> 24) & 0x7f) | 0x80));
+			out.append(static_cast<char>((length >> 16) & 0xff));
+			out.append(static_cast<char>((length >> 8) & 0xff));
+			out.append(static_cast<char>(length & 0xff));
+		}
+	}
+
+
+	FastCgiConnection::FastCgiConnection(int fd, const QString & address)
+	: m_fd(fd),
+	  m_address(address),
+	  m_writeTimeout(-1),
+	  m_cancellation(nullptr),
+	  m_failed(false) {
+	}
+
+
+	bool FastCgiConnection::sendRecord(RecordType type, uint16_t requestId, const char * content, uint16_t length) {
+		const uint8_t padding = static_cast<uint8_t>((8 - (length % 8)) % 8);
+		QByteArray record;
+		record.reserve(static_cast<int>(RecordHeaderSize) + length + padding);
+		record.append(static_cast<char>(FastCgiVersion));
+		record.append(static_cast<char>(type));
+		record.append(static_cast<char>((requestId >> 8) & 0xff));
+		record.append(static_cast<char>(requestId & 0xff));
+		record.append(static_cast<char>((length >> 8) & 0xff));
+		record.append(static_cast<char>(length & 0xff));
+		record.append(static_cast<char>(padding));
+		record.append('\0');
+		record.append(content, length);
+		record.append(padding, '\0');
+		return writeFully(record.constData(), static_cast<std::size_t>(record.size()));
+	}
+
+
+	bool FastCgiConnection::sendStream(RecordType type, uint16_t requestId, const QByteArray & data) {
+		if(data.isEmpty()) {
+			// empty record terminates the stream
+			return sendRecord(type, requestId, nullptr, 0);
+		}
+
+		int offset = 0;
+
+		while(offset < data.size()) {
+			const auto length = qMin(MaxRecordContentLength, data.size() - offset);
+
+			if(!sendRecord(type, requestId, data.constData() + offset, static_cast<uint16_t>(length))) {
+				return false;
+			}
+
+			offset += length;
+		}
+
+		return true;
+	}
+
+
+	bool FastCgiConnection::sendBeginRequest(uint16_t requestId, Role role, bool keepConnection) {
+		const auto roleValue = static_cast<uint16_t>(role);
+		const std::array<char, 8> body = {
+		  static_cast<char>((roleValue >> 8) & 0xff),
+		  static_cast<char>(roleValue & 0xff),
+		  static_cast<char>(keepConnection ? FastCgiKeepConnection : 0),
+		  0, 0, 0, 0, 0};
+		return sendRecord(RecordType::BeginRequest, requestId, body.data(), static_cast<uint16_t>(body.size()));
+	}
+
+
+	bool FastCgiConnection::sendParams(uint16_t requestId, const Params & params) {
+		QByteArray encoded;
+
+		for(const auto & param : params) {
+			appendParamLength(encoded, param.first.size());
+			appendParamLength(encoded, param.second.size());
+			encoded.append(param.first);
+			encoded.append(param.second);
+		}
+
+		// the params stream is always sent in one go, so it's terminated here
+		return (encoded.isEmpty() || sendStream(RecordType::Params, requestId, encoded)) && sendStream(RecordType::Params, requestId, {});
+	}
+
+
+	bool FastCgiConnection::sendStdin(uint16_t requestId, const QByteArray & data) {
+		return sendStream(RecordType::Stdin, requestId, data);
+	}
+
+
+	bool FastCgiConnection::sendAbortRequest(uint16_t requestId) {
+		return sendRecord(RecordType::AbortRequest, requestId, nullptr, 0);
+	}
+
+
+	std::optional<FastCgiConnection::Record> FastCgiConnection::readRecord(int timeout) {
+		std::array<unsigned char, RecordHeaderSize> header;
+
+		if(!readFully(reinterpret_cast<char *>(header.data()), header.size(), timeout)) {
+			return {};
+		}
+
+		if(FastCgiVersion != header[0]) {
+			anansiLog(Warning, "unsupported FastCGI protocol version " << static_cast<int>(header[0]) << " from \"" << qPrintable(m_address) << "\"");
+			return {};
+		}
+
+		Record record;
+		record.type = static_cast<RecordType>(header[1]);
+		record.requestId = static_cast<uint16_t>((header[2] << 8) | header[3]);
+		const int contentLength = (header[4] << 8) | header[5];
+		const int paddingLength = header[6];
+		record.content.resize(contentLength + paddingLength);
+
+		if(0 < record.content.size() && !readFully(record.content.data(), static_cast<std::size_t>(record.content.size()), timeout)) {
+			return {};
+		}
+
+		record.content.truncate(contentLength);
+		return record;
+	}
+
+
+#if defined(Q_OS_UNIX)
+
+
+	std::unique_ptr<FastCgiConnection> FastCgiConnection::connectTo(const QString & address, int timeout) {
+		const int fd = connectSocket(address, timeout);
+
+		if(-1 == fd) {
+			anansiLog(Warning, "failed to connect to FastCGI responder \"" << qPrintable(address) << "\"");
+			return {};
+		}
+
+		// reads and writes wait for the socket in poll(), never in recv()/send()
+		const auto flags = ::fcntl(fd, F_GETFL);
+
+		if(-1 == flags || -1 == ::fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+			anansiLog(Warning, "failed to make connection to FastCGI responder \"" << qPrintable(address) << "\" non-blocking: " << std::strerror(errno));
+			::close(fd);
+			return {};
+		}
+
+		auto connection = std::unique_ptr<FastCgiConnection>(new FastCgiConnection(fd, address));
+		connection->setWriteTimeout(timeout);
+		return connection;
+	}
+
+
+	FastCgiConnection::~FastCgiConnection() {
+		::close(m_fd);
+	}
+
+
+	bool FastCgiConnection::isUsable() const {
+		if(m_failed) {
+			// a record may have been left half-written
+			return false;
+		}
+
+		pollfd pfd = {m_fd, POLLIN, 0};
+		const auto result = ::poll(&pfd, 1, 0);
+
+		// an idle connection should have nothing to read - readable means either EOF or
+		// stray data from an earlier request, neither of which we can use
+		return 0 == result;
+	}
+
+
+	bool FastCgiConnection::waitForReadyRead(int msecs) const {
+		pollfd pfd = {m_fd, POLLIN, 0};
+		int ready;
+
+		do {
+			ready = ::poll(&pfd, 1, msecs);
+		} while(-1 == ready && EINTR == errno);
+
+		return 1 == ready;
+	}
+
+
+	bool FastCgiConnection::writeFully(const char * data, std::size_t length) {
+#if defined(MSG_NOSIGNAL)
+		static constexpr const int SendFlags = MSG_NOSIGNAL;
+#else
+		static constexpr const int SendFlags = 0;
+#endif
+
+		using Clock = std::chrono::steady_clock;
+
+		if(m_failed) {
+			return false;
+		}
+
+		const auto deadline = Clock::now() + std::chrono::milliseconds(m_writeTimeout);
+
+		while(0 < length) {
+			if(m_cancellation && m_cancellation->wasCancelled()) {
+				m_failed = true;
+				return false;
+			}
+
+			const auto written = ::send(m_fd, data, length, SendFlags);
+
+			if(0 <= written) {
+				data += written;
+				length -= static_cast<std::size_t>(written);
+				continue;
+			}
+
+			if(EINTR == errno) {
+				continue;
+			}
+
+			if(EAGAIN != errno && EWOULDBLOCK != errno) {
+				anansiLog(Warning, "error writing to FastCGI responder \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				m_failed = true;
+				return false;
+			}
+
+			// the responder isn't keeping up. wait for it to make room, watching the client
+			// as well so that a request nobody is waiting for is given up
+			int timeout = -1;
+
+			if(0 <= m_writeTimeout) {
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+
+				if(0 >= remaining) {
+					anansiLog(Warning, "timeout writing to FastCGI responder \"" << qPrintable(m_address) << "\"");
+					m_failed = true;
+					return false;
+				}
+
+				timeout = static_cast<int>(remaining);
+			}
+
+			const int cancellationFd = (m_cancellation ? static_cast<int>(m_cancellation->socketDescriptor()) : -1);
+			std::array<pollfd, 2> pfds = {{{m_fd, POLLOUT, 0}, {cancellationFd, static_cast<short>(m_cancellation ? m_cancellation->pollEvents() : 0), 0}}};
+
+			if(-1 == ::poll(pfds.data(), pfds.size(), timeout) && EINTR != errno) {
+				anansiLog(Warning, "error waiting for FastCGI responder \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				m_failed = true;
+				return false;
+			}
+
+			if(m_cancellation && 0 != pfds[1].revents) {
+				m_cancellation->checkPollResult(pfds[1].revents);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool FastCgiConnection::readFully(char * data, std::size_t length, int timeout) {
+		while(0 < length) {
+			pollfd pfd = {m_fd, POLLIN, 0};
+			const auto ready = ::poll(&pfd, 1, timeout);
+
+			if(-1 == ready) {
+				if(EINTR == errno) {
+					continue;
+				}
+
+				anansiLog(Warning, "error waiting for FastCGI responder \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				return false;
+			}
+
+			if(0 == ready) {
+				anansiLog(Warning, "timeout waiting for FastCGI responder \"" << qPrintable(m_address) << "\"");
+				return false;
+			}
+
+			const auto bytesRead = ::recv(m_fd, data, length, 0);
+
+			if(-1 == bytesRead) {
+				if(EINTR == errno || EAGAIN == errno || EWOULDBLOCK == errno) {
+					continue;
+				}
+
+				anansiLog(Warning, "error reading from FastCGI responder \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				return false;
+			}
+
+			if(0 == bytesRead) {
+				anansiLog(Warning, "FastCGI responder \"" << qPrintable(m_address) << "\" closed the connection");
+				return false;
+			}
+
+			data += bytesRead;
+			length -= static_cast<std::size_t>(bytesRead);
+		}
+
+		return true;
+	}
+
+
+#else
+
+
+	std::unique_ptr<FastCgiConnection> FastCgiConnection::connectTo(const QString & address, int) {
+		anansiLog(Error, "FastCGI is not supported on this platform (responder \"" << qPrintable(address) << "\")");
+		return {};
+	}
+
+
+	FastCgiConnection::~FastCgiConnection() = default;
+
+
+	bool FastCgiConnection::isUsable() const {
+		return false;
+	}
+
+
+	bool FastCgiConnection::waitForReadyRead(int) const {
+		return false;
+	}
+
+
+	bool FastCgiConnection::writeFully(const char *, std::size_t) {
+		return false;
+	}
+
+
+	bool FastCgiConnection::readFully(char *, std::size_t, int) {
+		return false;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiconnection.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the FastCgiConnection class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <memory>
+/// - <optional>
+/// - <vector>
+/// - <QString>
+/// - <QByteArray>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_FASTCGICONNECTION_H
+#define ANANSI_FASTCGICONNECTION_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QString>
+#include <QByteArray>
+
+namespace Anansi {
+
+	class CancellationToken;
+
+	class FastCgiConnection final {
+	public:
+		enum class RecordType : uint8_t {
+			BeginRequest = 1,
+			AbortRequest = 2,
+			EndRequest = 3,
+			Params = 4,
+			Stdin = 5,
+			Stdout = 6,
+			Stderr = 7,
+			Data = 8,
+			GetValues = 9,
+			GetValuesResult = 10,
+			UnknownType = 11,
+		};
+
+		enum class Role : uint16_t {
+			Responder = 1,
+			Authorizer = 2,
+			Filter = 3,
+		};
+
+		enum class ProtocolStatus : uint8_t {
+			RequestComplete = 0,
+			CantMultiplexConnection = 1,
+			Overloaded = 2,
+			UnknownRole = 3,
+		};
+
+		struct Record {
+			RecordType type;
+			uint16_t requestId;
+			QByteArray content;
+		};
+
+		using Params = std::vector<std::pair<QByteArray, QByteArray>>;
+
+		FastCgiConnection(const FastCgiConnection &) = delete;
+		FastCgiConnection(FastCgiConnection &&) = delete;
+		void operator=(const FastCgiConnection &) = delete;
+		void operator=(FastCgiConnection &&) = delete;
+		~FastCgiConnection();
+
+		// address is either "unix:/path/to/socket" or "host:port"
+		static std::unique_ptr<FastCgiConnection> connectTo(const QString & address, int timeout);
+
+		inline const QString & address() const noexcept {
+			return m_address;
+		}
+
+		// false if the responder has closed its end, left unread data on the connection or
+		// a write to it has failed
+		bool isUsable() const;
+
+		// writes wait up to msecs for the responder to make room, and give up early once the
+		// token is cancelled. a write that gives up leaves the connection unusable
+		inline void setWriteTimeout(int msecs) noexcept {
+			m_writeTimeout = msecs;
+		}
+
+		inline void setCancellationToken(CancellationToken * cancellation) noexcept {
+			m_cancellation = cancellation;
+		}
+
+		bool sendBeginRequest(uint16_t requestId, Role role = Role::Responder, bool keepConnection = true);
+		bool sendParams(uint16_t requestId, const Params & params);
+		bool sendStdin(uint16_t requestId, const QByteArray & data);
+		bool sendAbortRequest(uint16_t requestId);
+
+		std::optional<Record> readRecord(int timeout);
+
+		// true if there's something to read (or the responder has closed its end) within msecs
+		bool waitForReadyRead(int msecs) const;
+
+	private:
+		FastCgiConnection(int fd, const QString & address);
+
+		bool sendRecord(RecordType type, uint16_t requestId, const char * content, uint16_t length);
+		bool sendStream(RecordType type, uint16_t requestId, const QByteArray & data);
+		bool writeFully(const char * data, std::size_t length);
+		bool readFully(char * data, std::size_t length, int timeout);
+
+		int m_fd;
+		QString m_address;
+		int m_writeTimeout;
+		CancellationToken * m_cancellation;
+		bool m_failed;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_FASTCGICONNECTION_H
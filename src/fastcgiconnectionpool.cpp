@@ -0,0 +1,161 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiconnectionpool.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the FastCgiConnectionPool class for Anansi.
+///
+/// \dep
+/// - fastcgiconnectionpool.h
+/// - <chrono>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "fastcgiconnectionpool.h"
+
+#include <chrono>
+
+
+namespace Anansi {
+
+
+	FastCgiConnectionPool::Lease::Lease(FastCgiConnectionPool * pool, std::unique_ptr<FastCgiConnection> connection)
+	: m_pool(pool),
+	  m_connection(std::move(connection)),
+	  m_reusable(false) {
+	}
+
+
+	FastCgiConnectionPool::Lease::Lease(Lease && other) noexcept
+	: m_pool(other.m_pool),
+	  m_connection(std::move(other.m_connection)),
+	  m_reusable(other.m_reusable) {
+		other.m_pool = nullptr;
+	}
+
+
+	FastCgiConnectionPool::Lease & FastCgiConnectionPool::Lease::operator=(Lease && other) noexcept {
+		release();
+		m_pool = other.m_pool;
+		m_connection = std::move(other.m_connection);
+		m_reusable = other.m_reusable;
+		other.m_pool = nullptr;
+		return *this;
+	}
+
+
+	FastCgiConnectionPool::Lease::~Lease() {
+		release();
+	}
+
+
+	void FastCgiConnectionPool::Lease::release() {
+		if(m_pool && m_connection) {
+			m_pool->release(std::move(m_connection), m_reusable);
+		}
+
+		m_pool = nullptr;
+		m_connection.reset();
+	}
+
+
+	FastCgiConnectionPool & FastCgiConnectionPool::instance() {
+		static FastCgiConnectionPool pool;
+		return pool;
+	}
+
+
+	FastCgiConnectionPool::Lease FastCgiConnectionPool::acquire(const QString & address, int maxConnections, int timeout) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		auto & endpoint = m_endpoints[address];
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+		while(true) {
+			while(!endpoint.idle.empty()) {
+				auto connection = std::move(endpoint.idle.back());
+				endpoint.idle.pop_back();
+
+				if(connection->isUsable()) {
+					return {this, std::move(connection)};
+				}
+
+				// responder has dropped the connection (e.g. php-fpm recycled its worker)
+				--endpoint.openCount;
+			}
+
+			if(endpoint.openCount < maxConnections) {
+				break;
+			}
+
+			if(std::cv_status::timeout == endpoint.available.wait_until(lock, deadline)) {
+				return {};
+			}
+		}
+
+		// reserve the slot before connecting so that the lock isn't held while we wait
+		// for the responder
+		++endpoint.openCount;
+		lock.unlock();
+		auto connection = FastCgiConnection::connectTo(address, timeout);
+
+		if(!connection) {
+			lock.lock();
+			--endpoint.openCount;
+			endpoint.available.notify_one();
+			return {};
+		}
+
+		return {this, std::move(connection)};
+	}
+
+
+	void FastCgiConnectionPool::release(std::unique_ptr<FastCgiConnection> connection, bool reusable) {
+		// the token belongs to the request that is finishing with the connection, and a
+		// connection whose writes gave up may have a partial record on it
+		connection->setCancellationToken(nullptr);
+		reusable = reusable && connection->isUsable();
+		std::lock_guard<std::mutex> lock(m_lock);
+		auto & endpoint = m_endpoints[connection->address()];
+
+		if(reusable) {
+			endpoint.idle.push_back(std::move(connection));
+		}
+		else {
+			--endpoint.openCount;
+		}
+
+		endpoint.available.notify_one();
+	}
+
+
+	void FastCgiConnectionPool::clear() {
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for(auto & endpoint : m_endpoints) {
+			endpoint.second.openCount -= static_cast<int>(endpoint.second.idle.size());
+			endpoint.second.idle.clear();
+		}
+	}
+
+
+}  // namespace Anansi
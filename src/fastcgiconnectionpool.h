@@ -0,0 +1,119 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiconnectionpool.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the FastCgiConnectionPool class for Anansi.
+///
+/// \dep
+/// - <memory>
+/// - <mutex>
+/// - <condition_variable>
+/// - <unordered_map>
+/// - <vector>
+/// - <QString>
+/// - fastcgiconnection.h
+/// - qtstdhash.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_FASTCGICONNECTIONPOOL_H
+#define ANANSI_FASTCGICONNECTIONPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "fastcgiconnection.h"
+#include "qtstdhash.h"
+
+namespace Anansi {
+
+	class FastCgiConnectionPool final {
+	public:
+		// an exclusive hold on one pooled connection; the connection goes back to the
+		// pool when the lease is destroyed unless it has been marked as not reusable
+		class Lease final {
+		public:
+			Lease() = default;
+			Lease(const Lease &) = delete;
+			Lease(Lease && other) noexcept;
+			Lease & operator=(const Lease &) = delete;
+			Lease & operator=(Lease && other) noexcept;
+			~Lease();
+
+			inline explicit operator bool() const noexcept {
+				return static_cast<bool>(m_connection);
+			}
+
+			inline FastCgiConnection * operator->() const noexcept {
+				return m_connection.get();
+			}
+
+			inline FastCgiConnection & operator*() const noexcept {
+				return *m_connection;
+			}
+
+			inline void setReusable(bool reusable) noexcept {
+				m_reusable = reusable;
+			}
+
+		private:
+			friend class FastCgiConnectionPool;
+			Lease(FastCgiConnectionPool * pool, std::unique_ptr<FastCgiConnection> connection);
+			void release();
+
+			FastCgiConnectionPool * m_pool = nullptr;
+			std::unique_ptr<FastCgiConnection> m_connection;
+			bool m_reusable = false;
+		};
+
+		static FastCgiConnectionPool & instance();
+
+		// blocks for up to timeout msec if maxConnections are already leased for the address
+		Lease acquire(const QString & address, int maxConnections, int timeout);
+
+		// closes all idle connections
+		void clear();
+
+	private:
+		struct Endpoint {
+			std::vector<std::unique_ptr<FastCgiConnection>> idle;
+			int openCount = 0;
+			std::condition_variable available;
+		};
+
+		FastCgiConnectionPool() = default;
+		void release(std::unique_ptr<FastCgiConnection> connection, bool reusable);
+
+		std::mutex m_lock;
+		std::unordered_map<QString, Endpoint, Equit::QtHash<QString>> m_endpoints;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_FASTCGICONNECTIONPOOL_H
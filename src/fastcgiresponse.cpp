@@ -0,0 +1,201 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiresponse.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the FastCgiResponse class for Anansi.
+///
+/// \dep
+/// - fastcgiresponse.h
+/// - <cstring>
+/// - cancellationtoken.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "fastcgiresponse.h"
+
+#include <cstring>
+
+#include "cancellationtoken.h"
+
+
+namespace Anansi {
+
+
+	// stderr output is only kept for logging so there's no point buffering it all
+	static constexpr const int MaxStderrSize = 65536;
+
+
+	FastCgiResponse::FastCgiResponse(FastCgiConnection & connection, uint16_t requestId, int timeout)
+	: m_connection(connection),
+	  m_requestId(requestId),
+	  m_timeout(timeout),
+	  m_complete(false),
+	  m_failed(false),
+	  m_cancelled(false),
+	  m_cancellation(nullptr),
+	  m_protocolStatus(FastCgiConnection::ProtocolStatus::RequestComplete),
+	  m_appStatus(0) {
+		open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+	}
+
+
+	bool FastCgiResponse::isSequential() const {
+		return true;
+	}
+
+
+	bool FastCgiResponse::atEnd() const {
+		return m_complete && m_buffer.isEmpty();
+	}
+
+
+	qint64 FastCgiResponse::bytesAvailable() const {
+		return m_buffer.size() + QIODevice::bytesAvailable();
+	}
+
+
+	bool FastCgiResponse::canReadLine() const {
+		return m_buffer.contains('\n') || QIODevice::canReadLine();
+	}
+
+
+	bool FastCgiResponse::waitForReadyRead(int msecs) {
+		// must consume at least one more stdout record if there is one, otherwise callers
+		// waiting for a complete line would spin on a partial line in the buffer
+		const auto bufferedSize = m_buffer.size();
+
+		while(bufferedSize == m_buffer.size() && !m_complete) {
+			if(!readNextRecord(msecs)) {
+				return false;
+			}
+		}
+
+		return bufferedSize < m_buffer.size();
+	}
+
+
+	qint64 FastCgiResponse::readData(char * data, qint64 maxSize) {
+		while(m_buffer.isEmpty() && !m_complete) {
+			readNextRecord(m_timeout);
+		}
+
+		if(m_buffer.isEmpty()) {
+			return m_failed ? -1 : 0;
+		}
+
+		const auto size = qMin(maxSize, static_cast<qint64>(m_buffer.size()));
+		std::memcpy(data, m_buffer.constData(), static_cast<std::size_t>(size));
+		m_buffer.remove(0, static_cast<int>(size));
+		return size;
+	}
+
+
+	qint64 FastCgiResponse::writeData(const char *, qint64) {
+		return -1;
+	}
+
+
+	bool FastCgiResponse::waitForRecord(int timeout) {
+		if(!m_cancellation) {
+			return true;
+		}
+
+		// wait in short slices so that a client that goes away is noticed promptly; an
+		// expired timeout is left for readRecord() to report
+		while(0 < timeout) {
+			if(m_cancellation->isCancelled()) {
+				m_cancelled = true;
+				return false;
+			}
+
+			const auto slice = qMin(timeout, CancellationToken::CheckInterval);
+
+			if(m_connection.waitForReadyRead(slice)) {
+				break;
+			}
+
+			timeout -= slice;
+		}
+
+		return true;
+	}
+
+
+	bool FastCgiResponse::readNextRecord(int timeout) {
+		if(!waitForRecord(timeout)) {
+			m_failed = true;
+			m_complete = true;
+			setErrorString(QStringLiteral("client has disconnected"));
+			return false;
+		}
+
+		auto record = m_connection.readRecord(timeout);
+
+		if(!record) {
+			m_failed = true;
+			m_complete = true;
+			setErrorString(QStringLiteral("failed to read from FastCGI responder"));
+			return false;
+		}
+
+		if(m_requestId != record->requestId) {
+			// management records and records for other requests aren't ours to consume
+			return true;
+		}
+
+		switch(record->type) {
+			case FastCgiConnection::RecordType::Stdout:
+				m_buffer.append(record->content);
+				break;
+
+			case FastCgiConnection::RecordType::Stderr:
+				if(MaxStderrSize > m_stderr.size()) {
+					m_stderr.append(record->content.left(MaxStderrSize - m_stderr.size()));
+				}
+				break;
+
+			case FastCgiConnection::RecordType::EndRequest: {
+				const auto * body = reinterpret_cast<const unsigned char *>(record->content.constData());
+
+				if(8 > record->content.size()) {
+					m_failed = true;
+				}
+				else {
+					m_appStatus = (static_cast<uint32_t>(body[0]) << 24) | (static_cast<uint32_t>(body[1]) << 16) | (static_cast<uint32_t>(body[2]) << 8) | body[3];
+					m_protocolStatus = static_cast<FastCgiConnection::ProtocolStatus>(body[4]);
+				}
+
+				m_complete = true;
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		return true;
+	}
+
+
+}  // namespace Anansi
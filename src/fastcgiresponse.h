@@ -0,0 +1,111 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file fastcgiresponse.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the FastCgiResponse class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <QIODevice>
+/// - <QByteArray>
+/// - fastcgiconnection.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_FASTCGIRESPONSE_H
+#define ANANSI_FASTCGIRESPONSE_H
+
+#include <cstdint>
+
+#include <QIODevice>
+#include <QByteArray>
+
+#include "fastcgiconnection.h"
+
+namespace Anansi {
+
+	class CancellationToken;
+
+	// read-only sequential device presenting the FCGI_STDOUT stream of one request as
+	// it arrives from the responder
+	class FastCgiResponse final : public QIODevice {
+	public:
+		FastCgiResponse(FastCgiConnection & connection, uint16_t requestId, int timeout);
+
+		inline bool isComplete() const noexcept {
+			return m_complete;
+		}
+
+		// true only if FCGI_END_REQUEST was received with FCGI_REQUEST_COMPLETE
+		inline bool completedCleanly() const noexcept {
+			return m_complete && !m_failed && FastCgiConnection::ProtocolStatus::RequestComplete == m_protocolStatus;
+		}
+
+		inline uint32_t applicationStatus() const noexcept {
+			return m_appStatus;
+		}
+
+		inline const QByteArray & standardError() const noexcept {
+			return m_stderr;
+		}
+
+		// reads give up early once the token is cancelled
+		inline void setCancellationToken(CancellationToken * cancellation) noexcept {
+			m_cancellation = cancellation;
+		}
+
+		inline bool wasCancelled() const noexcept {
+			return m_cancelled;
+		}
+
+		bool isSequential() const override;
+		bool atEnd() const override;
+		qint64 bytesAvailable() const override;
+		bool canReadLine() const override;
+		bool waitForReadyRead(int msecs) override;
+
+	protected:
+		qint64 readData(char * data, qint64 maxSize) override;
+		qint64 writeData(const char *, qint64) override;
+
+	private:
+		bool readNextRecord(int timeout);
+		bool waitForRecord(int timeout);
+
+		FastCgiConnection & m_connection;
+		uint16_t m_requestId;
+		int m_timeout;
+		QByteArray m_buffer;
+		QByteArray m_stderr;
+		bool m_complete;
+		bool m_failed;
+		bool m_cancelled;
+		CancellationToken * m_cancellation;
+		FastCgiConnection::ProtocolStatus m_protocolStatus;
+		uint32_t m_appStatus;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_FASTCGIRESPONSE_H
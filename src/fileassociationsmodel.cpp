@@ -27,6 +27,7 @@
 /// \dep
 /// - fileassociationsmodel.h
 /// - <iostream>
+/// - <utility>
 /// - <Qt>
 /// - <QVector>
 /// - macros.h
@@ -40,6 +41,7 @@
 #include "fileassociationsmodel.h"
 
 #include <iostream>
+#include <utility>
 
 #include <Qt>
 #include <QVector>
@@ -61,7 +63,7 @@ namespace Anansi {
 
 
 	QModelIndex FileAssociationsModel::findFileExtension(const QString & ext) const {
-		const auto extensions = m_server->configuration().registeredFileExtensions();
+		const auto extensions = std::as_const(*m_server).configuration().registeredFileExtensions();
 		const auto & begin = extensions.cbegin();
 		const auto & end = extensions.cend();
 		const auto extIt = std::find(begin, end, ext);
@@ -84,7 +86,7 @@ namespace Anansi {
 			return {};
 		}
 
-		const auto mediaTypes = m_server->configuration().fileExtensionMediaTypes(parent.data().value<QString>());
+		const auto mediaTypes = std::as_const(*m_server).configuration().fileExtensionMediaTypes(parent.data().value<QString>());
 		const auto & begin = mediaTypes.cbegin();
 		const auto & end = mediaTypes.cend();
 		const auto mediaTypeIt = std::find(begin, end, mediaType);
@@ -111,7 +113,7 @@ namespace Anansi {
 		if(parent.isValid()) {
 			if(0 == parent.internalId()) {
 				// extension items have associated media types as children
-				if(m_server->configuration().fileExtensionMediaTypeCount(parent.data().value<QString>()) <= row) {
+				if(std::as_const(*m_server).configuration().fileExtensionMediaTypeCount(parent.data().value<QString>()) <= row) {
 					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: row for media type item index is out of bounds\n";
 					return {};
 				}
@@ -160,10 +162,10 @@ namespace Anansi {
 				return 0;
 			}
 
-			return m_server->configuration().fileExtensionMediaTypeCount(parent.data().value<QString>());
+			return std::as_const(*m_server).configuration().fileExtensionMediaTypeCount(parent.data().value<QString>());
 		}
 
-		return m_server->configuration().registeredFileExtensionCount();
+		return std::as_const(*m_server).configuration().registeredFileExtensionCount();
 	}
 
 
@@ -206,7 +208,7 @@ namespace Anansi {
 			}
 
 			int extIdx = idx.row();
-			const auto & config = m_server->configuration();
+			const auto & config = std::as_const(*m_server).configuration();
 
 			if(0 > extIdx || config.registeredFileExtensionCount() <= extIdx) {
 				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: extensions index row is not valid\n";
@@ -217,7 +219,7 @@ namespace Anansi {
 		}
 
 		auto extIdx = static_cast<int>(idx.internalId() - 1);
-		const auto & config = m_server->configuration();
+		const auto & config = std::as_const(*m_server).configuration();
 
 		if(0 > extIdx || config.registeredFileExtensionCount() <= extIdx) {
 			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid parent row index\n";
@@ -296,6 +298,8 @@ namespace Anansi {
 				return false;
 			}
 
+			m_server->configurationChanged();
+
 			Q_EMIT dataChanged(idx, idx, QVector<int>() << Qt::DisplayRole << Qt::EditRole);
 			Q_EMIT extensionMediaTypeChanged(ext, oldMediaType, newMediaType);
 			return true;
@@ -307,6 +311,8 @@ namespace Anansi {
 			return false;
 		}
 
+		m_server->configurationChanged();
+
 		const auto oldExt = idx.data().value<QString>();
 		const auto newExt = value.value<QString>();
 
@@ -347,6 +353,8 @@ namespace Anansi {
 			return {};
 		}
 
+		m_server->configurationChanged();
+
 		beginResetModel();
 		endResetModel();
 		return findFileExtension(ext);
@@ -380,6 +388,8 @@ namespace Anansi {
 			return {};
 		}
 
+		m_server->configurationChanged();
+
 		beginResetModel();
 		endResetModel();
 		return findFileExtensionMediaType(ext, mediaType);
@@ -391,6 +401,8 @@ namespace Anansi {
 			return false;
 		}
 
+		m_server->configurationChanged();
+
 		beginResetModel();
 		endResetModel();
 		return true;
@@ -402,6 +414,8 @@ namespace Anansi {
 			return false;
 		}
 
+		m_server->configurationChanged();
+
 		beginResetModel();
 		endResetModel();
 		return true;
@@ -411,6 +425,7 @@ namespace Anansi {
 	void FileAssociationsModel::clear() {
 		beginResetModel();
 		m_server->configuration().clearAllFileExtensions();
+		m_server->configurationChanged();
 		endResetModel();
 	}
 
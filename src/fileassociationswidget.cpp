@@ -30,6 +30,7 @@
 /// - <array>
 /// - <vector>
 /// - <iostream>
+/// - <utility>
 /// - <QMenu>
 /// - <QKeyEvent>
 /// - <QSignalBlocker>
@@ -50,6 +51,7 @@
 #include <array>
 #include <vector>
 #include <iostream>
+#include <utility>
 
 #include <QMenu>
 #include <QKeyEvent>
@@ -171,6 +173,7 @@ namespace Anansi {
 			}
 
 			m_server->configuration().setDefaultMediaType(mediaType);
+			m_server->configurationChanged();
 			Q_EMIT defaultMediaTypeChanged(mediaType);
 		});
 
@@ -202,11 +205,11 @@ namespace Anansi {
 			m_ui->defaultMediaType->clear();
 			m_ui->defaultMediaType->addMediaType(QStringLiteral("application/octet-stream"));
 
-			for(const auto & mediaType : server->configuration().allKnownMediaTypes()) {
+			for(const auto & mediaType : std::as_const(*server).configuration().allKnownMediaTypes()) {
 				m_ui->defaultMediaType->addMediaType(mediaType);
 			}
 
-			m_ui->defaultMediaType->setCurrentMediaType(server->configuration().defaultMediaType());
+			m_ui->defaultMediaType->setCurrentMediaType(std::as_const(*server).configuration().defaultMediaType());
 
 			connect(m_model.get(), &FileAssociationsModel::extensionChanged, this, &FileAssociationsWidget::extensionChanged);
 			connect(m_model.get(), &FileAssociationsModel::extensionMediaTypeChanged, this, &FileAssociationsWidget::extensionMediaTypeChanged);
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file handlermodule.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief The interface between Anansi and in-process handler modules.
+///
+/// This is the only Anansi header a module needs. It uses nothing from Qt so that
+/// modules can be built without it.
+///
+/// \dep
+/// - <cstddef>
+/// - <cstdint>
+/// - <string>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_HANDLERMODULE_H
+#define ANANSI_HANDLERMODULE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Anansi::Module {
+
+	// modules built against a different version are refused
+	static constexpr const int ApiVersion = 1;
+
+	// read-only view of the request being handled. the strings belong to the server and
+	// are only valid for the duration of Handler::handle()
+	class Request {
+	public:
+		virtual ~Request() = default;
+
+		virtual const std::string & method() const = 0;
+		virtual const std::string & uri() const = 0;
+		virtual const std::string & path() const = 0;
+		virtual const std::string & query() const = 0;
+		virtual const std::string & httpVersion() const = 0;
+
+		// header names are lower case; nullptr if the client didn't send the header
+		virtual const std::string * header(const std::string & name) const = 0;
+
+		virtual const std::string & clientAddress() const = 0;
+		virtual uint16_t clientPort() const = 0;
+
+		// the file in the document root that the request mapped to, which need not exist
+		virtual const std::string & localPath() const = 0;
+		virtual const std::string & mediaType() const = 0;
+
+		virtual std::size_t bodyLength() const = 0;
+
+		// reads the next part of the body; 0 once it has all been read, -1 on error
+		virtual int64_t readBody(char * data, std::size_t maxSize) = 0;
+	};
+
+	// the status and headers are sent with the first write() or when the handler returns,
+	// whichever comes first, and can't be changed after that. the server takes care of
+	// the Date header and any content-encoding
+	class Response {
+	public:
+		virtual ~Response() = default;
+
+		// 200 unless set otherwise, and no lower since interim responses are not supported.
+		// the default reason phrase is used if none is given
+		virtual bool setStatus(int code, const std::string & reason = {}) = 0;
+		virtual bool setHeader(const std::string & name, const std::string & value) = 0;
+
+		// blocks while the client is behind; fails once the client has gone
+		virtual bool write(const char * data, std::size_t size) = 0;
+
+		inline bool write(const std::string & data) {
+			return write(data.data(), data.size());
+		}
+
+		virtual bool headersSent() const = 0;
+
+		// long-running handlers should check this and give up early
+		virtual bool isCancelled() = 0;
+	};
+
+	// one handler is created per module and is shared by all the worker threads, so
+	// handle() must be safe to call concurrently
+	class Handler {
+	public:
+		virtual ~Handler() = default;
+		virtual void handle(Request & request, Response & response) = 0;
+	};
+
+	using ApiVersionFunction = int (*)();
+	using CreateHandlerFunction = Handler * (*)();
+
+}  // namespace Anansi::Module
+
+#if defined(_WIN32)
+#define ANANSI_MODULE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define ANANSI_MODULE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// defines the two functions a module must export, for a Handler subclass with a
+// default constructor. use it once, in one of the module's source files
+#define ANANSI_MODULE(HandlerClass) \
+	ANANSI_MODULE_EXPORT int anansiModuleApiVersion() { \
+		return Anansi::Module::ApiVersion; \
+	} \
+	ANANSI_MODULE_EXPORT Anansi::Module::Handler * anansiModuleCreateHandler() { \
+		return new HandlerClass(); \
+	}
+
+#endif  // ANANSI_HANDLERMODULE_H
@@ -26,22 +26,20 @@
 ///
 /// \dep
 /// - identitycontentencoder.h
-/// - <iostream>
 /// - <QIODevice>
 /// - <QByteArray>
-/// - macros.h
+/// - logger.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
 
 #include "identitycontentencoder.h"
 
-#include <iostream>
 
 #include <QIODevice>
 #include <QByteArray>
 
-#include "macros.h"
+#include "logger.h"
 
 
 namespace Anansi {
@@ -57,7 +55,7 @@ namespace Anansi {
 			auto thisWrite = out.write(buffer + written, length);
 
 			if(-1 == thisWrite) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed writing to socket\n";
+				anansiLog(Debug, "failed writing to socket");
 				++failCount;
 			}
 			else {
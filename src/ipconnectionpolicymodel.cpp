@@ -27,6 +27,7 @@
 /// \dep
 /// - ipconnectionpolicymodel.h
 /// - <iostream>
+/// - <utility>
 /// - <QIcon>
 /// - macros.h
 /// - assert.h
@@ -42,6 +43,7 @@
 #include "ipconnectionpolicymodel.h"
 
 #include <iostream>
+#include <utility>
 
 #include <QIcon>
 
@@ -62,7 +64,7 @@ namespace Anansi {
 
 	template<int ColumnIndex>
 	QModelIndex IpConnectionPolicyModel::findHelper(const QString & addr) const {
-		const auto addresses = m_server->configuration().registeredIpAddresses();
+		const auto addresses = std::as_const(*m_server).configuration().registeredIpAddresses();
 		const auto & begin = addresses.cbegin();
 		const auto & end = addresses.cend();
 		const auto addrIt = std::find(begin, end, addr);
@@ -118,7 +120,7 @@ namespace Anansi {
 
 
 	int IpConnectionPolicyModel::rowCount(const QModelIndex &) const {
-		return m_server->configuration().registeredIpAddressCount();
+		return std::as_const(*m_server).configuration().registeredIpAddressCount();
 	}
 
 
@@ -161,7 +163,7 @@ namespace Anansi {
 			return {};
 		}
 
-		const auto & config = m_server->configuration();
+		const auto & config = std::as_const(*m_server).configuration();
 		const auto addresses = config.registeredIpAddresses();
 		const auto & addr = addresses[static_cast<std::size_t>(row)];
 
@@ -177,7 +179,7 @@ namespace Anansi {
 			case PolicyColumnIndex:
 				switch(role) {
 					case Qt::DecorationRole:
-						switch(config.ipAddressConnectionPolicy(addr)) {
+						switch(config.registeredIpAddressConnectionPolicy(addr)) {
 							case ConnectionPolicy::None:
 								return QIcon(QStringLiteral(":/icons/connectionpolicies/reject"));
 
@@ -190,10 +192,10 @@ namespace Anansi {
 						break;
 
 					case Qt::DisplayRole:
-						return displayString(config.ipAddressConnectionPolicy(addr));
+						return displayString(config.registeredIpAddressConnectionPolicy(addr));
 
 					case Qt::EditRole:
-						return QVariant::fromValue(config.ipAddressConnectionPolicy(addr));
+						return QVariant::fromValue(config.registeredIpAddressConnectionPolicy(addr));
 				}
 				break;
 		}
@@ -244,7 +246,7 @@ namespace Anansi {
 
 			case PolicyColumnIndex: {
 				const auto addr = config.registeredIpAddresses()[static_cast<std::size_t>(row)];
-				const auto oldPolicy = config.ipAddressConnectionPolicy(addr);
+				const auto oldPolicy = config.registeredIpAddressConnectionPolicy(addr);
 				const auto policy = value.value<ConnectionPolicy>();
 
 				if(policy == oldPolicy) {
@@ -257,6 +259,7 @@ namespace Anansi {
 					return false;
 				}
 
+				m_server->configurationChanged();
 				Q_EMIT policyChanged(addr, policy);
 				return true;
 			}
@@ -283,6 +286,7 @@ namespace Anansi {
 			return {};
 		}
 
+		m_server->configurationChanged();
 		beginResetModel();
 		endResetModel();
 		return findIpAddressPolicy(addr);
@@ -318,6 +322,8 @@ namespace Anansi {
 			config.unsetIpAddressConnectionPolicy(addr);
 		});
 
+		m_server->configurationChanged();
+
 		endRemoveRows();
 		return true;
 	}
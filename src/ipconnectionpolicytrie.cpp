@@ -0,0 +1,226 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file ipconnectionpolicytrie.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the IpConnectionPolicyTrie class for Anansi.
+///
+/// Each node holds the full prefix that leads to it and its length in bits. A child
+/// is only created where two prefixes diverge or a policy is set, so the depth of the
+/// trie is bounded by the number of distinct prefix lengths along a path rather than
+/// by the 128 address bits.
+///
+/// \dep
+/// - ipconnectionpolicytrie.h
+/// - <algorithm>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "ipconnectionpolicytrie.h"
+
+#include <algorithm>
+
+
+namespace Anansi {
+
+
+	static constexpr const int MappedIpv4PrefixBits = 96;
+
+
+	static inline int bitAt(const IpConnectionPolicyTrie::Address & addr, int bit) {
+		return (addr[static_cast<std::size_t>(bit / 8)] >> (7 - bit % 8)) & 1;
+	}
+
+
+	// the number of leading bits, up to length, that two addresses share
+	static int commonPrefixLength(const IpConnectionPolicyTrie::Address & lhs, const IpConnectionPolicyTrie::Address & rhs, int length) {
+		int bits = 0;
+
+		for(std::size_t idx = 0; idx < lhs.size() && bits < length; ++idx) {
+			const auto diff = static_cast<uint8_t>(lhs[idx] ^ rhs[idx]);
+
+			if(0 == diff) {
+				bits += 8;
+				continue;
+			}
+
+			for(int bit = 7; 0 == (diff & (1 << bit)); --bit) {
+				++bits;
+			}
+
+			break;
+		}
+
+		return std::min(bits, length);
+	}
+
+
+	static IpConnectionPolicyTrie::Address masked(IpConnectionPolicyTrie::Address addr, int length) {
+		for(int bit = length; bit < IpConnectionPolicyTrie::AddressBits; ++bit) {
+			addr[static_cast<std::size_t>(bit / 8)] &= static_cast<uint8_t>(~(0x80 >> (bit % 8)));
+		}
+
+		return addr;
+	}
+
+
+	IpConnectionPolicyTrie::Address IpConnectionPolicyTrie::addressBytes(const QHostAddress & addr) {
+		Address bytes = {};
+
+		if(QAbstractSocket::IPv4Protocol == addr.protocol()) {
+			const auto ipv4 = addr.toIPv4Address();
+			bytes[10] = 0xff;
+			bytes[11] = 0xff;
+			bytes[12] = static_cast<uint8_t>(ipv4 >> 24);
+			bytes[13] = static_cast<uint8_t>(ipv4 >> 16);
+			bytes[14] = static_cast<uint8_t>(ipv4 >> 8);
+			bytes[15] = static_cast<uint8_t>(ipv4);
+		}
+		else {
+			const auto ipv6 = addr.toIPv6Address();
+			std::copy(ipv6.c, ipv6.c + 16, bytes.begin());
+		}
+
+		return bytes;
+	}
+
+
+	std::optional<std::pair<IpConnectionPolicyTrie::Address, int>> IpConnectionPolicyTrie::parsePrefix(const QString & cidr) {
+		const auto slash = cidr.indexOf('/');
+		const QHostAddress addr(-1 == slash ? cidr : cidr.left(slash));
+
+		if(addr.isNull()) {
+			return {};
+		}
+
+		const bool isIpv4 = (QAbstractSocket::IPv4Protocol == addr.protocol());
+		int length = (isIpv4 ? AddressBits - MappedIpv4PrefixBits : AddressBits);
+
+		if(-1 != slash) {
+			bool ok;
+			const auto prefixLength = cidr.mid(slash + 1).toInt(&ok);
+
+			if(!ok || 0 > prefixLength || length < prefixLength) {
+				return {};
+			}
+
+			length = prefixLength;
+		}
+
+		if(isIpv4) {
+			length += MappedIpv4PrefixBits;
+		}
+
+		return std::make_pair(masked(addressBytes(addr), length), length);
+	}
+
+
+	int IpConnectionPolicyTrie::addNode(const Address & prefix, int length, std::optional<ConnectionPolicy> policy) {
+		m_nodes.push_back({masked(prefix, length), length, policy, {-1, -1}});
+		return static_cast<int>(m_nodes.size() - 1);
+	}
+
+
+	void IpConnectionPolicyTrie::insert(const Address & prefix, int length, ConnectionPolicy policy) {
+		if(m_nodes.empty()) {
+			// the root is the zero-length prefix that every address matches
+			addNode({}, 0, {});
+		}
+
+		int node = 0;
+
+		while(true) {
+			if(length == m_nodes[node].length) {
+				m_nodes[node].policy = policy;
+				return;
+			}
+
+			const auto branch = bitAt(prefix, m_nodes[node].length);
+			const auto child = m_nodes[node].children[branch];
+
+			if(-1 == child) {
+				const auto leaf = addNode(prefix, length, policy);
+				m_nodes[node].children[branch] = leaf;
+				return;
+			}
+
+			const auto common = commonPrefixLength(m_nodes[child].prefix, prefix, std::min(m_nodes[child].length, length));
+
+			if(common == m_nodes[child].length) {
+				node = child;
+				continue;
+			}
+
+			// the new prefix diverges from the child part way along its edge, so the edge
+			// is split where they part
+			const auto split = addNode(prefix, common, {});
+			m_nodes[split].children[bitAt(m_nodes[child].prefix, common)] = child;
+
+			if(common == length) {
+				m_nodes[split].policy = policy;
+			}
+			else {
+				const auto leaf = addNode(prefix, length, policy);
+				m_nodes[split].children[bitAt(prefix, common)] = leaf;
+			}
+
+			m_nodes[node].children[branch] = split;
+			return;
+		}
+	}
+
+
+	std::optional<ConnectionPolicy> IpConnectionPolicyTrie::find(const QHostAddress & addr) const {
+		if(m_nodes.empty()) {
+			return {};
+		}
+
+		const auto bytes = addressBytes(addr);
+		std::optional<ConnectionPolicy> policy = m_nodes[0].policy;
+		int node = 0;
+
+		while(AddressBits > m_nodes[node].length) {
+			const auto child = m_nodes[node].children[bitAt(bytes, m_nodes[node].length)];
+
+			if(-1 == child || m_nodes[child].length > commonPrefixLength(m_nodes[child].prefix, bytes, m_nodes[child].length)) {
+				break;
+			}
+
+			node = child;
+
+			if(m_nodes[node].policy) {
+				policy = m_nodes[node].policy;
+			}
+		}
+
+		return policy;
+	}
+
+
+	void IpConnectionPolicyTrie::clear() {
+		m_nodes.clear();
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file ipconnectionpolicytrie.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the IpConnectionPolicyTrie class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <cstdint>
+/// - <optional>
+/// - <utility>
+/// - <vector>
+/// - <QHostAddress>
+/// - <QString>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_IPCONNECTIONPOLICYTRIE_H
+#define ANANSI_IPCONNECTIONPOLICYTRIE_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <QHostAddress>
+#include <QString>
+
+#include "types.h"
+
+namespace Anansi {
+
+	// connection policies for address prefixes (CIDR blocks), in a path-compressed
+	// binary radix trie keyed on the address bits. a lookup finds the policy for the
+	// longest prefix that contains the address. IPv4 addresses are held as IPv4-mapped
+	// IPv6 addresses, so one trie covers both and a client that connects to a dual-stack
+	// socket over IPv4 matches its IPv4 entries
+	class IpConnectionPolicyTrie final {
+	public:
+		using Address = std::array<uint8_t, 16>;
+		static constexpr const int AddressBits = 128;
+
+		// accepts an address on its own or followed by /prefix-length
+		static std::optional<std::pair<Address, int>> parsePrefix(const QString & cidr);
+		static Address addressBytes(const QHostAddress & addr);
+
+		void insert(const Address & prefix, int length, ConnectionPolicy policy);
+		std::optional<ConnectionPolicy> find(const QHostAddress & addr) const;
+		void clear();
+
+		inline bool isEmpty() const noexcept {
+			return m_nodes.empty();
+		}
+
+	private:
+		// nodes refer to their children by index so that the trie can be copied with the
+		// configuration that owns it
+		struct Node {
+			Address prefix;
+			int length;
+			std::optional<ConnectionPolicy> policy;
+			std::array<int, 2> children;
+		};
+
+		int addNode(const Address & prefix, int length, std::optional<ConnectionPolicy> policy);
+
+		std::vector<Node> m_nodes;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_IPCONNECTIONPOLICYTRIE_H
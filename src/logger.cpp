@@ -0,0 +1,261 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file logger.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the Logger class for Anansi.
+///
+/// The queue works the same way as AccessLogWriter's: a bounded multi-producer,
+/// single-consumer ring in which each cell carries a sequence number. A message is
+/// formatted in full before a cell is claimed, so a cell is never left half-written.
+///
+/// Each line written starts with the level and the function and line that logged it,
+/// in the same format the diagnostics written straight to stderr use.
+///
+/// \dep
+/// - logger.h
+/// - <algorithm>
+/// - <cerrno>
+/// - <chrono>
+/// - <cstdio>
+/// - <string>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+namespace Anansi {
+
+
+	static constexpr const LogLevel DefaultLevel = LogLevel::Warning;
+
+	// marks a message that didn't fit
+	static constexpr const char Truncated[] = "...";
+
+
+	static const char * levelPrefix(LogLevel level) noexcept {
+		switch(level) {
+			case LogLevel::Debug:
+				return "[debug] ";
+
+			case LogLevel::Info:
+				return "[info] ";
+
+			case LogLevel::Warning:
+				return "[warning] ";
+
+			case LogLevel::Error:
+				return "[error] ";
+		}
+
+		return "";
+	}
+
+
+	Logger::Message::Message(LogLevel level, const char * function, int line) noexcept
+	: m_level(level),
+	  m_length(0) {
+		*this << levelPrefix(level) << function << " [" << line << "]: ";
+	}
+
+
+	Logger::Message::~Message() {
+		Logger::instance().write(m_level, m_text.data(), m_length);
+	}
+
+
+	Logger::Message & Logger::Message::operator<<(double value) noexcept {
+		std::array<char, 32> digits;
+		const auto length = std::snprintf(digits.data(), digits.size(), "%g", value);
+
+		if(0 < length) {
+			append(digits.data(), std::min(static_cast<std::size_t>(length), digits.size() - 1));
+		}
+
+		return *this;
+	}
+
+
+	void Logger::Message::append(const char * str, std::size_t length) noexcept {
+		if(m_text.size() <= m_length) {
+			return;
+		}
+
+		if(m_text.size() - m_length < length) {
+			// keep what fits and make it clear that something is missing
+			static constexpr const auto TruncatedLength = sizeof(Truncated) - 1;
+			std::memcpy(m_text.data() + m_length, str, m_text.size() - m_length);
+			std::memcpy(m_text.data() + m_text.size() - TruncatedLength, Truncated, TruncatedLength);
+			m_length = m_text.size();
+			return;
+		}
+
+		std::memcpy(m_text.data() + m_length, str, length);
+		m_length += length;
+	}
+
+
+	Logger::Logger()
+	: m_level(DefaultLevel),
+	  m_cells(std::make_unique<std::array<Cell, QueueCapacity>>()),
+	  m_enqueuePosition(0),
+	  m_dequeuePosition(0),
+	  m_written(0),
+	  m_dropped(0),
+	  m_stopping(false),
+	  m_reportedDropped(0) {
+		// this happens the first time something is logged, and the message may well be about
+		// to report errno
+		const auto savedErrno = errno;
+
+		for(std::size_t idx = 0; idx < QueueCapacity; ++idx) {
+			(*m_cells)[idx].sequence.store(idx, std::memory_order_relaxed);
+		}
+
+		m_thread = std::thread(&Logger::run, this);
+		errno = savedErrno;
+	}
+
+
+	Logger::~Logger() {
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stopping = true;
+		}
+
+		m_wake.notify_one();
+
+		if(m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+
+	Logger & Logger::instance() {
+		static Logger logger;
+		return logger;
+	}
+
+
+	void Logger::write(LogLevel level, const char * text, std::size_t length) noexcept {
+		auto position = m_enqueuePosition.load(std::memory_order_relaxed);
+		Cell * cell;
+
+		while(true) {
+			cell = &(*m_cells)[position % QueueCapacity];
+			const auto sequence = cell->sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+			if(0 == diff) {
+				if(m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if(0 > diff) {
+				// the background thread hasn't caught up - get it going rather than wait for it
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				m_wake.notify_one();
+				return;
+			}
+			else {
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		auto & record = cell->record;
+		record.level = level;
+		record.length = static_cast<uint16_t>(std::min(length, MaxMessageLength));
+		std::memcpy(record.text, text, record.length);
+		cell->sequence.store(position + 1, std::memory_order_release);
+
+		if(LogLevel::Error <= level) {
+			m_wake.notify_one();
+		}
+	}
+
+
+	Logger::Statistics Logger::statistics() const noexcept {
+		Statistics statistics;
+		statistics.written = m_written.load(std::memory_order_relaxed);
+		statistics.dropped = m_dropped.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+
+	void Logger::run() {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		while(!m_stopping) {
+			lock.unlock();
+			flush();
+			lock.lock();
+			m_wake.wait_for(lock, std::chrono::milliseconds(FlushInterval));
+		}
+
+		lock.unlock();
+		flush();
+	}
+
+
+	void Logger::flush() {
+		std::string out;
+		uint64_t count = 0;
+
+		while(true) {
+			auto & cell = (*m_cells)[m_dequeuePosition % QueueCapacity];
+
+			if(cell.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+				break;
+			}
+
+			out.append(cell.record.text, cell.record.length);
+			out.push_back('\n');
+			cell.sequence.store(m_dequeuePosition + QueueCapacity, std::memory_order_release);
+			++m_dequeuePosition;
+			++count;
+		}
+
+		if(const auto dropped = m_dropped.load(std::memory_order_relaxed); dropped != m_reportedDropped) {
+			out.append(levelPrefix(LogLevel::Warning)).append(std::to_string(dropped - m_reportedDropped)).append(" log messages dropped\n");
+			m_reportedDropped = dropped;
+		}
+
+		if(out.empty()) {
+			return;
+		}
+
+		std::fwrite(out.data(), 1, out.size(), stderr);
+		std::fflush(stderr);
+		m_written.fetch_add(count, std::memory_order_relaxed);
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file logger.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the Logger class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <atomic>
+/// - <charconv>
+/// - <condition_variable>
+/// - <cstdint>
+/// - <cstring>
+/// - <memory>
+/// - <mutex>
+/// - <string>
+/// - <thread>
+/// - <type_traits>
+/// - macros.h
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_LOGGER_H
+#define ANANSI_LOGGER_H
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "macros.h"
+#include "types.h"
+
+// messages below this level are compiled out altogether. by default debug messages are
+// only built into debug builds
+#if !defined(ANANSI_MIN_LOG_LEVEL)
+#if defined(NDEBUG)
+#define ANANSI_MIN_LOG_LEVEL 1
+#else
+#define ANANSI_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+// log a diagnostic message. LEVEL is one of the LogLevel enumerators, MESSAGE is
+// anything that can be streamed into a Logger::Message. the message is not formatted -
+// none of the expressions in it are even evaluated - unless LEVEL is being logged
+#define anansiLog(LEVEL, MESSAGE) \
+	do { \
+		if constexpr(Anansi::LogLevel::LEVEL >= Anansi::Logger::MinimumLevel) { \
+			if(Anansi::Logger::instance().isEnabled(Anansi::LogLevel::LEVEL)) { \
+				Anansi::Logger::Message(Anansi::LogLevel::LEVEL, EQ_PRETTY_FUNCTION, __LINE__) << MESSAGE; \
+			} \
+		} \
+	} while(false)
+
+namespace Anansi {
+
+	// leveled diagnostic log, written to stderr. messages are formatted on the thread
+	// that logs them into a fixed-size buffer, handed over through a bounded lock-free
+	// queue and written out in batches by a background thread, so logging never waits
+	// on stderr. when the queue is full messages are dropped and counted
+	class Logger final {
+	public:
+		static constexpr const LogLevel MinimumLevel = static_cast<LogLevel>(ANANSI_MIN_LOG_LEVEL);
+
+		// the most messages waiting to be written
+		static constexpr const std::size_t QueueCapacity = 512;
+
+		// longer messages are truncated
+		static constexpr const std::size_t MaxMessageLength = 500;
+
+		// how often the background thread writes out what has been logged, in msec. errors
+		// are written straight away
+		static constexpr const int FlushInterval = 50;
+
+		struct Statistics {
+			uint64_t written = 0;
+			uint64_t dropped = 0;
+		};
+
+		// formats one message and hands it to the logger when it goes out of scope. use
+		// anansiLog() rather than creating these directly
+		class Message final {
+		public:
+			Message(LogLevel level, const char * function, int line) noexcept;
+			Message(const Message &) = delete;
+			Message(Message &&) = delete;
+			void operator=(const Message &) = delete;
+			void operator=(Message &&) = delete;
+			~Message();
+
+			inline Message & operator<<(const char * str) noexcept {
+				append(str, (str ? std::strlen(str) : 0));
+				return *this;
+			}
+
+			inline Message & operator<<(const std::string & str) noexcept {
+				append(str.data(), str.size());
+				return *this;
+			}
+
+			inline Message & operator<<(char ch) noexcept {
+				append(&ch, 1);
+				return *this;
+			}
+
+			inline Message & operator<<(bool value) noexcept {
+				return *this << (value ? "true" : "false");
+			}
+
+			template<class IntType, std::enable_if_t<std::is_integral_v<IntType>, bool> = true>
+			Message & operator<<(IntType value) noexcept {
+				std::array<char, 24> digits;
+				const auto result = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+				append(digits.data(), static_cast<std::size_t>(result.ptr - digits.data()));
+				return *this;
+			}
+
+			Message & operator<<(double value) noexcept;
+
+		private:
+			void append(const char * str, std::size_t length) noexcept;
+
+			LogLevel m_level;
+			std::size_t m_length;
+			std::array<char, MaxMessageLength> m_text;
+		};
+
+		Logger(const Logger &) = delete;
+		Logger(Logger &&) = delete;
+		void operator=(const Logger &) = delete;
+		void operator=(Logger &&) = delete;
+		~Logger();
+
+		static Logger & instance();
+
+		inline bool isEnabled(LogLevel level) const noexcept {
+			return MinimumLevel <= level && m_level.load(std::memory_order_relaxed) <= level;
+		}
+
+		inline LogLevel level() const noexcept {
+			return m_level.load(std::memory_order_relaxed);
+		}
+
+		// levels below MinimumLevel can't be turned back on at runtime
+		inline void setLevel(LogLevel level) noexcept {
+			m_level.store(level, std::memory_order_relaxed);
+		}
+
+		Statistics statistics() const noexcept;
+
+	private:
+		struct Record {
+			LogLevel level;
+			uint16_t length;
+			char text[MaxMessageLength];
+		};
+
+		struct Cell {
+			std::atomic<std::size_t> sequence;
+			Record record;
+		};
+
+		Logger();
+
+		// safe to call from any thread
+		void write(LogLevel level, const char * text, std::size_t length) noexcept;
+
+		void run();
+		void flush();
+
+		std::atomic<LogLevel> m_level;
+
+		// the queue: any thread enqueues, only the background thread dequeues
+		std::unique_ptr<std::array<Cell, QueueCapacity>> m_cells;
+		std::atomic<std::size_t> m_enqueuePosition;
+		std::size_t m_dequeuePosition;
+		std::atomic<uint64_t> m_written;
+		std::atomic<uint64_t> m_dropped;
+
+		// guards the thread's lifetime; never taken when a message is logged
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		bool m_stopping;
+		std::thread m_thread;
+
+		// only touched by the background thread
+		uint64_t m_reportedDropped;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_LOGGER_H
@@ -27,6 +27,7 @@
 /// - mainwindow.h
 /// - mainwindow.ui
 /// - <iostream>
+/// - <utility>
 /// - <QString>
 /// - <QIcon>
 /// - <QMenu>
@@ -50,6 +51,7 @@
 #include "ui_mainwindow.h"
 
 #include <iostream>
+#include <utility>
 
 #include <QString>
 #include <QIcon>
@@ -142,9 +144,12 @@ namespace Anansi {
 		auto * myServer = m_server.get();
 		m_ui->configuration->setServer(myServer);
 
-		connect(myServer, &Server::connectionReceived, statusBar(), &MainWindowStatusBar::incrementReceived);
-		connect(myServer, &Server::connectionRejected, statusBar(), &MainWindowStatusBar::incrementRejected);
-		connect(myServer, &Server::connectionAccepted, statusBar(), &MainWindowStatusBar::incrementAccepted);
+		statusBar()->setCounters(myServer->counters());
+
+		connect(myServer, &Server::configurationReloaded, this, [this]() {
+			m_ui->configuration->readConfiguration();
+			showTransientInlineNotification(tr("The configuration file has changed and has been reloaded."));
+		});
 
 		setEnabled(true);
 	}
@@ -164,8 +169,8 @@ namespace Anansi {
 			return false;
 		}
 
-		showTransientInlineNotification(tr("Server started listening on %1:%2.").arg(m_server->configuration().listenAddress()).arg(m_server->configuration().port()));
-		m_ui->statusbar->showMessage(tr("The server is listening on %1:%2.").arg(m_server->configuration().listenAddress()).arg(m_server->configuration().port()));
+		showTransientInlineNotification(tr("Server started listening on %1:%2.").arg(std::as_const(*m_server).configuration().listenAddress()).arg(std::as_const(*m_server).configuration().port()));
+		m_ui->statusbar->showMessage(tr("The server is listening on %1:%2.").arg(std::as_const(*m_server).configuration().listenAddress()).arg(std::as_const(*m_server).configuration().port()));
 		m_ui->startStop->setState(StartStopButton::State::Stop);
 		return true;
 	}
@@ -254,6 +259,7 @@ namespace Anansi {
 		QSignalBlocker block(m_recentConfigActionGroup.get());
 		action->setChecked(true);
 		m_server->setConfiguration(std::move(*newConfig));
+		m_server->watchConfigurationFile(fileName);
 		m_ui->configuration->readConfiguration();
 	}
 
@@ -267,7 +273,7 @@ namespace Anansi {
 		}
 
 		if(!QFile::exists(fileName) || QMessageBox::Yes == QMessageBox::question(this, tr("Save Webserver Configuration"), "The file already exists. Are you sure you wish to overwrite it with the webserver configuration?", QMessageBox::Yes | QMessageBox::No, QMessageBox::No)) {
-			if(!m_server->configuration().saveAs(fileName)) {
+			if(!std::as_const(*m_server).configuration().saveAs(fileName)) {
 				showInlineNotification(tr("Save Webserver Configuration"), tr("Could not save the configuration."), NotificationType::Error);
 			}
 
@@ -302,7 +308,7 @@ namespace Anansi {
 			configFilePath += QStringLiteral("/defaultsettings.awcx");
 		}
 
-		if(!m_server->configuration().saveAs(configFilePath)) {
+		if(!std::as_const(*m_server).configuration().saveAs(configFilePath)) {
 			showInlineNotification(tr("The current configuration could not be saved as the default configuration.\nIt was not possible to write to the file \"%1\".").arg(configFilePath), NotificationType::Error);
 			return;
 		}
@@ -311,21 +317,6 @@ namespace Anansi {
 	}
 
 
-	void MainWindow::incrementRequestReceivedCount() {
-		m_ui->statusbar->incrementReceived();
-	}
-
-
-	void MainWindow::incrementRequestAcceptedCount() {
-		m_ui->statusbar->incrementAccepted();
-	}
-
-
-	void MainWindow::incrementRequestRejectedCount() {
-		m_ui->statusbar->incrementRejected();
-	}
-
-
 	void MainWindow::resetRequestReceivedCount() {
 		m_ui->statusbar->resetReceived();
 	}
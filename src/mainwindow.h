@@ -73,9 +73,6 @@ namespace Anansi {
 		void loadConfiguration();
 		void loadConfiguration(const QString & fileName);
 
-		void incrementRequestReceivedCount();
-		void incrementRequestAcceptedCount();
-		void incrementRequestRejectedCount();
 		void resetRequestReceivedCount();
 		void resetRequestAcceptedCount();
 		void resetRequestRejectedCount();
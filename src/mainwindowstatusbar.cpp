@@ -24,8 +24,13 @@
 ///
 /// \brief Implementation of the MainWindowStatusBar class.
 ///
+/// The counts shown are kept by the status bar itself: each poll adds the change in
+/// the server's counters since the previous poll, so resetting a count here leaves
+/// the server's totals alone.
+///
 /// \dep
 /// - mainwindowstatusbar.h
+/// - <QLabel>
 /// - counterlabel.h
 ///
 /// \par Changes
@@ -33,50 +38,126 @@
 
 #include "mainwindowstatusbar.h"
 
+#include <QLabel>
+
 #include "counterlabel.h"
 
 
 namespace Anansi {
 
 
+	// formats a rate in bytes per second for display
+	static QString bytesPerSecondText(double bytesPerSecond) {
+		if(1024.0 * 1024.0 <= bytesPerSecond) {
+			return MainWindowStatusBar::tr("%1 MiB/s").arg(bytesPerSecond / (1024.0 * 1024.0), 0, 'f', 1);
+		}
+
+		if(1024.0 <= bytesPerSecond) {
+			return MainWindowStatusBar::tr("%1 KiB/s").arg(bytesPerSecond / 1024.0, 0, 'f', 1);
+		}
+
+		return MainWindowStatusBar::tr("%1 B/s").arg(bytesPerSecond, 0, 'f', 0);
+	}
+
+
+	// the counts shown are ints; the server's counters are not
+	static int countDelta(uint64_t now, uint64_t then) {
+		return static_cast<int>(now - then);
+	}
+
+
 	MainWindowStatusBar::MainWindowStatusBar(QWidget * parent)
 	: QStatusBar(parent),
 	  m_received(std::make_unique<Equit::CounterLabel>(tr("Requests received: %1"), 0, this)),
 	  m_accepted(std::make_unique<Equit::CounterLabel>(tr("Requests accepted: %1"), 0, this)),
-	  m_rejected(std::make_unique<Equit::CounterLabel>(tr("Requests rejected: %1"), 0, this)) {
+	  m_rejected(std::make_unique<Equit::CounterLabel>(tr("Requests rejected: %1"), 0, this)),
+	  m_cancelled(std::make_unique<Equit::CounterLabel>(tr("Requests cancelled: %1"), 0, this)),
+	  m_throughput(std::make_unique<QLabel>(this)) {
 		addPermanentWidget(m_received.get());
 		addPermanentWidget(m_accepted.get());
 		addPermanentWidget(m_rejected.get());
+		addPermanentWidget(m_cancelled.get());
+		addPermanentWidget(m_throughput.get());
+		m_throughput->setVisible(false);
+		m_pollTimer.setInterval(PollInterval);
+		connect(&m_pollTimer, &QTimer::timeout, this, &MainWindowStatusBar::pollCounters);
 	}
 
 
-	void MainWindowStatusBar::resetReceived() {
-		m_received->reset();
+	// required in impl. file due to use of std::unique_ptr with forward-declared class.
+	MainWindowStatusBar::~MainWindowStatusBar() = default;
+
+
+	void MainWindowStatusBar::setCounters(std::shared_ptr<const ServerCounters> counters) {
+		m_counters = std::move(counters);
+
+		if(!m_counters) {
+			m_pollTimer.stop();
+			m_throughput->setVisible(false);
+			return;
+		}
+
+		m_lastValues = m_counters->values();
+		m_sinceLastPoll.start();
+		m_throughput->setText(tr("%1 req/s, %2").arg(0).arg(bytesPerSecondText(0.0)));
+		m_throughput->setVisible(true);
+		m_pollTimer.start();
 	}
 
 
-	void MainWindowStatusBar::resetAccepted() {
-		m_accepted->reset();
+	void MainWindowStatusBar::pollCounters() {
+		if(!m_counters) {
+			return;
+		}
+
+		const auto values = m_counters->values();
+		const auto elapsed = m_sinceLastPoll.restart();
+
+		// each counter is redrawn at most once per poll
+		if(const auto received = countDelta(values.received, m_lastValues.received); 0 < received) {
+			m_received->add(received);
+		}
+
+		if(const auto accepted = countDelta(values.accepted, m_lastValues.accepted); 0 < accepted) {
+			m_accepted->add(accepted);
+		}
+
+		if(const auto rejected = countDelta(values.rejected, m_lastValues.rejected); 0 < rejected) {
+			m_rejected->add(rejected);
+		}
+
+		if(const auto cancelled = countDelta(values.cancelled, m_lastValues.cancelled); 0 < cancelled) {
+			m_cancelled->add(cancelled);
+		}
+
+		if(0 < elapsed) {
+			const auto seconds = static_cast<double>(elapsed) / 1000.0;
+			const auto requestsPerSecond = static_cast<double>(values.completed - m_lastValues.completed) / seconds;
+			const auto bytesPerSecond = static_cast<double>(values.bytesSent - m_lastValues.bytesSent) / seconds;
+			m_throughput->setText(tr("%1 req/s, %2").arg(requestsPerSecond, 0, 'f', 1).arg(bytesPerSecondText(bytesPerSecond)));
+		}
+
+		m_lastValues = values;
 	}
 
 
-	void MainWindowStatusBar::resetRejected() {
-		m_rejected->reset();
+	void MainWindowStatusBar::resetReceived() {
+		m_received->reset();
 	}
 
 
-	void MainWindowStatusBar::incrementReceived() {
-		m_received->increment();
+	void MainWindowStatusBar::resetAccepted() {
+		m_accepted->reset();
 	}
 
 
-	void MainWindowStatusBar::incrementAccepted() {
-		m_accepted->increment();
+	void MainWindowStatusBar::resetRejected() {
+		m_rejected->reset();
 	}
 
 
-	void MainWindowStatusBar::incrementRejected() {
-		m_rejected->increment();
+	void MainWindowStatusBar::resetCancelled() {
+		m_cancelled->reset();
 	}
 
 
@@ -84,6 +165,7 @@ namespace Anansi {
 		m_received->reset();
 		m_accepted->reset();
 		m_rejected->reset();
+		m_cancelled->reset();
 	}
 
 
@@ -27,6 +27,9 @@
 /// \dep
 /// - <memory>
 /// - <QStatusBar>
+/// - <QTimer>
+/// - <QElapsedTimer>
+/// - servercounters.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -37,6 +40,12 @@
 #include <memory>
 
 #include <QStatusBar>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "servercounters.h"
+
+class QLabel;
 
 namespace Equit {
 	class CounterLabel;
@@ -45,21 +54,36 @@ namespace Equit {
 namespace Anansi {
 	class MainWindowStatusBar : public QStatusBar {
 	public:
+		// how often the server's counters are read, in msec
+		static constexpr const int PollInterval = 1000;
+
 		explicit MainWindowStatusBar(QWidget * parent = nullptr);
+		~MainWindowStatusBar() override;
+
+		// the counters to show. the counts start from whatever the counters hold now
+		void setCounters(std::shared_ptr<const ServerCounters> counters);
 
 	public Q_SLOTS:
 		void resetReceived();
 		void resetAccepted();
 		void resetRejected();
+		void resetCancelled();
 		void resetAllCounters();
-		void incrementReceived();
-		void incrementAccepted();
-		void incrementRejected();
 
 	private:
+		// adds whatever has happened since the last poll to the counters and updates the
+		// throughput display
+		void pollCounters();
+
 		std::unique_ptr<Equit::CounterLabel> m_received;
 		std::unique_ptr<Equit::CounterLabel> m_accepted;
 		std::unique_ptr<Equit::CounterLabel> m_rejected;
+		std::unique_ptr<Equit::CounterLabel> m_cancelled;
+		std::unique_ptr<QLabel> m_throughput;
+		std::shared_ptr<const ServerCounters> m_counters;
+		ServerCounters::Values m_lastValues;
+		QElapsedTimer m_sinceLastPoll;
+		QTimer m_pollTimer;
 	};
 }  // namespace Anansi
 
@@ -29,6 +29,7 @@
 /// - <cstddef>
 /// - <algorithm>
 /// - <iostream>
+/// - <utility>
 /// - macros.h
 /// - assert.h
 /// - types.h
@@ -46,6 +47,7 @@
 #include <cstddef>
 #include <algorithm>
 #include <iostream>
+#include <utility>
 
 #include "macros.h"
 #include "eqassert.h"
@@ -65,7 +67,7 @@ namespace Anansi {
 
 	template<int ColumnIndex>
 	QModelIndex MediaTypeActionsModel::findHelper(const QString & mediaType) const {
-		const auto mediaTypes = m_server->configuration().registeredMediaTypes();
+		const auto mediaTypes = std::as_const(*m_server).configuration().registeredMediaTypes();
 		const auto & begin = mediaTypes.cbegin();
 		const auto & end = mediaTypes.cend();
 		const auto mediaTypeIt = std::find(begin, end, mediaType);
@@ -101,7 +103,7 @@ namespace Anansi {
 
 
 	int MediaTypeActionsModel::rowCount(const QModelIndex &) const {
-		return m_server->configuration().registeredMediaTypeCount();
+		return std::as_const(*m_server).configuration().registeredMediaTypeCount();
 	}
 
 
@@ -173,7 +175,7 @@ namespace Anansi {
 			return {};
 		}
 
-		const auto & config = m_server->configuration();
+		const auto & config = std::as_const(*m_server).configuration();
 		const auto mediaTypes = config.registeredMediaTypes();
 		const auto & mediaType = mediaTypes[static_cast<std::size_t>(row)];
 
@@ -201,6 +203,12 @@ namespace Anansi {
 
 							case WebServerAction::Forbid:
 								return QIcon::fromTheme(QStringLiteral("error"), QIcon(QStringLiteral(":/icons/webserveractions/forbid")));
+
+							case WebServerAction::Proxy:
+								return QIcon::fromTheme(QStringLiteral("network-server"));
+
+							case WebServerAction::Module:
+								return QIcon::fromTheme(QStringLiteral("application-x-sharedlib"));
 						}
 						break;
 
@@ -239,7 +247,7 @@ namespace Anansi {
 				break;
 
 			case CgiColumnIndex: {
-				const auto & config = m_server->configuration();
+				const auto & config = std::as_const(*m_server).configuration();
 				const auto mediaTypes = config.registeredMediaTypes();
 				const auto row = idx.row();
 
@@ -293,6 +301,7 @@ namespace Anansi {
 					return false;
 				}
 
+				m_server->configurationChanged();
 				Q_EMIT actionChanged(mediaType, newAction);
 				return true;
 			}
@@ -308,6 +317,7 @@ namespace Anansi {
 				}
 
 				config.setMediaTypeCgi(mediaType, newCgi);
+				m_server->configurationChanged();
 				Q_EMIT cgiChanged(mediaType, newCgi);
 				return true;
 			}
@@ -349,6 +359,7 @@ namespace Anansi {
 			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: received CGI \"" << qPrintable(cgi) << "\" for media type \"" << qPrintable(mediaType) << "\" but its action was not WebServerAction::CGI\n";
 		}
 
+		m_server->configurationChanged();
 		beginResetModel();
 		endResetModel();
 		return findMediaTypeAction(mediaType);
@@ -384,6 +395,8 @@ namespace Anansi {
 			config.unsetMediaTypeAction(mediaType);
 		});
 
+		m_server->configurationChanged();
+
 		endRemoveRows();
 		return true;
 	}
@@ -392,6 +405,7 @@ namespace Anansi {
 	void MediaTypeActionsModel::clear() {
 		beginResetModel();
 		m_server->configuration().clearAllMediaTypeActions();
+		m_server->configurationChanged();
 		endResetModel();
 	}
 
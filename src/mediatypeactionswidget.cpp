@@ -29,6 +29,7 @@
 /// - mediatypeactionswidget.ui
 /// - <array>
 /// - <iostream>
+/// - <utility>
 /// - <QMenu>
 /// - <QSignalBlocker>
 /// - <QPushButton>
@@ -52,6 +53,7 @@
 
 #include <array>
 #include <iostream>
+#include <utility>
 
 #include <QMenu>
 #include <QSignalBlocker>
@@ -153,6 +155,7 @@ namespace Anansi {
 			}
 
 			m_server->configuration().setDefaultAction(action);
+			m_server->configurationChanged();
 			Q_EMIT defaultActionChanged(action);
 		});
 	}
@@ -182,9 +185,9 @@ namespace Anansi {
 			m_model = std::make_unique<MediaTypeActionsModel>(server);
 			m_proxyModel->setSourceModel(m_model.get());
 
-			m_ui->defaultAction->setWebServerAction(server->configuration().defaultAction());
+			m_ui->defaultAction->setWebServerAction(std::as_const(*server).configuration().defaultAction());
 
-			for(const auto & mediaType : server->configuration().allKnownMediaTypes()) {
+			for(const auto & mediaType : std::as_const(*server).configuration().allKnownMediaTypes()) {
 				m_addMediaTypeCombo->addMediaType(mediaType);
 			}
 		}
@@ -27,6 +27,7 @@
 /// \dep
 /// - mediatypeicons.h
 /// - <QBuffer>
+/// - <QGuiApplication>
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -34,12 +35,18 @@
 #include "mediatypeicons.h"
 
 #include <QBuffer>
+#include <QGuiApplication>
 
 
 namespace Anansi {
 
 
 	QByteArray mediaTypeIconUri(const QString & mediaType, int size) {
+		// icons can't be rendered without a GUI application (e.g. in anansid)
+		if(!qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+			return {};
+		}
+
 		auto icon = mediaTypeIcon(mediaType);
 
 		if(icon.isNull()) {
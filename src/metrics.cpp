@@ -0,0 +1,553 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file metrics.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the Metrics class for Anansi.
+///
+/// Each thread that records anything gets a shard of counters the first time it does
+/// so. Only that thread ever writes to the shard, so recording is a plain load and
+/// store with no read-modify-write; the atomics are only there so that a report can
+/// read the shard while its thread is still running. When a thread finishes, its
+/// shard is added to the retired totals. Request handlers run on a thread per
+/// connection, so this happens once per connection.
+///
+/// \dep
+/// - metrics.h
+/// - <algorithm>
+/// - <cmath>
+/// - <QByteArray>
+/// - cgiconcurrencylimiter.h
+/// - cgiresponsecache.h
+/// - accesslogwriter.h
+/// - requesttracewriter.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QByteArray>
+
+#include "cgiconcurrencylimiter.h"
+#include "cgiresponsecache.h"
+#include "accesslogwriter.h"
+#include "requesttracewriter.h"
+
+
+namespace Anansi {
+
+
+	// the histogram buckets reported to Prometheus, in usec: every power of two from 16us
+	// to about 33s. these are all bucket limits, so the counts for them are exact
+	static constexpr const int FirstReportedMagnitude = 4;
+	static constexpr const int LastReportedMagnitude = 25;
+
+	static constexpr const std::array<double, 6> ReportedPercentiles = {0.5, 0.75, 0.9, 0.99, 0.999, 1.0};
+
+	static constexpr const std::array<const char *, Metrics::StageCount> StageNames = {"read_headers", "read_body", "resolve", "send", "total"};
+	static constexpr const std::array<const char *, Metrics::CgiLaunchCount> CgiLaunchNames = {"process", "pooled_worker", "fastcgi"};
+	static constexpr const std::array<const char *, Metrics::EncodingCount> EncodingNames = {"identity", "deflate", "gzip"};
+
+
+	struct AtomicHistogram {
+		std::array<std::atomic<uint64_t>, Metrics::Histogram::BucketCount> counts;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> max;
+	};
+
+
+	struct Metrics::Shard {
+		std::atomic<uint64_t> requests;
+		std::array<std::atomic<uint64_t>, ActionCount> actions;
+		std::array<std::atomic<uint64_t>, StatusCount> statuses;
+		std::atomic<uint64_t> bytesIn;
+		std::atomic<uint64_t> bytesOut;
+		std::array<std::atomic<uint64_t>, EncodingCount> encodings;
+		std::array<std::atomic<uint64_t>, CgiLaunchCount> cgiLaunches;
+		AtomicHistogram cgiDuration;
+		std::array<AtomicHistogram, StageCount> stages;
+	};
+
+
+	// owns the calling thread's shard and retires it when the thread finishes
+	class Metrics::LocalShard final {
+	public:
+		explicit LocalShard(Metrics & metrics)
+		: m_metrics(metrics),
+		  m_shard(std::make_unique<Shard>()) {
+			std::lock_guard<std::mutex> lock(m_metrics.m_lock);
+			m_metrics.m_shards.push_back(m_shard.get());
+		}
+
+		~LocalShard() {
+			std::lock_guard<std::mutex> lock(m_metrics.m_lock);
+			addShard(m_metrics.m_retired, *m_shard);
+			m_metrics.m_shards.erase(std::find(m_metrics.m_shards.begin(), m_metrics.m_shards.end(), m_shard.get()));
+		}
+
+		inline Shard & shard() noexcept {
+			return *m_shard;
+		}
+
+	private:
+		Metrics & m_metrics;
+		std::unique_ptr<Shard> m_shard;
+	};
+
+
+	// only ever called by the thread that owns the counter
+	static inline void bump(std::atomic<uint64_t> & counter, uint64_t amount = 1) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+
+	static void record(AtomicHistogram & histogram, Metrics::Clock::duration duration) noexcept {
+		const auto usec = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+		bump(histogram.counts[static_cast<std::size_t>(Metrics::Histogram::bucket(usec))]);
+		bump(histogram.count);
+		bump(histogram.sum, usec);
+
+		if(histogram.max.load(std::memory_order_relaxed) < usec) {
+			histogram.max.store(usec, std::memory_order_relaxed);
+		}
+	}
+
+
+	static void add(Metrics::Histogram & histogram, const AtomicHistogram & shard) noexcept {
+		for(std::size_t idx = 0; idx < histogram.counts.size(); ++idx) {
+			histogram.counts[idx] += shard.counts[idx].load(std::memory_order_relaxed);
+		}
+
+		histogram.count += shard.count.load(std::memory_order_relaxed);
+		histogram.sum += shard.sum.load(std::memory_order_relaxed);
+		histogram.max = std::max(histogram.max, shard.max.load(std::memory_order_relaxed));
+	}
+
+
+	int Metrics::Histogram::bucket(uint64_t value) noexcept {
+		if(static_cast<uint64_t>(ExactCount) > value) {
+			return static_cast<int>(value);
+		}
+
+		int magnitude = 0;
+
+		while(value >> (magnitude + 1)) {
+			++magnitude;
+		}
+
+		if(MaxMagnitude < magnitude) {
+			return BucketCount - 1;
+		}
+
+		const auto subBucket = static_cast<int>(value >> (magnitude - SubBucketBits)) - SubBucketCount;
+		return ExactCount + (magnitude - SubBucketBits - 1) * SubBucketCount + subBucket;
+	}
+
+
+	uint64_t Metrics::Histogram::bucketLimit(int bucket) noexcept {
+		if(ExactCount > bucket) {
+			return static_cast<uint64_t>(bucket) + 1;
+		}
+
+		const auto magnitude = SubBucketBits + 1 + (bucket - ExactCount) / SubBucketCount;
+		const auto subBucket = (bucket - ExactCount) % SubBucketCount;
+		return static_cast<uint64_t>(SubBucketCount + subBucket + 1) << (magnitude - SubBucketBits);
+	}
+
+
+	uint64_t Metrics::Histogram::percentile(double fraction) const noexcept {
+		if(0 == count) {
+			return 0;
+		}
+
+		const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count))));
+		uint64_t seen = 0;
+
+		for(int idx = 0; idx < BucketCount; ++idx) {
+			seen += counts[static_cast<std::size_t>(idx)];
+
+			if(target <= seen) {
+				return std::min(bucketLimit(idx), max);
+			}
+		}
+
+		return max;
+	}
+
+
+	uint64_t Metrics::Histogram::countBelow(uint64_t limit) const noexcept {
+		uint64_t below = 0;
+
+		for(int idx = 0; idx < BucketCount && bucketLimit(idx) <= limit; ++idx) {
+			below += counts[static_cast<std::size_t>(idx)];
+		}
+
+		return below;
+	}
+
+
+	void Metrics::Histogram::add(const Histogram & other) noexcept {
+		for(std::size_t idx = 0; idx < counts.size(); ++idx) {
+			counts[idx] += other.counts[idx];
+		}
+
+		count += other.count;
+		sum += other.sum;
+		max = std::max(max, other.max);
+	}
+
+
+	Metrics::Metrics()
+	: m_activeConnections(0) {
+	}
+
+
+	Metrics::~Metrics() = default;
+
+
+	Metrics & Metrics::instance() {
+		static Metrics metrics;
+		return metrics;
+	}
+
+
+	Metrics::Shard & Metrics::localShard() {
+		thread_local LocalShard local(*this);
+		return local.shard();
+	}
+
+
+	void Metrics::addShard(Snapshot & snapshot, const Shard & shard) noexcept {
+		const auto addAll = [](auto & totals, const auto & counters) {
+			for(std::size_t idx = 0; idx < totals.size(); ++idx) {
+				totals[idx] += counters[idx].load(std::memory_order_relaxed);
+			}
+		};
+
+		snapshot.requests += shard.requests.load(std::memory_order_relaxed);
+		addAll(snapshot.actions, shard.actions);
+		addAll(snapshot.statuses, shard.statuses);
+		snapshot.bytesIn += shard.bytesIn.load(std::memory_order_relaxed);
+		snapshot.bytesOut += shard.bytesOut.load(std::memory_order_relaxed);
+		addAll(snapshot.encodings, shard.encodings);
+		addAll(snapshot.cgiLaunches, shard.cgiLaunches);
+		add(snapshot.cgiDuration, shard.cgiDuration);
+
+		for(std::size_t idx = 0; idx < snapshot.stages.size(); ++idx) {
+			add(snapshot.stages[idx], shard.stages[idx]);
+		}
+	}
+
+
+	void Metrics::recordAction(WebServerAction action) noexcept {
+		bump(localShard().actions[static_cast<std::size_t>(action)]);
+	}
+
+
+	void Metrics::recordRequest(const Request & request) noexcept {
+		auto & shard = localShard();
+		bump(shard.requests);
+
+		if(100 <= request.status && 100 + StatusCount > request.status) {
+			bump(shard.statuses[static_cast<std::size_t>(request.status - 100)]);
+		}
+
+		bump(shard.bytesIn, request.bytesIn);
+		bump(shard.bytesOut, request.bytesOut);
+
+		if(request.encoding) {
+			bump(shard.encodings[static_cast<std::size_t>(*request.encoding)]);
+		}
+
+		for(std::size_t idx = 0; idx < request.stages.size(); ++idx) {
+			if(request.stages[idx]) {
+				record(shard.stages[idx], *request.stages[idx]);
+			}
+		}
+	}
+
+
+	void Metrics::recordCgiLaunch(CgiLaunch launch) noexcept {
+		bump(localShard().cgiLaunches[static_cast<std::size_t>(launch)]);
+	}
+
+
+	void Metrics::recordCgiDuration(Clock::duration duration) noexcept {
+		record(localShard().cgiDuration, duration);
+	}
+
+
+	Metrics::Snapshot Metrics::snapshot() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		auto snapshot = m_retired;
+
+		for(const auto * shard : m_shards) {
+			addShard(snapshot, *shard);
+		}
+
+		snapshot.activeConnections = m_activeConnections.load(std::memory_order_relaxed);
+		return snapshot;
+	}
+
+
+	static QByteArray seconds(uint64_t usec) {
+		return QByteArray::number(static_cast<double>(usec) / 1000000.0, 'g', 9);
+	}
+
+
+	QByteArray Metrics::prometheusText() const {
+		const auto metrics = snapshot();
+		const auto cgiLimiter = CgiConcurrencyLimiter::instance().statistics();
+		const auto cgiCache = CgiResponseCache::instance().statistics();
+		const auto accessLog = AccessLogWriter::instance().statistics();
+		const auto requestTrace = RequestTraceWriter::instance().statistics();
+		QByteArray out;
+
+		const auto header = [&out](const char * name, const char * type, const char * help) {
+			out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+			out.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+		};
+
+		const auto value = [&out](const char * name, uint64_t value, const QByteArray & labels = {}) {
+			out.append(name);
+
+			if(!labels.isEmpty()) {
+				out.append('{').append(labels).append('}');
+			}
+
+			out.append(' ').append(QByteArray::number(static_cast<qulonglong>(value))).append('\n');
+		};
+
+		const auto histogram = [&out](const char * name, const Histogram & histogram, const QByteArray & labels = {}) {
+			const QByteArray prefix = (labels.isEmpty() ? QByteArray() : labels + ',');
+
+			for(auto magnitude = FirstReportedMagnitude; magnitude <= LastReportedMagnitude; ++magnitude) {
+				const auto limit = uint64_t(1) << magnitude;
+				out.append(name).append("_bucket{").append(prefix).append("le=\"").append(seconds(limit)).append("\"} ");
+				out.append(QByteArray::number(static_cast<qulonglong>(histogram.countBelow(limit)))).append('\n');
+			}
+
+			out.append(name).append("_bucket{").append(prefix).append("le=\"+Inf\"} ").append(QByteArray::number(static_cast<qulonglong>(histogram.count))).append('\n');
+			out.append(name).append("_sum");
+
+			if(!labels.isEmpty()) {
+				out.append('{').append(labels).append('}');
+			}
+
+			out.append(' ').append(seconds(histogram.sum)).append('\n');
+			out.append(name).append("_count");
+
+			if(!labels.isEmpty()) {
+				out.append('{').append(labels).append('}');
+			}
+
+			out.append(' ').append(QByteArray::number(static_cast<qulonglong>(histogram.count))).append('\n');
+		};
+
+		header("anansi_requests_total", "counter", "Requests handled.");
+		value("anansi_requests_total", metrics.requests);
+
+		header("anansi_actions_total", "counter", "Actions taken for requested resources.");
+
+		for(std::size_t idx = 0; idx < metrics.actions.size(); ++idx) {
+			value("anansi_actions_total", metrics.actions[idx], "action=\"" + enumeratorString<QByteArray>(static_cast<WebServerAction>(idx)) + '"');
+		}
+
+		header("anansi_responses_total", "counter", "Responses sent, by HTTP response code.");
+
+		for(std::size_t idx = 0; idx < metrics.statuses.size(); ++idx) {
+			if(0 < metrics.statuses[idx]) {
+				value("anansi_responses_total", metrics.statuses[idx], "code=\"" + QByteArray::number(static_cast<int>(idx) + 100) + '"');
+			}
+		}
+
+		header("anansi_received_bytes_total", "counter", "Bytes received from clients in request lines, headers and bodies.");
+		value("anansi_received_bytes_total", metrics.bytesIn);
+		header("anansi_sent_bytes_total", "counter", "Bytes sent to clients, headers included.");
+		value("anansi_sent_bytes_total", metrics.bytesOut);
+		header("anansi_active_connections", "gauge", "Connections currently being handled.");
+		value("anansi_active_connections", static_cast<uint64_t>(std::max(0, metrics.activeConnections)));
+
+		header("anansi_content_encodings_total", "counter", "Responses sent with each content encoding.");
+
+		for(std::size_t idx = 0; idx < metrics.encodings.size(); ++idx) {
+			value("anansi_content_encodings_total", metrics.encodings[idx], QByteArrayLiteral("encoding=\"") + EncodingNames[idx] + '"');
+		}
+
+		header("anansi_cgi_launches_total", "counter", "CGI requests, by how the script was run.");
+
+		for(std::size_t idx = 0; idx < metrics.cgiLaunches.size(); ++idx) {
+			value("anansi_cgi_launches_total", metrics.cgiLaunches[idx], QByteArrayLiteral("kind=\"") + CgiLaunchNames[idx] + '"');
+		}
+
+		header("anansi_cgi_duration_seconds", "histogram", "Time from running a CGI script to sending the last of its response.");
+		histogram("anansi_cgi_duration_seconds", metrics.cgiDuration);
+
+		header("anansi_cgi_running", "gauge", "CGI processes currently admitted by the concurrency limiter.");
+		value("anansi_cgi_running", static_cast<uint64_t>(std::max(0, cgiLimiter.running)));
+		header("anansi_cgi_queued", "gauge", "CGI requests waiting for the concurrency limiter.");
+		value("anansi_cgi_queued", static_cast<uint64_t>(std::max(0, cgiLimiter.queued)));
+		header("anansi_cgi_rejected_total", "counter", "CGI requests turned away because the queue was full or the wait timed out.");
+		value("anansi_cgi_rejected_total", cgiLimiter.rejected + cgiLimiter.timedOut);
+		header("anansi_cgi_queue_cancelled_total", "counter", "CGI requests whose client disconnected while they waited for the concurrency limiter.");
+		value("anansi_cgi_queue_cancelled_total", cgiLimiter.cancelled);
+		header("anansi_cgi_admitted_total", "counter", "CGI requests admitted by the concurrency limiter, straight away or after waiting.");
+		value("anansi_cgi_admitted_total", cgiLimiter.admitted);
+		header("anansi_cgi_queue_waits_total", "counter", "CGI requests that had to wait for the concurrency limiter.");
+		value("anansi_cgi_queue_waits_total", cgiLimiter.waited);
+		header("anansi_cgi_queue_wait_seconds_total", "counter", "Time CGI requests spent waiting for the concurrency limiter before being admitted.");
+		out.append("anansi_cgi_queue_wait_seconds_total ").append(seconds(cgiLimiter.totalWaitTime * 1000)).append('\n');
+		header("anansi_cgi_queue_wait_max_seconds", "gauge", "Longest time a CGI request has waited for the concurrency limiter before being admitted.");
+		out.append("anansi_cgi_queue_wait_max_seconds ").append(seconds(static_cast<uint64_t>(std::max(0, cgiLimiter.maxWaitTime)) * 1000)).append('\n');
+
+		header("anansi_cgi_cache_lookups_total", "counter", "CGI response cache lookups, by outcome.");
+		value("anansi_cgi_cache_lookups_total", cgiCache.hits, "outcome=\"hit\"");
+		value("anansi_cgi_cache_lookups_total", cgiCache.staleHits, "outcome=\"stale\"");
+		value("anansi_cgi_cache_lookups_total", cgiCache.misses, "outcome=\"miss\"");
+		value("anansi_cgi_cache_lookups_total", cgiCache.coalesced, "outcome=\"coalesced\"");
+		header("anansi_cgi_cache_bytes", "gauge", "CGI output held in the response cache.");
+		value("anansi_cgi_cache_bytes", static_cast<uint64_t>(std::max(0, cgiCache.size)));
+
+		header("anansi_access_log_lines_total", "counter", "Access log lines, by outcome.");
+		value("anansi_access_log_lines_total", accessLog.written, "outcome=\"written\"");
+		value("anansi_access_log_lines_total", accessLog.dropped, "outcome=\"dropped\"");
+
+		header("anansi_request_traces_total", "counter", "Sampled request traces, by outcome.");
+		value("anansi_request_traces_total", requestTrace.written, "outcome=\"written\"");
+		value("anansi_request_traces_total", requestTrace.dropped, "outcome=\"dropped\"");
+
+		header("anansi_request_stage_duration_seconds", "histogram", "Time spent in each stage of handling a request.");
+
+		for(std::size_t idx = 0; idx < metrics.stages.size(); ++idx) {
+			histogram("anansi_request_stage_duration_seconds", metrics.stages[idx], QByteArrayLiteral("stage=\"") + StageNames[idx] + '"');
+		}
+
+		return out;
+	}
+
+
+	QByteArray Metrics::json() const {
+		const auto metrics = snapshot();
+		const auto cgiLimiter = CgiConcurrencyLimiter::instance().statistics();
+		const auto cgiCache = CgiResponseCache::instance().statistics();
+		const auto accessLog = AccessLogWriter::instance().statistics();
+		const auto requestTrace = RequestTraceWriter::instance().statistics();
+		QByteArray out;
+
+		const auto number = [](auto value) {
+			return QByteArray::number(static_cast<qulonglong>(value));
+		};
+
+		// all values in usec
+		const auto histogram = [&out, &number](const Histogram & histogram) {
+			out.append("{\"count\":").append(number(histogram.count));
+			out.append(",\"mean\":").append(number(0 == histogram.count ? 0 : histogram.sum / histogram.count));
+
+			for(const auto fraction : ReportedPercentiles) {
+				if(1.0 == fraction) {
+					out.append(",\"max\":").append(number(histogram.max));
+				}
+				else {
+					out.append(",\"p").append(QByteArray::number(fraction * 100.0, 'g', 4)).append("\":").append(number(histogram.percentile(fraction)));
+				}
+			}
+
+			out.append('}');
+		};
+
+		out.append("{\"requests\":").append(number(metrics.requests));
+		out.append(",\"actions\":{");
+
+		for(std::size_t idx = 0; idx < metrics.actions.size(); ++idx) {
+			out.append(0 == idx ? "\"" : ",\"").append(enumeratorString<QByteArray>(static_cast<WebServerAction>(idx))).append("\":").append(number(metrics.actions[idx]));
+		}
+
+		out.append("},\"responses\":{");
+		bool first = true;
+
+		for(std::size_t idx = 0; idx < metrics.statuses.size(); ++idx) {
+			if(0 < metrics.statuses[idx]) {
+				out.append(first ? "\"" : ",\"").append(QByteArray::number(static_cast<int>(idx) + 100)).append("\":").append(number(metrics.statuses[idx]));
+				first = false;
+			}
+		}
+
+		out.append("},\"bytesIn\":").append(number(metrics.bytesIn));
+		out.append(",\"bytesOut\":").append(number(metrics.bytesOut));
+		out.append(",\"activeConnections\":").append(QByteArray::number(metrics.activeConnections));
+		out.append(",\"contentEncodings\":{");
+
+		for(std::size_t idx = 0; idx < metrics.encodings.size(); ++idx) {
+			out.append(0 == idx ? "\"" : ",\"").append(EncodingNames[idx]).append("\":").append(number(metrics.encodings[idx]));
+		}
+
+		out.append("},\"cgi\":{\"launches\":{");
+
+		for(std::size_t idx = 0; idx < metrics.cgiLaunches.size(); ++idx) {
+			out.append(0 == idx ? "\"" : ",\"").append(CgiLaunchNames[idx]).append("\":").append(number(metrics.cgiLaunches[idx]));
+		}
+
+		out.append("},\"duration\":");
+		histogram(metrics.cgiDuration);
+		out.append(",\"running\":").append(QByteArray::number(cgiLimiter.running));
+		out.append(",\"queued\":").append(QByteArray::number(cgiLimiter.queued));
+		out.append(",\"peakQueued\":").append(QByteArray::number(cgiLimiter.peakQueued));
+		out.append(",\"rejected\":").append(number(cgiLimiter.rejected));
+		out.append(",\"timedOut\":").append(number(cgiLimiter.timedOut));
+		out.append(",\"cancelled\":").append(number(cgiLimiter.cancelled));
+		out.append(",\"admitted\":").append(number(cgiLimiter.admitted));
+		out.append(",\"waited\":").append(number(cgiLimiter.waited));
+
+		// in usec, like the histograms
+		out.append(",\"totalWait\":").append(number(cgiLimiter.totalWaitTime * 1000));
+		out.append(",\"maxWait\":").append(number(static_cast<uint64_t>(std::max(0, cgiLimiter.maxWaitTime)) * 1000));
+		out.append(",\"cache\":{\"hits\":").append(number(cgiCache.hits));
+		out.append(",\"staleHits\":").append(number(cgiCache.staleHits));
+		out.append(",\"misses\":").append(number(cgiCache.misses));
+		out.append(",\"coalesced\":").append(number(cgiCache.coalesced));
+		out.append(",\"entries\":").append(QByteArray::number(cgiCache.entries));
+		out.append(",\"size\":").append(QByteArray::number(cgiCache.size));
+		out.append("}},\"accessLog\":{\"written\":").append(number(accessLog.written));
+		out.append(",\"dropped\":").append(number(accessLog.dropped));
+		out.append(",\"rotations\":").append(number(accessLog.rotations));
+		out.append("},\"requestTrace\":{\"kept\":").append(number(requestTrace.kept));
+		out.append(",\"written\":").append(number(requestTrace.written));
+		out.append(",\"dropped\":").append(number(requestTrace.dropped));
+		out.append("},\"stages\":{");
+
+		for(std::size_t idx = 0; idx < metrics.stages.size(); ++idx) {
+			out.append(0 == idx ? "\"" : ",\"").append(StageNames[idx]).append("\":");
+			histogram(metrics.stages[idx]);
+		}
+
+		out.append("}}");
+		return out;
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file metrics.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the Metrics class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <atomic>
+/// - <chrono>
+/// - <cstdint>
+/// - <memory>
+/// - <mutex>
+/// - <optional>
+/// - <vector>
+/// - <QByteArray>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_METRICS_H
+#define ANANSI_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <QByteArray>
+
+#include "types.h"
+
+namespace Anansi {
+
+	// server-wide counters and latency histograms, served from the status endpoint. each
+	// thread records into counters of its own, which are only added up when a report is
+	// requested, so recording never contends with other threads
+	class Metrics final {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		enum class Stage {
+			ReadHeaders = 0,
+			ReadBody,
+			Resolve,
+			Send,
+			Total,
+		};
+
+		enum class CgiLaunch {
+			Process = 0,
+			PooledWorker,
+			FastCgi,
+		};
+
+		static constexpr const int StageCount = static_cast<int>(Stage::Total) + 1;
+		static constexpr const int CgiLaunchCount = static_cast<int>(CgiLaunch::FastCgi) + 1;
+		static constexpr const int ActionCount = static_cast<int>(WebServerAction::Module) + 1;
+		static constexpr const int EncodingCount = static_cast<int>(ContentEncoding::Gzip) + 1;
+
+		// response codes 100 to 599
+		static constexpr const int StatusCount = 500;
+
+		// durations in usec, in log-linear buckets: exact below 16, and above that each
+		// power of two is split into 8 so any value is within 12.5% of its bucket's bounds
+		class Histogram final {
+		public:
+			static constexpr const int SubBucketBits = 3;
+			static constexpr const int SubBucketCount = 1 << SubBucketBits;
+			static constexpr const int ExactCount = SubBucketCount * 2;
+			static constexpr const int MaxMagnitude = 36;
+			static constexpr const int BucketCount = ExactCount + (MaxMagnitude - SubBucketBits) * SubBucketCount;
+
+			static int bucket(uint64_t value) noexcept;
+
+			// the smallest value that falls in the next bucket
+			static uint64_t bucketLimit(int bucket) noexcept;
+
+			// the smallest bucket limit that at least the given fraction of values are below
+			uint64_t percentile(double fraction) const noexcept;
+
+			// values below limit, which should be a bucket limit
+			uint64_t countBelow(uint64_t limit) const noexcept;
+
+			void add(const Histogram & other) noexcept;
+
+			std::array<uint64_t, BucketCount> counts = {};
+			uint64_t count = 0;
+			uint64_t sum = 0;
+			uint64_t max = 0;
+		};
+
+		struct Snapshot {
+			uint64_t requests = 0;
+			std::array<uint64_t, ActionCount> actions = {};
+			std::array<uint64_t, StatusCount> statuses = {};
+			uint64_t bytesIn = 0;
+			uint64_t bytesOut = 0;
+			std::array<uint64_t, EncodingCount> encodings = {};
+			std::array<uint64_t, CgiLaunchCount> cgiLaunches = {};
+			Histogram cgiDuration;
+			std::array<Histogram, StageCount> stages;
+			int activeConnections = 0;
+		};
+
+		// what a handler reports once it has finished with its connection. stages that
+		// were never reached are left empty
+		struct Request {
+			int status = 0;
+			uint64_t bytesIn = 0;
+			uint64_t bytesOut = 0;
+			std::optional<ContentEncoding> encoding;
+			std::array<std::optional<Clock::duration>, StageCount> stages;
+		};
+
+		Metrics(const Metrics &) = delete;
+		Metrics(Metrics &&) = delete;
+		void operator=(const Metrics &) = delete;
+		void operator=(Metrics &&) = delete;
+		~Metrics();
+
+		static Metrics & instance();
+
+		void recordAction(WebServerAction action) noexcept;
+		void recordRequest(const Request & request) noexcept;
+		void recordCgiLaunch(CgiLaunch launch) noexcept;
+		void recordCgiDuration(Clock::duration duration) noexcept;
+
+		inline void connectionOpened() noexcept {
+			m_activeConnections.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		inline void connectionClosed() noexcept {
+			m_activeConnections.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		Snapshot snapshot() const;
+
+		// the snapshot plus the statistics of the CGI limiter and cache and the access
+		// log, in Prometheus text exposition format or as a JSON object
+		QByteArray prometheusText() const;
+		QByteArray json() const;
+
+	private:
+		struct Shard;
+		class LocalShard;
+
+		Metrics();
+		Shard & localShard();
+		static void addShard(Snapshot & snapshot, const Shard & shard) noexcept;
+
+		mutable std::mutex m_lock;
+		std::vector<Shard *> m_shards;
+
+		// the totals from threads that have finished
+		Snapshot m_retired;
+
+		std::atomic<int> m_activeConnections;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_METRICS_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file moduleloader.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the ModuleLoader class for Anansi.
+///
+/// A module that fails to load is not remembered, so it is tried again for the next
+/// request that needs it. This means a broken module can be fixed without restarting
+/// the server; a module that has loaded is never reloaded.
+///
+/// \dep
+/// - moduleloader.h
+/// - <mutex>
+/// - <QLibrary>
+/// - logger.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "moduleloader.h"
+
+#include <mutex>
+
+#include <QLibrary>
+
+#include "logger.h"
+
+
+namespace Anansi {
+
+
+	ModuleLoader::~ModuleLoader() = default;
+
+
+	ModuleLoader & ModuleLoader::instance() {
+		static ModuleLoader loader;
+		return loader;
+	}
+
+
+	std::optional<ModuleLoader::LoadedModule> ModuleLoader::load(const QString & path) {
+		auto library = std::make_unique<QLibrary>(path);
+
+		if(!library->load()) {
+			anansiLog(Error, "failed to load handler module \"" << qPrintable(path) << "\" (\"" << qPrintable(library->errorString()) << "\")");
+			return {};
+		}
+
+		const auto apiVersion = reinterpret_cast<Module::ApiVersionFunction>(library->resolve("anansiModuleApiVersion"));
+		const auto createHandler = reinterpret_cast<Module::CreateHandlerFunction>(library->resolve("anansiModuleCreateHandler"));
+
+		if(!apiVersion || !createHandler) {
+			anansiLog(Error, "\"" << qPrintable(path) << "\" is not an Anansi handler module");
+			library->unload();
+			return {};
+		}
+
+		if(Module::ApiVersion != apiVersion()) {
+			anansiLog(Error, "handler module \"" << qPrintable(path) << "\" was built for API version " << apiVersion() << " (expecting " << Module::ApiVersion << ")");
+			library->unload();
+			return {};
+		}
+
+		std::unique_ptr<Module::Handler> handler(createHandler());
+
+		if(!handler) {
+			anansiLog(Error, "handler module \"" << qPrintable(path) << "\" failed to create its handler");
+			library->unload();
+			return {};
+		}
+
+		return LoadedModule{std::move(library), std::move(handler)};
+	}
+
+
+	Module::Handler * ModuleLoader::handler(const QString & path) {
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lock);
+
+			if(const auto module = m_modules.find(path); module != m_modules.cend()) {
+				return module->second.handler.get();
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(m_lock);
+
+		// another thread may have loaded it while we were waiting for the lock
+		if(const auto module = m_modules.find(path); module != m_modules.cend()) {
+			return module->second.handler.get();
+		}
+
+		auto module = load(path);
+
+		if(!module) {
+			return nullptr;
+		}
+
+		return m_modules.emplace(path, std::move(*module)).first->second.handler.get();
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file moduleloader.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the ModuleLoader class for Anansi.
+///
+/// \dep
+/// - <memory>
+/// - <optional>
+/// - <shared_mutex>
+/// - <unordered_map>
+/// - <QString>
+/// - handlermodule.h
+/// - qtstdhash.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_MODULELOADER_H
+#define ANANSI_MODULELOADER_H
+
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <QString>
+
+#include "handlermodule.h"
+#include "qtstdhash.h"
+
+class QLibrary;
+
+namespace Anansi {
+
+	// the handler modules in use, each loaded the first time a request needs it. modules
+	// stay loaded until the server exits so their handlers can be used without holding
+	// any lock
+	class ModuleLoader final {
+	public:
+		ModuleLoader(const ModuleLoader &) = delete;
+		ModuleLoader(ModuleLoader &&) = delete;
+		void operator=(const ModuleLoader &) = delete;
+		void operator=(ModuleLoader &&) = delete;
+		~ModuleLoader();
+
+		static ModuleLoader & instance();
+
+		// nullptr if the module can't be loaded or was built for a different API version
+		Module::Handler * handler(const QString & path);
+
+	private:
+		struct LoadedModule {
+			std::unique_ptr<QLibrary> library;
+			std::unique_ptr<Module::Handler> handler;
+		};
+
+		ModuleLoader() = default;
+		static std::optional<LoadedModule> load(const QString & path);
+
+		std::shared_mutex m_lock;
+		std::unordered_map<QString, LoadedModule, Equit::QtHash<QString>> m_modules;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_MODULELOADER_H
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file proxyconnection.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the ProxyConnection class for Anansi.
+///
+/// Like FastCgiConnection this uses a plain socket so that pooled connections can be
+/// picked up by any RequestHandler thread. The socket is non-blocking and every read and
+/// write waits in poll() with a timeout, so an upstream that stops reading (e.g. one
+/// that has answered early part way through a large upload) can't hold up the request
+/// handler indefinitely. Only unix-like platforms are currently supported.
+///
+/// \dep
+/// - proxyconnection.h
+/// - <array>
+/// - <chrono>
+/// - <cerrno>
+/// - <cstring>
+/// - <QtGlobal>
+/// - logger.h
+/// - connectsocket.h
+/// - cancellationtoken.h
+/// - <sys/socket.h>, <poll.h>, <fcntl.h>, <unistd.h> (unix only)
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "proxyconnection.h"
+
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "logger.h"
+#include "connectsocket.h"
+#include "cancellationtoken.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace Anansi {
+
+
+	// upstream status and header lines longer than this are treated as invalid
+	static constexpr const int MaxLineLength = 16384;
+	static constexpr const int ReadBufferSize = 16384;
+
+
+	ProxyConnection::ProxyConnection(int fd, const QString & address)
+	: m_fd(fd),
+	  m_address(address),
+	  m_closed(false),
+	  m_failed(false),
+	  m_cancelled(false),
+	  m_cancellation(nullptr) {
+	}
+
+
+	std::unique_ptr<ProxyConnection> ProxyConnection::connectTo(const QString & address, int timeout) {
+		const int fd = connectSocket(address, timeout);
+
+		if(-1 == fd) {
+			anansiLog(Warning, "failed to connect to upstream server \"" << qPrintable(address) << "\"");
+			return {};
+		}
+
+#if defined(Q_OS_UNIX)
+		// reads and writes wait for the socket in poll(), never in recv()/send()
+		const auto flags = ::fcntl(fd, F_GETFL);
+
+		if(-1 == flags || -1 == ::fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+			anansiLog(Warning, "failed to make connection to upstream server \"" << qPrintable(address) << "\" non-blocking: " << std::strerror(errno));
+			::close(fd);
+			return {};
+		}
+#endif
+
+		return std::unique_ptr<ProxyConnection>(new ProxyConnection(fd, address));
+	}
+
+
+	std::optional<std::string> ProxyConnection::readLine(int timeout) {
+		while(true) {
+			if(const auto eol = m_buffer.indexOf('\n'); -1 != eol) {
+				auto length = eol;
+
+				if(0 < length && '\r' == m_buffer.at(length - 1)) {
+					--length;
+				}
+
+				std::string line(m_buffer.constData(), static_cast<std::size_t>(length));
+				m_buffer.remove(0, eol + 1);
+				return line;
+			}
+
+			if(MaxLineLength < m_buffer.size()) {
+				anansiLog(Warning, "line from upstream server \"" << qPrintable(m_address) << "\" is too long");
+				return {};
+			}
+
+			if(!fillBuffer(timeout)) {
+				return {};
+			}
+
+			if(m_closed) {
+				anansiLog(Warning, "upstream server \"" << qPrintable(m_address) << "\" closed the connection mid-line");
+				return {};
+			}
+		}
+	}
+
+
+#if defined(Q_OS_UNIX)
+
+
+	ProxyConnection::~ProxyConnection() {
+		::close(m_fd);
+	}
+
+
+	bool ProxyConnection::isUsable() const {
+		// after a failed write the upstream may have part of a request
+		if(!m_buffer.isEmpty() || m_closed || m_failed) {
+			return false;
+		}
+
+		pollfd pfd = {m_fd, POLLIN, 0};
+
+		// an idle connection should have nothing to read - readable means either EOF or
+		// stray data from an earlier response, neither of which we can use
+		return 0 == ::poll(&pfd, 1, 0);
+	}
+
+
+	bool ProxyConnection::write(const char * data, std::size_t length, int timeout) {
+#if defined(MSG_NOSIGNAL)
+		static constexpr const int SendFlags = MSG_NOSIGNAL;
+#else
+		static constexpr const int SendFlags = 0;
+#endif
+
+		using Clock = std::chrono::steady_clock;
+
+		if(m_failed) {
+			return false;
+		}
+
+		const auto deadline = Clock::now() + std::chrono::milliseconds(timeout);
+
+		while(0 < length) {
+			if(m_cancellation && m_cancellation->wasCancelled()) {
+				m_cancelled = true;
+				m_failed = true;
+				return false;
+			}
+
+			const auto written = ::send(m_fd, data, length, SendFlags);
+
+			if(0 <= written) {
+				data += written;
+				length -= static_cast<std::size_t>(written);
+				continue;
+			}
+
+			if(EINTR == errno) {
+				continue;
+			}
+
+			if(EAGAIN != errno && EWOULDBLOCK != errno) {
+				anansiLog(Warning, "error writing to upstream server \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				m_failed = true;
+				return false;
+			}
+
+			// the upstream isn't keeping up. wait for it to make room, watching the client as
+			// well so that a request nobody is waiting for is given up
+			const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+
+			if(0 >= remaining) {
+				anansiLog(Warning, "timeout writing to upstream server \"" << qPrintable(m_address) << "\"");
+				m_failed = true;
+				return false;
+			}
+
+			const int cancellationFd = (m_cancellation ? static_cast<int>(m_cancellation->socketDescriptor()) : -1);
+			std::array<pollfd, 2> pfds = {{{m_fd, POLLOUT, 0}, {cancellationFd, static_cast<short>(m_cancellation ? m_cancellation->pollEvents() : 0), 0}}};
+
+			if(-1 == ::poll(pfds.data(), pfds.size(), static_cast<int>(remaining)) && EINTR != errno) {
+				anansiLog(Warning, "error waiting for upstream server \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				m_failed = true;
+				return false;
+			}
+
+			if(m_cancellation && 0 != pfds[1].revents) {
+				m_cancellation->checkPollResult(pfds[1].revents);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool ProxyConnection::waitForReadyRead(int timeout) {
+		// wait in short slices so that a client that goes away is noticed promptly
+		while(true) {
+			if(m_cancellation && m_cancellation->isCancelled()) {
+				m_cancelled = true;
+				return false;
+			}
+
+			const auto slice = (m_cancellation ? qMin(timeout, CancellationToken::CheckInterval) : timeout);
+			pollfd pfd = {m_fd, POLLIN, 0};
+			const auto ready = ::poll(&pfd, 1, slice);
+
+			if(1 == ready) {
+				return true;
+			}
+
+			if(-1 == ready && EINTR != errno) {
+				anansiLog(Warning, "error waiting for upstream server \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				return false;
+			}
+
+			if(0 == ready) {
+				timeout -= slice;
+
+				if(0 >= timeout) {
+					anansiLog(Warning, "timeout waiting for upstream server \"" << qPrintable(m_address) << "\"");
+					return false;
+				}
+			}
+		}
+	}
+
+
+	bool ProxyConnection::fillBuffer(int timeout) {
+		if(m_closed) {
+			return true;
+		}
+
+		if(!waitForReadyRead(timeout)) {
+			return false;
+		}
+
+		const auto offset = m_buffer.size();
+		m_buffer.resize(offset + ReadBufferSize);
+		ssize_t bytesRead;
+
+		do {
+			bytesRead = ::recv(m_fd, m_buffer.data() + offset, ReadBufferSize, 0);
+		} while(-1 == bytesRead && EINTR == errno);
+
+		if(-1 == bytesRead && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+			// nothing after all; the caller waits again
+			m_buffer.truncate(offset);
+			return true;
+		}
+
+		if(-1 == bytesRead) {
+			m_buffer.truncate(offset);
+			anansiLog(Warning, "error reading from upstream server \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+			return false;
+		}
+
+		m_buffer.truncate(offset + static_cast<int>(bytesRead));
+		m_closed = (0 == bytesRead);
+		return true;
+	}
+
+
+	qint64 ProxyConnection::read(char * data, qint64 maxSize, int timeout) {
+		if(m_buffer.isEmpty()) {
+			if(m_closed) {
+				return 0;
+			}
+
+			// nothing buffered, so read straight into the caller's buffer
+			ssize_t bytesRead;
+
+			do {
+				if(!waitForReadyRead(timeout)) {
+					return -1;
+				}
+
+				do {
+					bytesRead = ::recv(m_fd, data, static_cast<std::size_t>(maxSize), 0);
+				} while(-1 == bytesRead && EINTR == errno);
+			} while(-1 == bytesRead && (EAGAIN == errno || EWOULDBLOCK == errno));
+
+			if(-1 == bytesRead) {
+				anansiLog(Warning, "error reading from upstream server \"" << qPrintable(m_address) << "\": " << std::strerror(errno));
+				return -1;
+			}
+
+			m_closed = (0 == bytesRead);
+			return static_cast<qint64>(bytesRead);
+		}
+
+		const auto size = qMin(maxSize, static_cast<qint64>(m_buffer.size()));
+		std::memcpy(data, m_buffer.constData(), static_cast<std::size_t>(size));
+		m_buffer.remove(0, static_cast<int>(size));
+		return size;
+	}
+
+
+#else
+
+
+	ProxyConnection::~ProxyConnection() = default;
+
+
+	bool ProxyConnection::isUsable() const {
+		return false;
+	}
+
+
+	bool ProxyConnection::write(const char *, std::size_t, int) {
+		return false;
+	}
+
+
+	bool ProxyConnection::waitForReadyRead(int) {
+		return false;
+	}
+
+
+	bool ProxyConnection::fillBuffer(int) {
+		return false;
+	}
+
+
+	qint64 ProxyConnection::read(char *, qint64, int) {
+		return -1;
+	}
+
+
+#endif
+
+
+}  // namespace Anansi
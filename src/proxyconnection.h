@@ -0,0 +1,116 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file proxyconnection.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the ProxyConnection class for Anansi.
+///
+/// \dep
+/// - <cstddef>
+/// - <memory>
+/// - <optional>
+/// - <string>
+/// - <QString>
+/// - <QByteArray>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_PROXYCONNECTION_H
+#define ANANSI_PROXYCONNECTION_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <QString>
+#include <QByteArray>
+
+namespace Anansi {
+
+	class CancellationToken;
+
+	// a connection to an upstream HTTP server. it deals only in raw bytes and lines;
+	// the messages themselves are put together and taken apart by RequestHandler
+	class ProxyConnection final {
+	public:
+		ProxyConnection(const ProxyConnection &) = delete;
+		ProxyConnection(ProxyConnection &&) = delete;
+		void operator=(const ProxyConnection &) = delete;
+		void operator=(ProxyConnection &&) = delete;
+		~ProxyConnection();
+
+		// address is either "unix:/path/to/socket" or "host:port"
+		static std::unique_ptr<ProxyConnection> connectTo(const QString & address, int timeout);
+
+		inline const QString & address() const noexcept {
+			return m_address;
+		}
+
+		// false if the upstream has closed its end, left unread data on the connection or a
+		// write to it has failed
+		bool isUsable() const;
+
+		// reads and writes give up early once the token is cancelled
+		inline void setCancellationToken(CancellationToken * cancellation) noexcept {
+			m_cancellation = cancellation;
+			m_cancelled = false;
+		}
+
+		inline bool wasCancelled() const noexcept {
+			return m_cancelled;
+		}
+
+		// waits up to timeout msec for the upstream to make room. a write that gives up
+		// leaves the connection unusable
+		bool write(const char * data, std::size_t length, int timeout);
+
+		inline bool write(const QByteArray & data, int timeout) {
+			return write(data.constData(), static_cast<std::size_t>(data.size()), timeout);
+		}
+
+		// the line terminator is not included. empty optional on error, timeout, or if the
+		// upstream closes the connection before the end of the line
+		std::optional<std::string> readLine(int timeout);
+
+		// returns 0 once the upstream has closed the connection, -1 on error or timeout
+		qint64 read(char * data, qint64 maxSize, int timeout);
+
+	private:
+		ProxyConnection(int fd, const QString & address);
+
+		bool waitForReadyRead(int timeout);
+		bool fillBuffer(int timeout);
+
+		int m_fd;
+		QString m_address;
+		QByteArray m_buffer;
+		bool m_closed;
+		bool m_failed;
+		bool m_cancelled;
+		CancellationToken * m_cancellation;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_PROXYCONNECTION_H
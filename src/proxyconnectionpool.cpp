@@ -0,0 +1,223 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file proxyconnectionpool.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the ProxyConnectionPool class for Anansi.
+///
+/// Health checking is passive: an upstream is judged only by how the requests sent
+/// to it fare. After MaxConsecutiveFailures failed connections or responses in a
+/// row it is passed over for RetryInterval, after which it is given another chance.
+/// A single further failure then takes it out again straight away.
+///
+/// \dep
+/// - proxyconnectionpool.h
+/// - logger.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "proxyconnectionpool.h"
+
+
+#include "logger.h"
+
+
+namespace Anansi {
+
+
+	static constexpr const int MaxConsecutiveFailures = 3;
+	static constexpr const std::chrono::milliseconds RetryInterval(10000);
+
+
+	ProxyConnectionPool::Lease::Lease(ProxyConnectionPool * pool, std::unique_ptr<ProxyConnection> connection)
+	: m_pool(pool),
+	  m_connection(std::move(connection)),
+	  m_reusable(false) {
+	}
+
+
+	ProxyConnectionPool::Lease::Lease(Lease && other) noexcept
+	: m_pool(other.m_pool),
+	  m_connection(std::move(other.m_connection)),
+	  m_reusable(other.m_reusable) {
+		other.m_pool = nullptr;
+	}
+
+
+	ProxyConnectionPool::Lease & ProxyConnectionPool::Lease::operator=(Lease && other) noexcept {
+		release();
+		m_pool = other.m_pool;
+		m_connection = std::move(other.m_connection);
+		m_reusable = other.m_reusable;
+		other.m_pool = nullptr;
+		return *this;
+	}
+
+
+	ProxyConnectionPool::Lease::~Lease() {
+		release();
+	}
+
+
+	void ProxyConnectionPool::Lease::release() {
+		if(m_pool && m_connection) {
+			// the token belongs to the request that is finishing with the connection
+			m_connection->setCancellationToken(nullptr);
+			m_pool->release(std::move(m_connection), m_reusable);
+		}
+
+		m_pool = nullptr;
+		m_connection.reset();
+	}
+
+
+	ProxyConnectionPool & ProxyConnectionPool::instance() {
+		static ProxyConnectionPool pool;
+		return pool;
+	}
+
+
+	ProxyConnectionPool::Lease ProxyConnectionPool::acquire(const UpstreamList & upstreams, int maxConnections, int timeout) {
+		if(upstreams.empty()) {
+			return {};
+		}
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		const auto deadline = Clock::now() + std::chrono::milliseconds(timeout);
+		const auto first = m_nextUpstream++;
+
+		while(true) {
+			bool canWait = false;
+
+			for(std::size_t idx = 0; idx < upstreams.size(); ++idx) {
+				const auto & upstream = upstreams[(first + idx) % upstreams.size()];
+				auto & endpoint = m_endpoints[upstream];
+
+				if(Clock::now() < endpoint.downUntil) {
+					continue;
+				}
+
+				while(!endpoint.idle.empty()) {
+					auto connection = std::move(endpoint.idle.back());
+					endpoint.idle.pop_back();
+
+					if(connection->isUsable()) {
+						return {this, std::move(connection)};
+					}
+
+					// upstream has dropped the keep-alive connection
+					--endpoint.openCount;
+				}
+
+				if(endpoint.openCount >= maxConnections) {
+					canWait = true;
+					continue;
+				}
+
+				// reserve the slot before connecting so that the lock isn't held while we
+				// wait for the upstream
+				++endpoint.openCount;
+				lock.unlock();
+				auto connection = ProxyConnection::connectTo(upstream, timeout);
+				lock.lock();
+
+				if(connection) {
+					return {this, std::move(connection)};
+				}
+
+				--endpoint.openCount;
+				recordFailure(endpoint, upstream);
+				m_available.notify_all();
+			}
+
+			// only worth waiting if a healthy upstream is just busy
+			if(!canWait) {
+				anansiLog(Warning, "none of the " << upstreams.size() << " upstream server(s) is available");
+				return {};
+			}
+
+			if(std::cv_status::timeout == m_available.wait_until(lock, deadline)) {
+				return {};
+			}
+		}
+	}
+
+
+	void ProxyConnectionPool::release(std::unique_ptr<ProxyConnection> connection, bool reusable) {
+		// the token belongs to the request that is finishing with the connection
+		connection->setCancellationToken(nullptr);
+		std::lock_guard<std::mutex> lock(m_lock);
+		auto & endpoint = m_endpoints[connection->address()];
+
+		if(reusable) {
+			endpoint.idle.push_back(std::move(connection));
+		}
+		else {
+			--endpoint.openCount;
+		}
+
+		m_available.notify_all();
+	}
+
+
+	void ProxyConnectionPool::recordFailure(Endpoint & endpoint, const QString & upstream) {
+		++endpoint.failureCount;
+
+		if(MaxConsecutiveFailures > endpoint.failureCount) {
+			return;
+		}
+
+		anansiLog(Warning, "upstream server \"" << qPrintable(upstream) << "\" has failed " << endpoint.failureCount << " times in a row; not using it for " << RetryInterval.count() << "ms");
+		endpoint.downUntil = Clock::now() + RetryInterval;
+
+		// idle connections to a failing upstream are unlikely to be any good
+		endpoint.openCount -= static_cast<int>(endpoint.idle.size());
+		endpoint.idle.clear();
+	}
+
+
+	void ProxyConnectionPool::reportFailure(const QString & upstream) {
+		std::lock_guard<std::mutex> lock(m_lock);
+		recordFailure(m_endpoints[upstream], upstream);
+	}
+
+
+	void ProxyConnectionPool::reportSuccess(const QString & upstream) {
+		std::lock_guard<std::mutex> lock(m_lock);
+		auto & endpoint = m_endpoints[upstream];
+		endpoint.failureCount = 0;
+		endpoint.downUntil = {};
+	}
+
+
+	void ProxyConnectionPool::clear() {
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for(auto & endpoint : m_endpoints) {
+			endpoint.second.openCount -= static_cast<int>(endpoint.second.idle.size());
+			endpoint.second.idle.clear();
+		}
+	}
+
+
+}  // namespace Anansi
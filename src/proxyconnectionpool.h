@@ -0,0 +1,144 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file proxyconnectionpool.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the ProxyConnectionPool class for Anansi.
+///
+/// \dep
+/// - <cstddef>
+/// - <chrono>
+/// - <memory>
+/// - <mutex>
+/// - <condition_variable>
+/// - <unordered_map>
+/// - <vector>
+/// - <QString>
+/// - proxyconnection.h
+/// - qtstdhash.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_PROXYCONNECTIONPOOL_H
+#define ANANSI_PROXYCONNECTIONPOOL_H
+
+#include <cstddef>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "proxyconnection.h"
+#include "qtstdhash.h"
+
+namespace Anansi {
+
+	// keep-alive connections to upstream HTTP servers. requests are shared among a set
+	// of upstreams in turn, passing over any that have recently been failing
+	class ProxyConnectionPool final {
+	public:
+		using UpstreamList = std::vector<QString>;
+
+		// an exclusive hold on one pooled connection; the connection goes back to the
+		// pool when the lease is destroyed unless it has been marked as not reusable
+		class Lease final {
+		public:
+			Lease() = default;
+			Lease(const Lease &) = delete;
+			Lease(Lease && other) noexcept;
+			Lease & operator=(const Lease &) = delete;
+			Lease & operator=(Lease && other) noexcept;
+			~Lease();
+
+			inline explicit operator bool() const noexcept {
+				return static_cast<bool>(m_connection);
+			}
+
+			inline ProxyConnection * operator->() const noexcept {
+				return m_connection.get();
+			}
+
+			inline ProxyConnection & operator*() const noexcept {
+				return *m_connection;
+			}
+
+			inline void setReusable(bool reusable) noexcept {
+				m_reusable = reusable;
+			}
+
+		private:
+			friend class ProxyConnectionPool;
+			Lease(ProxyConnectionPool * pool, std::unique_ptr<ProxyConnection> connection);
+			void release();
+
+			ProxyConnectionPool * m_pool = nullptr;
+			std::unique_ptr<ProxyConnection> m_connection;
+			bool m_reusable = false;
+		};
+
+		ProxyConnectionPool(const ProxyConnectionPool &) = delete;
+		ProxyConnectionPool(ProxyConnectionPool &&) = delete;
+		void operator=(const ProxyConnectionPool &) = delete;
+		void operator=(ProxyConnectionPool &&) = delete;
+
+		static ProxyConnectionPool & instance();
+
+		// blocks for up to timeout msec if every healthy upstream already has
+		// maxConnections leased. an empty lease means none of the upstreams could be
+		// reached
+		Lease acquire(const UpstreamList & upstreams, int maxConnections, int timeout);
+
+		// passive health checks: upstreams that fail repeatedly are left out for a while
+		void reportFailure(const QString & upstream);
+		void reportSuccess(const QString & upstream);
+
+		// closes all idle connections
+		void clear();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Endpoint {
+			std::vector<std::unique_ptr<ProxyConnection>> idle;
+			int openCount = 0;
+			int failureCount = 0;
+			Clock::time_point downUntil;
+		};
+
+		ProxyConnectionPool() = default;
+		void release(std::unique_ptr<ProxyConnection> connection, bool reusable);
+		void recordFailure(Endpoint & endpoint, const QString & upstream);
+
+		std::mutex m_lock;
+		std::condition_variable m_available;
+		std::unordered_map<QString, Endpoint, Equit::QtHash<QString>> m_endpoints;
+		std::size_t m_nextUpstream = 0;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_PROXYCONNECTIONPOOL_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file requesteventchannel.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the RequestEventChannel class for Anansi.
+///
+/// Each source is a single-producer, single-consumer ring. The producer owns the
+/// head index and the consumer owns the tail; each publishes its index with release
+/// semantics after touching the records, so neither ever waits for the other. A
+/// connection produces only a handful of events, so the rings are small, and the
+/// number of sources waiting to be drained is capped so that a consumer that falls
+/// behind costs a bounded amount of memory.
+///
+/// \dep
+/// - requesteventchannel.h
+/// - <algorithm>
+/// - <cstring>
+/// - <QDateTime>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "requesteventchannel.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDateTime>
+
+
+namespace Anansi {
+
+
+	RequestEventChannel::Source::Source(QString address, uint16_t port)
+	: m_address(std::move(address)),
+	  m_port(port),
+	  m_records(),
+	  m_head(0),
+	  m_tail(0),
+	  m_dropped(0),
+	  m_closed(false) {
+	}
+
+
+	bool RequestEventChannel::Source::push(RequestEvent::Type type, uint8_t detail, const char * resource, std::size_t resourceLength) noexcept {
+		const auto head = m_head.load(std::memory_order_relaxed);
+
+		if(Capacity <= head - m_tail.load(std::memory_order_acquire)) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		auto & record = m_records[head % Capacity];
+		record.time = QDateTime::currentMSecsSinceEpoch();
+		record.type = type;
+		record.detail = detail;
+		record.resourceLength = static_cast<uint8_t>(std::min<std::size_t>(resourceLength, MaxResourceLength));
+		std::memcpy(record.resource, resource, record.resourceLength);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+
+	bool RequestEventChannel::Source::push(RequestEvent::Type type) noexcept {
+		return push(type, 0, nullptr, 0);
+	}
+
+
+	bool RequestEventChannel::Source::pushPolicy(ConnectionPolicy policy) noexcept {
+		return push(RequestEvent::Type::PolicyDetermined, static_cast<uint8_t>(policy), nullptr, 0);
+	}
+
+
+	bool RequestEventChannel::Source::pushAction(WebServerAction action, const std::string & resource) noexcept {
+		return push(RequestEvent::Type::ActionTaken, static_cast<uint8_t>(action), resource.data(), resource.size());
+	}
+
+
+	void RequestEventChannel::Source::close() noexcept {
+		m_closed.store(true, std::memory_order_release);
+	}
+
+
+	std::shared_ptr<RequestEventChannel::Source> RequestEventChannel::open(const QString & address, uint16_t port) {
+		if(MaxSources <= m_sources.size()) {
+			++m_dropped;
+			return nullptr;
+		}
+
+		m_sources.push_back(std::make_shared<Source>(address, port));
+		return m_sources.back();
+	}
+
+
+	RequestEventBatch RequestEventChannel::drain() {
+		RequestEventBatch events;
+
+		const auto drainSource = [this, &events](Source & source) -> bool {
+			// read before the records so that a closed source is known to be fully drained
+			const bool closed = source.m_closed.load(std::memory_order_acquire);
+			const auto head = source.m_head.load(std::memory_order_acquire);
+			auto tail = source.m_tail.load(std::memory_order_relaxed);
+
+			while(tail != head) {
+				const auto & record = source.m_records[tail % Source::Capacity];
+				RequestEvent event = {QDateTime::fromMSecsSinceEpoch(record.time), record.type, source.m_address, source.m_port, ConnectionPolicy::None, WebServerAction::Ignore, {}};
+
+				if(RequestEvent::Type::PolicyDetermined == record.type) {
+					event.policy = static_cast<ConnectionPolicy>(record.detail);
+				}
+				else if(RequestEvent::Type::ActionTaken == record.type) {
+					event.action = static_cast<WebServerAction>(record.detail);
+					event.resource = QString::fromUtf8(record.resource, record.resourceLength);
+				}
+
+				events.push_back(std::move(event));
+				++tail;
+			}
+
+			source.m_tail.store(tail, std::memory_order_release);
+			m_dropped += source.m_dropped.exchange(0, std::memory_order_relaxed);
+			return closed;
+		};
+
+		m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(), [&drainSource](const std::shared_ptr<Source> & source) {
+			return drainSource(*source);
+		}), m_sources.end());
+
+		// the sources are drained one after another, so interleave their events again
+		std::stable_sort(events.begin(), events.end(), [](const RequestEvent & lhs, const RequestEvent & rhs) {
+			return lhs.time < rhs.time;
+		});
+
+		return events;
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file requesteventchannel.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the RequestEventChannel class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <atomic>
+/// - <cstdint>
+/// - <memory>
+/// - <string>
+/// - <vector>
+/// - <QDateTime>
+/// - <QString>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_REQUESTEVENTCHANNEL_H
+#define ANANSI_REQUESTEVENTCHANNEL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QDateTime>
+#include <QString>
+
+#include "types.h"
+
+namespace Anansi {
+
+	// something that happened while handling a connection, as delivered to the thread
+	// that drains the channel
+	struct RequestEvent {
+		enum class Type : uint8_t {
+			ConnectionReceived = 0,
+			ConnectionAccepted,
+			ConnectionRejected,
+			PolicyDetermined,
+			ActionTaken,
+			Cancelled,
+		};
+
+		QDateTime time;
+		Type type;
+		QString address;
+		uint16_t port;
+
+		// only for PolicyDetermined
+		ConnectionPolicy policy;
+
+		// only for ActionTaken
+		WebServerAction action;
+		QString resource;
+	};
+
+	using RequestEventBatch = std::vector<RequestEvent>;
+
+	// carries events from request handler threads to one consumer thread without locks or
+	// cross-thread signals. each connection writes compact records into its own small
+	// ring; the consumer opens the rings and drains them all in batches. a record that
+	// doesn't fit is dropped and counted rather than making the handler wait
+	class RequestEventChannel final {
+	public:
+		// the producing end for one connection. only one thread may push at a time
+		class Source final {
+		public:
+			static constexpr const uint32_t Capacity = 8;
+			static constexpr const int MaxResourceLength = 245;
+
+			Source(QString address, uint16_t port);
+			Source(const Source &) = delete;
+			Source(Source &&) = delete;
+			void operator=(const Source &) = delete;
+			void operator=(Source &&) = delete;
+
+			// these return false if the event had to be dropped
+			bool push(RequestEvent::Type type) noexcept;
+			bool pushPolicy(ConnectionPolicy policy) noexcept;
+
+			// resources longer than MaxResourceLength bytes are truncated
+			bool pushAction(WebServerAction action, const std::string & resource) noexcept;
+
+			// no more events will be pushed; the consumer forgets the source once it has
+			// drained it
+			void close() noexcept;
+
+		private:
+			friend class RequestEventChannel;
+
+			struct Record {
+				qint64 time;
+				RequestEvent::Type type;
+				uint8_t detail;
+				uint8_t resourceLength;
+				char resource[MaxResourceLength];
+			};
+
+			bool push(RequestEvent::Type type, uint8_t detail, const char * resource, std::size_t resourceLength) noexcept;
+
+			const QString m_address;
+			const uint16_t m_port;
+			std::array<Record, Capacity> m_records;
+			std::atomic<uint32_t> m_head;
+			std::atomic<uint32_t> m_tail;
+			std::atomic<uint32_t> m_dropped;
+			std::atomic<bool> m_closed;
+		};
+
+		// the most sources waiting to be drained; connections beyond this go unrecorded
+		static constexpr const std::size_t MaxSources = 4096;
+
+		RequestEventChannel() = default;
+		RequestEventChannel(const RequestEventChannel &) = delete;
+		RequestEventChannel(RequestEventChannel &&) = delete;
+		void operator=(const RequestEventChannel &) = delete;
+		void operator=(RequestEventChannel &&) = delete;
+
+		// open(), drain() and dropped() must all be called on the consumer thread. open()
+		// returns nullptr (and counts a dropped event) if too many sources are waiting
+		std::shared_ptr<Source> open(const QString & address, uint16_t port);
+
+		// events are in the order they happened
+		RequestEventBatch drain();
+
+		inline bool hasSources() const noexcept {
+			return !m_sources.empty();
+		}
+
+		inline uint64_t dropped() const noexcept {
+			return m_dropped;
+		}
+
+	private:
+		std::vector<std::shared_ptr<Source>> m_sources;
+		uint64_t m_dropped = 0;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_REQUESTEVENTCHANNEL_H
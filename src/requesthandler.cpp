@@ -29,17 +29,21 @@
 ///
 /// \dep
 /// - requesthandler.h
-/// - <iostream>
 /// - <algorithm>
 /// - <cstdint>
+/// - <cstring>
+/// - <cctype>
 /// - <string>
 /// - <array>
 /// - <vector>
 /// - <optional>
+/// - <unordered_set>
 /// - <regex>
+/// - <limits>
+/// - <exception>
 /// - <QByteArray>
 /// - <QStringBuilder>
-/// - <QApplication>
+/// - <QCoreApplication>
 /// - <QCryptographicHash>
 /// - <QDir>
 /// - <QFile>
@@ -50,30 +54,48 @@
 /// - assert.h
 /// - qtmetatypes.h
 /// - configuration.h
+/// - routingtable.h
 /// - strings.h
 /// - scopeguard.h
 /// - mediatypeicons.h
 /// - deflatecontentencoder.h
 /// - gzipcontentencoder.h
 /// - identitycontentencoder.h
+/// - fastcgiconnectionpool.h
+/// - fastcgiresponse.h
+/// - cgienvironment.h
+/// - cgiworkerpool.h
+/// - cgiconcurrencylimiter.h
+/// - cgiresponsecache.h
+/// - proxyconnectionpool.h
+/// - moduleloader.h
+/// - responsewriter.h
+/// - accesslogwriter.h
+/// - metrics.h
+/// - requesttracewriter.h
+/// - logger.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
 
 #include "requesthandler.h"
 
-#include <iostream>
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <cctype>
 #include <string>
 #include <array>
 #include <vector>
 #include <optional>
+#include <unordered_set>
 #include <regex>
+#include <limits>
+#include <exception>
 
 #include <QByteArray>
 #include <QStringBuilder>
-#include <QApplication>
+#include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
@@ -81,16 +103,32 @@
 #include <QUrl>
 #include <QHostAddress>
 #include <QProcess>
+#include <QBuffer>
+#include <QTemporaryFile>
 
 #include "eqassert.h"
 #include "qtmetatypes.h"
 #include "configuration.h"
+#include "routingtable.h"
 #include "strings.h"
 #include "scopeguard.h"
 #include "mediatypeicons.h"
 #include "deflatecontentencoder.h"
 #include "gzipcontentencoder.h"
 #include "identitycontentencoder.h"
+#include "fastcgiconnectionpool.h"
+#include "fastcgiresponse.h"
+#include "cgienvironment.h"
+#include "cgiworkerpool.h"
+#include "cgiconcurrencylimiter.h"
+#include "cgiresponsecache.h"
+#include "proxyconnectionpool.h"
+#include "moduleloader.h"
+#include "responsewriter.h"
+#include "accesslogwriter.h"
+#include "metrics.h"
+#include "requesttracewriter.h"
+#include "logger.h"
 
 
 namespace Anansi {
@@ -99,15 +137,26 @@ namespace Anansi {
 	using Equit::ScopeGuard;
 	using Equit::percent_decode;
 	using Equit::starts_with;
+	using Equit::ends_with;
 	using Equit::to_html_entities;
 	using Equit::to_lower;
 	using Equit::parse_int;
+	using Equit::parse_uint;
 
 
 	static constexpr const int MaxReadErrorCount = 3;
 	static constexpr const unsigned int ReadBufferSize = 1024;
 	static const QByteArray EOL = QByteArrayLiteral("\r\n");
 
+	// CGI output is read this much at a time
+	static constexpr const unsigned int CgiReadBufferSize = 16384;
+
+	// proxied request and response bodies are passed on this much at a time
+	static constexpr const unsigned int ProxyReadBufferSize = 16384;
+
+	// reserved for the server's own status report
+	static const std::string StatusPath = "/.anansi/status";
+
 
 	static const std::unordered_map<std::string, ContentEncoding> SupportedEncodings = {
 	  {"deflate", ContentEncoding::Deflate},
@@ -128,7 +177,7 @@ namespace Anansi {
 		QFile staticResourceFile(QStringLiteral(":/stylesheets/directory-listing"));
 
 		if(!staticResourceFile.open(QIODevice::ReadOnly)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to read built-in directory listing stylesheet (couldn't open resource file)\n";
+			anansiLog(Error, "failed to read built-in directory listing stylesheet (couldn't open resource file)");
 			return false;
 		}
 
@@ -142,6 +191,144 @@ namespace Anansi {
 	};
 
 
+	// appends str as a quoted JSON string; str must be UTF-8, multi-byte sequences are
+	// passed through untouched
+	static void appendJsonString(QByteArray & out, const QByteArray & str) {
+		static constexpr const char HexDigits[] = "0123456789abcdef";
+		out.append('"');
+
+		for(const auto ch : str) {
+			if('"' == ch || '\\' == ch) {
+				out.append('\\');
+				out.append(ch);
+			}
+			else if(0x20 > static_cast<unsigned char>(ch)) {
+				out.append("\\u00");
+				out.append(HexDigits[(ch >> 4) & 0x0f]);
+				out.append(HexDigits[ch & 0x0f]);
+			}
+			else {
+				out.append(ch);
+			}
+		}
+
+		out.append('"');
+	}
+
+
+	static void trim(std::string & str) {
+		while(!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) {
+			str.pop_back();
+		}
+
+		const auto first = std::find_if(str.cbegin(), str.cend(), [](const auto ch) {
+			return !std::isspace(static_cast<unsigned char>(ch));
+		});
+
+		str.erase(str.cbegin(), first);
+	}
+
+
+	// the quality the client gives mediaType in an Accept header value, along with how
+	// specifically it was matched (0 = no match, 1 = */*, 2 = type/*, 3 = type/subtype);
+	// the most specific matching media range decides the quality (RFC 7231 s5.3.2)
+	static std::pair<double, int> acceptQuality(const std::string & accept, const std::string & mediaType) {
+		const auto slash = mediaType.find('/');
+		const auto type = mediaType.substr(0, slash + 1);
+		double quality = 0.0;
+		int specificity = 0;
+		std::string::size_type begin = 0;
+
+		while(begin < accept.size()) {
+			auto end = accept.find(',', begin);
+
+			if(std::string::npos == end) {
+				end = accept.size();
+			}
+
+			auto range = to_lower(accept.substr(begin, end - begin));
+			begin = end + 1;
+			double rangeQuality = 1.0;
+
+			if(const auto semicolon = range.find(';'); std::string::npos != semicolon) {
+				auto params = range.substr(semicolon + 1);
+				range.erase(semicolon);
+				std::string::size_type paramBegin = 0;
+
+				while(paramBegin < params.size()) {
+					auto paramEnd = params.find(';', paramBegin);
+
+					if(std::string::npos == paramEnd) {
+						paramEnd = params.size();
+					}
+
+					auto param = params.substr(paramBegin, paramEnd - paramBegin);
+					paramBegin = paramEnd + 1;
+					trim(param);
+
+					if(starts_with(param, "q=")) {
+						bool ok;
+						const auto value = QByteArray::fromStdString(param.substr(2)).toDouble(&ok);
+
+						// an unparseable weight makes the whole range meaningless
+						rangeQuality = (ok && 0.0 <= value && 1.0 >= value ? value : 0.0);
+						break;
+					}
+				}
+			}
+
+			trim(range);
+			int rangeSpecificity = 0;
+
+			if(range == mediaType) {
+				rangeSpecificity = 3;
+			}
+			else if(range == type + "*") {
+				rangeSpecificity = 2;
+			}
+			else if("*/*" == range) {
+				rangeSpecificity = 1;
+			}
+
+			if(rangeSpecificity > specificity) {
+				specificity = rangeSpecificity;
+				quality = rangeQuality;
+			}
+		}
+
+		return {quality, specificity};
+	}
+
+
+	// true if the value of an If-None-Match header matches etag (weak comparison, as the
+	// header requires)
+	static bool etagMatches(const std::string & ifNoneMatch, const QByteArray & etag) {
+		std::string::size_type begin = 0;
+
+		while(begin < ifNoneMatch.size()) {
+			auto end = ifNoneMatch.find(',', begin);
+
+			if(std::string::npos == end) {
+				end = ifNoneMatch.size();
+			}
+
+			auto candidate = ifNoneMatch.substr(begin, end - begin);
+			begin = end + 1;
+			trim(candidate);
+
+			if(starts_with(candidate, "W/")) {
+				candidate.erase(0, 2);
+			}
+
+			if("*" == candidate || etag == candidate.c_str()) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
 	template<class StringType = std::string>
 	static std::optional<HttpMethod> parseHttpMethod(const StringType & str) {
 		if("OPTIONS" == str) {
@@ -188,11 +375,11 @@ namespace Anansi {
 
 		while(!in.canReadLine()) {
 			if(!in.waitForReadyRead(3000)) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error reading header line (\"" << qPrintable(in.errorString()) << "\"\n";
+				anansiLog(Debug, "error reading header line (\"" << qPrintable(in.errorString()) << "\"");
 				++consecutiveReadErrorCount;
 
 				if(MaxReadErrorCount < consecutiveReadErrorCount) {
-					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: too many errors attempting to read header line\n";
+					anansiLog(Debug, "too many errors attempting to read header line");
 					return {};
 				}
 			}
@@ -241,20 +428,42 @@ namespace Anansi {
 		return {};
 	}
 
-	RequestHandler::RequestHandler(std::unique_ptr<QTcpSocket> socket, const Configuration & config, QObject * parent)
+	RequestHandler::RequestHandler(std::unique_ptr<QTcpSocket> socket, std::shared_ptr<const Configuration> config, std::shared_ptr<const RoutingTable> routes, std::shared_ptr<const QByteArray> cgiEnvironment, std::shared_ptr<RequestEventChannel::Source> events, std::shared_ptr<ServerCounters> counters, QObject * parent)
 	: QThread(parent),
 	  m_socket(std::move(socket)),
-	  m_config(config),
+	  m_cancellation(m_socket->socketDescriptor()),
+	  m_out(std::make_unique<ResponseWriter>(*m_socket, m_cancellation)),
+	  m_configSnapshot(std::move(config)),
+	  m_config(*m_configSnapshot),
+	  m_routesSnapshot(std::move(routes)),
+	  m_routes(*m_routesSnapshot),
+	  m_cgiEnvironment(std::move(cgiEnvironment)),
+	  m_events(std::move(events)),
+	  m_counters(std::move(counters)),
 	  m_stage(ResponseStage::SendingResponse),
+	  m_receivedAt(0),
+	  m_responseStatus(0),
+	  m_requestBodyReadTime(0),
+	  m_requestBytes(0),
+	  m_requestBodyLength(0),
+	  m_requestBodyUnread(0),
+	  m_requestBodyChunked(false),
 	  m_responseEncoding(ContentEncoding::Identity),
-	  m_encoder(nullptr) {
+	  m_encoder(nullptr),
+	  m_cgiCaptureLimit(-1) {
 		eqAssert(m_socket, "socket must not be null");
+		eqAssert(m_counters, "counters must not be null");
 		m_socket->moveToThread(this);
+		m_out->moveToThread(this);
 	}
 
 
 	RequestHandler::~RequestHandler() {
 		disposeSocket();
+
+		if(m_events) {
+			m_events->close();
+		}
 	}
 
 
@@ -264,7 +473,7 @@ namespace Anansi {
 				m_socket->disconnectFromHost();
 
 				if(QAbstractSocket::ConnectedState == m_socket->state() && !m_socket->waitForDisconnected()) {
-					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error disconnecting socket (" << qPrintable(m_socket->errorString()) << ")\n";
+					anansiLog(Debug, "error disconnecting socket (" << qPrintable(m_socket->errorString()) << ")");
 				}
 			}
 
@@ -273,6 +482,86 @@ namespace Anansi {
 	}
 
 
+	void RequestHandler::writeAccessLog() const {
+		if(m_config.accessLogFile().isEmpty() || !m_socket) {
+			return;
+		}
+
+		std::string request;
+
+		if(!m_requestLine.method.empty()) {
+			request = m_requestLine.method + ' ' + m_requestLine.uri + " HTTP/" + m_requestLine.httpVersion;
+		}
+
+		const auto header = [this](const char * name) -> const std::string & {
+			static const std::string none;
+			const auto headerIt = m_requestHeaders.find(name);
+			return (m_requestHeaders.cend() == headerIt ? none : headerIt->second);
+		};
+
+		AccessLogWriter::instance().log(m_socket->peerAddress(), m_receivedAt, m_responseStatus, m_out->totalWritten(), request, header("referer"), header("user-agent"));
+	}
+
+
+	void RequestHandler::recordMetrics() const {
+		using Point = RequestTrace::Point;
+		Metrics::Request request;
+		request.status = m_responseStatus;
+		request.bytesIn = m_requestBytes;
+		request.bytesOut = static_cast<uint64_t>(m_out->totalWritten());
+		m_counters->requestCompleted(request.bytesOut);
+
+		if(m_encoder) {
+			request.encoding = m_responseEncoding;
+		}
+
+		if(m_trace.reached(Point::HeadersRead)) {
+			request.stages[static_cast<std::size_t>(Metrics::Stage::ReadHeaders)] = m_trace.between(Point::Received, Point::HeadersRead);
+		}
+
+		if(0 < m_requestBodyLength) {
+			request.stages[static_cast<std::size_t>(Metrics::Stage::ReadBody)] = m_requestBodyReadTime;
+		}
+
+		if(m_trace.reached(Point::Resolved)) {
+			request.stages[static_cast<std::size_t>(Metrics::Stage::Resolve)] = m_trace.between(Point::HeadersRead, Point::Resolved);
+			request.stages[static_cast<std::size_t>(Metrics::Stage::Send)] = m_trace.between(Point::Resolved, Point::Completed);
+		}
+
+		request.stages[static_cast<std::size_t>(Metrics::Stage::Total)] = m_trace.between(Point::Received, Point::Completed);
+		Metrics::instance().recordRequest(request);
+	}
+
+
+	void RequestHandler::sendStatus() {
+		if(!m_config.statusEndpointAllowed(m_socket->peerAddress())) {
+			sendError(HttpResponseCode::Forbidden);
+			return;
+		}
+
+		if(HttpMethod::Get != m_requestMethod && HttpMethod::Head != m_requestMethod) {
+			sendError(HttpResponseCode::MethodNotAllowed, {}, {}, {{"Allow", "GET, HEAD"}});
+			return;
+		}
+
+		// same ?format=json switch and accept header check as directory listings
+		const auto isJson = (DirectoryListingFormat::Json == directoryListingFormat());
+		const auto body = (isJson ? Metrics::instance().json() : Metrics::instance().prometheusText());
+		sendResponseCode(HttpResponseCode::Ok);
+		sendDateHeader();
+		sendHeader(QByteArrayLiteral("Content-type"), (isJson ? QByteArrayLiteral("application/json; charset=UTF-8") : QByteArrayLiteral("text/plain; version=0.0.4; charset=UTF-8")));
+		sendHeader(QByteArrayLiteral("Cache-control"), QByteArrayLiteral("no-store"));
+		sendHeader(QByteArrayLiteral("Content-length"), QByteArray::number(body.size()));
+		sendData(EOL);
+
+		if(HttpMethod::Get == m_requestMethod) {
+			sendData(body);
+		}
+
+		m_stage = ResponseStage::Completed;
+	}
+
+
 	bool RequestHandler::determineResponseEncoding() {
 		//#warning Compiling RequestHandler with forced response content encoding for debug purposes
 		//		m_responseEncoding = ContentEncoding::Deflate;
@@ -362,7 +651,7 @@ namespace Anansi {
 		}
 
 		if(!canFallBackOnIdentityEncoding && m_responseEncoding == ContentEncoding::Identity) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to find supported, acceptable encoding from \"" << acceptEncodingHeaderValue << "\"\n";
+			anansiLog(Debug, "failed to find supported, acceptable encoding from \"" << acceptEncodingHeaderValue << "\"");
 			return false;
 		}
 
@@ -372,7 +661,7 @@ namespace Anansi {
 
 	bool RequestHandler::sendData(const QByteArray & data) {
 		if(!m_socket->isWritable()) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: tcp socket  is not writable\n";
+			anansiLog(Debug, "tcp socket  is not writable");
 			return false;
 		}
 
@@ -381,10 +670,10 @@ namespace Anansi {
 		const char * buffer = data.data();
 
 		while(0 < remaining) {
-			bytes = m_socket->write(buffer, remaining);
+			bytes = m_out->write(buffer, remaining);
 
 			if(-1 == bytes) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error writing to TCP socket (\"" << qPrintable(m_socket->errorString()) << "\")\n";
+				anansiLog(Debug, "error writing to TCP socket (\"" << qPrintable(m_out->errorString()) << "\")");
 				return false;
 			}
 #ifndef NDEBUG
@@ -392,7 +681,7 @@ namespace Anansi {
 				/// socket buffers so we shouldn't receive 0-length writes, only
 				/// successful writes or errors; if we do, we want to know how
 				/// likely this is
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: zero-length write to socket (expecting to write up to " << remaining << " bytes)\n";
+				anansiLog(Debug, "zero-length write to socket (expecting to write up to " << remaining << " bytes)");
 			}
 #endif
 
@@ -407,265 +696,267 @@ namespace Anansi {
 	QString RequestHandler::defaultResponseReason(HttpResponseCode code) {
 		switch(code) {
 			case HttpResponseCode::Continue:
-				return QApplication::tr("Continue");
+				return QCoreApplication::tr("Continue");
 
 			case HttpResponseCode::SwitchingProtocols:
-				return QApplication::tr("Switching Protocols");
+				return QCoreApplication::tr("Switching Protocols");
 
 			case HttpResponseCode::Ok:
-				return QApplication::tr("OK");
+				return QCoreApplication::tr("OK");
 
 			case HttpResponseCode::Created:
-				return QApplication::tr("Created");
+				return QCoreApplication::tr("Created");
 
 			case HttpResponseCode::Accepted:
-				return QApplication::tr("Accepted");
+				return QCoreApplication::tr("Accepted");
 
 			case HttpResponseCode::NonAuthoritativeInformation:
-				return QApplication::tr("Non-Authoritative Information");
+				return QCoreApplication::tr("Non-Authoritative Information");
 
 			case HttpResponseCode::NoContent:
-				return QApplication::tr("No Content");
+				return QCoreApplication::tr("No Content");
 
 			case HttpResponseCode::ResetContent:
-				return QApplication::tr("Reset Content");
+				return QCoreApplication::tr("Reset Content");
 
 			case HttpResponseCode::PartialContent:
-				return QApplication::tr("Partial Content");
+				return QCoreApplication::tr("Partial Content");
 
 			case HttpResponseCode::MultipleChoices:
-				return QApplication::tr("Multiple Choices");
+				return QCoreApplication::tr("Multiple Choices");
 
 			case HttpResponseCode::MovedPermanently:
-				return QApplication::tr("Moved Permanently");
+				return QCoreApplication::tr("Moved Permanently");
 
 			case HttpResponseCode::Found:
-				return QApplication::tr("Found");
+				return QCoreApplication::tr("Found");
 
 			case HttpResponseCode::SeeOther:
-				return QApplication::tr("See Other");
+				return QCoreApplication::tr("See Other");
 
 			case HttpResponseCode::NotModified:
-				return QApplication::tr("Not Modified");
+				return QCoreApplication::tr("Not Modified");
 
 			case HttpResponseCode::UseProxy:
-				return QApplication::tr("Use Proxy");
+				return QCoreApplication::tr("Use Proxy");
 
 			case HttpResponseCode::Code306Unused:
-				return QApplication::tr("(Unused)");
+				return QCoreApplication::tr("(Unused)");
 
 			case HttpResponseCode::TemporaryRedirect:
-				return QApplication::tr("Temporary Redirect");
+				return QCoreApplication::tr("Temporary Redirect");
 
 			case HttpResponseCode::BadRequest:
-				return QApplication::tr("Bad Request");
+				return QCoreApplication::tr("Bad Request");
 
 			case HttpResponseCode::Unauthorised:
-				return QApplication::tr("Unauthorised");
+				return QCoreApplication::tr("Unauthorised");
 
 			case HttpResponseCode::PaymentRequired:
-				return QApplication::tr("Payment Required");
+				return QCoreApplication::tr("Payment Required");
 
 			case HttpResponseCode::Forbidden:
-				return QApplication::tr("Forbidden");
+				return QCoreApplication::tr("Forbidden");
 
 			case HttpResponseCode::NotFound:
-				return QApplication::tr("Not Found");
+				return QCoreApplication::tr("Not Found");
 
 			case HttpResponseCode::MethodNotAllowed:
-				return QApplication::tr("Method Not Allowed");
+				return QCoreApplication::tr("Method Not Allowed");
 
 			case HttpResponseCode::NotAcceptable:
-				return QApplication::tr("Not Acceptable");
+				return QCoreApplication::tr("Not Acceptable");
 
 			case HttpResponseCode::ProxyAuthenticationRequired:
-				return QApplication::tr("Proxy Authentication Required");
+				return QCoreApplication::tr("Proxy Authentication Required");
 
 			case HttpResponseCode::RequestTimeout:
-				return QApplication::tr("Request Timeout");
+				return QCoreApplication::tr("Request Timeout");
 
 			case HttpResponseCode::Conflict:
-				return QApplication::tr("Conflict");
+				return QCoreApplication::tr("Conflict");
 
 			case HttpResponseCode::Gone:
-				return QApplication::tr("Gone");
+				return QCoreApplication::tr("Gone");
 
 			case HttpResponseCode::LengthRequired:
-				return QApplication::tr("Length Required");
+				return QCoreApplication::tr("Length Required");
 
 			case HttpResponseCode::PreconditionFailed:
-				return QApplication::tr("Precondition Failed");
+				return QCoreApplication::tr("Precondition Failed");
 
 			case HttpResponseCode::RequestEntityTooLarge:
-				return QApplication::tr("Request Entity Too Large");
+				return QCoreApplication::tr("Request Entity Too Large");
 
 			case HttpResponseCode::RequestUriTooLong:
-				return QApplication::tr("Request-URI Too Long");
+				return QCoreApplication::tr("Request-URI Too Long");
 
 			case HttpResponseCode::UnsupportedMediaType:
-				return QApplication::tr("Unsupported Media Type");
+				return QCoreApplication::tr("Unsupported Media Type");
 
 			case HttpResponseCode::RequestRangeNotSatisfiable:
-				return QApplication::tr("Requested Range Not Satisfiable");
+				return QCoreApplication::tr("Requested Range Not Satisfiable");
 
 			case HttpResponseCode::ExpectationFailed:
-				return QApplication::tr("Expectation Failed");
+				return QCoreApplication::tr("Expectation Failed");
 
 			case HttpResponseCode::InternalServerError:
-				return QApplication::tr("Internal Server Error");
+				return QCoreApplication::tr("Internal Server Error");
 
 			case HttpResponseCode::NotImplemented:
-				return QApplication::tr("Not Implemented");
+				return QCoreApplication::tr("Not Implemented");
 
 			case HttpResponseCode::BadGateway:
-				return QApplication::tr("Bad Gateway");
+				return QCoreApplication::tr("Bad Gateway");
 
 			case HttpResponseCode::ServiceUnavailable:
-				return QApplication::tr("Service Unavailable");
+				return QCoreApplication::tr("Service Unavailable");
 
 			case HttpResponseCode::GatewayTimeout:
-				return QApplication::tr("Gateway Timeout");
+				return QCoreApplication::tr("Gateway Timeout");
 
 			case HttpResponseCode::HttpVersionNotSupported:
-				return QApplication::tr("HTTP Version Not Supported");
+				return QCoreApplication::tr("HTTP Version Not Supported");
 		}
 
-		return QApplication::tr("Unknown");
+		return QCoreApplication::tr("Unknown");
 	}
 
 
 	QString RequestHandler::defaultResponseMessage(HttpResponseCode code) {
 		switch(code) {
 			case HttpResponseCode::Continue:
-				return QApplication::tr("Continue");
+				return QCoreApplication::tr("Continue");
 
 			case HttpResponseCode::SwitchingProtocols:
-				return QApplication::tr("Switching Protocols");
+				return QCoreApplication::tr("Switching Protocols");
 
 			case HttpResponseCode::Ok:
-				return QApplication::tr("The request was accepted and will be honoured.");
+				return QCoreApplication::tr("The request was accepted and will be honoured.");
 
 			case HttpResponseCode::Created:
-				return QApplication::tr("Created");
+				return QCoreApplication::tr("Created");
 
 			case HttpResponseCode::Accepted:
-				return QApplication::tr("Accepted");
+				return QCoreApplication::tr("Accepted");
 
 			case HttpResponseCode::NonAuthoritativeInformation:
-				return QApplication::tr("Non-Authoritative Information");
+				return QCoreApplication::tr("Non-Authoritative Information");
 
 			case HttpResponseCode::NoContent:
-				return QApplication::tr("No Content");
+				return QCoreApplication::tr("No Content");
 
 			case HttpResponseCode::ResetContent:
-				return QApplication::tr("Reset Content");
+				return QCoreApplication::tr("Reset Content");
 
 			case HttpResponseCode::PartialContent:
-				return QApplication::tr("Partial Content");
+				return QCoreApplication::tr("Partial Content");
 
 			case HttpResponseCode::MultipleChoices:
-				return QApplication::tr("Multiple Choices");
+				return QCoreApplication::tr("Multiple Choices");
 
 			case HttpResponseCode::MovedPermanently:
-				return QApplication::tr("Moved Permanently");
+				return QCoreApplication::tr("Moved Permanently");
 
 			case HttpResponseCode::Found:
-				return QApplication::tr("Found");
+				return QCoreApplication::tr("Found");
 
 			case HttpResponseCode::SeeOther:
-				return QApplication::tr("See Other");
+				return QCoreApplication::tr("See Other");
 
 			case HttpResponseCode::NotModified:
-				return QApplication::tr("Not Modified");
+				return QCoreApplication::tr("Not Modified");
 
 			case HttpResponseCode::UseProxy:
-				return QApplication::tr("Use Proxy");
+				return QCoreApplication::tr("Use Proxy");
 
 			case HttpResponseCode::Code306Unused:
-				return QApplication::tr("(Unused)");
+				return QCoreApplication::tr("(Unused)");
 
 			case HttpResponseCode::TemporaryRedirect:
-				return QApplication::tr("Temporary Redirect");
+				return QCoreApplication::tr("Temporary Redirect");
 
 			case HttpResponseCode::BadRequest:
-				return QApplication::tr("Bad Request");
+				return QCoreApplication::tr("Bad Request");
 
 			case HttpResponseCode::Unauthorised:
-				return QApplication::tr("Unauthorised");
+				return QCoreApplication::tr("Unauthorised");
 
 			case HttpResponseCode::PaymentRequired:
-				return QApplication::tr("Payment Required");
+				return QCoreApplication::tr("Payment Required");
 
 			case HttpResponseCode::Forbidden:
-				return QApplication::tr("The request could not be fulfilled because you are not allowed to access the resource requested.");
+				return QCoreApplication::tr("The request could not be fulfilled because you are not allowed to access the resource requested.");
 
 			case HttpResponseCode::NotFound:
-				return QApplication::tr("The resource requested could not be located on this server.");
+				return QCoreApplication::tr("The resource requested could not be located on this server.");
 
 			case HttpResponseCode::MethodNotAllowed:
-				return QApplication::tr("Method Not Allowed");
+				return QCoreApplication::tr("Method Not Allowed");
 
 			case HttpResponseCode::NotAcceptable:
-				return QApplication::tr("Not Acceptable");
+				return QCoreApplication::tr("Not Acceptable");
 
 			case HttpResponseCode::ProxyAuthenticationRequired:
-				return QApplication::tr("Proxy Authentication Required");
+				return QCoreApplication::tr("Proxy Authentication Required");
 
 			case HttpResponseCode::RequestTimeout:
-				return QApplication::tr("The request could not be fulfilled because it took too long to process. If the server is currently busy, it may be possible to successfully fulfil the request later.");
+				return QCoreApplication::tr("The request could not be fulfilled because it took too long to process. If the server is currently busy, it may be possible to successfully fulfil the request later.");
 
 			case HttpResponseCode::Conflict:
-				return QApplication::tr("Conflict");
+				return QCoreApplication::tr("Conflict");
 
 			case HttpResponseCode::Gone:
-				return QApplication::tr("The requested resource has been permanently removed from this server.");
+				return QCoreApplication::tr("The requested resource has been permanently removed from this server.");
 
 			case HttpResponseCode::LengthRequired:
-				return QApplication::tr("Length Required");
+				return QCoreApplication::tr("Length Required");
 
 			case HttpResponseCode::PreconditionFailed:
-				return QApplication::tr("Precondition Failed");
+				return QCoreApplication::tr("Precondition Failed");
 
 			case HttpResponseCode::RequestEntityTooLarge:
-				return QApplication::tr("Request Entity Too Large");
+				return QCoreApplication::tr("Request Entity Too Large");
 
 			case HttpResponseCode::RequestUriTooLong:
-				return QApplication::tr("The request could not be fulfilled because the identifier of the resource requested was too long to process.");
+				return QCoreApplication::tr("The request could not be fulfilled because the identifier of the resource requested was too long to process.");
 
 			case HttpResponseCode::UnsupportedMediaType:
-				return QApplication::tr("Unsupported Media Type");
+				return QCoreApplication::tr("Unsupported Media Type");
 
 			case HttpResponseCode::RequestRangeNotSatisfiable:
-				return QApplication::tr("Requested Range Not Satisfiable");
+				return QCoreApplication::tr("Requested Range Not Satisfiable");
 
 			case HttpResponseCode::ExpectationFailed:
-				return QApplication::tr("Expectation Failed");
+				return QCoreApplication::tr("Expectation Failed");
 
 			case HttpResponseCode::InternalServerError:
-				return QApplication::tr("The request could not be fulfilled because of an unexpected internal error in the server.");
+				return QCoreApplication::tr("The request could not be fulfilled because of an unexpected internal error in the server.");
 
 			case HttpResponseCode::NotImplemented:
-				return QApplication::tr("The request could not be fulfilled because it is of an unsupported type.");
+				return QCoreApplication::tr("The request could not be fulfilled because it is of an unsupported type.");
 
 			case HttpResponseCode::BadGateway:
-				return QApplication::tr("Bad Gateway");
+				return QCoreApplication::tr("Bad Gateway");
 
 			case HttpResponseCode::ServiceUnavailable:
-				return QApplication::tr("Service Unavailable");
+				return QCoreApplication::tr("Service Unavailable");
 
 			case HttpResponseCode::GatewayTimeout:
-				return QApplication::tr("Gateway Timeout");
+				return QCoreApplication::tr("Gateway Timeout");
 
 			case HttpResponseCode::HttpVersionNotSupported:
-				return QApplication::tr("HTTP Version Not Supported");
+				return QCoreApplication::tr("HTTP Version Not Supported");
 		}
 
-		return QApplication::tr("Unknown response code.");
+		return QCoreApplication::tr("Unknown response code.");
 	}
 
 
 	bool RequestHandler::sendResponseCode(HttpResponseCode code, const std::optional<QString> & title) {
 		eqAssert(ResponseStage::SendingResponse == m_stage, "must be in SendingResponse stage to send the HTTP response header (stage is currently " << responseStageString<std::string>(m_stage) << ")");
+		m_responseStatus = static_cast<int>(code);
+		m_trace.mark(RequestTrace::Point::ResponseStarted);
 		return sendData(QByteArrayLiteral("HTTP/1.1 ") % QByteArray::number(static_cast<unsigned int>(code)) % ' ' % (!title ? RequestHandler::defaultResponseReason(code).toUtf8() : title->toUtf8()) + EOL);
 	}
 
@@ -702,14 +993,15 @@ namespace Anansi {
 		if(ResponseStage::SendingBody != m_stage) {
 			sendData(EOL);
 			m_stage = ResponseStage::SendingBody;
+			m_trace.mark(RequestTrace::Point::BodyStarted);
 
-			if(!m_encoder->startEncoding(*m_socket)) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to start data encoding\n";
+			if(!m_encoder->startEncoding(*m_out)) {
+				anansiLog(Warning, "failed to start data encoding");
 				return false;
 			}
 		}
 
-		return m_encoder->encodeTo(*m_socket, body);
+		return m_encoder->encodeTo(*m_out, body);
 	}
 
 
@@ -720,18 +1012,19 @@ namespace Anansi {
 		if(ResponseStage::SendingBody != m_stage) {
 			sendData(EOL);
 			m_stage = ResponseStage::SendingBody;
+			m_trace.mark(RequestTrace::Point::BodyStarted);
 
-			if(!m_encoder->startEncoding(*m_socket)) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to start data encoding\n";
+			if(!m_encoder->startEncoding(*m_out)) {
+				anansiLog(Warning, "failed to start data encoding");
 				return false;
 			}
 		}
 
-		return m_encoder->encodeTo(*m_socket, in, size);
+		return m_encoder->encodeTo(*m_out, in, size);
 	}
 
 
-	bool RequestHandler::sendError(HttpResponseCode code, QString msg, QString title) {
+	bool RequestHandler::sendError(HttpResponseCode code, QString msg, QString title, const HttpHeaders & headers) {
 		eqAssert(ResponseStage::SendingResponse == m_stage, "cannot send a complete error response when header or body content has already been sent (stage is currently " << responseStageString<std::string>(m_stage) << ")");
 
 		if(title.isEmpty()) {
@@ -739,12 +1032,17 @@ namespace Anansi {
 		}
 
 		if(!sendResponseCode(code, title)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: sending of response line for error failed.\n";
+			anansiLog(Debug, "sending of response line for error failed.");
 			return false;
 		}
 
 		if(!sendDateHeader() || !sendHeader(QByteArrayLiteral("Content-type"), QByteArrayLiteral("text/html"))) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: sending of date or content-type header for error failed.\n";
+			anansiLog(Debug, "sending of date or content-type header for error failed.");
+			return false;
+		}
+
+		if(!sendHeaders(headers)) {
+			anansiLog(Debug, "sending of additional headers for error failed.");
 			return false;
 		}
 
@@ -756,12 +1054,12 @@ namespace Anansi {
 		const QByteArray htmlMsg = QByteArrayLiteral("\r\n<html><head><title>") % htmlTitle % QByteArrayLiteral("</title></head><body><h1>") % QByteArray::number(static_cast<unsigned int>(code)) % ' ' % htmlTitle % QByteArrayLiteral("</h1><p>") % to_html_entities(msg).toUtf8() % QByteArrayLiteral("</p></body></html>");
 
 		if(!sendHeader(QByteArrayLiteral("Content-length"), QByteArray::number(htmlMsg.size() - 2))) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: sending of content-length header for error failed.\n";
+			anansiLog(Debug, "sending of content-length header for error failed.");
 			return false;
 		}
 
 		if(!sendData(htmlMsg)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: sending of body content for error failed.\n";
+			anansiLog(Debug, "sending of body content for error failed.");
 			return false;
 		}
 
@@ -770,21 +1068,143 @@ namespace Anansi {
 	}
 
 
-	void RequestHandler::sendDirectoryListing(const QString & localPath) {
-		const QString clientAddr = m_socket->peerAddress().toString();
-		const uint16_t clientPort = m_socket->peerPort();
+	RequestHandler::DirectoryListingFormat RequestHandler::directoryListingFormat() const {
+		// explicit switch in the query string takes precedence over the accept header
+		if(!m_requestUri.query.empty()) {
+			std::string::size_type begin = 0;
+
+			while(begin <= m_requestUri.query.size()) {
+				auto end = m_requestUri.query.find('&', begin);
+
+				if(std::string::npos == end) {
+					end = m_requestUri.query.size();
+				}
+
+				const auto param = m_requestUri.query.substr(begin, end - begin);
+
+				if("format=json" == param) {
+					return DirectoryListingFormat::Json;
+				}
+
+				if("format=html" == param) {
+					return DirectoryListingFormat::Html;
+				}
+
+				begin = end + 1;
+			}
+		}
+
+		// JSON only when the client prefers it to HTML; browsers only reach it via */* at a
+		// lower weight than text/html, and a tie goes to whichever the client named more
+		// specifically, with HTML winning if neither is
+		if(const auto acceptIt = m_requestHeaders.find("accept"); m_requestHeaders.cend() != acceptIt) {
+			const auto [jsonQuality, jsonSpecificity] = acceptQuality(acceptIt->second, "application/json");
+			const auto [htmlQuality, htmlSpecificity] = acceptQuality(acceptIt->second, "text/html");
+
+			if(0.0 < jsonQuality && (jsonQuality > htmlQuality || (jsonQuality == htmlQuality && jsonSpecificity > htmlSpecificity))) {
+				return DirectoryListingFormat::Json;
+			}
+		}
+
+		return DirectoryListingFormat::Html;
+	}
+
+
+	QFileInfoList RequestHandler::directoryListingEntries(const QString & localPath) const {
+		QDir::Filters dirListFilters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
+		QDir::SortFlags dirSortFlags = QDir::Name;
 
+		if(m_config.showHiddenFilesInDirectoryListings()) {
+			dirListFilters |= QDir::Hidden;
+		}
+
+		switch(m_config.directoryListingSortOrder()) {
+			case DirectoryListingSortOrder::AscendingDirectoriesFirst:
+				dirSortFlags |= QDir::DirsFirst;
+				break;
+
+			case DirectoryListingSortOrder::AscendingFilesFirst:
+				dirSortFlags |= QDir::DirsLast;
+				break;
+
+			case DirectoryListingSortOrder::Ascending:
+				break;
+
+			case DirectoryListingSortOrder::DescendingDirectoriesFirst:
+				dirSortFlags |= QDir::DirsFirst | QDir::Reversed;
+				break;
+
+			case DirectoryListingSortOrder::DescendingFilesFirst:
+				dirSortFlags |= QDir::DirsLast | QDir::Reversed;
+				break;
+
+			case DirectoryListingSortOrder::Descending:
+				dirSortFlags |= QDir::Reversed;
+				break;
+		}
+
+		return QDir(localPath).entryInfoList(dirListFilters, dirSortFlags);
+	}
+
+
+	void RequestHandler::sendDirectoryListing(const QString & localPath) {
 		if(!m_config.directoryListingsAllowed()) {
-			Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+			recordAction(WebServerAction::Forbid);
 			sendError(HttpResponseCode::Forbidden);
 			return;
 		}
 
-		Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Serve);
+		recordAction(WebServerAction::Serve);
+
+		switch(directoryListingFormat()) {
+			case DirectoryListingFormat::Html:
+				sendDirectoryListingBody(QByteArrayLiteral("text/html; charset=UTF-8"), htmlDirectoryListing(localPath));
+				break;
+
+			case DirectoryListingFormat::Json:
+				sendDirectoryListingBody(QByteArrayLiteral("application/json; charset=UTF-8"), jsonDirectoryListing(localPath));
+				break;
+		}
+	}
+
+
+	void RequestHandler::sendDirectoryListingBody(const QByteArray & contentType, const QByteArray & body) {
+		const auto md5 = QCryptographicHash::hash(body, QCryptographicHash::Md5).toHex();
+
+		// the body differs between formats so the tag does too, and it changes whenever
+		// anything shown in the listing does
+		const QByteArray etag = '"' % md5 % '"';
+
+		if(const auto ifNoneMatchIt = m_requestHeaders.find("if-none-match"); m_requestHeaders.cend() != ifNoneMatchIt && etagMatches(ifNoneMatchIt->second, etag)) {
+			sendResponseCode(HttpResponseCode::NotModified);
+			sendDateHeader();
+			sendHeader(QByteArrayLiteral("ETag"), etag);
+			sendHeader(QByteArrayLiteral("Vary"), QByteArrayLiteral("Accept"));
+			sendData(EOL);
+			m_stage = ResponseStage::Completed;
+			return;
+		}
+
 		sendResponseCode(HttpResponseCode::Ok);
 		sendDateHeader();
-		sendHeader(QByteArrayLiteral("Content-type"), QByteArrayLiteral("text/html; charset=UTF-8"));
+		sendHeader(QByteArrayLiteral("Content-type"), contentType);
+		// the format is chosen from the Accept header (see directoryListingFormat())
+		sendHeader(QByteArrayLiteral("Vary"), QByteArrayLiteral("Accept"));
+		sendHeader(QByteArrayLiteral("ETag"), etag);
 		sendHeaders(m_encoder->headers());
+		sendHeader(QByteArrayLiteral("Content-length"), QByteArray::number(body.size()));
+		sendHeader(QByteArrayLiteral("Content-MD5"), md5);
+
+		if(HttpMethod::Get == m_requestMethod || HttpMethod::Post == m_requestMethod) {
+			sendBody(body);
+		}
+		else {
+			sendData(EOL);
+		}
+	}
+
+
+	QByteArray RequestHandler::htmlDirectoryListing(const QString & localPath) {
 		QByteArray responseBody = QByteArrayLiteral("<html>\n<head><title>Directory listing for ");
 		QByteArray htmlPath(0, '\0');
 
@@ -833,39 +1253,7 @@ namespace Anansi {
 			responseBody += QByteArrayLiteral("<img src=\"") % mediaTypeIconUri(QStringLiteral("application/octet-stream")) % QByteArrayLiteral("\" />&nbsp;");
 		};
 
-		QDir::Filters dirListFilters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
-		QDir::SortFlags dirSortFlags = QDir::Name;
-
-		if(m_config.showHiddenFilesInDirectoryListings()) {
-			dirListFilters |= QDir::Hidden;
-		}
-
-		switch(m_config.directoryListingSortOrder()) {
-			case DirectoryListingSortOrder::AscendingDirectoriesFirst:
-				dirSortFlags |= QDir::DirsFirst;
-				break;
-
-			case DirectoryListingSortOrder::AscendingFilesFirst:
-				dirSortFlags |= QDir::DirsLast;
-				break;
-
-			case DirectoryListingSortOrder::Ascending:
-				break;
-
-			case DirectoryListingSortOrder::DescendingDirectoriesFirst:
-				dirSortFlags |= QDir::DirsFirst | QDir::Reversed;
-				break;
-
-			case DirectoryListingSortOrder::DescendingFilesFirst:
-				dirSortFlags |= QDir::DirsLast | QDir::Reversed;
-				break;
-
-			case DirectoryListingSortOrder::Descending:
-				dirSortFlags |= QDir::Reversed;
-				break;
-		}
-
-		for(const auto & entry : QDir(localPath).entryInfoList(dirListFilters, dirSortFlags)) {
+		for(const auto & entry : directoryListingEntries(localPath)) {
 			const auto htmlFileName = to_html_entities(entry.fileName());
 			responseBody += QByteArrayLiteral("<li");
 
@@ -903,23 +1291,58 @@ namespace Anansi {
 		}
 
 		responseBody += QByteArrayLiteral("</ul></div>\n<div id=\"footer\"><p>") % to_html_entities(qApp->applicationDisplayName()) % QStringLiteral(" v") % to_html_entities(qApp->applicationVersion()) % "</p></div></body>\n</html>";
-		sendHeader(QStringLiteral("Content-length"), QString::number(responseBody.size()));
-		sendHeader(QStringLiteral("Content-MD5"), QString::fromUtf8(QCryptographicHash::hash(responseBody, QCryptographicHash::Md5).toHex()));
+		return responseBody;
+	}
 
-		if(HttpMethod::Get == m_requestMethod || HttpMethod::Post == m_requestMethod) {
-			sendBody(responseBody);
+
+	QByteArray RequestHandler::jsonDirectoryListing(const QString & localPath) const {
+		QByteArray buffer;
+		buffer.append('[');
+		bool first = true;
+
+		for(const auto & entry : directoryListingEntries(localPath)) {
+			if(first) {
+				first = false;
+			}
+			else {
+				buffer.append(',');
+			}
+
+			buffer.append(QByteArrayLiteral("{\"name\":"));
+			appendJsonString(buffer, entry.fileName().toUtf8());
+			buffer.append(QByteArrayLiteral(",\"type\":"));
+
+			if(entry.isSymLink()) {
+				buffer.append(QByteArrayLiteral("\"symlink\""));
+			}
+			else if(entry.isDir()) {
+				buffer.append(QByteArrayLiteral("\"directory\""));
+			}
+			else if(entry.isFile()) {
+				buffer.append(QByteArrayLiteral("\"file\""));
+			}
+			else {
+				buffer.append(QByteArrayLiteral("\"other\""));
+			}
+
+			buffer.append(QByteArrayLiteral(",\"size\":"));
+			buffer.append(QByteArray::number(entry.isFile() ? entry.size() : 0));
+			buffer.append(QByteArrayLiteral(",\"mtime\":"));
+			buffer.append(QByteArray::number(entry.lastModified().toSecsSinceEpoch()));
+			buffer.append('}');
 		}
+
+		buffer.append(']');
+		return buffer;
 	}
 
 
 	void RequestHandler::sendFile(const QString & localPath, const QString & mediaType) {
-		const QString clientAddr = m_socket->peerAddress().toString();
-		const uint16_t clientPort = m_socket->peerPort();
 		const auto cgiBinPath = m_config.cgiBin();
 
 		if(!cgiBinPath.isEmpty() && starts_with(QFileInfo(localPath).absolutePath(), QFileInfo(cgiBinPath).absolutePath())) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Refusing to serve file \"" << qPrintable(localPath) << "\" from inside cgi-bin\n";
-			Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+			anansiLog(Info, "Refusing to serve file \"" << qPrintable(localPath) << "\" from inside cgi-bin");
+			recordAction(WebServerAction::Forbid);
 			sendError(HttpResponseCode::Forbidden);
 			return;
 		}
@@ -927,20 +1350,21 @@ namespace Anansi {
 		QFile localFile(localPath);
 
 		if(!localFile.exists()) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: File not found - sending HTTP_NOT_FOUND\n";
-			Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+			anansiLog(Debug, "File not found - sending HTTP_NOT_FOUND");
+			recordAction(WebServerAction::Forbid);
 			sendError(HttpResponseCode::NotFound);
 			return;
 		}
 
 		if(!localFile.open(QIODevice::ReadOnly)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: File can't be found - sending HTTP_NOT_FOUND\n";
-			Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+			anansiLog(Debug, "File can't be found - sending HTTP_NOT_FOUND");
+			recordAction(WebServerAction::Forbid);
 			sendError(HttpResponseCode::NotFound);
 			return;
 		}
 
-		Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Serve);
+		m_trace.mark(RequestTrace::Point::FileOpened);
+		recordAction(WebServerAction::Serve);
 
 		sendResponseCode(HttpResponseCode::Ok);
 		sendDateHeader();
@@ -956,197 +1380,1221 @@ namespace Anansi {
 	}
 
 
-	void RequestHandler::doCgi(const QString & localPath, const QString & mediaType) {
-		const QString clientAddr = m_socket->peerAddress().toString();
-		const uint16_t clientPort = m_socket->peerPort();
-		const auto docRoot = QFileInfo(m_config.documentRoot());
+	CgiEnvironment RequestHandler::cgiEnvironment(const QString & scriptFileName) const {
+		CgiEnvironment env(m_cgiEnvironment);
+		env.add("REMOTE_ADDR", m_socket->peerAddress().toString().toLatin1());
+		env.add("REMOTE_PORT", QByteArray::number(m_socket->peerPort()));
+		env.add("REQUEST_METHOD", QByteArray::fromStdString(m_requestLine.method));
+		env.add("REQUEST_URI", QByteArray::fromStdString(m_requestLine.uri));
+		env.add("SCRIPT_NAME", QByteArray::fromStdString(m_requestUri.path));
+		env.add("SCRIPT_FILENAME", scriptFileName.toLocal8Bit());
+		env.add("SERVER_PROTOCOL", QByteArrayLiteral("HTTP/") % QByteArray::fromStdString(m_requestLine.httpVersion));
 
-		// empty means no CGI execution
-		if(m_config.cgiBin().isEmpty()) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Server not configured for CGI support - sending HTTP_NOT_FOUND\n";
-			Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
-			sendError(HttpResponseCode::NotFound);
-			return;
+		if(!m_requestUri.query.empty()) {
+			env.add("QUERY_STRING", QByteArray::fromStdString(m_requestUri.query));
 		}
 
-		QString cgiCommandLine;
-		QString cgiWorkingDir;
-		QString envScriptFileName;
-
-		if(starts_with(m_requestUri.path, "/cgi-bin/")) {
-			cgiWorkingDir = m_config.cgiBin();
-			cgiCommandLine = m_config.cgiBin();
-
-			// use .back() when we can rely on Qt5.10 or later
-			if('/' != cgiCommandLine.at(cgiCommandLine.size() - 1)) {
-				cgiCommandLine.push_back('/');
-			}
+		const auto contentTypeIter = m_requestHeaders.find("content-type");
 
-			// 9 == "/cgi-bin/".size()
-			const auto begin = m_requestUri.path.cbegin() + 9;
-			cgiCommandLine.append(QString::fromStdString({begin, m_requestUri.path.cend()}));
-			envScriptFileName = cgiCommandLine;
+		if(m_requestHeaders.cend() != contentTypeIter) {
+			env.add("CONTENT_TYPE", QByteArray::fromStdString(contentTypeIter->second));
+			env.add("CONTENT_LENGTH", QByteArray::number(m_requestBodyLength));
 		}
-		else {
-			cgiCommandLine = m_config.mediaTypeCgi(mediaType);
 
-			if(cgiCommandLine.isEmpty()) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: no CGI processor set for script \"" << m_requestLine.uri << "\" (media type: " << qPrintable(mediaType) << ")\n";
-				Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+		// put the HTTP headers into the CGI environment
+		for(const auto & header : m_requestHeaders) {
+			env.addHttpHeader(header.first, header.second);
+		}
+
+		return env;
+	}
+
+
+	// runs a CGI script with no client attached and collects all of its output
+	template<class ProcessType>
+	static std::optional<QByteArray> readCompleteCgiOutput(ProcessType & cgiProcess, int timeout, int maxSize) {
+		cgiProcess.closeWriteChannel();
+		QByteArray output;
+
+		while(true) {
+			if(0 == cgiProcess.bytesAvailable() && !cgiProcess.waitForReadyRead(timeout)) {
+				break;
+			}
+
+			output.append(cgiProcess.readAll());
+
+			if(maxSize < output.size()) {
+				return {};
+			}
+		}
+
+		if(!cgiProcess.waitForFinished(timeout) || 0 != cgiProcess.exitCode()) {
+			return {};
+		}
+
+		return output;
+	}
+
+
+	// builds the job that refreshes a stale cached response in the background. everything
+	// is copied because the request will be long gone by the time it runs
+	static CgiResponseCache::Fetch cgiRevalidator(const QString & script, const QString & program, const QStringList & args, const CgiEnvironment & env, const QString & workingDir, const Configuration & config, int maxSize) {
+		const CgiConcurrencyLimiter::Limits limits = {config.cgiConcurrencyLimit(), config.cgiScriptConcurrencyLimit(), config.cgiQueueLength(), config.cgiQueueTimeout()};
+		const auto timeout = config.cgiTimeout();
+
+		return [program, args, env, workingDir, limits, timeout, script, maxSize]() -> std::optional<QByteArray> {
+			const auto cgiSlot = CgiConcurrencyLimiter::instance().acquire(script, limits);
+
+			if(!cgiSlot) {
+				return {};
+			}
+
+#if defined(Q_OS_UNIX)
+			auto cgiProcess = CgiProcess::start(program, args, env, workingDir);
+
+			if(!cgiProcess) {
+				return {};
+			}
+
+			cgiProcess->setReadTimeout(timeout);
+			return readCompleteCgiOutput(*cgiProcess, timeout, maxSize);
+#else
+			QProcess cgiProcess;
+			cgiProcess.setEnvironment(env.toStringList());
+			cgiProcess.setWorkingDirectory(workingDir);
+			cgiProcess.start(program, args, QIODevice::ReadWrite);
+
+			if(!cgiProcess.waitForStarted(timeout)) {
+				return {};
+			}
+
+			return readCompleteCgiOutput(cgiProcess, timeout, maxSize);
+#endif
+		};
+	}
+
+
+	void RequestHandler::doCgi(const QString & localPath, const QString & mediaType) {
+		// empty means no CGI execution
+		if(m_config.cgiBin().isEmpty()) {
+			anansiLog(Debug, "Server not configured for CGI support - sending HTTP_NOT_FOUND");
+			recordAction(WebServerAction::Forbid);
+			sendError(HttpResponseCode::NotFound);
+			return;
+		}
+
+		if(!starts_with(m_requestUri.path, "/cgi-bin/") && CgiTransport::FastCgi == m_config.mediaTypeCgiTransport(mediaType)) {
+			doFastCgi(localPath, mediaType);
+			return;
+		}
+
+		QString cgiProgram;
+		QStringList cgiArguments;
+		QString cgiWorkingDir;
+		QString envScriptFileName;
+		const bool isCgiBinRequest = starts_with(m_requestUri.path, "/cgi-bin/");
+
+		if(isCgiBinRequest) {
+			cgiWorkingDir = m_config.cgiBin();
+			cgiProgram = m_config.cgiBin();
+
+			// use .back() when we can rely on Qt5.10 or later
+			if('/' != cgiProgram.at(cgiProgram.size() - 1)) {
+				cgiProgram.push_back('/');
+			}
+
+			// 9 == "/cgi-bin/".size()
+			const auto begin = m_requestUri.path.cbegin() + 9;
+			cgiProgram.append(QString::fromStdString({begin, m_requestUri.path.cend()}));
+			envScriptFileName = cgiProgram;
+		}
+		else {
+			cgiProgram = m_config.mediaTypeCgi(mediaType);
+
+			if(cgiProgram.isEmpty()) {
+				anansiLog(Warning, "no CGI processor set for script \"" << m_requestLine.uri << "\" (media type: " << qPrintable(mediaType) << ")");
+				recordAction(WebServerAction::Forbid);
+				sendError(HttpResponseCode::Forbidden);
+				return;
+			}
+
+			cgiProgram = QFileInfo(cgiProgram).absoluteFilePath();
+
+			if(cgiProgram.isEmpty()) {
+				anansiLog(Warning, "CGI processor \"" << qPrintable(m_config.mediaTypeCgi(mediaType)) << "\" for CGI script (\"" << m_requestLine.uri << "\", media type " << qPrintable(mediaType) << ") not found");
+				recordAction(WebServerAction::Forbid);
 				sendError(HttpResponseCode::Forbidden);
 				return;
 			}
 
-			cgiCommandLine = QFileInfo(cgiCommandLine).absoluteFilePath();
+			auto localPathInfo = QFileInfo(localPath);
+			cgiArguments.push_back(localPathInfo.absoluteFilePath());
+			cgiWorkingDir = localPathInfo.absolutePath();
+			envScriptFileName = localPathInfo.absoluteFilePath();
+		}
+
+		// cgiProgram is now fully-resolved path to executable, with script as argument if necessary
+		const auto env = cgiEnvironment(envScriptFileName);
+		CgiResponseCache::Lookup cachedResponse;
+
+		// only plain GETs can be answered for one client with output produced for another
+		if(0 < m_config.cgiResponseCacheSize() && HttpMethod::Get == m_requestMethod && 0 == m_requestBodyLength && m_requestHeaders.cend() == m_requestHeaders.find("authorization")) {
+			const auto cacheSize = m_config.cgiResponseCacheSize();
+			cachedResponse = CgiResponseCache::instance().lookup(envScriptFileName, m_requestUri.query, m_requestHeaders, cacheSize, m_config.cgiTimeout(), cgiRevalidator(envScriptFileName, cgiProgram, cgiArguments, env, cgiWorkingDir, m_config, cacheSize));
+
+			if(cachedResponse.isHit()) {
+				recordAction(WebServerAction::CGI);
+				QBuffer cgiOutput;
+				cgiOutput.setData(cachedResponse.output());
+				cgiOutput.open(QIODevice::ReadOnly);
+				sendCgiResponse(cgiOutput);
+				return;
+			}
+		}
+
+		// held until the process has finished with the request
+		const auto cgiSlot = CgiConcurrencyLimiter::instance().acquire(envScriptFileName, {m_config.cgiConcurrencyLimit(), m_config.cgiScriptConcurrencyLimit(), m_config.cgiQueueLength(), m_config.cgiQueueTimeout()}, &m_cancellation);
+
+		if(!cgiSlot) {
+			if(m_cancellation.isCancelled()) {
+				return;
+			}
+
+			anansiLog(Warning, "too many CGI requests in progress to run \"" << qPrintable(envScriptFileName) << "\"");
+
+			// suggest the client tries again once the current queue should have cleared
+			sendError(HttpResponseCode::ServiceUnavailable, tr("The server is too busy to run this script at present. Please try again shortly."), {}, {{"Retry-After", std::to_string((m_config.cgiQueueTimeout() + 999) / 1000)}});
+			return;
+		}
+
+		m_trace.mark(RequestTrace::Point::CgiAdmitted);
+		recordAction(WebServerAction::CGI);
+		bool cgiSucceeded = false;
+		bool cgiLaunched = false;
+		const auto cgiStartedAt = Metrics::Clock::now();
+
+		if(cachedResponse.mustFill()) {
+			m_cgiCapture.clear();
+			m_cgiCaptureLimit = cachedResponse.maxSize();
+		}
+
+		// the output is only worth keeping if the script ran to a successful finish
+#if defined(_MSC_VER)
+		// MSVC doesn't do class template argument deduction (yet?)
+		auto cacheCgiOutputFunction = [this, &cachedResponse, &cgiSucceeded, &cgiLaunched, &cgiStartedAt]() {
+			if(cgiLaunched) {
+				Metrics::instance().recordCgiDuration(Metrics::Clock::now() - cgiStartedAt);
+			}
+
+			if(cgiSucceeded && 0 <= m_cgiCaptureLimit) {
+				cachedResponse.fill(m_cgiCapture);
+			}
+
+			m_cgiCaptureLimit = -1;
+			m_cgiCapture.clear();
+		};
+		ScopeGuard<decltype(cacheCgiOutputFunction)> cacheCgiOutput(cacheCgiOutputFunction);
+#else
+		ScopeGuard cacheCgiOutput = [this, &cachedResponse, &cgiSucceeded, &cgiLaunched, &cgiStartedAt]() {
+			if(cgiLaunched) {
+				Metrics::instance().recordCgiDuration(Metrics::Clock::now() - cgiStartedAt);
+			}
+
+			if(cgiSucceeded && 0 <= m_cgiCaptureLimit) {
+				cachedResponse.fill(m_cgiCapture);
+			}
+
+			m_cgiCaptureLimit = -1;
+			m_cgiCapture.clear();
+		};
+#endif
+
+		if(!isCgiBinRequest) {
+			if(const auto workers = m_config.mediaTypeCgiWorkers(mediaType); 0 < workers.maximum) {
+				if(auto cgiProcess = CgiWorkerPool::instance().launch(cgiProgram, cgiArguments, env, cgiWorkingDir, workers, m_config.cgiWorkerIdleTimeout()); cgiProcess) {
+					Metrics::instance().recordCgiLaunch(Metrics::CgiLaunch::PooledWorker);
+					m_trace.mark(RequestTrace::Point::CgiLaunched);
+					cgiLaunched = true;
+					cgiProcess->setReadTimeout(m_config.cgiTimeout());
+					cgiProcess->setCancellationToken(&m_cancellation);
+					cgiSucceeded = sendCgiProcessResponse(*cgiProcess);
+					return;
+				}
+
+				// no warm worker available, fall back on starting the process directly
+			}
+		}
+
+#if defined(Q_OS_UNIX)
+		auto cgiProcess = CgiProcess::start(cgiProgram, cgiArguments, env, cgiWorkingDir);
+
+		if(!cgiProcess) {
+			sendError(HttpResponseCode::InternalServerError);
+			return;
+		}
+
+		Metrics::instance().recordCgiLaunch(Metrics::CgiLaunch::Process);
+		m_trace.mark(RequestTrace::Point::CgiLaunched);
+		cgiLaunched = true;
+		cgiProcess->setReadTimeout(m_config.cgiTimeout());
+		cgiProcess->setCancellationToken(&m_cancellation);
+		cgiSucceeded = sendCgiProcessResponse(*cgiProcess);
+#else
+		QProcess cgiProcess;
+
+		// ensure CGI process is closed on all exit paths
+#if defined(_MSC_VER)
+		// MSVC doesn't do class template argument deduction (yet?)
+		auto scopeGuardFunction = [&cgiProcess]() {
+			cgiProcess.close();
+		};
+		ScopeGuard<decltype(scopeGuardFunction)> cgiProcessGuard(scopeGuardFunction);
+#else
+		ScopeGuard cgiProcessGuard = [&cgiProcess]() {
+			cgiProcess.close();
+		};
+#endif
+		cgiProcess.setEnvironment(env.toStringList());
+		cgiProcess.setWorkingDirectory(cgiWorkingDir);
+		cgiProcess.start(cgiProgram, cgiArguments, QIODevice::ReadWrite);
+
+		if(!cgiProcess.waitForStarted(m_config.cgiTimeout())) {
+			if(QProcess::Timedout == cgiProcess.error()) {
+				anansiLog(Error, "Timeout waiting for CGI process to start.");
+				sendError(HttpResponseCode::RequestTimeout);
+			}
+			else {
+				anansiLog(Error, "Error starting CGI process: \"" << qPrintable(cgiProcess.errorString()) << "\".");
+				sendError(HttpResponseCode::InternalServerError);
+			}
+
+			return;
+		}
+
+		Metrics::instance().recordCgiLaunch(Metrics::CgiLaunch::Process);
+		m_trace.mark(RequestTrace::Point::CgiLaunched);
+		cgiLaunched = true;
+		cgiSucceeded = sendCgiProcessResponse(cgiProcess);
+#endif
+	}
+
+
+	template<class ProcessType>
+	bool RequestHandler::writeCgiRequestBody(ProcessType & cgiProcess) {
+		std::array<char, CgiReadBufferSize> bodyBuffer;
+		bool writable = true;
+
+		while(true) {
+			const auto bytesRead = readRequestBodyData(bodyBuffer.data(), bodyBuffer.size());
+
+			if(-1 == bytesRead) {
+				return false;
+			}
+
+			if(0 == bytesRead) {
+				break;
+			}
+
+			if(!writable) {
+				// script has stopped reading, keep consuming the body so the client isn't cut off
+				continue;
+			}
+
+			// wait for the script to take each chunk before reading the next one from the client,
+			// so a slow script throttles the upload rather than having it buffered here
+			if(bytesRead != cgiProcess.write(bodyBuffer.data(), bytesRead) || !cgiProcess.waitForBytesWritten(m_config.cgiTimeout())) {
+				anansiLog(Warning, "CGI process stopped accepting the request body (\"" << qPrintable(cgiProcess.errorString()) << "\")");
+				writable = false;
+			}
+		}
+
+		cgiProcess.closeWriteChannel();
+		return true;
+	}
+
+
+	template<class ProcessType>
+	bool RequestHandler::sendCgiProcessResponse(ProcessType & cgiProcess) {
+		if(!writeCgiRequestBody(cgiProcess)) {
+			// the process is killed when it goes out of scope
+			if(!m_cancellation.isCancelled()) {
+				sendError(HttpResponseCode::BadRequest);
+			}
+
+			return false;
+		}
+
+		if(!sendCgiResponse(cgiProcess)) {
+			// the process (and anything it has started) is killed when it goes out of scope
+			return false;
+		}
+
+		// the script has closed its output so should be on its way out
+		if(!cgiProcess.waitForFinished(m_config.cgiTimeout())) {
+			anansiLog(Warning, "CGI process did not exit after sending its response: \"" << qPrintable(cgiProcess.errorString()) << "\".");
+			return false;
+		}
+
+		if(0 != cgiProcess.exitCode()) {
+			anansiLog(Warning, "CGI process returned error status " << cgiProcess.exitCode());
+			anansiLog(Warning, "CGI process standard error: " << qPrintable(cgiProcess.readAllStandardError()));
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool RequestHandler::sendCgiResponse(QIODevice & cgiOutput) {
+		std::string headerData;
+		std::regex headerRx("^([a-zA-Z][a-zA-Z\\-]*) *: *(.+)$");
+		std::regex statusRx("^([1-5][0-9]{2})(?: +(.*))?$");
+		std::smatch captures;
+		auto responseCode = HttpResponseCode::Ok;
+		std::optional<QString> responseTitle;
+		bool haveStatus = false;
+		bool haveLocation = false;
+
+		while(true) {
+			// the CGI timeout applies to each wait rather than to the script as a whole, so
+			// long-running scripts that produce output steadily are not cut off
+			while(!cgiOutput.canReadLine()) {
+				if(!cgiOutput.waitForReadyRead(m_config.cgiTimeout())) {
+					anansiLog(Warning, "invalid CGI output - headers incomplete (\"" << qPrintable(cgiOutput.errorString()) << "\")");
+					sendError(HttpResponseCode::InternalServerError);
+					return false;
+				}
+			}
+
+			auto headerLine = readHeaderLine(cgiOutput);
+
+			if(!headerLine) {
+				anansiLog(Warning, "invalid CGI output - invalid header");
+				sendError(HttpResponseCode::InternalServerError);
+				return false;
+			}
+
+			captureCgiOutput(headerLine->data(), static_cast<int>(headerLine->size()));
+			captureCgiOutput(EOL.constData(), EOL.size());
+
+			if(headerLine->empty()) {
+				// all headers read
+				break;
+			}
+
+			if(!std::regex_match(*headerLine, captures, headerRx)) {
+				anansiLog(Warning, "invalid CGI output (invalid header \"" << *headerLine << "\")");
+				sendError(HttpResponseCode::InternalServerError);
+				return false;
+			}
+
+			const auto headerName = to_lower(captures.str(1));
+
+			if("status" == headerName) {
+				// Status is a CGI header, not an HTTP one - it becomes the response line
+				const auto statusValue = captures.str(2);
+
+				if(!std::regex_match(statusValue, captures, statusRx)) {
+					anansiLog(Warning, "invalid CGI output (invalid status \"" << statusValue << "\")");
+					sendError(HttpResponseCode::InternalServerError);
+					return false;
+				}
+
+				responseCode = static_cast<HttpResponseCode>(std::stoi(captures.str(1)));
+
+				if(captures[2].matched && 0 < captures[2].length()) {
+					responseTitle = QString::fromStdString(captures.str(2));
+				}
+
+				haveStatus = true;
+				continue;
+			}
+
+			if("location" == headerName) {
+				haveLocation = true;
+			}
+			else if("content-length" == headerName && ContentEncoding::Identity != m_responseEncoding) {
+				// the script's length is for the unencoded body
+				continue;
+			}
+
+			headerData.append(*headerLine);
+			headerData.append(EOL);
+		}
+
+		if(haveLocation && !haveStatus) {
+			// RFC 3875 6.2.3: a Location header without a Status is a client redirect
+			responseCode = HttpResponseCode::Found;
+		}
+
+		sendResponseCode(responseCode, responseTitle);
+		sendHeaders(m_encoder->headers());
+		sendDateHeader();
+		sendData(QByteArray::fromStdString(headerData));
+		return sendCgiBody(cgiOutput);
+	}
+
+
+	bool RequestHandler::sendCgiBody(QIODevice & cgiOutput) {
+		std::array<char, CgiReadBufferSize> readBuffer;
+
+		// forward output as the script produces it; reading only as fast as the client accepts
+		// lets the script block on its full stdout pipe rather than having its output pile up
+		// here
+		while(true) {
+			if(m_cancellation.isCancelled()) {
+				return false;
+			}
+
+			if(0 == cgiOutput.bytesAvailable() && !cgiOutput.waitForReadyRead(m_config.cgiTimeout())) {
+				// the script has closed its output, or has stalled for longer than the CGI timeout
+				break;
+			}
+
+			const auto bytesRead = cgiOutput.read(readBuffer.data(), readBuffer.size());
+
+			if(-1 == bytesRead) {
+				anansiLog(Warning, "error reading CGI output (\"" << qPrintable(cgiOutput.errorString()) << "\")");
+				return false;
+			}
+
+			if(0 == bytesRead) {
+				if(cgiOutput.atEnd()) {
+					break;
+				}
+
+				continue;
+			}
+
+			captureCgiOutput(readBuffer.data(), static_cast<int>(bytesRead));
+
+			// writes block while the client is behind and fail once it has gone
+			if(!sendBody(QByteArray::fromRawData(readBuffer.data(), static_cast<int>(bytesRead)))) {
+				return false;
+			}
+		}
+
+		if(ResponseStage::SendingBody != m_stage) {
+			// script produced no body - the headers still need terminating
+			return sendBody(QByteArray());
+		}
+
+		return true;
+	}
+
+
+	void RequestHandler::captureCgiOutput(const char * data, int size) {
+		if(0 > m_cgiCaptureLimit) {
+			return;
+		}
+
+		if(m_cgiCaptureLimit - m_cgiCapture.size() < size) {
+			// too big to cache - stop collecting it
+			m_cgiCaptureLimit = -1;
+			m_cgiCapture.clear();
+			return;
+		}
+
+		m_cgiCapture.append(data, size);
+	}
+
+
+	void RequestHandler::doFastCgi(const QString & localPath, const QString & mediaType) {
+		const auto responderAddress = m_config.mediaTypeCgi(mediaType);
+
+		if(responderAddress.isEmpty()) {
+			anansiLog(Warning, "no FastCGI responder set for script \"" << m_requestLine.uri << "\" (media type: " << qPrintable(mediaType) << ")");
+			recordAction(WebServerAction::Forbid);
+			sendError(HttpResponseCode::Forbidden);
+			return;
+		}
+
+		auto connection = FastCgiConnectionPool::instance().acquire(responderAddress, m_config.fastCgiConnectionLimit(), m_config.cgiTimeout());
+
+		if(!connection) {
+			anansiLog(Warning, "no connection available to FastCGI responder \"" << qPrintable(responderAddress) << "\"");
+			sendError(HttpResponseCode::BadGateway);
+			return;
+		}
+
+		// each connection carries a single request at a time so the ID never needs to vary
+		static constexpr const uint16_t RequestId = 1;
+		connection->setWriteTimeout(m_config.cgiTimeout());
+		connection->setCancellationToken(&m_cancellation);
+		FastCgiConnection::Params params;
+
+		const auto env = cgiEnvironment(QFileInfo(localPath).absoluteFilePath());
+
+		for(const auto * variable : env.entries()) {
+			if(!variable) {
+				break;
+			}
+
+			const auto * eq = std::strchr(variable, '=');
+			params.emplace_back(QByteArray(variable, static_cast<int>(eq - variable)), QByteArray(eq + 1));
+		}
+
+		recordAction(WebServerAction::CGI);
+		Metrics::instance().recordCgiLaunch(Metrics::CgiLaunch::FastCgi);
+		m_trace.mark(RequestTrace::Point::CgiLaunched);
+
+		if(!connection->sendBeginRequest(RequestId) || !connection->sendParams(RequestId, params)) {
+			anansiLog(Warning, "failed to send request to FastCGI responder \"" << qPrintable(responderAddress) << "\"");
+			sendError(HttpResponseCode::BadGateway);
+			return;
+		}
+
+		// pass the body on as it arrives from the client; writes to the connection wait for
+		// the responder, so we don't read from the client faster than it consumes it
+		std::array<char, CgiReadBufferSize> bodyBuffer;
+
+		while(true) {
+			const auto bytesRead = readRequestBodyData(bodyBuffer.data(), bodyBuffer.size());
+
+			if(-1 == bytesRead) {
+				connection->sendAbortRequest(RequestId);
+
+				if(!m_cancellation.isCancelled()) {
+					sendError(HttpResponseCode::BadRequest);
+				}
+
+				return;
+			}
+
+			if(!connection->sendStdin(RequestId, QByteArray::fromRawData(bodyBuffer.data(), static_cast<int>(bytesRead)))) {
+				anansiLog(Warning, "failed to send request body to FastCGI responder \"" << qPrintable(responderAddress) << "\"");
+				sendError(HttpResponseCode::BadGateway);
+				return;
+			}
+
+			if(0 == bytesRead) {
+				// the empty record that was just sent marks the end of the body
+				break;
+			}
+		}
+
+		FastCgiResponse response(*connection, RequestId, m_config.cgiTimeout());
+		response.setCancellationToken(&m_cancellation);
+
+		const auto sent = sendCgiResponse(response);
+
+		if(!sent && m_cancellation.isCancelled()) {
+			// tell the responder to stop work on the request; the connection is not reused
+			if(!response.isComplete() || response.wasCancelled()) {
+				connection->sendAbortRequest(RequestId);
+			}
+
+			return;
+		}
+
+		if(!sent && !response.isComplete()) {
+			// abandoned mid-response, the connection can't be reused
+			return;
+		}
+
+		if(!response.standardError().isEmpty()) {
+			anansiLog(Warning, "FastCGI application standard error: " << qPrintable(response.standardError()));
+		}
+
+		if(0 != response.applicationStatus()) {
+			anansiLog(Warning, "FastCGI application returned error status " << response.applicationStatus());
+		}
+
+		connection.setReusable(response.completedCleanly() && connection->isUsable());
+	}
+
+
+	// headers that only describe one connection, so are not passed on (RFC 7230 6.1),
+	// plus any others that the Connection header names as such
+	static std::unordered_set<std::string> hopByHopHeaders(const std::string & connectionHeader) {
+		static const std::regex tokenRx("[^,\\s]+");
+		std::unordered_set<std::string> headers = {"connection", "keep-alive", "proxy-authenticate", "proxy-authorization", "proxy-connection", "te", "trailer", "transfer-encoding", "upgrade"};
+
+		for(auto token = std::sregex_iterator(connectionHeader.cbegin(), connectionHeader.cend(), tokenRx); token != std::sregex_iterator(); ++token) {
+			headers.insert(to_lower(token->str()));
+		}
+
+		return headers;
+	}
+
+
+	void RequestHandler::doProxy(const std::vector<QString> & upstreams) {
+		const QString clientAddr = m_socket->peerAddress().toString();
+
+		// the upstream's response is relayed as it stands rather than re-encoded
+		m_encoder.reset();
+
+		if(upstreams.empty()) {
+			anansiLog(Warning, "no upstream servers configured to proxy \"" << m_requestLine.uri << "\"");
+			recordAction(WebServerAction::Forbid);
+			sendError(HttpResponseCode::Forbidden);
+			return;
+		}
+
+		recordAction(WebServerAction::Proxy);
+		auto & pool = ProxyConnectionPool::instance();
+		auto connection = pool.acquire(upstreams, m_config.proxyConnectionLimit(), m_config.proxyTimeout());
+
+		if(!connection) {
+			anansiLog(Warning, "no upstream server available for \"" << m_requestLine.uri << "\"");
+			sendError(HttpResponseCode::BadGateway);
+			return;
+		}
+
+		const auto upstream = connection->address();
+		const auto timeout = m_config.proxyTimeout();
+		connection->setCancellationToken(&m_cancellation);
+
+		// a failure that is down to the client going away says nothing about the upstream
+		const auto upstreamFailed = [this, &pool, &upstream, &connection]() {
+			if(connection->wasCancelled() || m_cancellation.wasCancelled()) {
+				return;
+			}
+
+			pool.reportFailure(upstream);
+
+			if(ResponseStage::SendingResponse == m_stage) {
+				sendError(HttpResponseCode::BadGateway);
+			}
+		};
+
+		std::string requestHead = m_requestLine.method + ' ' + m_requestLine.uri + " HTTP/1.1\r\n";
+		const auto connectionIt = m_requestHeaders.find("connection");
+		auto dropHeaders = hopByHopHeaders(m_requestHeaders.cend() != connectionIt ? connectionIt->second : std::string());
+		std::string forwardedFor;
+
+		// the body is sent regardless, so the client has no need to hear from the upstream first
+		dropHeaders.insert("expect");
+
+		for(const auto & header : m_requestHeaders) {
+			if(0 != dropHeaders.count(header.first)) {
+				continue;
+			}
+
+			if("x-forwarded-for" == header.first) {
+				forwardedFor = header.second + ", ";
+				continue;
+			}
+
+			requestHead += header.first + ": " + header.second + "\r\n";
+		}
+
+		if(m_requestHeaders.cend() == m_requestHeaders.find("host")) {
+			// HTTP/1.0 clients needn't send one, but it's mandatory upstream
+			requestHead += "host: " + (upstream.startsWith(QStringLiteral("unix:")) ? std::string("localhost") : upstream.toStdString()) + "\r\n";
+		}
+
+		requestHead += "x-forwarded-for: " + forwardedFor + clientAddr.toStdString() + "\r\nx-forwarded-proto: http\r\n\r\n";
+
+		if(!connection->write(requestHead.data(), requestHead.size(), timeout)) {
+			anansiLog(Warning, "failed to send request to upstream server \"" << qPrintable(upstream) << "\"");
+			upstreamFailed();
+			return;
+		}
+
+		// pass the body on as it arrives from the client; writes to the connection wait for
+		// the upstream, so we don't read from the client faster than it consumes it
+		std::array<char, ProxyReadBufferSize> bodyBuffer;
+
+		while(true) {
+			const auto bytesRead = readRequestBodyData(bodyBuffer.data(), bodyBuffer.size());
+
+			if(-1 == bytesRead) {
+				// the upstream has an incomplete request, so the connection is not reused
+				if(!m_cancellation.isCancelled()) {
+					sendError(HttpResponseCode::BadRequest);
+				}
+
+				return;
+			}
+
+			if(0 == bytesRead) {
+				break;
+			}
+
+			if(!connection->write(bodyBuffer.data(), static_cast<std::size_t>(bytesRead), timeout)) {
+				anansiLog(Warning, "failed to send request body to upstream server \"" << qPrintable(upstream) << "\"");
+				upstreamFailed();
+				return;
+			}
+		}
+
+		std::regex statusRx("^HTTP/1\\.([01]) ([1-5][0-9]{2})(?: (.*))?$");
+		std::regex headerRx("^([^\\s:]+)[ \\t]*:[ \\t]*(.*?)[ \\t]*$");
+		std::smatch captures;
+		int responseCode;
+		std::optional<QString> responseTitle;
+		bool upstreamIsHttp10;
+		std::vector<std::pair<std::string, std::string>> responseHeaders;
+
+		// interim 1xx responses (e.g. 100 Continue) are not passed on
+		do {
+			const auto statusLine = connection->readLine(timeout);
+
+			if(!statusLine || !std::regex_match(*statusLine, captures, statusRx)) {
+				anansiLog(Warning, "invalid or missing status line from upstream server \"" << qPrintable(upstream) << "\"");
+				upstreamFailed();
+				return;
+			}
+
+			upstreamIsHttp10 = ("0" == captures.str(1));
+			responseCode = std::stoi(captures.str(2));
+			responseTitle.reset();
+
+			if(captures[3].matched && 0 < captures[3].length()) {
+				responseTitle = QString::fromStdString(captures.str(3));
+			}
+
+			responseHeaders.clear();
+
+			while(true) {
+				const auto headerLine = connection->readLine(timeout);
+
+				if(!headerLine) {
+					anansiLog(Warning, "incomplete headers from upstream server \"" << qPrintable(upstream) << "\"");
+					upstreamFailed();
+					return;
+				}
+
+				if(headerLine->empty()) {
+					break;
+				}
+
+				if(!std::regex_match(*headerLine, captures, headerRx)) {
+					anansiLog(Warning, "invalid header \"" << *headerLine << "\" from upstream server \"" << qPrintable(upstream) << "\"");
+					upstreamFailed();
+					return;
+				}
+
+				responseHeaders.emplace_back(captures.str(1), captures.str(2));
+			}
+		} while(200 > responseCode);
+
+		pool.reportSuccess(upstream);
+
+		std::string connectionHeader;
+		std::optional<uint64_t> contentLength;
+		bool chunked = false;
+		bool hasTransferEncoding = false;
+
+		for(const auto & header : responseHeaders) {
+			const auto name = to_lower(header.first);
+
+			if("connection" == name) {
+				connectionHeader += header.second + ',';
+			}
+			else if("content-length" == name) {
+				contentLength = parse_uint<uint64_t>(header.second.c_str());
+			}
+			else if("transfer-encoding" == name) {
+				hasTransferEncoding = true;
+				chunked = ends_with(to_lower(header.second), std::string("chunked"));
+			}
+		}
+
+		const auto connectionTokens = hopByHopHeaders(connectionHeader);
+		bool upstreamCloses = (0 != connectionTokens.count("close") || (upstreamIsHttp10 && 0 == connectionTokens.count("keep-alive")));
+		const bool hasBody = HttpMethod::Head != m_requestMethod && 204 != responseCode && 304 != responseCode;
+
+		if(hasTransferEncoding && !chunked) {
+			// some other coding, which only the upstream closing the connection can delimit
+			contentLength.reset();
+			upstreamCloses = true;
+		}
+		else if(hasBody && !chunked && !contentLength) {
+			upstreamCloses = true;
+		}
+
+		// the body is re-chunked for HTTP/1.1 clients so they can tell a complete response
+		// from a truncated one; HTTP/1.0 clients just get the data
+		const bool chunkToClient = hasBody && chunked && "1.1" == m_requestLine.httpVersion;
+
+		sendResponseCode(static_cast<HttpResponseCode>(responseCode), responseTitle);
+
+		for(const auto & header : responseHeaders) {
+			const auto name = to_lower(header.first);
+
+			if(0 != connectionTokens.count(name) || (chunked && "content-length" == name)) {
+				continue;
+			}
+
+			sendHeader(header.first, header.second);
+		}
+
+		if(chunkToClient) {
+			sendHeader(QByteArrayLiteral("Transfer-Encoding"), QByteArrayLiteral("chunked"));
+		}
+
+		// the client connection is always closed after the response
+		sendHeader(QByteArrayLiteral("Connection"), QByteArrayLiteral("close"));
+		sendData(EOL);
+		m_stage = ResponseStage::SendingBody;
+		m_trace.mark(RequestTrace::Point::BodyStarted);
+
+		if(!hasBody) {
+			connection.setReusable(!upstreamCloses && connection->isUsable());
+			return;
+		}
+
+		if(!relayProxyBody(*connection, contentLength, chunked)) {
+			anansiLog(Warning, "failed to relay response body from upstream server \"" << qPrintable(upstream) << "\"");
+			upstreamFailed();
+			return;
+		}
+
+		connection.setReusable(!upstreamCloses && connection->isUsable());
+	}
+
+
+	bool RequestHandler::relayProxyBody(ProxyConnection & upstream, const std::optional<uint64_t> & length, bool chunked) {
+		if(!chunked) {
+			// without a length the body runs until the upstream closes the connection
+			return relayProxyData(upstream, length, false);
+		}
+
+		const auto timeout = m_config.proxyTimeout();
+		const bool chunkToClient = ("1.1" == m_requestLine.httpVersion);
+
+		while(true) {
+			const auto sizeLine = upstream.readLine(timeout);
+
+			if(!sizeLine) {
+				return false;
+			}
+
+			// chunk extensions are of no interest
+			const auto size = parse_uint<uint64_t>(sizeLine->substr(0, sizeLine->find(';')).c_str(), 16);
+
+			if(!size) {
+				anansiLog(Warning, "invalid chunk size \"" << *sizeLine << "\"");
+				return false;
+			}
+
+			if(0 == *size) {
+				break;
+			}
+
+			if(!relayProxyData(upstream, *size, chunkToClient)) {
+				return false;
+			}
+
+			// each chunk's data is followed by an empty line
+			if(const auto chunkEnd = upstream.readLine(timeout); !chunkEnd || !chunkEnd->empty()) {
+				return false;
+			}
+		}
+
+		// trailers are dropped
+		while(true) {
+			const auto trailer = upstream.readLine(timeout);
+
+			if(!trailer) {
+				return false;
+			}
+
+			if(trailer->empty()) {
+				break;
+			}
+		}
+
+		return !chunkToClient || sendData(QByteArrayLiteral("0\r\n\r\n"));
+	}
+
+
+	bool RequestHandler::relayProxyData(ProxyConnection & upstream, std::optional<uint64_t> size, bool chunk) {
+		std::array<char, ProxyReadBufferSize> readBuffer;
+		const auto timeout = m_config.proxyTimeout();
+
+		// reading only as fast as the client accepts keeps the upstream's output in its
+		// socket buffers rather than piling up here
+		while(!size || 0 < *size) {
+			const auto maxSize = (size ? std::min<uint64_t>(*size, readBuffer.size()) : readBuffer.size());
+			const auto bytesRead = upstream.read(readBuffer.data(), static_cast<qint64>(maxSize), timeout);
+
+			if(-1 == bytesRead) {
+				return false;
+			}
+
+			if(0 == bytesRead) {
+				// closing is only a valid end to a body that has no length
+				return !size;
+			}
+
+			if(size) {
+				*size -= static_cast<uint64_t>(bytesRead);
+			}
+
+			const auto data = QByteArray::fromRawData(readBuffer.data(), static_cast<int>(bytesRead));
+
+			if(chunk ? !sendData(QByteArray::number(static_cast<int>(bytesRead), 16) % EOL % data % EOL) : !sendData(data)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	// the request as a handler module sees it; everything it hands out refers to the
+	// RequestHandler's own copy
+	class RequestHandler::ModuleRequest final : public Module::Request {
+	public:
+		ModuleRequest(RequestHandler & handler, const QString & localPath, const QString & mediaType)
+		: m_handler(handler),
+		  m_clientAddress(handler.m_socket->peerAddress().toString().toStdString()),
+		  m_clientPort(handler.m_socket->peerPort()),
+		  m_localPath(localPath.toStdString()),
+		  m_mediaType(mediaType.toStdString()) {
+		}
+
+		const std::string & method() const override {
+			return m_handler.m_requestLine.method;
+		}
+
+		const std::string & uri() const override {
+			return m_handler.m_requestLine.uri;
+		}
+
+		const std::string & path() const override {
+			return m_handler.m_requestUri.path;
+		}
+
+		const std::string & query() const override {
+			return m_handler.m_requestUri.query;
+		}
+
+		const std::string & httpVersion() const override {
+			return m_handler.m_requestLine.httpVersion;
+		}
+
+		const std::string * header(const std::string & name) const override {
+			const auto headerIt = m_handler.m_requestHeaders.find(name);
+
+			if(m_handler.m_requestHeaders.cend() == headerIt) {
+				return nullptr;
+			}
+
+			return &headerIt->second;
+		}
+
+		const std::string & clientAddress() const override {
+			return m_clientAddress;
+		}
+
+		uint16_t clientPort() const override {
+			return m_clientPort;
+		}
+
+		const std::string & localPath() const override {
+			return m_localPath;
+		}
+
+		const std::string & mediaType() const override {
+			return m_mediaType;
+		}
+
+		std::size_t bodyLength() const override {
+			return static_cast<std::size_t>(m_handler.m_requestBodyLength);
+		}
+
+		int64_t readBody(char * data, std::size_t maxSize) override {
+			return m_handler.readRequestBodyData(data, static_cast<qint64>(std::min<std::size_t>(maxSize, std::numeric_limits<int>::max())));
+		}
+
+	private:
+		RequestHandler & m_handler;
+		std::string m_clientAddress;
+		uint16_t m_clientPort;
+		std::string m_localPath;
+		std::string m_mediaType;
+	};
+
+
+	// holds the status and headers a handler module sets until there is body content
+	// to send, or the handler returns
+	class RequestHandler::ModuleResponse final : public Module::Response {
+	public:
+		explicit ModuleResponse(RequestHandler & handler)
+		: m_handler(handler),
+		  m_status(HttpResponseCode::Ok),
+		  m_headersSent(false) {
+		}
+
+		bool setStatus(int code, const std::string & reason) override {
+			if(m_headersSent || 200 > code || 599 < code || std::string::npos != reason.find_first_of("\r\n")) {
+				return false;
+			}
+
+			m_status = static_cast<HttpResponseCode>(code);
 
-			if(cgiCommandLine.isEmpty()) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: CGI processor \"" << qPrintable(m_config.mediaTypeCgi(mediaType)) << "\" for CGI script (\"" << m_requestLine.uri << "\", media type " << qPrintable(mediaType) << ") not found\n";
-				Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
-				sendError(HttpResponseCode::Forbidden);
-				return;
+			if(reason.empty()) {
+				m_reason.reset();
+			}
+			else {
+				m_reason = QString::fromStdString(reason);
 			}
 
-			cgiCommandLine += QStringLiteral(" \"") % localPath % '\"';
-			auto localPathInfo = QFileInfo(localPath);
-			cgiWorkingDir = localPathInfo.absolutePath();
-			envScriptFileName = localPathInfo.absoluteFilePath();
+			return true;
 		}
 
-		// cgiCommandLine is now fully-resolved path to executable with script as path if necessary
-
-		QStringList env = {QStringLiteral("GATEWAY_INTERFACE=CGI/1.1"),
-								 QStringLiteral("REDIRECT_STATUS=1"),  // non-standard, but since 5.3 is required to make PHP happy
-								 QStringLiteral("REMOTE_ADDR=") % clientAddr,
-								 QStringLiteral("REMOTE_PORT=") % QString::number(clientPort),
-								 QStringLiteral("REQUEST_METHOD=") % QString::fromStdString(m_requestLine.method),
-								 QStringLiteral("REQUEST_URI=") % QString::fromStdString(m_requestLine.uri),
-								 QStringLiteral("SCRIPT_NAME=") % QString::fromStdString(m_requestUri.path),
-								 QStringLiteral("SCRIPT_FILENAME=") % envScriptFileName,
-								 QStringLiteral("SERVER_NAME=") % m_config.listenAddress(),
-								 QStringLiteral("SERVER_ADDR=") % m_config.listenAddress(),
-								 QStringLiteral("SERVER_PORT=") % QString::number(m_config.port()),
-								 QStringLiteral("DOCUMENT_ROOT=") % docRoot.absoluteFilePath(),
-								 QStringLiteral("SERVER_PROTOCOL=HTTP/") % QString::fromStdString(m_requestLine.httpVersion),
-								 QStringLiteral("SERVER_SOFTWARE=") % qApp->applicationName() % QStringLiteral(" v") % qApp->applicationVersion(),
-								 QStringLiteral("SERVER_SIGNATURE=AnansiRequestHandler on ") % m_config.listenAddress() % QStringLiteral(" port ") % QString::number(m_config.port()),
-								 QStringLiteral("SERVER_ADMIN=") % m_config.administratorEmail()};
+		bool setHeader(const std::string & name, const std::string & value) override {
+			// a line break would let the module inject headers of its own making
+			if(m_headersSent || name.empty() || std::string::npos != name.find_first_of(":\r\n") || std::string::npos != value.find_first_of("\r\n")) {
+				return false;
+			}
 
-		if(!m_requestUri.query.empty()) {
-			env.push_back(QStringLiteral("QUERY_STRING=") % QString::fromStdString(m_requestUri.query));
-		}
+			const auto lowerName = to_lower(name);
 
-		const auto contentTypeIter = m_requestHeaders.find("content-type");
+			if("date" == lowerName || ("content-length" == lowerName && ContentEncoding::Identity != m_handler.m_responseEncoding)) {
+				// the server sends the date, and the module's length is for the unencoded body
+				return true;
+			}
 
-		if(m_requestHeaders.cend() != contentTypeIter) {
-			env.push_back(QStringLiteral("CONTENT_TYPE=") % QString::fromStdString(contentTypeIter->second));
-			env.push_back(QStringLiteral("CONTENT_LENGTH=") % QString::number(m_requestBody.size()));
+			m_headers.emplace_back(name, value);
+			return true;
 		}
 
-		// put the HTTP headers into the CGI environment
-		for(const auto & header : m_requestHeaders) {
-			env.push_back(QStringLiteral("HTTP_") % QString::fromStdString(header.first).replace('-', '_').toUpper() % "=" % header.second.data());
+		bool write(const char * data, std::size_t size) override {
+			if(!m_headersSent && !sendHeaders()) {
+				return false;
+			}
+
+			if(HttpMethod::Head == m_handler.m_requestMethod) {
+				return true;
+			}
+
+			while(0 < size) {
+				const auto chunkSize = static_cast<int>(std::min<std::size_t>(size, std::numeric_limits<int>::max()));
+
+				// writes block while the client is behind and fail once it has gone
+				if(!m_handler.sendBody(QByteArray::fromRawData(data, chunkSize))) {
+					return false;
+				}
+
+				data += chunkSize;
+				size -= static_cast<std::size_t>(chunkSize);
+			}
+
+			return true;
 		}
 
-		QProcess cgiProcess;
+		bool headersSent() const override {
+			return m_headersSent;
+		}
 
-		// ensure CGI process is closed on all exit paths
-#if defined(_MSC_VER)
-		// MSVC doesn't do class template argument deduction (yet?)
-		auto scopeGuardFunction = [&cgiProcess]() {
-			cgiProcess.close();
-		};
-		ScopeGuard<decltype(scopeGuardFunction)> cgiProcessGuard(scopeGuardFunction);
-#else
-		ScopeGuard cgiProcessGuard = [&cgiProcess]() {
-			cgiProcess.close();
-		};
-#endif
-		cgiProcess.setEnvironment(env);
-		cgiProcess.setWorkingDirectory(cgiWorkingDir);
-		Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::CGI);
-		cgiProcess.start(cgiCommandLine, QIODevice::ReadWrite);
+		bool isCancelled() override {
+			return m_handler.m_cancellation.isCancelled();
+		}
 
-		if(!cgiProcess.waitForStarted(m_config.cgiTimeout())) {
-			if(QProcess::Timedout == cgiProcess.error()) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Timeout waiting for CGI process to start.\n";
-				sendError(HttpResponseCode::RequestTimeout);
+		// sends whatever the handler didn't
+		bool finish() {
+			if(!m_headersSent && !sendHeaders()) {
+				return false;
 			}
-			else {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Error starting CGI process: \"" << qPrintable(cgiProcess.errorString()) << "\".\n";
-				sendError(HttpResponseCode::InternalServerError);
+
+			if(ResponseStage::SendingBody != m_handler.m_stage) {
+				// no body - the headers still need terminating
+				return m_handler.sendBody(QByteArray());
 			}
 
-			return;
+			return true;
 		}
 
-		if(!cgiProcess.waitForFinished(m_config.cgiTimeout())) {
-			if(QProcess::Timedout == cgiProcess.error()) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Timeout waiting for CGI process to complete.\n";
-				sendError(HttpResponseCode::RequestTimeout);
+	private:
+		bool sendHeaders() {
+			m_headersSent = true;
+
+			if(!m_handler.sendResponseCode(m_status, m_reason) || !m_handler.sendDateHeader() || !m_handler.sendHeaders(m_handler.m_encoder->headers())) {
+				return false;
 			}
-			else {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Error in CGI process: \"" << qPrintable(cgiProcess.errorString()) << "\".\n";
-				sendError(HttpResponseCode::InternalServerError);
+
+			for(const auto & header : m_headers) {
+				if(!m_handler.sendHeader(header.first, header.second)) {
+					return false;
+				}
 			}
 
+			return true;
+		}
+
+		RequestHandler & m_handler;
+		HttpResponseCode m_status;
+		std::optional<QString> m_reason;
+		std::vector<std::pair<std::string, std::string>> m_headers;
+		bool m_headersSent;
+	};
+
+
+	void RequestHandler::doModule(const QString & localPath, const QString & mediaType) {
+		const auto modulePath = m_config.mediaTypeModule(mediaType);
+
+		if(modulePath.isEmpty()) {
+			anansiLog(Warning, "no handler module set for \"" << m_requestLine.uri << "\" (media type: " << qPrintable(mediaType) << ")");
+			recordAction(WebServerAction::Forbid);
+			sendError(HttpResponseCode::Forbidden);
 			return;
 		}
 
-		cgiProcess.waitForReadyRead();
+		auto * handler = ModuleLoader::instance().handler(modulePath);
 
-		if(0 != cgiProcess.exitCode()) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: CGI process returned error status " << cgiProcess.exitCode() << "\n";
-			std::cerr << qPrintable(cgiProcess.readAllStandardError()) << "\n";
+		if(!handler) {
+			anansiLog(Warning, "handler module \"" << qPrintable(modulePath) << "\" is not available");
+			recordAction(WebServerAction::Forbid);
+			sendError(HttpResponseCode::InternalServerError);
+			return;
 		}
 
-		std::string headerData;
-		std::regex headerRx("^([a-zA-Z][a-zA-Z\\-]*) *: *(.+)$");
+		recordAction(WebServerAction::Module);
+		ModuleRequest request(*this, localPath, mediaType);
+		ModuleResponse response(*this);
 
-		while(true) {
-			auto headerLine = readHeaderLine(cgiProcess);
+		// the module runs on this thread, so an exception it doesn't handle would otherwise
+		// take the whole server down
+		try {
+			handler->handle(request, response);
+		}
+		catch(const std::exception & err) {
+			anansiLog(Error, "handler module \"" << qPrintable(modulePath) << "\" threw an exception (\"" << err.what() << "\")");
 
-			if(!headerLine) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI output - invalid header\n";
+			if(!response.headersSent()) {
+				sendError(HttpResponseCode::InternalServerError);
 			}
 
-			if(headerLine->empty()) {
-				// all headers read
-				break;
-			}
+			return;
+		}
+		catch(...) {
+			anansiLog(Error, "handler module \"" << qPrintable(modulePath) << "\" threw an exception");
 
-			if(!std::regex_match(*headerLine, headerRx)) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid CGI output (invalid header \"" << *headerLine << "\")\n";
+			if(!response.headersSent()) {
 				sendError(HttpResponseCode::InternalServerError);
-				return;
 			}
 
-			headerData.append(*headerLine);
-			headerData.append(EOL);
+			return;
 		}
 
-		sendResponseCode(HttpResponseCode::Ok);
-		sendHeaders(m_encoder->headers());
-		sendDateHeader();
-		sendData(QByteArray::fromStdString(headerData));
-		sendBody(cgiProcess);
+		if(!response.finish() && !m_cancellation.wasCancelled()) {
+			anansiLog(Debug, "failed to send response from handler module \"" << qPrintable(modulePath) << "\"");
+		}
 	}
 
 
-	ConnectionPolicy RequestHandler::determineConnectionPolicy() const {
-		QString clientAddress = m_socket->peerAddress().toString();
-		uint16_t clientPort = m_socket->peerPort();
-		Q_EMIT handlingRequestFrom(clientAddress, clientPort);
-		ConnectionPolicy policy = m_config.ipAddressConnectionPolicy(clientAddress);
-		Q_EMIT requestConnectionPolicyDetermined(clientAddress, clientPort, policy);
+	ConnectionPolicy RequestHandler::determineConnectionPolicy() {
+		ConnectionPolicy policy = m_config.ipAddressConnectionPolicy(m_socket->peerAddress());
+
+		if(m_events) {
+			m_events->pushPolicy(policy);
+		}
 
 		switch(policy) {
 			case ConnectionPolicy::Accept:
-				Q_EMIT acceptedRequestFrom(clientAddress, clientPort);
+				m_counters->connectionAccepted();
+				recordEvent(RequestEvent::Type::ConnectionAccepted);
 				break;
 
 			case ConnectionPolicy::None:
 			case ConnectionPolicy::Reject:
-				Q_EMIT rejectedRequestFrom(clientAddress, clientPort, tr("Policy for this IP address is Reject"));
+				m_counters->connectionRejected();
+				recordEvent(RequestEvent::Type::ConnectionRejected);
 				break;
 		}
 
@@ -1162,17 +2610,19 @@ namespace Anansi {
 			auto headerLine = readHeaderLine(*m_socket);
 
 			if(!headerLine) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request (invalid header)\n";
+				anansiLog(Debug, "invalid HTTP request (invalid header)");
 				return false;
 			}
 
+			m_requestBytes += headerLine->size() + 2;
+
 			if(headerLine->empty()) {
 				// all headers read
 				break;
 			}
 
 			if(!std::regex_match(*headerLine, captures, headerRx)) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request (invalid header \"" << *headerLine << "\")\n";
+				anansiLog(Debug, "invalid HTTP request (invalid header \"" << *headerLine << "\")");
 				return false;
 			}
 
@@ -1198,61 +2648,203 @@ namespace Anansi {
 	}
 
 
-	bool RequestHandler::readRequestBody(std::optional<int> contentLength) {
-		eqAssert(!contentLength || 0 < *contentLength, "invalid content length (" << (contentLength ? std::to_string(*contentLength) : "[empty]") << ")");
-		std::array<char, ReadBufferSize> readBuffer;
-		int consecutiveTimeoutCount = 0;
-		m_requestBody.clear();
-
-		if(contentLength && m_requestBody.capacity() < static_cast<std::string::size_type>(*contentLength)) {
-			m_requestBody.reserve(static_cast<std::string::size_type>(*contentLength));
+	bool RequestHandler::readRequestBody() {
+		if(m_requestBody) {
+			return m_requestBody->seek(0);
 		}
 
-		while((!contentLength || 0 < *contentLength) && !m_socket->atEnd()) {
-			auto bytesRead = m_socket->read(&readBuffer[0], readBuffer.size());
+		std::unique_ptr<QIODevice> body = std::make_unique<QBuffer>();
+		body->open(QIODevice::ReadWrite);
+		bool inMemory = true;
+		std::array<char, ReadBufferSize> readBuffer;
+
+		while(true) {
+			const auto bytesRead = readRequestBodyData(readBuffer.data(), readBuffer.size());
 
 			if(-1 == bytesRead) {
-				if(QAbstractSocket::SocketTimeoutError != m_socket->error()) {
-					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: error reading body data from socket (" << qPrintable(m_socket->errorString()) << ")\n";
-					return {};
-				}
+				return false;
+			}
+
+			if(0 == bytesRead) {
+				break;
+			}
 
-				++consecutiveTimeoutCount;
+			if(inMemory && m_config.requestBodyMemoryLimit() < body->size() + bytesRead) {
+				// too big to keep in memory, move what we have so far to a temporary file
+				auto file = std::make_unique<QTemporaryFile>();
 
-				if(MaxReadErrorCount < consecutiveTimeoutCount) {
-					std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: too many timeouts attempting to read request body\n";
-					return {};
+				if(!file->open()) {
+					anansiLog(Error, "failed to create temporary file for request body (\"" << qPrintable(file->errorString()) << "\")");
+					return false;
+				}
+
+				if(-1 == file->write(static_cast<QBuffer *>(body.get())->data())) {
+					anansiLog(Error, "failed to write request body to temporary file (\"" << qPrintable(file->errorString()) << "\")");
+					return false;
 				}
+
+				body = std::move(file);
+				inMemory = false;
 			}
-			else {
-				if(contentLength) {
-					*contentLength -= bytesRead;
+
+			if(bytesRead != body->write(readBuffer.data(), bytesRead)) {
+				anansiLog(Error, "failed to store request body (\"" << qPrintable(body->errorString()) << "\")");
+				return false;
+			}
+		}
+
+		body->seek(0);
+		m_requestBody = std::move(body);
+		return true;
+	}
+
+
+	qint64 RequestHandler::readRequestBodyData(char * data, qint64 maxSize) {
+		if(m_requestBody) {
+			return m_requestBody->read(data, maxSize);
+		}
+
+		if(0 == m_requestBodyUnread) {
+			if(!m_requestBodyChunked) {
+				return 0;
+			}
+
+			if(!readRequestBodyChunkHeader()) {
+				return -1;
+			}
+
+			if(0 == m_requestBodyUnread) {
+				// the last chunk
+				return 0;
+			}
+		}
+
+		const auto readStartedAt = Metrics::Clock::now();
+		int consecutiveTimeoutCount = 0;
+
+		while(0 == m_socket->bytesAvailable()) {
+			if(m_socket->waitForReadyRead(3000)) {
+				continue;
+			}
+
+			if(QAbstractSocket::SocketTimeoutError != m_socket->error()) {
+				anansiLog(Debug, "error reading body data from socket while still expecting " << m_requestBodyUnread << " bytes (\"" << qPrintable(m_socket->errorString()) << "\")");
+
+				if(QAbstractSocket::RemoteHostClosedError == m_socket->error()) {
+					m_cancellation.cancel();
 				}
 
-				m_requestBody.append(&readBuffer[0], static_cast<std::string::size_type>(bytesRead));
-				consecutiveTimeoutCount = 0;
+				return -1;
+			}
+
+			++consecutiveTimeoutCount;
+
+			if(MaxReadErrorCount < consecutiveTimeoutCount) {
+				anansiLog(Debug, "too many timeouts attempting to read request body");
+				return -1;
+			}
+		}
+
+		const auto bytesRead = m_socket->read(data, qMin(maxSize, static_cast<qint64>(m_requestBodyUnread)));
+
+		if(-1 == bytesRead) {
+			anansiLog(Debug, "error reading body data from socket (\"" << qPrintable(m_socket->errorString()) << "\")");
+			return -1;
+		}
+
+		m_requestBodyUnread -= static_cast<int>(bytesRead);
+		m_requestBodyReadTime += Metrics::Clock::now() - readStartedAt;
+		m_requestBytes += static_cast<uint64_t>(bytesRead);
+
+		// each chunk's data is followed by an empty line
+		if(m_requestBodyChunked && 0 == m_requestBodyUnread) {
+			const auto chunkEnd = readHeaderLine(*m_socket);
+
+			if(!chunkEnd || !chunkEnd->empty()) {
+				anansiLog(Debug, "invalid chunked request body (missing CRLF after chunk data)");
+				return -1;
 			}
+
+			m_requestBytes += 2;
+		}
+		else if(!m_requestBodyChunked && 0 == m_requestBodyUnread) {
+			m_cancellation.requestReceived();
+		}
+
+		return bytesRead;
+	}
+
+
+	// reads the size line for the next chunk of a chunked request body into
+	// m_requestBodyUnread. the last chunk has size 0; its trailers are read and dropped and
+	// the body is then complete
+	bool RequestHandler::readRequestBodyChunkHeader() {
+		const auto sizeLine = readHeaderLine(*m_socket);
+
+		if(!sizeLine) {
+			anansiLog(Debug, "invalid chunked request body (failed to read chunk size)");
+			return false;
+		}
+
+		m_requestBytes += sizeLine->size() + 2;
+
+		// chunk extensions are of no interest
+		const auto size = parse_uint<uint64_t>(sizeLine->substr(0, sizeLine->find(';')).c_str(), 16);
+
+		if(!size) {
+			anansiLog(Debug, "invalid chunked request body (invalid chunk size \"" << *sizeLine << "\")");
+			return false;
 		}
 
-		if(contentLength && 0 < *contentLength) {
-			// not enough body data
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: socket stopped providing data while still expecting " << *contentLength << " bytes (\"" << qPrintable(m_socket->errorString()) << "\")\n";
+		if(static_cast<uint64_t>(std::numeric_limits<int>::max() - m_requestBodyLength) < *size) {
+			anansiLog(Debug, "chunked request body is too large");
 			return false;
 		}
 
-		if(!m_socket->atEnd() || (contentLength && 0 > *contentLength)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: socket provided more body data than expected\n";
+		if(0 < *size) {
+			m_requestBodyLength += static_cast<int>(*size);
+			m_requestBodyUnread = static_cast<int>(*size);
+			return true;
+		}
+
+		while(true) {
+			const auto trailer = readHeaderLine(*m_socket);
+
+			if(!trailer) {
+				anansiLog(Debug, "invalid chunked request body (failed to read trailer)");
+				return false;
+			}
+
+			m_requestBytes += trailer->size() + 2;
+
+			if(trailer->empty()) {
+				break;
+			}
 		}
 
+		m_requestBodyChunked = false;
+		m_cancellation.requestReceived();
 		return true;
 	}
 
 
+	void RequestHandler::discardRequestBody() {
+		if(!m_socket || QAbstractSocket::ConnectedState != m_socket->state()) {
+			return;
+		}
+
+		std::array<char, ReadBufferSize> readBuffer;
+
+		while(0 < readRequestBodyData(readBuffer.data(), readBuffer.size())) {
+		}
+	}
+
+
 	std::optional<RequestHandler::HttpRequestLine> RequestHandler::parseHttpRequestLine(const std::string & requestLine) {
 		std::smatch captures;
 
 		if(!std::regex_match(requestLine, captures, std::regex("^(OPTIONS|GET|HEAD|POST|PUT|DELETE|TRACE|CONNECT) ([^ ]+) HTTP/([0-9](?:\\.[0-9]+)*)$"))) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request line \"" << requestLine << "\"\n";
+			anansiLog(Debug, "invalid HTTP request line \"" << requestLine << "\"");
 			return {};
 		}
 
@@ -1261,18 +2853,58 @@ namespace Anansi {
 
 
 	void RequestHandler::run() {
+		m_receivedAt = QDateTime::currentMSecsSinceEpoch();
+		m_trace.mark(RequestTrace::Point::Received);
+		Metrics::instance().connectionOpened();
+
 		// scope guard does all cleanup on all exit paths
 #if defined(_MSC_VER)
 		// MSVC doesn't do class template argument deduction (yet?)
 		auto cleanupFunction = [this]() {
 			m_socket->flush();
+			m_trace.mark(RequestTrace::Point::Completed);
+
+			// only counts if noticed while the request was being worked on - a client is free
+			// to close once it has the whole response
+			if(m_cancellation.wasCancelled()) {
+				anansiLog(Debug, "client disconnected before the response was complete");
+				recordEvent(RequestEvent::Type::Cancelled);
+				m_counters->requestCancelled();
+			}
+			else {
+				// closing with unread data can cause the peer to discard the response
+				discardRequestBody();
+			}
+
+			writeAccessLog();
+			recordMetrics();
+			RequestTraceWriter::instance().submit(m_trace, m_requestLine.method, m_requestLine.uri, m_responseStatus);
 			disposeSocket();
+			Metrics::instance().connectionClosed();
 		};
 		ScopeGuard<decltype(cleanupFunction)> cleanup(cleanupFunction);
 #else
 		ScopeGuard cleanup = [this]() {
 			m_socket->flush();
+			m_trace.mark(RequestTrace::Point::Completed);
+
+			// only counts if noticed while the request was being worked on - a client is free
+			// to close once it has the whole response
+			if(m_cancellation.wasCancelled()) {
+				anansiLog(Debug, "client disconnected before the response was complete");
+				recordEvent(RequestEvent::Type::Cancelled);
+				m_counters->requestCancelled();
+			}
+			else {
+				// closing with unread data can cause the peer to discard the response
+				discardRequestBody();
+			}
+
+			writeAccessLog();
+			recordMetrics();
+			RequestTraceWriter::instance().submit(m_trace, m_requestLine.method, m_requestLine.uri, m_responseStatus);
 			disposeSocket();
+			Metrics::instance().connectionClosed();
 		};
 #endif
 
@@ -1282,17 +2914,19 @@ namespace Anansi {
 		}
 
 		if(auto requestLine = readHeaderLine(*m_socket); !requestLine) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request (failed to read request line)\n";
+			anansiLog(Debug, "invalid HTTP request (failed to read request line)");
 			sendError(HttpResponseCode::BadRequest);
 			return;
 		}
 		else if(auto parsedRequestLine = parseHttpRequestLine(*requestLine); !parsedRequestLine) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request (failed to parse request line)\n";
+			anansiLog(Debug, "invalid HTTP request (failed to parse request line)");
 			sendError(HttpResponseCode::BadRequest);
 			return;
 		}
 		else {
+			m_requestBytes += requestLine->size() + 2;
 			m_requestLine = std::move(*parsedRequestLine);
+			m_trace.mark(RequestTrace::Point::RequestLineRead);
 		}
 
 		// safe to deref optional without checking because RX in parseHttpRequestLine()
@@ -1304,21 +2938,64 @@ namespace Anansi {
 			return;
 		}
 
-		std::optional<int> contentLength;
+		m_trace.mark(RequestTrace::Point::HeadersRead);
 
 		if(const auto contentLengthIt = m_requestHeaders.find("content-length"); contentLengthIt != m_requestHeaders.cend()) {
-			contentLength = parseContentLengthValue(contentLengthIt->second);
+			const auto contentLength = parseContentLengthValue(contentLengthIt->second);
 
 			if(!contentLength) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: invalid HTTP request (invalid content-length header)\n";
+				anansiLog(Debug, "invalid HTTP request (invalid content-length header)");
 				sendError(HttpResponseCode::BadRequest);
 				return;
 			}
+
+			// the body is read on demand so that it can be streamed to where it's needed
+			m_requestBodyLength = *contentLength;
+			m_requestBodyUnread = *contentLength;
 		}
 
-		if(!readRequestBody(contentLength)) {
-			sendError(HttpResponseCode::BadRequest);
-			return;
+		if(const auto transferEncodingIt = m_requestHeaders.find("transfer-encoding"); transferEncodingIt != m_requestHeaders.cend()) {
+			auto transferEncoding = to_lower(transferEncodingIt->second);
+
+			while(!transferEncoding.empty() && std::isspace(static_cast<unsigned char>(transferEncoding.back()))) {
+				transferEncoding.pop_back();
+			}
+
+			// chunked is the only transfer coding we can decode
+			if("chunked" != transferEncoding) {
+				anansiLog(Debug, "unsupported transfer-encoding \"" << transferEncodingIt->second << "\" for request body");
+				sendError(HttpResponseCode::NotImplemented);
+				return;
+			}
+
+			// the two would disagree about where the body ends, which is how requests get
+			// smuggled past one server to another (RFC 7230 3.3.3)
+			if(m_requestHeaders.cend() != m_requestHeaders.find("content-length")) {
+				anansiLog(Debug, "invalid HTTP request (both content-length and transfer-encoding headers)");
+				sendError(HttpResponseCode::BadRequest);
+				return;
+			}
+
+			// the body is decoded up front, spilling to a temporary file if it's large, so
+			// that everything that consumes it (CGI, FastCGI, proxying) gets a plain body of
+			// known length
+			m_requestBodyChunked = true;
+
+			if(!readRequestBody()) {
+				if(!m_cancellation.wasCancelled()) {
+					sendError(HttpResponseCode::BadRequest);
+				}
+
+				return;
+			}
+
+			m_requestHeaders.erase(transferEncodingIt);
+			m_requestHeaders.insert_or_assign("content-length", std::to_string(m_requestBodyLength));
+		}
+
+		// from here on the client closing its end means it has gone
+		if(0 == m_requestBodyUnread && !m_requestBodyChunked) {
+			m_cancellation.requestReceived();
 		}
 
 		handleHttpRequest();
@@ -1330,38 +3007,60 @@ namespace Anansi {
 
 		// will accept anything up to HTTP/1.1 and process it as HTTP/1.1
 		if("1.0" != m_requestLine.httpVersion && "1.1" != m_requestLine.httpVersion) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: HTTP version (HTTP/" << m_requestLine.httpVersion << ") is not supported\n";
+			anansiLog(Debug, "HTTP version (HTTP/" << m_requestLine.httpVersion << ") is not supported");
 			sendError(HttpResponseCode::HttpVersionNotSupported);
 			return;
 		}
 
-		// covers the REQUIRED HTTP/1.1 methods (GET, HEAD).
-		if(HttpMethod::Get != m_requestMethod && HttpMethod::Head != m_requestMethod && HttpMethod::Post != m_requestMethod) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: Request method " << enumeratorString(m_requestMethod) << " not supported\n";
-			sendError(HttpResponseCode::NotImplemented);
-			return;
-		}
-
 		std::regex rxUri("^([^?#]*)(?:\\?([^#]+))?(?:#(.*))?$");
 		std::smatch captures;
 
 		if(!std::regex_match(m_requestLine.uri, captures, rxUri)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed parsing request URI \"" << m_requestLine.uri << "\"\n";
+			anansiLog(Debug, "failed parsing request URI \"" << m_requestLine.uri << "\"");
 			sendError(HttpResponseCode::BadRequest);
 			return;
 		}
 
 		// we should never receive a fragment, should we?
 		m_requestUri = {percent_decode(captures[1].str()), captures[2], captures[3]};
+
+		if(StatusPath == m_requestUri.path && m_config.statusEndpointEnabled()) {
+			markResolved();
+			sendStatus();
+			return;
+		}
+
+		// proxy routes go by path alone, and the upstream decides which methods it supports
+		if(HttpMethod::Connect != m_requestMethod && HttpMethod::Trace != m_requestMethod) {
+			if(const auto upstreams = m_config.proxyUpstreamsForPath(QString::fromStdString(m_requestUri.path)); !upstreams.empty()) {
+				markResolved();
+				doProxy(upstreams);
+				m_stage = ResponseStage::Completed;
+				return;
+			}
+		}
+
+		// covers the REQUIRED HTTP/1.1 methods (GET, HEAD).
+		if(HttpMethod::Get != m_requestMethod && HttpMethod::Head != m_requestMethod && HttpMethod::Post != m_requestMethod) {
+			anansiLog(Debug, "Request method " << enumeratorString(m_requestMethod) << " not supported");
+			sendError(HttpResponseCode::NotImplemented);
+			return;
+		}
 		const auto & md5It = m_requestHeaders.find("content-md5");
 
 		if(md5It != m_requestHeaders.cend()) {
+			if(!readRequestBody()) {
+				sendError(HttpResponseCode::BadRequest);
+				return;
+			}
+
 			QCryptographicHash hash(QCryptographicHash::Md5);
-			hash.addData(m_requestBody.data(), static_cast<int>(m_requestBody.size()));
+			hash.addData(m_requestBody.get());
+			m_requestBody->seek(0);
 
 			if(md5It->second != hash.result().toHex().constData()) {
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: calculated MD5 of request body does not match Content-MD5 header\n";
-				std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: calculated:" << hash.result().toHex().constData() << "; header:" << md5It->second << "\n";
+				anansiLog(Debug, "calculated MD5 of request body does not match Content-MD5 header");
+				anansiLog(Debug, "calculated:" << hash.result().toHex().constData() << "; header:" << md5It->second);
 				// I think this is the correct response for this error case
 				sendError(HttpResponseCode::BadRequest);
 			}
@@ -1375,26 +3074,23 @@ namespace Anansi {
 
 		// only serve request from inside doc root
 		if(!starts_with(resolvedResourcePath, docRoot.absoluteFilePath())) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: requested local resource is outside document root.\n";
+			anansiLog(Info, "requested local resource is outside document root.");
 			sendError(HttpResponseCode::NotFound);
 			return;
 		}
 
-		const QString clientAddr = m_socket->peerAddress().toString();
-		const uint16_t clientPort = m_socket->peerPort();
-
 #if defined(_MSC_VER)
 		// MSVC doesn't do class template argument deduction (yet?)
 		auto finishSendingBodyFunction = [this]() {
 			if(m_encoder) {
-				m_encoder->finishEncoding(*m_socket);
+				m_encoder->finishEncoding(*m_out);
 			}
 		};
 		ScopeGuard<decltype(finishSendingBodyFunction)> finishSendingBody(finishSendingBodyFunction);
 #else
 		ScopeGuard finishSendingBody = [this]() {
 			if(m_encoder) {
-				m_encoder->finishEncoding(*m_socket);
+				m_encoder->finishEncoding(*m_out);
 			}
 		};
 #endif
@@ -1417,11 +3113,13 @@ namespace Anansi {
 
 		if(!m_encoder) {
 			const auto acceptIt = m_requestHeaders.find("accept-encoding");
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to find a suitable content encoder (accept-encoding: " << (m_requestHeaders.cend() != acceptIt ? acceptIt->second : "<not specified>") << "\n";
+			anansiLog(Debug, "failed to find a suitable content encoder (accept-encoding: " << (m_requestHeaders.cend() != acceptIt ? acceptIt->second : "<not specified>"));
 			sendError(HttpResponseCode::NotAcceptable, tr("No supported, acceptable content-encoding could be determined."));
 			return;
 		}
 
+		markResolved();
+
 		if(resource.isDir()) {
 			sendDirectoryListing(resolvedResourcePath);
 			m_stage = ResponseStage::Completed;
@@ -1436,32 +3134,41 @@ namespace Anansi {
 			suffix = "";
 		}
 
-		// NEXTRELEASE support fcgi
-		for(const auto & mediaType : m_config.fileExtensionMediaTypes(suffix)) {
-			switch(m_config.mediaTypeAction(mediaType)) {
+		if(const auto * route = m_routes.route(suffix)) {
+			switch(route->action) {
 				case WebServerAction::Ignore:
-					// just try the next media type for the resource
+					// never compiled into a route
 					break;
 
 				case WebServerAction::Serve:
-					sendFile(resolvedResourcePath, mediaType);
+					sendFile(resolvedResourcePath, route->mediaType);
 					m_stage = ResponseStage::Completed;
 					return;
 
 				case WebServerAction::CGI:
-					doCgi(resolvedResourcePath, mediaType);
+					doCgi(resolvedResourcePath, route->mediaType);
 					m_stage = ResponseStage::Completed;
 					return;
 
 				case WebServerAction::Forbid:
-					Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+					recordAction(WebServerAction::Forbid);
 					sendError(HttpResponseCode::Forbidden);
 					return;
+
+				case WebServerAction::Proxy:
+					doProxy(route->proxyUpstreams);
+					m_stage = ResponseStage::Completed;
+					return;
+
+				case WebServerAction::Module:
+					doModule(resolvedResourcePath, route->mediaType);
+					m_stage = ResponseStage::Completed;
+					return;
 			}
 		}
 
-		std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: no action configured for resource \"" << m_requestUri.path << "\", falling back on Forbid (Not found)\n";
-		Q_EMIT requestActionTaken(clientAddr, clientPort, QString::fromStdString(m_requestLine.uri), WebServerAction::Forbid);
+		anansiLog(Debug, "no action configured for resource \"" << m_requestUri.path << "\", falling back on Forbid (Not found)");
+		recordAction(WebServerAction::Forbid);
 		sendError(HttpResponseCode::NotFound);
 	}
 
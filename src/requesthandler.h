@@ -25,14 +25,23 @@
 /// \brief Declaration of the RequestHandler class for Anansi.
 ///
 /// \dep
+/// - <cstdint>
 /// - <memory>
 /// - <optional>
+/// - <vector>
 /// - <QThread>
 /// - <QString>
+/// - <QStringList>
 /// - <QTcpSocket>
 /// - <QDateTime>
+/// - <QFileInfoList>
 /// - macros.h
 /// - types.h
+/// - cancellationtoken.h
+/// - requesteventchannel.h
+/// - servercounters.h
+/// - metrics.h
+/// - requesttrace.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -40,29 +49,45 @@
 #ifndef ANANSI_REQUESTHANDLER_H
 #define ANANSI_REQUESTHANDLER_H
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include <QThread>
 #include <QString>
+#include <QStringList>
 #include <QTcpSocket>
 #include <QDateTime>
+#include <QFileInfoList>
 
 #include "macros.h"
 #include "types.h"
+#include "cancellationtoken.h"
+#include "requesteventchannel.h"
+#include "servercounters.h"
+#include "metrics.h"
+#include "requesttrace.h"
 
 class QByteArray;
 
 namespace Anansi {
 
 	class ContentEncoder;
+	class ResponseWriter;
+	class CgiEnvironment;
 	class Configuration;
+	class RoutingTable;
+	class ProxyConnection;
 
 	class RequestHandler : public QThread {
 		Q_OBJECT
 
 	public:
-		RequestHandler(std::unique_ptr<QTcpSocket> socket, const Configuration & config, QObject * parent = nullptr);
+		// events is where the handler records what happens to the connection; it may be
+		// null if nothing is interested. cgiEnvironment is the fixed part of the CGI
+		// environment for config (see CgiEnvironment::fixedEntries())
+		RequestHandler(std::unique_ptr<QTcpSocket> socket, std::shared_ptr<const Configuration> config, std::shared_ptr<const RoutingTable> routes, std::shared_ptr<const QByteArray> cgiEnvironment, std::shared_ptr<RequestEventChannel::Source> events, std::shared_ptr<ServerCounters> counters, QObject * parent = nullptr);
 		~RequestHandler() override;
 
 		static QString defaultResponseReason(HttpResponseCode);
@@ -70,13 +95,6 @@ namespace Anansi {
 
 		void run() override;
 
-	Q_SIGNALS:
-		void handlingRequestFrom(const QString &, uint16_t) const;
-		void acceptedRequestFrom(const QString &, uint16_t) const;
-		void rejectedRequestFrom(const QString &, uint16_t, const QString &) const;
-		void requestConnectionPolicyDetermined(const QString &, uint16_t, ConnectionPolicy) const;
-		void requestActionTaken(const QString &, uint16_t, const QString &, WebServerAction) const;
-
 	protected:
 		virtual void handleHttpRequest();
 
@@ -88,6 +106,11 @@ namespace Anansi {
 			Completed
 		};
 
+		enum class DirectoryListingFormat {
+			Html = 0,
+			Json,
+		};
+
 		struct HttpRequestLine {
 			std::string method;
 			std::string uri;
@@ -131,30 +154,107 @@ namespace Anansi {
 		bool sendBody(const QByteArray &);
 		bool sendBody(QIODevice &, const std::optional<int> & = {});
 
-		bool sendError(HttpResponseCode, QString = {}, QString = {});
+		bool sendError(HttpResponseCode, QString = {}, QString = {}, const HttpHeaders & = {});
+		DirectoryListingFormat directoryListingFormat() const;
+		QFileInfoList directoryListingEntries(const QString &) const;
 		void sendDirectoryListing(const QString &);
+		QByteArray htmlDirectoryListing(const QString &);
+		QByteArray jsonDirectoryListing(const QString &) const;
+		void sendDirectoryListingBody(const QByteArray & contentType, const QByteArray & body);
 		void sendFile(const QString & localPath, const QString & mediaType);
+		CgiEnvironment cgiEnvironment(const QString & scriptFileName) const;
+		bool sendCgiResponse(QIODevice & cgiOutput);
+		bool sendCgiBody(QIODevice & cgiOutput);
+		void captureCgiOutput(const char * data, int size);
 		void doCgi(const QString & localPath, const QString & mediaType);
 
+		template<class ProcessType>
+		bool writeCgiRequestBody(ProcessType & cgiProcess);
+
+		template<class ProcessType>
+		bool sendCgiProcessResponse(ProcessType & cgiProcess);
+
+		void doFastCgi(const QString & localPath, const QString & mediaType);
+
+		void doProxy(const std::vector<QString> & upstreams);
+		bool relayProxyBody(ProxyConnection & upstream, const std::optional<uint64_t> & length, bool chunked);
+		bool relayProxyData(ProxyConnection & upstream, std::optional<uint64_t> size, bool chunk);
+
+		class ModuleRequest;
+		class ModuleResponse;
+		void doModule(const QString & localPath, const QString & mediaType);
+
 		void disposeSocket();
+		void writeAccessLog() const;
+
+		inline void recordEvent(RequestEvent::Type type) noexcept {
+			if(m_events) {
+				m_events->push(type);
+			}
+		}
 
-		ConnectionPolicy determineConnectionPolicy() const;
+		inline void recordAction(WebServerAction action) noexcept {
+			Metrics::instance().recordAction(action);
+
+			if(m_events) {
+				m_events->pushAction(action, m_requestLine.uri);
+			}
+		}
+
+		// the request has been worked out and the response is about to start
+		inline void markResolved() noexcept {
+			m_trace.mark(RequestTrace::Point::Resolved);
+		}
+
+		void recordMetrics() const;
+		void sendStatus();
+
+		ConnectionPolicy determineConnectionPolicy();
 		bool readRequestHeaders();
-		bool readRequestBody(std::optional<int> = {});
+		bool readRequestBody();
+		qint64 readRequestBodyData(char * data, qint64 maxSize);
+		bool readRequestBodyChunkHeader();
+		void discardRequestBody();
 		bool determineResponseEncoding();
 
 		std::unique_ptr<QTcpSocket> m_socket;
+		CancellationToken m_cancellation;
+		std::unique_ptr<ResponseWriter> m_out;
+
+		// the configuration snapshot the request is handled with
+		std::shared_ptr<const Configuration> m_configSnapshot;
 		const Configuration & m_config;
+		std::shared_ptr<const RoutingTable> m_routesSnapshot;
+		const RoutingTable & m_routes;
+		std::shared_ptr<const QByteArray> m_cgiEnvironment;
+		std::shared_ptr<RequestEventChannel::Source> m_events;
+		std::shared_ptr<ServerCounters> m_counters;
 		ResponseStage m_stage;
+		qint64 m_receivedAt;
+		int m_responseStatus;
+
+		// timings for the Metrics and the request trace
+		RequestTrace m_trace;
+		Metrics::Clock::duration m_requestBodyReadTime;
+		uint64_t m_requestBytes;
 
 		HttpHeaders m_requestHeaders;
 		HttpRequestLine m_requestLine;
 		HttpMethod m_requestMethod;
 		HttpRequestUri m_requestUri;
-		std::string m_requestBody;
+		int m_requestBodyLength;
+		// for a chunked body, what's left of the current chunk
+		int m_requestBodyUnread;
+		// still decoding a chunked body; see readRequestBodyChunkHeader()
+		bool m_requestBodyChunked;
+		std::unique_ptr<QIODevice> m_requestBody;
 
 		ContentEncoding m_responseEncoding;
 		std::unique_ptr<ContentEncoder> m_encoder;
+
+		// CGI output being kept for the response cache; -1 when not capturing
+		int m_cgiCaptureLimit;
+		QByteArray m_cgiCapture;
 	};
 
 }  // namespace Anansi
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file requesttrace.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the RequestTrace class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <chrono>
+/// - <cstddef>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_REQUESTTRACE_H
+#define ANANSI_REQUESTTRACE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace Anansi {
+
+	// when a request reached each of a fixed set of points in its handling. marking a
+	// point is a clock read and a store, so every request is traced; RequestTraceWriter
+	// decides afterwards which traces are worth keeping
+	class RequestTrace final {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		// a request only passes some of these, depending on how it is handled
+		enum class Point {
+			Received = 0,
+			RequestLineRead,
+			HeadersRead,
+			Resolved,
+			FileOpened,
+			CgiAdmitted,
+			CgiLaunched,
+			ResponseStarted,
+			BodyStarted,
+			Completed,
+		};
+
+		static constexpr const std::size_t PointCount = static_cast<std::size_t>(Point::Completed) + 1;
+
+		inline void mark(Point point) noexcept {
+			m_times[static_cast<std::size_t>(point)] = Clock::now();
+		}
+
+		// only the first time the point is reached counts
+		inline void markOnce(Point point) noexcept {
+			if(!reached(point)) {
+				mark(point);
+			}
+		}
+
+		inline bool reached(Point point) const noexcept {
+			return Clock::time_point() != m_times[static_cast<std::size_t>(point)];
+		}
+
+		inline Clock::time_point time(Point point) const noexcept {
+			return m_times[static_cast<std::size_t>(point)];
+		}
+
+		// from one point to another; both must have been reached
+		inline Clock::duration between(Point from, Point to) const noexcept {
+			return time(to) - time(from);
+		}
+
+	private:
+		std::array<Clock::time_point, PointCount> m_times = {};
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_REQUESTTRACE_H
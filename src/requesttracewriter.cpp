@@ -0,0 +1,376 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file requesttracewriter.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the RequestTraceWriter class for Anansi.
+///
+/// Each kept request is written as one complete ("X") event spanning the whole
+/// request. It is followed by one event for each stretch between the points the
+/// request reached, named after what was happening in that stretch. Every request gets
+/// its own track (the trace event tid), so overlapping requests don't hide each other.
+/// Timestamps are in usec on the steady clock.
+///
+/// The file uses the JSON array form of the trace event format. It is only ever
+/// appended to, so it has no closing bracket and each event is followed by a comma;
+/// trace viewers accept this.
+///
+/// \dep
+/// - requesttracewriter.h
+/// - <algorithm>
+/// - <cstring>
+/// - <QByteArray>
+/// - <QCoreApplication>
+/// - logger.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "requesttracewriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QByteArray>
+#include <QCoreApplication>
+
+#include "logger.h"
+
+
+namespace Anansi {
+
+
+	// what the request was doing up to each point
+	static constexpr const std::array<const char *, RequestTrace::PointCount> StretchNames = {
+	  "",
+	  "read request line",
+	  "read headers",
+	  "resolve",
+	  "open file",
+	  "wait for CGI slot",
+	  "launch CGI",
+	  "prepare response",
+	  "send headers",
+	  "send body",
+	};
+
+
+	static uint16_t copyField(char * dest, std::size_t capacity, const std::string & str) noexcept {
+		const auto length = std::min(capacity, str.size());
+		std::memcpy(dest, str.data(), length);
+		return static_cast<uint16_t>(length);
+	}
+
+
+	static void appendJsonString(QByteArray & out, const char * str, std::size_t length) {
+		static constexpr const char HexDigits[] = "0123456789abcdef";
+		out.append('"');
+
+		for(const auto * ch = str; ch < str + length; ++ch) {
+			const auto byte = static_cast<unsigned char>(*ch);
+
+			if('"' == byte || '\\' == byte) {
+				out.append('\\');
+				out.append(*ch);
+			}
+			else if(0x20 > byte) {
+				out.append("\\u00", 4);
+				out.append(HexDigits[byte >> 4]);
+				out.append(HexDigits[byte & 0x0f]);
+			}
+			else {
+				out.append(*ch);
+			}
+		}
+
+		out.append('"');
+	}
+
+
+	static QByteArray microseconds(RequestTrace::Clock::time_point time) {
+		return QByteArray::number(static_cast<qint64>(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count()));
+	}
+
+
+	static QByteArray microseconds(RequestTrace::Clock::duration duration) {
+		return QByteArray::number(static_cast<qint64>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+	}
+
+
+	RequestTraceWriter::RequestTraceWriter()
+	: m_enabled(false),
+	  m_sampleRate(0),
+	  m_threshold(0),
+	  m_requests(0),
+	  m_kept(0),
+	  m_written(0),
+	  m_dropped(0),
+	  m_queueHead(0),
+	  m_queueSize(0),
+	  m_optionsChanged(false),
+	  m_stopping(false),
+	  m_openFailed(false) {
+	}
+
+
+	RequestTraceWriter::~RequestTraceWriter() {
+		m_enabled.store(false, std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stopping = true;
+		}
+
+		m_wake.notify_one();
+
+		if(m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+
+	RequestTraceWriter & RequestTraceWriter::instance() {
+		static RequestTraceWriter writer;
+		return writer;
+	}
+
+
+	void RequestTraceWriter::setOptions(const Options & options) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_sampleRate.store(std::max(0, options.sampleRate), std::memory_order_relaxed);
+		m_threshold.store(std::max(0, options.threshold), std::memory_order_relaxed);
+
+		if(options.fileName.isEmpty() || (0 >= options.sampleRate && 0 >= options.threshold)) {
+			m_enabled.store(false, std::memory_order_release);
+
+			if(m_thread.joinable()) {
+				// the thread writes out whatever is still queued to the current file before it
+				// finishes
+				m_stopping = true;
+				lock.unlock();
+				m_wake.notify_one();
+				m_thread.join();
+				lock.lock();
+				m_stopping = false;
+			}
+
+			return;
+		}
+
+		if(!m_queue) {
+			m_queue = std::make_unique<Entries>();
+			m_batch = std::make_unique<Entries>();
+		}
+
+		m_options = options;
+		m_optionsChanged = true;
+
+		if(!m_thread.joinable()) {
+			m_thread = std::thread(&RequestTraceWriter::run, this);
+		}
+
+		m_enabled.store(true, std::memory_order_release);
+		lock.unlock();
+		m_wake.notify_one();
+	}
+
+
+	bool RequestTraceWriter::submit(const RequestTrace & trace, const std::string & method, const std::string & uri, int status) noexcept {
+		using Point = RequestTrace::Point;
+
+		if(!m_enabled.load(std::memory_order_acquire) || !trace.reached(Point::Received) || !trace.reached(Point::Completed)) {
+			return false;
+		}
+
+		const auto id = m_requests.fetch_add(1, std::memory_order_relaxed);
+		const auto sampleRate = m_sampleRate.load(std::memory_order_relaxed);
+		const auto threshold = m_threshold.load(std::memory_order_relaxed);
+		const bool isSampled = (0 < sampleRate && 0 == id % static_cast<uint64_t>(sampleRate));
+		const bool isSlow = (0 < threshold && std::chrono::milliseconds(threshold) <= trace.between(Point::Received, Point::Completed));
+
+		if(!isSampled && !isSlow) {
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			if(QueueCapacity <= m_queueSize) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			auto & entry = (*m_queue)[(m_queueHead + m_queueSize) % QueueCapacity];
+			entry.trace = trace;
+			entry.id = id;
+			entry.status = status;
+			entry.methodLength = copyField(entry.method, MaxMethodLength, method);
+			entry.uriLength = copyField(entry.uri, MaxUriLength, uri);
+			++m_queueSize;
+		}
+
+		m_kept.fetch_add(1, std::memory_order_relaxed);
+		m_wake.notify_one();
+		return true;
+	}
+
+
+	RequestTraceWriter::Statistics RequestTraceWriter::statistics() const noexcept {
+		Statistics statistics;
+		statistics.kept = m_kept.load(std::memory_order_relaxed);
+		statistics.written = m_written.load(std::memory_order_relaxed);
+		statistics.dropped = m_dropped.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+
+	void RequestTraceWriter::run() {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		while(true) {
+			m_wake.wait(lock, [this]() {
+				return m_stopping || m_optionsChanged || 0 < m_queueSize;
+			});
+
+			if(m_optionsChanged) {
+				m_optionsChanged = false;
+
+				if(m_options.fileName != m_activeFileName) {
+					m_file.close();
+					m_activeFileName = m_options.fileName;
+					m_openFailed = false;
+				}
+			}
+
+			// take everything queued so that requests aren't held up while it's written
+			const auto count = m_queueSize;
+
+			for(std::size_t idx = 0; idx < count; ++idx) {
+				(*m_batch)[idx] = (*m_queue)[(m_queueHead + idx) % QueueCapacity];
+			}
+
+			m_queueHead = (m_queueHead + count) % QueueCapacity;
+			m_queueSize = 0;
+			const auto stopping = m_stopping;
+			lock.unlock();
+
+			if(0 < count) {
+				QByteArray out;
+
+				for(std::size_t idx = 0; idx < count; ++idx) {
+					appendEntry(out, (*m_batch)[idx]);
+				}
+
+				if(!m_file.isOpen() && !openFile()) {
+					m_dropped.fetch_add(count, std::memory_order_relaxed);
+				}
+				else if(out.size() != m_file.write(out)) {
+					anansiLog(Error, "failed to write to request trace file \"" << qPrintable(m_activeFileName) << "\": " << qPrintable(m_file.errorString()));
+					m_dropped.fetch_add(count, std::memory_order_relaxed);
+				}
+				else {
+					m_written.fetch_add(count, std::memory_order_relaxed);
+				}
+			}
+
+			lock.lock();
+
+			if(stopping) {
+				break;
+			}
+		}
+
+		m_file.close();
+		m_activeFileName.clear();
+	}
+
+
+	bool RequestTraceWriter::openFile() {
+		m_file.setFileName(m_activeFileName);
+
+		if(!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+			// only report it once, not for every batch until it comes good
+			if(!m_openFailed) {
+				anansiLog(Error, "failed to open request trace file \"" << qPrintable(m_activeFileName) << "\": " << qPrintable(m_file.errorString()));
+				m_openFailed = true;
+			}
+
+			return false;
+		}
+
+		m_openFailed = false;
+
+		// a new file starts the event array; an existing one is carried on
+		if(0 == m_file.size()) {
+			m_file.write("[\n", 2);
+		}
+
+		return true;
+	}
+
+
+	void RequestTraceWriter::appendEntry(QByteArray & out, const Entry & entry) const {
+		using Point = RequestTrace::Point;
+		static const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+		const auto & trace = entry.trace;
+		const auto tid = QByteArray::number(static_cast<qulonglong>(entry.id));
+
+		const auto appendEvent = [&out, &tid](const char * category, RequestTrace::Clock::time_point start, RequestTrace::Clock::duration duration) {
+			out.append(",\"cat\":\"").append(category).append("\",\"ph\":\"X\",\"ts\":").append(microseconds(start));
+			out.append(",\"dur\":").append(microseconds(duration));
+			out.append(",\"pid\":").append(pid).append(",\"tid\":").append(tid);
+		};
+
+		out.append("{\"name\":");
+		QByteArray name(entry.method, entry.methodLength);
+		name.append(' ');
+		name.append(entry.uri, entry.uriLength);
+		appendJsonString(out, name.constData(), static_cast<std::size_t>(name.size()));
+		appendEvent("request", trace.time(Point::Received), trace.between(Point::Received, Point::Completed));
+		out.append(",\"args\":{\"status\":").append(QByteArray::number(entry.status)).append("}},\n");
+
+		// the points a request passes through depend on how it was handled, so put the
+		// ones it reached in the order it reached them
+		std::array<Point, RequestTrace::PointCount> points;
+		std::size_t pointCount = 0;
+
+		for(std::size_t idx = 0; idx < RequestTrace::PointCount; ++idx) {
+			if(trace.reached(static_cast<Point>(idx))) {
+				points[pointCount] = static_cast<Point>(idx);
+				++pointCount;
+			}
+		}
+
+		std::stable_sort(points.begin(), points.begin() + pointCount, [&trace](Point first, Point second) {
+			return trace.time(first) < trace.time(second);
+		});
+
+		for(std::size_t idx = 1; idx < pointCount; ++idx) {
+			out.append("{\"name\":\"").append(StretchNames[static_cast<std::size_t>(points[idx])]).append('"');
+			appendEvent("stage", trace.time(points[idx - 1]), trace.between(points[idx - 1], points[idx]));
+			out.append("},\n");
+		}
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file requesttracewriter.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the RequestTraceWriter class for Anansi.
+///
+/// \dep
+/// - <array>
+/// - <atomic>
+/// - <condition_variable>
+/// - <cstdint>
+/// - <memory>
+/// - <mutex>
+/// - <string>
+/// - <thread>
+/// - <QByteArray>
+/// - <QFile>
+/// - <QString>
+/// - requesttrace.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_REQUESTTRACEWRITER_H
+#define ANANSI_REQUESTTRACEWRITER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "requesttrace.h"
+
+namespace Anansi {
+
+	// keeps a sample of request traces and writes them to a file in the Chrome trace event
+	// format, which Perfetto and chrome://tracing can load. one in every sampleRate
+	// requests is kept, along with every request that takes at least threshold msec. the
+	// file is written by a background thread
+	class RequestTraceWriter final {
+	public:
+		// a sampleRate or threshold of 0 turns that kind of sampling off
+		struct Options {
+			QString fileName;
+			int sampleRate = 0;
+			int threshold = 0;
+		};
+
+		struct Statistics {
+			uint64_t kept = 0;
+			uint64_t written = 0;
+			uint64_t dropped = 0;
+		};
+
+		// the most kept traces waiting to be written
+		static constexpr const std::size_t QueueCapacity = 256;
+
+		RequestTraceWriter(const RequestTraceWriter &) = delete;
+		RequestTraceWriter(RequestTraceWriter &&) = delete;
+		void operator=(const RequestTraceWriter &) = delete;
+		void operator=(RequestTraceWriter &&) = delete;
+		~RequestTraceWriter();
+
+		static RequestTraceWriter & instance();
+
+		// an empty file name stops tracing and closes the file
+		void setOptions(const Options & options);
+
+		// call once the request is complete. returns whether the trace was kept. long URIs
+		// are truncated. safe to call from any thread
+		bool submit(const RequestTrace & trace, const std::string & method, const std::string & uri, int status) noexcept;
+
+		Statistics statistics() const noexcept;
+
+	private:
+		static constexpr const std::size_t MaxMethodLength = 16;
+		static constexpr const std::size_t MaxUriLength = 256;
+
+		struct Entry {
+			RequestTrace trace;
+			uint64_t id;
+			int status;
+			uint16_t methodLength;
+			uint16_t uriLength;
+			char method[MaxMethodLength];
+			char uri[MaxUriLength];
+		};
+
+		using Entries = std::array<Entry, QueueCapacity>;
+
+		RequestTraceWriter();
+
+		void run();
+		bool openFile();
+		void appendEntry(QByteArray & out, const Entry & entry) const;
+
+		std::atomic<bool> m_enabled;
+		std::atomic<int> m_sampleRate;
+		std::atomic<int> m_threshold;
+		std::atomic<uint64_t> m_requests;
+		std::atomic<uint64_t> m_kept;
+		std::atomic<uint64_t> m_written;
+		std::atomic<uint64_t> m_dropped;
+
+		// guards the queue, the options and the thread's lifetime. only requests whose
+		// traces are kept take it
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::unique_ptr<Entries> m_queue;
+		std::size_t m_queueHead;
+		std::size_t m_queueSize;
+		Options m_options;
+		bool m_optionsChanged;
+		bool m_stopping;
+		std::thread m_thread;
+
+		// only touched by the background thread
+		std::unique_ptr<Entries> m_batch;
+		QFile m_file;
+		QString m_activeFileName;
+		bool m_openFailed;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_REQUESTTRACEWRITER_H
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file responsewriter.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the ResponseWriter class for Anansi.
+///
+/// \dep
+/// - responsewriter.h
+/// - <QTcpSocket>
+/// - cancellationtoken.h
+/// - logger.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "responsewriter.h"
+
+
+#include <QTcpSocket>
+
+#include "cancellationtoken.h"
+#include "logger.h"
+
+
+namespace Anansi {
+
+
+	// how far the client may fall behind before writes block
+	static constexpr const qint64 MaxPendingBytes = 65536;
+
+	// a client that accepts nothing at all for this long is treated as gone
+	static constexpr const int MaxStallTime = 30000;
+
+
+	ResponseWriter::ResponseWriter(QTcpSocket & socket, CancellationToken & cancellation)
+	: m_socket(socket),
+	  m_cancellation(cancellation),
+	  m_totalWritten(0) {
+		open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+	}
+
+
+	bool ResponseWriter::isSequential() const {
+		return true;
+	}
+
+
+	qint64 ResponseWriter::readData(char *, qint64) {
+		return -1;
+	}
+
+
+	qint64 ResponseWriter::writeData(const char * data, qint64 size) {
+		// the socket is only polled in waitForClient(), when the write would block
+		if(m_cancellation.wasCancelled()) {
+			setErrorString(QStringLiteral("client has disconnected"));
+			return -1;
+		}
+
+		qint64 written = 0;
+
+		while(written < size) {
+			const auto bytes = m_socket.write(data + written, size - written);
+
+			if(-1 == bytes) {
+				anansiLog(Debug, "error writing to TCP socket (\"" << qPrintable(m_socket.errorString()) << "\")");
+				m_cancellation.cancel();
+				setErrorString(m_socket.errorString());
+				return -1;
+			}
+
+			written += bytes;
+			m_totalWritten += bytes;
+		}
+
+		if(!waitForClient()) {
+			return -1;
+		}
+
+		return written;
+	}
+
+
+	bool ResponseWriter::waitForClient() {
+		int stalledFor = 0;
+
+		while(MaxPendingBytes < m_socket.bytesToWrite()) {
+			if(m_socket.waitForBytesWritten(CancellationToken::CheckInterval)) {
+				stalledFor = 0;
+				continue;
+			}
+
+			if(QAbstractSocket::SocketTimeoutError != m_socket.error()) {
+				anansiLog(Debug, "error writing to TCP socket (\"" << qPrintable(m_socket.errorString()) << "\")");
+				m_cancellation.cancel();
+				setErrorString(m_socket.errorString());
+				return false;
+			}
+
+			stalledFor += CancellationToken::CheckInterval;
+
+			if(MaxStallTime <= stalledFor) {
+				anansiLog(Debug, "client has not accepted any data for " << stalledFor << "ms");
+				m_cancellation.cancel();
+			}
+
+			if(m_cancellation.isCancelled()) {
+				setErrorString(QStringLiteral("client has disconnected"));
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+}  // namespace Anansi
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file responsewriter.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the ResponseWriter class for Anansi.
+///
+/// \dep
+/// - <QIODevice>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_RESPONSEWRITER_H
+#define ANANSI_RESPONSEWRITER_H
+
+#include <QIODevice>
+
+class QTcpSocket;
+
+namespace Anansi {
+
+	class CancellationToken;
+
+	// write-only device that response content is written through on its way to the client.
+	// writes block while the client is more than a little behind, so producers (file
+	// reads, encoders, CGI scripts) are paced by the client. once the client has gone,
+	// all writes fail so that producers stop early
+	class ResponseWriter final : public QIODevice {
+	public:
+		ResponseWriter(QTcpSocket & socket, CancellationToken & cancellation);
+
+		bool isSequential() const override;
+
+		// everything written so far, headers included
+		inline qint64 totalWritten() const noexcept {
+			return m_totalWritten;
+		}
+
+	protected:
+		qint64 readData(char * data, qint64 maxSize) override;
+		qint64 writeData(const char * data, qint64 size) override;
+
+	private:
+		bool waitForClient();
+
+		QTcpSocket & m_socket;
+		CancellationToken & m_cancellation;
+		qint64 m_totalWritten;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_RESPONSEWRITER_H
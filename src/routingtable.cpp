@@ -0,0 +1,219 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file routingtable.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Implementation of the RoutingTable class for Anansi.
+///
+/// The extensions are hashed into buckets of about four. Each bucket is given the
+/// first seed that moves all of its extensions into slots that are still free,
+/// largest buckets first. A lookup is therefore two hashes and one comparison
+/// whatever the number of extensions, and never allocates.
+///
+/// \dep
+/// - routingtable.h
+/// - <algorithm>
+/// - configuration.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include "routingtable.h"
+
+#include <algorithm>
+
+#include "configuration.h"
+
+
+namespace Anansi {
+
+
+	// average number of extensions that share a seed
+	static constexpr const std::size_t ExtensionsPerBucket = 4;
+
+	// how many seeds to try for a bucket before making the table larger
+	static constexpr const uint32_t MaxSeed = 1 << 16;
+
+
+	RoutingTable::RoutingTable(const Configuration & config) {
+		const auto extensions = config.registeredFileExtensions();
+
+		if(const auto defaultMediaType = config.defaultMediaType(); !defaultMediaType.isEmpty()) {
+			m_defaultRoute = resolve(config, {defaultMediaType});
+		}
+
+		if(extensions.empty()) {
+			return;
+		}
+
+		std::vector<std::vector<const QString *>> buckets((extensions.size() + ExtensionsPerBucket - 1) / ExtensionsPerBucket);
+
+		for(const auto & ext : extensions) {
+			buckets[hash(ext, 0) % buckets.size()].push_back(&ext);
+		}
+
+		// the biggest buckets are the hardest to place so they go while there's most room
+		std::vector<std::size_t> order(buckets.size());
+
+		for(std::size_t idx = 0; idx < order.size(); ++idx) {
+			order[idx] = idx;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&buckets](std::size_t lhs, std::size_t rhs) {
+			return buckets[lhs].size() > buckets[rhs].size();
+		});
+
+		std::vector<std::vector<const QString *>> sortedBuckets;
+		sortedBuckets.reserve(buckets.size());
+
+		for(const auto idx : order) {
+			sortedBuckets.push_back(buckets[idx]);
+		}
+
+		m_seeds.assign(buckets.size(), 0);
+		auto slotCount = extensions.size() + extensions.size() / 4 + 1;
+
+		while(!place(sortedBuckets, slotCount)) {
+			slotCount *= 2;
+		}
+
+		// place() fills the seeds in sorted order
+		std::vector<uint32_t> seeds(m_seeds.size());
+
+		for(std::size_t idx = 0; idx < order.size(); ++idx) {
+			seeds[order[idx]] = m_seeds[idx];
+		}
+
+		m_seeds = std::move(seeds);
+
+		for(const auto & ext : extensions) {
+			auto & slot = m_slots[hash(ext, m_seeds[hash(ext, 0) % m_seeds.size()]) % m_slots.size()];
+			slot.extension = ext;
+			slot.route = resolve(config, config.fileExtensionMediaTypes(ext));
+		}
+	}
+
+
+	uint32_t RoutingTable::hash(const QString & key, uint32_t seed) {
+		// FNV-1a with the seed folded into the offset basis, followed by the murmur3
+		// finaliser so that every bit of the result depends on the seed
+		uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+		const auto * data = key.constData();
+
+		for(int idx = 0; idx < key.size(); ++idx) {
+			hash ^= data[idx].unicode();
+			hash *= 16777619u;
+		}
+
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35u;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+
+	std::optional<RoutingTable::Route> RoutingTable::resolve(const Configuration & config, const std::vector<QString> & mediaTypes) {
+		// the first media type whose action isn't Ignore decides
+		for(const auto & mediaType : mediaTypes) {
+			const auto action = config.mediaTypeAction(mediaType);
+
+			if(WebServerAction::Ignore == action) {
+				continue;
+			}
+
+			Route route = {action, mediaType, {}};
+
+			if(WebServerAction::Proxy == action) {
+				route.proxyUpstreams = config.mediaTypeProxyUpstreams(mediaType);
+			}
+
+			return route;
+		}
+
+		return {};
+	}
+
+
+	bool RoutingTable::place(const std::vector<std::vector<const QString *>> & buckets, std::size_t slotCount) {
+		std::vector<bool> used(slotCount, false);
+		std::vector<std::size_t> slots;
+
+		for(std::size_t bucketIdx = 0; bucketIdx < buckets.size(); ++bucketIdx) {
+			const auto & bucket = buckets[bucketIdx];
+			uint32_t seed = 1;
+
+			for(; seed < MaxSeed; ++seed) {
+				slots.clear();
+
+				for(const auto * ext : bucket) {
+					const auto slot = hash(*ext, seed) % slotCount;
+
+					if(used[slot] || slots.cend() != std::find(slots.cbegin(), slots.cend(), slot)) {
+						break;
+					}
+
+					slots.push_back(slot);
+				}
+
+				if(slots.size() == bucket.size()) {
+					break;
+				}
+			}
+
+			if(MaxSeed == seed) {
+				return false;
+			}
+
+			for(const auto slot : slots) {
+				used[slot] = true;
+			}
+
+			m_seeds[bucketIdx] = seed;
+		}
+
+		m_slots.assign(slotCount, {});
+		return true;
+	}
+
+
+	const RoutingTable::Route * RoutingTable::route(const QString & extension) const {
+		// resources without an extension are never routed
+		if(extension.isEmpty()) {
+			return nullptr;
+		}
+
+		if(!m_slots.empty()) {
+			const auto & slot = m_slots[hash(extension, m_seeds[hash(extension, 0) % m_seeds.size()]) % m_slots.size()];
+
+			if(slot.extension == extension) {
+				return (slot.route ? &(*slot.route) : nullptr);
+			}
+		}
+
+		return (m_defaultRoute ? &(*m_defaultRoute) : nullptr);
+	}
+
+
+}  // namespace Anansi
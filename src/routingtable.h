@@ -0,0 +1,92 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/// \file routingtable.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Declaration of the RoutingTable class for Anansi.
+///
+/// \dep
+/// - <cstdint>
+/// - <optional>
+/// - <vector>
+/// - <QString>
+/// - types.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_ROUTINGTABLE_H
+#define ANANSI_ROUTINGTABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <QString>
+
+#include "types.h"
+
+namespace Anansi {
+
+	class Configuration;
+
+	// what to do with a resource, resolved in advance for each file extension in a
+	// configuration. the table is built once for each configuration snapshot so that
+	// handling a request takes one lookup rather than a walk through the extension's
+	// media types and their actions
+	class RoutingTable final {
+	public:
+		struct Route {
+			WebServerAction action;
+			QString mediaType;
+			std::vector<QString> proxyUpstreams;
+		};
+
+		RoutingTable() = default;
+		explicit RoutingTable(const Configuration & config);
+
+		// nullptr if nothing is to be done with resources with the extension
+		const Route * route(const QString & extension) const;
+
+	private:
+		struct Slot {
+			QString extension;
+			std::optional<Route> route;
+		};
+
+		static uint32_t hash(const QString & key, uint32_t seed);
+		static std::optional<Route> resolve(const Configuration & config, const std::vector<QString> & mediaTypes);
+		bool place(const std::vector<std::vector<const QString *>> & buckets, std::size_t slotCount);
+
+		// perfect hash over the configured extensions: the first hash picks a seed, the
+		// seeded hash picks the extension's slot
+		std::vector<uint32_t> m_seeds;
+		std::vector<Slot> m_slots;
+
+		// for extensions that aren't configured
+		std::optional<Route> m_defaultRoute;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_ROUTINGTABLE_H
@@ -24,29 +24,84 @@
 ///
 /// \brief Implementation of the Server class for Anansi.
 ///
+/// When the listen address or port changes while the server is listening, the new
+/// listening socket is opened before the old one is closed, and connections already
+/// queued on the old one are accepted first, so no client is turned away by the
+/// switch. Only unix-like platforms do this; elsewhere the old socket is simply closed
+/// and the server listens again.
+///
+/// On unix-like platforms the connection policy for a client is checked as soon as
+/// its connection is accepted. A rejected client is sent a fixed 403 response and
+/// disconnected without a socket object, handler or thread being created for it.
+///
+/// Request handlers don't signal the server as they work. Each connection is given a
+/// source in the server's RequestEventChannel, which the handler writes to from its
+/// own thread, and the server drains them all on a timer and emits the events in one
+/// batch. Nothing is collected while no-one is connected to requestEventsReceived().
+///
+/// Publishing the configuration also passes the access log and request trace settings
+/// on to the AccessLogWriter and RequestTraceWriter, which start or stop writing their
+/// files to match, and sets the Logger's level.
+///
 /// \dep
 /// - server.h
-/// - <iostream>
+/// - <atomic>
+/// - <cerrno>
+/// - <cstring>
+/// - <string>
 /// - <QHostAddress>
 /// - <QString>
+/// - <QDateTime>
+/// - <QTimer>
+/// - <QFileInfo>
+/// - <QMetaMethod>
 /// - assert.h
 /// - requesthandler.h
+/// - cgienvironment.h
+/// - accesslogwriter.h
+/// - metrics.h
+/// - requesttracewriter.h
+/// - logger.h
+/// - configurationwatcher.h
 /// - qtmetatypes.h
+/// - <sys/socket.h>, <netinet/in.h>, <netdb.h>, <fcntl.h>, <unistd.h>, <signal.h> (unix only)
 ///
 /// \par Changes
 /// - (2018-03) First release.
 
 #include "server.h"
 
-#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
 
 #include <QHostAddress>
 #include <QString>
+#include <QDateTime>
+#include <QTimer>
+#include <QFileInfo>
+#include <QMetaMethod>
 
 #include "eqassert.h"
 #include "requesthandler.h"
+#include "cgienvironment.h"
+#include "accesslogwriter.h"
+#include "metrics.h"
+#include "requesttracewriter.h"
+#include "logger.h"
+#include "configurationwatcher.h"
 #include "qtmetatypes.h"
 
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
 
 namespace Anansi {
 
@@ -55,21 +110,83 @@ namespace Anansi {
 	/// NEXTRELEASE SSL support?
 
 
-	Server::Server(const Configuration & config) {
-		setConfiguration(config);
+#if defined(Q_OS_UNIX)
+
+
+	// sent to clients whose connections are rejected. it is the same for every client so
+	// that rejecting a connection costs nothing but the write
+	static constexpr const char RejectedResponse[] = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+
+	// returns -1 if the address can't be listened on
+	static int openListeningSocket(const QString & address, int port) {
+		addrinfo hints = {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV | AI_PASSIVE;
+		addrinfo * addrs = nullptr;
+
+		if(const auto err = ::getaddrinfo(qPrintable(address), std::to_string(port).c_str(), &hints, &addrs); 0 != err) {
+			anansiLog(Error, "invalid listen address " << qPrintable(address) << ":" << port << " (" << ::gai_strerror(err) << ")");
+			return -1;
+		}
+
+		int fd = ::socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+
+		if(-1 == fd) {
+			anansiLog(Error, "failed to create socket (" << std::strerror(errno) << ")");
+			::freeaddrinfo(addrs);
+			return -1;
+		}
+
+		// same options QTcpServer uses, so the new socket behaves as the old one did
+		const int on = 1;
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+		if(-1 == ::bind(fd, addrs->ai_addr, addrs->ai_addrlen) || -1 == ::listen(fd, SOMAXCONN)) {
+			anansiLog(Error, "failed to listen on " << qPrintable(address) << ":" << port << " (" << std::strerror(errno) << ")");
+			::close(fd);
+			fd = -1;
+		}
+
+		::freeaddrinfo(addrs);
+		return fd;
+	}
+
+
+#endif
+
+
+	Server::Server(const Configuration & config)
+	: Server(Configuration(config)) {
 	}
 
 
 	Server::Server(Configuration && config) {
+#if defined(Q_OS_UNIX)
+		// writing to a client or CGI process that has closed its end must not kill the
+		// server (QProcess does the same)
+		static const bool sigPipeIgnored = (SIG_ERR != ::signal(SIGPIPE, SIG_IGN));
+		Q_UNUSED(sigPipeIgnored);
+#endif
+
 		setConfiguration(std::move(config));
+		m_eventTimer.setInterval(RequestEventInterval);
+		connect(&m_eventTimer, &QTimer::timeout, this, &Server::deliverRequestEvents);
 	}
 
 
+	// required in impl. file due to use of std::unique_ptr with forward-declared class.
+	Server::~Server() = default;
+
+
 	bool Server::listen() {
 		eqAssert(!isListening(), "can't call listen() on a Server that is already listening");
 
 		if(!QTcpServer::listen(QHostAddress(m_config.listenAddress()), static_cast<quint16>(m_config.port()))) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to listen on " << qPrintable(m_config.listenAddress()) << ":" << m_config.port() << " (" << qPrintable(errorString()) << ")\n";
+			anansiLog(Error, "failed to listen on " << qPrintable(m_config.listenAddress()) << ":" << m_config.port() << " (" << qPrintable(errorString()) << ")");
 			return false;
 		}
 
@@ -83,7 +200,7 @@ namespace Anansi {
 		QTcpServer::close();
 
 		if(isListening()) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to stop listening on" << qPrintable(m_config.listenAddress()) << ":" << m_config.port() << " (" << qPrintable(errorString()) << ")\n";
+			anansiLog(Error, "failed to stop listening on" << qPrintable(m_config.listenAddress()) << ":" << m_config.port() << " (" << qPrintable(errorString()) << ")");
 			return;
 		}
 
@@ -92,58 +209,279 @@ namespace Anansi {
 	}
 
 
+	bool Server::rejectConnection(qintptr socketFd, const Configuration & config) {
+#if defined(Q_OS_UNIX)
+		sockaddr_storage peer = {};
+		socklen_t peerLength = sizeof(peer);
+
+		if(-1 == ::getpeername(static_cast<int>(socketFd), reinterpret_cast<sockaddr *>(&peer), &peerLength)) {
+			// leave it for the handler to deal with
+			return false;
+		}
+
+		const QHostAddress peerAddress(reinterpret_cast<const sockaddr *>(&peer));
+		const auto policy = config.ipAddressConnectionPolicy(peerAddress);
+
+		if(ConnectionPolicy::Accept == policy) {
+			return false;
+		}
+
+		const auto peerPort = ntohs(AF_INET6 == peer.ss_family ? reinterpret_cast<const sockaddr_in6 *>(&peer)->sin6_port : reinterpret_cast<const sockaddr_in *>(&peer)->sin_port);
+
+#if defined(MSG_NOSIGNAL)
+		static constexpr const int SendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+		static constexpr const int SendFlags = MSG_DONTWAIT;
+#endif
+
+		// the socket is brand new so the response fits in its buffer; if it doesn't get
+		// sent the client is simply disconnected
+		const auto sent = ::send(static_cast<int>(socketFd), RejectedResponse, sizeof(RejectedResponse) - 1, SendFlags);
+		::close(static_cast<int>(socketFd));
+		m_counters->connectionReceived();
+		m_counters->connectionRejected();
+		m_counters->requestCompleted(0 < sent ? static_cast<uint64_t>(sent) : 0);
+
+		if(!config.accessLogFile().isEmpty()) {
+			// the request itself is never read
+			AccessLogWriter::instance().log(peerAddress, QDateTime::currentMSecsSinceEpoch(), 403, (0 < sent ? static_cast<qint64>(sent) : 0), {});
+		}
+
+		Metrics::Request rejected;
+		rejected.status = 403;
+		rejected.bytesOut = (0 < sent ? static_cast<uint64_t>(sent) : 0);
+		Metrics::instance().recordRequest(rejected);
+
+		if(auto events = openRequestEventSource(peerAddress.toString(), peerPort)) {
+			events->push(RequestEvent::Type::ConnectionReceived);
+			events->pushPolicy(policy);
+			events->push(RequestEvent::Type::ConnectionRejected);
+			events->close();
+		}
+
+		return true;
+#else
+		// the handler checks the policy once it has a socket
+		Q_UNUSED(socketFd);
+		Q_UNUSED(config);
+		return false;
+#endif
+	}
+
+
 	void Server::incomingConnection(qintptr socketFd) {
+		const auto snapshot = std::atomic_load(&m_snapshot);
+
+		if(rejectConnection(socketFd, snapshot->config)) {
+			return;
+		}
+
+		m_counters->connectionReceived();
+
 		// we're not using the Pending Connections mechanism of QTcpServer so we
 		// don't call addPendingConnection()
 		auto socket = std::make_unique<QTcpSocket>();
 
 		if(!socket->setSocketDescriptor(socketFd)) {
-			std::cerr << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: failed to set socket descriptor (" << qPrintable(socket->errorString()) << ")\n";
+			anansiLog(Error, "failed to set socket descriptor (" << qPrintable(socket->errorString()) << ")");
 			return;
 		}
 
 		// handler takes ownership of the socket, moving it to its own thread. the handler is
 		// scheduled for deletion as soon as it completes. when it is deleted, it deletes the
-		// socket with it
-		Q_EMIT connectionReceived(socket->peerAddress().toString(), socket->peerPort());
-
-		// still need to parent the handler so that if the Server is destroyed the handler
-		// it spawned is also destroyed. this ensures that the handler doesn't outlive the
-		// server and therefore does not attempt to read the Configuration that is loaned
-		// to it by the server after the server has destroyed it
-		RequestHandler * handler = new RequestHandler(std::move(socket), m_config, this);
-		connect(handler, &RequestHandler::finished, handler, &RequestHandler::deleteLater);
+		// socket with it. the handler records what it does in the event source, which is
+		// handed over to it along with the socket
+		auto events = openRequestEventSource(socket->peerAddress().toString(), socket->peerPort());
 
-		// pass signals from handler through signals from server
-		connect(handler, &RequestHandler::acceptedRequestFrom, this, &Server::connectionAccepted);
-		connect(handler, &RequestHandler::rejectedRequestFrom, this, &Server::connectionRejected);
-		connect(handler, &RequestHandler::requestConnectionPolicyDetermined, this, &Server::requestConnectionPolicyDetermined, Qt::QueuedConnection);
-		connect(handler, &RequestHandler::requestActionTaken, this, &Server::requestActionTaken, Qt::QueuedConnection);
+		if(events) {
+			events->push(RequestEvent::Type::ConnectionReceived);
+		}
 
+		// the handler keeps the snapshot it starts with for the whole request, so it never
+		// sees a configuration change part way through. still need to parent the handler
+		// so that if the Server is destroyed the handler it spawned is also destroyed
+		RequestHandler * handler = new RequestHandler(std::move(socket), {snapshot, &snapshot->config}, {snapshot, &snapshot->routes}, {snapshot, &snapshot->cgiEnvironment}, std::move(events), m_counters, this);
+		connect(handler, &RequestHandler::finished, handler, &RequestHandler::deleteLater);
 		handler->start();
 	}
 
 
-	bool Server::setConfiguration(const Configuration & config) {
-		if(isListening() && (config.listenAddress() != m_config.listenAddress() || config.port() != m_config.port())) {
-			std::cout << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: server already started - listen address and port changes will not take effect until server restart.\n"
-						 << std::flush;
+	std::shared_ptr<RequestEventChannel::Source> Server::openRequestEventSource(const QString & address, uint16_t port) {
+		// nothing to deliver the events to, so don't collect them
+		if(!isSignalConnected(QMetaMethod::fromSignal(&Server::requestEventsReceived))) {
+			return nullptr;
 		}
 
-		m_config = config;
-		return true;
+		if(!m_eventTimer.isActive()) {
+			m_eventTimer.start();
+		}
+
+		return m_events.open(address, port);
+	}
+
+
+	void Server::deliverRequestEvents() {
+		auto events = m_events.drain();
+
+		if(!m_events.hasSources()) {
+			m_eventTimer.stop();
+		}
+
+		if(!events.empty()) {
+			Q_EMIT requestEventsReceived(events);
+		}
+	}
+
+
+	void Server::configurationChanged() {
+		if(m_publishPending) {
+			return;
+		}
+
+		m_publishPending = true;
+
+		QTimer::singleShot(0, this, [this]() {
+			if(m_publishPending) {
+				publishConfiguration();
+			}
+		});
+	}
+
+
+	std::shared_ptr<const Configuration> Server::configurationSnapshot() const {
+		const auto snapshot = std::atomic_load(&m_snapshot);
+		return {snapshot, &snapshot->config};
+	}
+
+
+	std::shared_ptr<const RoutingTable> Server::routingTableSnapshot() const {
+		const auto snapshot = std::atomic_load(&m_snapshot);
+		return {snapshot, &snapshot->routes};
+	}
+
+
+	void Server::publishConfiguration() {
+		// handlers still working with the old snapshot keep it alive until they finish
+		m_publishPending = false;
+		std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>(Snapshot{m_config, RoutingTable(m_config), CgiEnvironment::fixedEntries(m_config)})));
+
+		AccessLogWriter::Options accessLog;
+		accessLog.fileName = m_config.accessLogFile();
+		accessLog.format = m_config.accessLogFormat();
+		accessLog.rotateSize = m_config.accessLogRotateSize();
+		accessLog.rotateInterval = m_config.accessLogRotateInterval();
+		accessLog.rotateCount = m_config.accessLogRotateCount();
+		AccessLogWriter::instance().setOptions(accessLog);
+
+		RequestTraceWriter::Options requestTrace;
+		requestTrace.fileName = m_config.requestTraceFile();
+		requestTrace.sampleRate = m_config.requestTraceSampleRate();
+		requestTrace.threshold = m_config.requestTraceThreshold();
+		RequestTraceWriter::instance().setOptions(requestTrace);
+		Logger::instance().setLevel(m_config.logLevel());
+	}
+
+
+	void Server::acceptPendingConnections() {
+#if defined(Q_OS_UNIX)
+		// the listening socket is non-blocking, so this stops once the backlog is empty
+		while(true) {
+			const auto fd = ::accept(static_cast<int>(socketDescriptor()), nullptr, nullptr);
+
+			if(-1 == fd) {
+				if(EINTR == errno) {
+					continue;
+				}
+
+				break;
+			}
+
+			incomingConnection(fd);
+		}
+#endif
+	}
+
+
+	bool Server::rebind(const QString & address, int port) {
+#if defined(Q_OS_UNIX)
+		// fails if the new address overlaps the old one (e.g. a specific address on the
+		// same port as a wildcard one), in which case the old socket has to go first
+		if(const auto fd = openListeningSocket(address, port); -1 != fd) {
+			acceptPendingConnections();
+			QTcpServer::close();
+
+			if(setSocketDescriptor(fd)) {
+				return true;
+			}
+
+			anansiLog(Error, "failed to use new listening socket (" << qPrintable(errorString()) << ")");
+			::close(fd);
+		}
+		else {
+			acceptPendingConnections();
+			QTcpServer::close();
+		}
+#else
+		QTcpServer::close();
+#endif
+
+		if(QTcpServer::listen(QHostAddress(address), static_cast<quint16>(port))) {
+			return true;
+		}
+
+		anansiLog(Error, "failed to listen on " << qPrintable(address) << ":" << port << " (" << qPrintable(errorString()) << ") - staying on " << qPrintable(m_config.listenAddress()) << ":" << m_config.port());
+
+		if(!isListening() && !QTcpServer::listen(QHostAddress(m_config.listenAddress()), static_cast<quint16>(m_config.port()))) {
+			anansiLog(Error, "failed to listen again on " << qPrintable(m_config.listenAddress()) << ":" << m_config.port() << " (" << qPrintable(errorString()) << ")");
+			Q_EMIT stoppedListening();
+			Q_EMIT listeningStateChanged(false);
+		}
+
+		return false;
+	}
+
+
+	bool Server::setConfiguration(const Configuration & config) {
+		return setConfiguration(Configuration(config));
 	}
 
 
 	bool Server::setConfiguration(Configuration && config) {
-		if(isListening() && (config.listenAddress() != m_config.listenAddress() || config.port() != m_config.port())) {
-			std::cout << EQ_PRETTY_FUNCTION << " [" << __LINE__ << "]: server already started - listen address and port changes will not take effect until server restart.\n"
-						 << std::flush;
+		bool ret = true;
+
+		// connections already being handled are unaffected by the switch
+		if(isListening() && (config.listenAddress() != m_config.listenAddress() || config.port() != m_config.port()) && !rebind(config.listenAddress(), config.port())) {
+			config.setListenAddress(m_config.listenAddress());
+			config.setPort(m_config.port());
+			ret = false;
 		}
 
 		m_config = std::move(config);
+		publishConfiguration();
+		return ret;
+	}
+
+
+	bool Server::watchConfigurationFile(const QString & fileName) {
+		if(!QFileInfo(fileName).isFile()) {
+			anansiLog(Error, "\"" << qPrintable(fileName) << "\" is not a file");
+			return false;
+		}
+
+		m_watcher = std::make_unique<ConfigurationWatcher>(fileName);
+
+		connect(m_watcher.get(), &ConfigurationWatcher::configurationLoaded, this, [this](const Configuration & config) {
+			setConfiguration(config);
+			Q_EMIT configurationReloaded();
+		});
+
 		return true;
 	}
 
 
+	void Server::stopWatchingConfigurationFile() {
+		m_watcher.reset();
+	}
+
+
 }  // namespace Anansi
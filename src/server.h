@@ -26,9 +26,16 @@
 ///
 /// \dep
 /// - <cstdint>
+/// - <memory>
+/// - <QByteArray>
 /// - <QTcpServer>
+/// - <QString>
+/// - <QTimer>
 /// - types.h
 /// - configuration.h
+/// - routingtable.h
+/// - requesteventchannel.h
+/// - servercounters.h
 ///
 /// \par Changes
 /// - (2018-03) First release.
@@ -37,24 +44,35 @@
 #define ANANSI_SERVER_H
 
 #include <cstdint>
+#include <memory>
 
+#include <QByteArray>
 #include <QTcpServer>
+#include <QString>
+#include <QTimer>
 
 #include "types.h"
 #include "configuration.h"
-
-class QString;
+#include "routingtable.h"
+#include "requesteventchannel.h"
+#include "servercounters.h"
 
 namespace Anansi {
 
+	class ConfigurationWatcher;
+
 	class Server : public QTcpServer {
 		Q_OBJECT
 
 	public:
+		// how often events from request handlers are delivered, in msec
+		static constexpr const int RequestEventInterval = 50;
+
 		explicit Server(const Configuration & config);
 		explicit Server(Configuration && config);
 		Server(const Server &) = delete;
 		Server(Server &&) = delete;
+		~Server() override;
 
 		Server & operator=(const Server &) = delete;
 		Server & operator=(Server &&) = delete;
@@ -62,6 +80,8 @@ namespace Anansi {
 		bool listen();
 		void close();
 
+		// for editing in place. call configurationChanged() after editing so that the edits
+		// reach request handlers
 		inline Configuration & configuration() noexcept {
 			return m_config;
 		}
@@ -70,24 +90,72 @@ namespace Anansi {
 			return m_config;
 		}
 
+		// the configuration has been edited in place. the edits reach request handlers as a
+		// new snapshot once control returns to the event loop, so a run of edits is
+		// published together
+		void configurationChanged();
+
+		// the immutable configuration that new connections are handled with
+		std::shared_ptr<const Configuration> configurationSnapshot() const;
+
+		// the routes compiled from the current configuration snapshot
+		std::shared_ptr<const RoutingTable> routingTableSnapshot() const;
+
 		bool setConfiguration(const Configuration & config);
 		bool setConfiguration(Configuration && config);
 
+		// reloads the configuration whenever the file changes. a file that doesn't parse or
+		// validate is ignored and the current configuration stays in place
+		bool watchConfigurationFile(const QString & fileName);
+		void stopWatchingConfigurationFile();
+
+		// events that were lost because requestEventsReceived() receivers fell behind
+		inline uint64_t droppedRequestEventCount() const noexcept {
+			return m_events.dropped();
+		}
+
+		// updated by request handlers as they go; read it whenever convenient
+		inline std::shared_ptr<const ServerCounters> counters() const noexcept {
+			return m_counters;
+		}
+
 	Q_SIGNALS:
 		void startedListening() const;
 		void stoppedListening() const;
 		void listeningStateChanged(bool listening) const;
-		void connectionReceived(const QString & addr, uint16_t port) const;
-		void connectionAccepted(const QString & addr, uint16_t port) const;
-		void connectionRejected(const QString & addr, uint16_t port, const QString & msg) const;
-		void requestConnectionPolicyDetermined(const QString & addr, uint16_t port, ConnectionPolicy policy) const;
-		void requestActionTaken(const QString & addr, uint16_t port, const QString & resource, WebServerAction action) const;
+
+		// what has happened to connections since the last batch, in order. events are only
+		// collected while something is connected to this
+		void requestEventsReceived(const RequestEventBatch & events) const;
+		void configurationReloaded() const;
 
 	protected:
 		void incomingConnection(qintptr socket) override;
 
 	private:
+		// closes the connection if the client's address is not accepted
+		bool rejectConnection(qintptr socketFd, const Configuration & config);
+		void publishConfiguration();
+		bool rebind(const QString & address, int port);
+		void acceptPendingConnections();
+		std::shared_ptr<RequestEventChannel::Source> openRequestEventSource(const QString & address, uint16_t port);
+		void deliverRequestEvents();
+
+		// the routes and the part of the CGI environment that only depends on the
+		// configuration are built along with each snapshot and published with it
+		struct Snapshot {
+			Configuration config;
+			RoutingTable routes;
+			QByteArray cgiEnvironment;
+		};
+
 		Configuration m_config;
+		std::shared_ptr<const Snapshot> m_snapshot;
+		bool m_publishPending = false;
+		std::unique_ptr<ConfigurationWatcher> m_watcher;
+		RequestEventChannel m_events;
+		QTimer m_eventTimer;
+		std::shared_ptr<ServerCounters> m_counters = std::make_shared<ServerCounters>();
 	};
 
 }  // namespace Anansi
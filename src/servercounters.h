@@ -0,0 +1,120 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file servercounters.h
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief Definition of the ServerCounters class for Anansi.
+///
+/// \dep
+/// - <cstddef>
+/// - <cstdint>
+/// - <atomic>
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#ifndef ANANSI_SERVERCOUNTERS_H
+#define ANANSI_SERVERCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+namespace Anansi {
+
+	// running totals of what a Server has done. request handler threads bump them as they
+	// go and anything interested (e.g. the status bar) reads them whenever it likes, so
+	// nothing is queued or signalled per connection. each counter has a cache line to
+	// itself so that handlers updating different counters don't contend
+	class ServerCounters final {
+	public:
+		static constexpr const std::size_t CacheLineSize = 64;
+
+		struct Values {
+			uint64_t received = 0;
+			uint64_t accepted = 0;
+			uint64_t rejected = 0;
+			uint64_t cancelled = 0;
+			uint64_t completed = 0;
+			uint64_t bytesSent = 0;
+		};
+
+		ServerCounters() = default;
+		ServerCounters(const ServerCounters &) = delete;
+		ServerCounters(ServerCounters &&) = delete;
+		void operator=(const ServerCounters &) = delete;
+		void operator=(ServerCounters &&) = delete;
+
+		inline void connectionReceived() noexcept {
+			add(m_received);
+		}
+
+		inline void connectionAccepted() noexcept {
+			add(m_accepted);
+		}
+
+		inline void connectionRejected() noexcept {
+			add(m_rejected);
+		}
+
+		inline void requestCancelled() noexcept {
+			add(m_cancelled);
+		}
+
+		inline void requestCompleted(uint64_t bytesSent) noexcept {
+			add(m_completed);
+			add(m_bytesSent, bytesSent);
+		}
+
+		// the counters are read one at a time so the values can be very slightly out of step
+		// with each other while requests are in flight
+		inline Values values() const noexcept {
+			Values values;
+			values.received = m_received.value.load(std::memory_order_relaxed);
+			values.accepted = m_accepted.value.load(std::memory_order_relaxed);
+			values.rejected = m_rejected.value.load(std::memory_order_relaxed);
+			values.cancelled = m_cancelled.value.load(std::memory_order_relaxed);
+			values.completed = m_completed.value.load(std::memory_order_relaxed);
+			values.bytesSent = m_bytesSent.value.load(std::memory_order_relaxed);
+			return values;
+		}
+
+	private:
+		struct alignas(CacheLineSize) Counter {
+			std::atomic<uint64_t> value{0};
+		};
+
+		static inline void add(Counter & counter, uint64_t amount = 1) noexcept {
+			counter.value.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		Counter m_received;
+		Counter m_accepted;
+		Counter m_rejected;
+		Counter m_cancelled;
+		Counter m_completed;
+		Counter m_bytesSent;
+	};
+
+}  // namespace Anansi
+
+#endif  // ANANSI_SERVERCOUNTERS_H
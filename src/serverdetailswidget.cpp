@@ -30,6 +30,7 @@
 /// - <cstdint>
 /// - <array>
 /// - <iostream>
+/// - <utility>
 /// - <QtEndian>
 /// - <QIcon>
 /// - <QRegularExpression>
@@ -54,6 +55,7 @@
 #include <cstdint>
 #include <array>
 #include <iostream>
+#include <utility>
 
 #include <QtEndian>
 #include <QIcon>
@@ -166,6 +168,9 @@ namespace Anansi {
 			if(!m_server->configuration().setDocumentRoot(docRoot)) {
 				showNotification(this, tr("<p>The document root could not be set to <strong>%1</strong>.</p>").arg(docRoot), NotificationType::Error);
 			}
+			else {
+				m_server->configurationChanged();
+			}
 
 			Q_EMIT documentRootChanged(docRoot);
 		});
@@ -202,6 +207,7 @@ namespace Anansi {
 			eqAssert(m_server, "server cannot be null");
 			const auto adminEmail = m_ui->serverAdmin->text();
 			m_server->configuration().setAdministratorEmail(adminEmail);
+			m_server->configurationChanged();
 			Q_EMIT administratorEmailChanged(adminEmail);
 		});
 
@@ -213,8 +219,9 @@ namespace Anansi {
 				showNotification(this, tr("<p>The cgi-bin directory could not be set to <strong>%1</strong>.</p>").arg(cgiBin), NotificationType::Error);
 			}
 			else {
+				m_server->configurationChanged();
 				auto cgiBinInfo = QFileInfo(cgiBin);
-				auto docRootInfo = QFileInfo(m_server->configuration().documentRoot());
+				auto docRootInfo = QFileInfo(std::as_const(*m_server).configuration().documentRoot());
 
 				// if path does not exist, absoluteFilePath() returns empty which could result
 				// in false positives
@@ -341,6 +348,7 @@ namespace Anansi {
 				return;
 			}
 
+			m_server->configurationChanged();
 			m_ui->addressStatus->setPixmap({});
 			m_ui->addressStatus->setToolTip({});
 			m_ui->addressStatus->setVisible(false);
@@ -357,7 +365,7 @@ namespace Anansi {
 			const auto port = m_ui->port->value();
 			auto & config = m_server->configuration();
 
-			if(!m_server->configuration().setPort(port)) {
+			if(!config.setPort(port)) {
 				showNotification(this, tr("<p>The listen port could not be set to <strong>%1</strong>.</p><p><small>The port must be between 1 and 65535.</small></p>").arg(port), NotificationType::Error);
 				auto oldPort = config.port();
 
@@ -371,6 +379,8 @@ namespace Anansi {
 				return;
 			}
 
+			m_server->configurationChanged();
+
 			if(m_server->isListening()) {
 				showNotification(this, tr("<p>The listen port was changed while the server was running. This will not take effect until the server is restarted.</p><p><small>The server will continue to listen on the previous port until it is restarted.</small></p>"), NotificationType::Warning);
 			}
@@ -405,7 +415,7 @@ namespace Anansi {
 			m_ui->serverAdmin->setText(QStringLiteral(""));
 		}
 		else {
-			const auto & config = server->configuration();
+			const auto & config = std::as_const(*server).configuration();
 			m_ui->docRoot->setPath(config.documentRoot());
 			m_ui->address->setCurrentText(config.listenAddress());
 			m_ui->port->setValue(config.port());
@@ -55,6 +55,29 @@ namespace Anansi {
 		Serve,
 		CGI,
 		Forbid,
+		Proxy,
+		Module,
+	};
+
+
+	enum class CgiTransport {
+		Process = 0,
+		FastCgi,
+	};
+
+
+	enum class AccessLogFormat {
+		Common = 0,
+		Combined,
+	};
+
+
+	// in increasing order of severity
+	enum class LogLevel {
+		Debug = 0,
+		Info,
+		Warning,
+		Error,
 	};
 
 
@@ -193,6 +216,63 @@ namespace Anansi {
 
 			case WebServerAction::Forbid:
 				return "Forbid";
+
+			case WebServerAction::Proxy:
+				return "Proxy";
+
+			case WebServerAction::Module:
+				return "Module";
+		}
+
+		eqAssert(false, "unhandled enumerator value " << static_cast<int>(enumerator));
+		return {};
+	}
+
+
+	template<class StringType = std::string>
+	StringType enumeratorString(CgiTransport enumerator) {
+		switch(enumerator) {
+			case CgiTransport::Process:
+				return "Process";
+
+			case CgiTransport::FastCgi:
+				return "FastCGI";
+		}
+
+		eqAssert(false, "unhandled enumerator value " << static_cast<int>(enumerator));
+		return {};
+	}
+
+
+	template<class StringType = std::string>
+	StringType enumeratorString(AccessLogFormat enumerator) {
+		switch(enumerator) {
+			case AccessLogFormat::Common:
+				return "Common";
+
+			case AccessLogFormat::Combined:
+				return "Combined";
+		}
+
+		eqAssert(false, "unhandled enumerator value " << static_cast<int>(enumerator));
+		return {};
+	}
+
+
+	template<class StringType = std::string>
+	StringType enumeratorString(LogLevel enumerator) {
+		switch(enumerator) {
+			case LogLevel::Debug:
+				return "Debug";
+
+			case LogLevel::Info:
+				return "Info";
+
+			case LogLevel::Warning:
+				return "Warning";
+
+			case LogLevel::Error:
+				return "Error";
 		}
 
 		eqAssert(false, "unhandled enumerator value " << static_cast<int>(enumerator));
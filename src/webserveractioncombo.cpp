@@ -54,6 +54,8 @@ namespace Anansi {
 		QComboBox::addItem(QIcon::fromTheme(QStringLiteral("dialog-ok"), QIcon(QStringLiteral(":/icons/webserveractions/serve"))), displayString(WebServerAction::Serve), QVariant::fromValue(WebServerAction::Serve));
 		QComboBox::addItem(QIcon::fromTheme(QStringLiteral("system-run"), QIcon(QStringLiteral(":/icons/webserveractions/cgi"))), displayString(WebServerAction::CGI), QVariant::fromValue(WebServerAction::CGI));
 		QComboBox::addItem(QIcon::fromTheme(QStringLiteral("error"), QIcon(QStringLiteral(":/icons/webserveractions/forbid"))), displayString(WebServerAction::Forbid), QVariant::fromValue(WebServerAction::Forbid));
+		QComboBox::addItem(QIcon::fromTheme(QStringLiteral("network-server")), displayString(WebServerAction::Proxy), QVariant::fromValue(WebServerAction::Proxy));
+		QComboBox::addItem(QIcon::fromTheme(QStringLiteral("application-x-sharedlib")), displayString(WebServerAction::Module), QVariant::fromValue(WebServerAction::Module));
 		setToolTip(tr("<p>Choose what to do with requests of this type.</p>"));
 
         // can't use qOverload() with MSVC because it doesn't implement SD-6 (feature
@@ -0,0 +1,1498 @@
+/*
+ * Copyright 2015 - 2018 Darren Edale
+ *
+ * This file is part of Anansi web server.
+ *
+ * Anansi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Anansi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Anansi. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// \file anansibench.cpp
+/// \author Darren Edale
+/// \version 1.0.0
+/// \date March 2018
+///
+/// \brief anansi-bench, an HTTP/1.1 load generator for measuring Anansi.
+///
+/// Runs a number of client connections spread across a number of threads, each
+/// thread driving its connections with non-blocking sockets. In closed-loop mode
+/// (the default) each connection sends its next request as soon as the last one has
+/// been answered, so the load is as much as the server can take. With `--rate` the
+/// load is open-loop: requests are sent at a constant overall rate on a fixed
+/// schedule, whatever the server is doing.
+///
+/// Latency is measured from when a request was due to be sent, not from when it
+/// actually was, so a server that stalls is charged for the requests that queued up
+/// behind the stall (i.e. the percentiles are corrected for coordinated omission).
+/// In open-loop mode the schedule provides the due times; in closed-loop mode the
+/// correction is estimated afterwards from the average time between requests on a
+/// connection, as HdrHistogram does.
+///
+/// Only builds on POSIX platforms.
+///
+/// \dep
+/// - <cerrno>
+/// - <cmath>
+/// - <cstdint>
+/// - <cstdio>
+/// - <cstring>
+/// - <algorithm>
+/// - <chrono>
+/// - <fstream>
+/// - <iostream>
+/// - <iterator>
+/// - <memory>
+/// - <optional>
+/// - <random>
+/// - <sstream>
+/// - <string>
+/// - <thread>
+/// - <vector>
+/// - <fcntl.h>
+/// - <netdb.h>
+/// - <netinet/in.h>
+/// - <netinet/tcp.h>
+/// - <poll.h>
+/// - <signal.h>
+/// - <sys/socket.h>
+/// - <unistd.h>
+/// - src/strings.h
+///
+/// \par Changes
+/// - (2018-03) First release.
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "src/strings.h"
+
+
+namespace {
+
+
+	using Equit::parse_uint;
+	using Equit::starts_with;
+	using Equit::to_lower;
+	using Clock = std::chrono::steady_clock;
+
+
+	// the most response header data accepted before the response is considered invalid
+	static constexpr const std::size_t MaxResponseHeaderSize = 64 * 1024;
+	static constexpr const std::size_t ReadBufferSize = 64 * 1024;
+
+	// the longest a thread waits in poll() before looking at its schedule again, in msec
+	static constexpr const int MaxPollWait = 10;
+
+#if defined(MSG_NOSIGNAL)
+	static constexpr const int SendFlags = MSG_NOSIGNAL;
+#else
+	// SIGPIPE is ignored instead
+	static constexpr const int SendFlags = 0;
+#endif
+
+
+	struct Url {
+		std::string host;
+		std::string port = "80";
+		std::string path = "/";
+	};
+
+
+	// a path from the URL mix and how often it is requested relative to the others
+	struct Target {
+		std::string path;
+		double weight;
+	};
+
+
+	struct Options {
+		Url url;
+		std::vector<Target> targets;
+		std::vector<std::string> headers;
+		int threads = 2;
+		int connections = 10;
+		double duration = 10.0;
+		double warmup = 0.0;
+
+		// requests/sec across all connections; 0 for closed-loop
+		double rate = 0.0;
+		bool keepAlive = true;
+		int timeout = 10000;
+		uint32_t seed = 1;
+		bool json = false;
+	};
+
+
+	static uint64_t microseconds(Clock::duration duration) {
+		return static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+	}
+
+
+	// log-linear histogram of latencies in usec, after HdrHistogram: values are
+	// recorded to within 1/64 (about 1.5%) of their true value
+	class LatencyHistogram final {
+	public:
+		LatencyHistogram()
+		: m_counts(bucketCount(), 0) {
+		}
+
+		void record(uint64_t value, uint64_t count = 1) {
+			value = std::min(value, MaxValue);
+			m_counts[bucketIndex(value)] += count;
+			m_total += count;
+			m_sum += static_cast<double>(value) * static_cast<double>(count);
+			m_max = std::max(m_max, value);
+		}
+
+		void add(const LatencyHistogram & other) {
+			for(std::size_t idx = 0; idx < m_counts.size(); ++idx) {
+				m_counts[idx] += other.m_counts[idx];
+			}
+
+			m_total += other.m_total;
+			m_sum += other.m_sum;
+			m_max = std::max(m_max, other.m_max);
+		}
+
+		// a copy with the requests that a closed-loop client would have sent while waiting
+		// on each slow response filled in, assuming one request every expectedInterval usec
+		LatencyHistogram correctedForCoordinatedOmission(uint64_t expectedInterval) const {
+			LatencyHistogram corrected;
+
+			for(std::size_t idx = 0; idx < m_counts.size(); ++idx) {
+				if(0 == m_counts[idx]) {
+					continue;
+				}
+
+				const auto value = bucketValue(idx);
+				corrected.record(value, m_counts[idx]);
+
+				if(0 == expectedInterval) {
+					continue;
+				}
+
+				for(auto missing = value; missing > expectedInterval;) {
+					missing -= expectedInterval;
+					corrected.record(missing, m_counts[idx]);
+				}
+			}
+
+			corrected.m_max = std::max(corrected.m_max, m_max);
+			return corrected;
+		}
+
+		inline uint64_t count() const noexcept {
+			return m_total;
+		}
+
+		inline uint64_t max() const noexcept {
+			return m_max;
+		}
+
+		inline double mean() const noexcept {
+			return (0 == m_total ? 0.0 : m_sum / static_cast<double>(m_total));
+		}
+
+		uint64_t percentile(double percentile) const {
+			if(0 == m_total) {
+				return 0;
+			}
+
+			const auto wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(m_total))));
+			uint64_t seen = 0;
+
+			for(std::size_t idx = 0; idx < m_counts.size(); ++idx) {
+				seen += m_counts[idx];
+
+				if(seen >= wanted) {
+					return std::min(bucketValue(idx), m_max);
+				}
+			}
+
+			return m_max;
+		}
+
+	private:
+		// values below this are recorded exactly
+		static constexpr const uint64_t LinearLimit = 128;
+		static constexpr const int SubBucketBits = 6;
+		static constexpr const uint64_t SubBucketCount = 1 << SubBucketBits;
+
+		// about 12 days
+		static constexpr const uint64_t MaxValue = (uint64_t{1} << 40) - 1;
+
+		static constexpr std::size_t bucketCount() {
+			return bucketIndex(MaxValue) + 1;
+		}
+
+		static constexpr int magnitude(uint64_t value) {
+			int bits = 0;
+
+			while(value >>= 1) {
+				++bits;
+			}
+
+			return bits;
+		}
+
+		static constexpr std::size_t bucketIndex(uint64_t value) {
+			if(value < LinearLimit) {
+				return static_cast<std::size_t>(value);
+			}
+
+			// each power of two from LinearLimit up is split into SubBucketCount buckets
+			const auto shift = magnitude(value) - SubBucketBits;
+			return static_cast<std::size_t>(LinearLimit + static_cast<uint64_t>(shift - 1) * SubBucketCount + ((value >> shift) - SubBucketCount));
+		}
+
+		// the middle of the range of values that fall in a bucket
+		static constexpr uint64_t bucketValue(std::size_t idx) {
+			if(idx < LinearLimit) {
+				return idx;
+			}
+
+			const auto shift = static_cast<int>((idx - LinearLimit) / SubBucketCount) + 1;
+			const auto subBucket = (idx - LinearLimit) % SubBucketCount + SubBucketCount;
+			return (subBucket << shift) + (uint64_t{1} << (shift - 1));
+		}
+
+		std::vector<uint64_t> m_counts;
+		uint64_t m_total = 0;
+		double m_sum = 0.0;
+		uint64_t m_max = 0;
+	};
+
+
+	struct Results {
+		LatencyHistogram latency;
+		LatencyHistogram serviceTime;
+		uint64_t completed = 0;
+		uint64_t bytesReceived = 0;
+		uint64_t connects = 0;
+		uint64_t connectErrors = 0;
+		uint64_t readErrors = 0;
+		uint64_t writeErrors = 0;
+		uint64_t timeouts = 0;
+		uint64_t invalidResponses = 0;
+
+		// by the first digit of the status code
+		uint64_t statusClasses[6] = {};
+
+		void add(const Results & other) {
+			latency.add(other.latency);
+			serviceTime.add(other.serviceTime);
+			completed += other.completed;
+			bytesReceived += other.bytesReceived;
+			connects += other.connects;
+			connectErrors += other.connectErrors;
+			readErrors += other.readErrors;
+			writeErrors += other.writeErrors;
+			timeouts += other.timeouts;
+			invalidResponses += other.invalidResponses;
+
+			for(std::size_t idx = 0; idx < std::size(statusClasses); ++idx) {
+				statusClasses[idx] += other.statusClasses[idx];
+			}
+		}
+
+		inline uint64_t errors() const noexcept {
+			return connectErrors + readErrors + writeErrors + timeouts + invalidResponses;
+		}
+	};
+
+
+	// incremental parser for a response to a GET request. the body is counted, not kept
+	class ResponseParser final {
+	public:
+		enum class Result {
+			NeedMore,
+			Complete,
+			Invalid,
+		};
+
+		void reset() {
+			*this = {};
+		}
+
+		inline bool hasStarted() const noexcept {
+			return m_started;
+		}
+
+		inline int status() const noexcept {
+			return m_status;
+		}
+
+		// whether the server will accept another request on the connection
+		inline bool keepAlive() const noexcept {
+			return m_keepAlive;
+		}
+
+		Result feed(const char * data, std::size_t size) {
+			m_started = m_started || 0 < size;
+
+			while(0 < size) {
+				switch(m_stage) {
+					case Stage::Headers: {
+						const auto headEnd = m_head.size();
+						m_head.append(data, size);
+						const auto end = m_head.find("\r\n\r\n", (3 < headEnd ? headEnd - 3 : 0));
+
+						if(std::string::npos == end) {
+							return (MaxResponseHeaderSize < m_head.size() ? Result::Invalid : Result::NeedMore);
+						}
+
+						// whatever follows the headers is the start of the body
+						const auto consumed = end + 4 - headEnd;
+						data += consumed;
+						size -= consumed;
+						m_head.resize(end);
+
+						if(!parseHead()) {
+							return Result::Invalid;
+						}
+
+						if(Stage::Done == m_stage) {
+							return Result::Complete;
+						}
+
+						break;
+					}
+
+					case Stage::Body: {
+						if(m_untilClose) {
+							return Result::NeedMore;
+						}
+
+						const auto consumed = static_cast<std::size_t>(std::min<uint64_t>(m_remaining, size));
+						m_remaining -= consumed;
+						data += consumed;
+						size -= consumed;
+
+						if(0 == m_remaining) {
+							m_stage = Stage::Done;
+							return Result::Complete;
+						}
+
+						break;
+					}
+
+					case Stage::ChunkSize:
+					case Stage::ChunkEnd:
+					case Stage::Trailers: {
+						const auto * newline = static_cast<const char *>(std::memchr(data, '\n', size));
+
+						if(!newline) {
+							m_line.append(data, size);
+							return (MaxResponseHeaderSize < m_line.size() ? Result::Invalid : Result::NeedMore);
+						}
+
+						m_line.append(data, static_cast<std::size_t>(newline - data));
+						size -= static_cast<std::size_t>(newline + 1 - data);
+						data = newline + 1;
+
+						if(!m_line.empty() && '\r' == m_line.back()) {
+							m_line.pop_back();
+						}
+
+						if(!parseChunkLine()) {
+							return Result::Invalid;
+						}
+
+						m_line.clear();
+
+						if(Stage::Done == m_stage) {
+							return Result::Complete;
+						}
+
+						break;
+					}
+
+					case Stage::ChunkData: {
+						const auto consumed = static_cast<std::size_t>(std::min<uint64_t>(m_remaining, size));
+						m_remaining -= consumed;
+						data += consumed;
+						size -= consumed;
+
+						if(0 == m_remaining) {
+							m_stage = Stage::ChunkEnd;
+						}
+
+						break;
+					}
+
+					case Stage::Done:
+						// nothing more was asked for
+						return Result::Invalid;
+				}
+			}
+
+			return Result::NeedMore;
+		}
+
+		// the server has closed the connection
+		Result finish() const {
+			if(Stage::Body == m_stage && m_untilClose) {
+				return Result::Complete;
+			}
+
+			return (Stage::Done == m_stage ? Result::Complete : Result::Invalid);
+		}
+
+	private:
+		enum class Stage {
+			Headers,
+			Body,
+			ChunkSize,
+			ChunkData,
+			ChunkEnd,
+			Trailers,
+			Done,
+		};
+
+		bool parseHead() {
+			std::istringstream head(m_head);
+			std::string line;
+
+			if(!std::getline(head, line) || !starts_with(line, std::string("HTTP/1.")) || 12 > line.size()) {
+				return false;
+			}
+
+			const auto status = parse_uint<uint16_t>(line.substr(9, 3).c_str());
+
+			if(!status || 100 > *status || 599 < *status) {
+				return false;
+			}
+
+			m_status = *status;
+			m_keepAlive = ('1' == line[7]);
+			bool chunked = false;
+			std::optional<uint64_t> contentLength;
+
+			while(std::getline(head, line)) {
+				if(!line.empty() && '\r' == line.back()) {
+					line.pop_back();
+				}
+
+				const auto colon = line.find(':');
+
+				if(std::string::npos == colon) {
+					continue;
+				}
+
+				const auto name = to_lower(line.substr(0, colon));
+				auto value = line.substr(colon + 1);
+				value.erase(0, value.find_first_not_of(" \t"));
+
+				if("content-length" == name) {
+					contentLength = parse_uint<uint64_t>(value.c_str());
+
+					if(!contentLength) {
+						return false;
+					}
+				}
+				else if("transfer-encoding" == name) {
+					chunked = (std::string::npos != to_lower(value).find("chunked"));
+				}
+				else if("connection" == name) {
+					const auto connection = to_lower(value);
+
+					if(std::string::npos != connection.find("close")) {
+						m_keepAlive = false;
+					}
+					else if(std::string::npos != connection.find("keep-alive")) {
+						m_keepAlive = true;
+					}
+				}
+			}
+
+			if(204 == m_status || 304 == m_status || 200 > m_status) {
+				m_stage = Stage::Done;
+			}
+			else if(chunked) {
+				m_stage = Stage::ChunkSize;
+			}
+			else if(contentLength) {
+				m_remaining = *contentLength;
+				m_stage = (0 == m_remaining ? Stage::Done : Stage::Body);
+			}
+			else {
+				m_untilClose = true;
+				m_keepAlive = false;
+				m_stage = Stage::Body;
+			}
+
+			return true;
+		}
+
+		bool parseChunkLine() {
+			switch(m_stage) {
+				case Stage::ChunkSize: {
+					const auto size = parse_uint<uint64_t>(m_line.substr(0, m_line.find(';')).c_str(), 16);
+
+					if(!size) {
+						return false;
+					}
+
+					m_remaining = *size;
+					m_stage = (0 == m_remaining ? Stage::Trailers : Stage::ChunkData);
+					return true;
+				}
+
+				case Stage::ChunkEnd:
+					m_stage = Stage::ChunkSize;
+					return m_line.empty();
+
+				case Stage::Trailers:
+					if(m_line.empty()) {
+						m_stage = Stage::Done;
+					}
+
+					return true;
+
+				default:
+					return false;
+			}
+		}
+
+		Stage m_stage = Stage::Headers;
+		std::string m_head;
+		std::string m_line;
+		uint64_t m_remaining = 0;
+		int m_status = 0;
+		bool m_started = false;
+		bool m_keepAlive = false;
+		bool m_untilClose = false;
+	};
+
+
+	class Connection final {
+	public:
+		enum class State {
+			Idle,
+			Connecting,
+			Writing,
+			Reading,
+		};
+
+		Connection() = default;
+		Connection(const Connection &) = delete;
+		Connection(Connection && other) noexcept
+		: m_fd(other.m_fd),
+		  m_state(other.m_state),
+		  m_due(other.m_due) {
+			other.m_fd = -1;
+		}
+
+		Connection & operator=(const Connection &) = delete;
+		Connection & operator=(Connection &&) = delete;
+
+		~Connection() {
+			close();
+		}
+
+		inline int fd() const noexcept {
+			return m_fd;
+		}
+
+		inline State state() const noexcept {
+			return m_state;
+		}
+
+		inline Clock::time_point due() const noexcept {
+			return m_due;
+		}
+
+		inline void setDue(Clock::time_point due) noexcept {
+			m_due = due;
+		}
+
+		inline Clock::time_point sentAt() const noexcept {
+			return m_sentAt;
+		}
+
+		inline ResponseParser & response() noexcept {
+			return m_response;
+		}
+
+		inline bool isReused() const noexcept {
+			return m_reused;
+		}
+
+		// starts a request, connecting first if there is no open connection to reuse.
+		// returns false if the connection can't be made
+		bool start(const addrinfo & address, const std::string * request, Results & results) {
+			m_request = request;
+			m_written = 0;
+			m_sentAt = Clock::now();
+			m_response.reset();
+			m_reused = (-1 != m_fd);
+
+			if(m_reused) {
+				m_state = State::Writing;
+				return true;
+			}
+
+			m_fd = ::socket(address.ai_family, address.ai_socktype, address.ai_protocol);
+
+			if(-1 == m_fd) {
+				return false;
+			}
+
+			::fcntl(m_fd, F_SETFD, FD_CLOEXEC);
+			::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+			const int on = 1;
+			::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+			++results.connects;
+
+			if(-1 == ::connect(m_fd, address.ai_addr, address.ai_addrlen)) {
+				if(EINPROGRESS != errno) {
+					close();
+					return false;
+				}
+
+				m_state = State::Connecting;
+				return true;
+			}
+
+			m_state = State::Writing;
+			return true;
+		}
+
+		// the connection attempt has finished one way or the other
+		bool connected() {
+			int error = 0;
+			socklen_t length = sizeof(error);
+
+			if(-1 == ::getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &error, &length) || 0 != error) {
+				close();
+				return false;
+			}
+
+			m_state = State::Writing;
+			return true;
+		}
+
+		// false on error
+		bool write() {
+			while(m_written < m_request->size()) {
+				const auto written = ::send(m_fd, m_request->data() + m_written, m_request->size() - m_written, SendFlags);
+
+				if(-1 == written) {
+					return (EAGAIN == errno || EWOULDBLOCK == errno);
+				}
+
+				m_written += static_cast<std::size_t>(written);
+			}
+
+			m_state = State::Reading;
+			return true;
+		}
+
+		void close() {
+			if(-1 != m_fd) {
+				::close(m_fd);
+			}
+
+			m_fd = -1;
+			m_state = State::Idle;
+		}
+
+		inline void finish() noexcept {
+			m_state = State::Idle;
+		}
+
+	private:
+		int m_fd = -1;
+		State m_state = State::Idle;
+		Clock::time_point m_due;
+		Clock::time_point m_sentAt;
+		const std::string * m_request = nullptr;
+		std::size_t m_written = 0;
+		ResponseParser m_response;
+		bool m_reused = false;
+	};
+
+
+	// drives a share of the connections on its own thread
+	class Worker final {
+	public:
+		Worker(const Options & options, const addrinfo & address, const std::vector<std::string> & requests, int firstConnection, int connectionCount, uint32_t seed)
+		: m_options(options),
+		  m_address(address),
+		  m_requests(requests),
+		  m_firstConnection(firstConnection),
+		  m_random(seed) {
+			std::vector<double> weights;
+
+			for(const auto & target : options.targets) {
+				weights.push_back(target.weight);
+			}
+
+			m_choose = std::discrete_distribution<std::size_t>(weights.cbegin(), weights.cend());
+			m_connections.resize(static_cast<std::size_t>(connectionCount));
+			m_buffer.resize(ReadBufferSize);
+		}
+
+		inline const Results & results() const noexcept {
+			return m_results;
+		}
+
+		void run(Clock::time_point start, Clock::time_point measureFrom, Clock::time_point end) {
+			m_measureFrom = measureFrom;
+
+			if(0.0 < m_options.rate) {
+				// the connections take turns so requests go out evenly spaced overall
+				m_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_options.connections / m_options.rate));
+				const auto stagger = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.rate));
+
+				for(std::size_t idx = 0; idx < m_connections.size(); ++idx) {
+					m_connections[idx].setDue(start + stagger * (m_firstConnection + static_cast<int>(idx)));
+				}
+			}
+			else {
+				for(auto & connection : m_connections) {
+					connection.setDue(start);
+				}
+			}
+
+			std::vector<pollfd> pollFds;
+			std::vector<Connection *> polled;
+
+			while(true) {
+				auto now = Clock::now();
+
+				if(now >= end) {
+					break;
+				}
+
+				auto wait = std::chrono::milliseconds(MaxPollWait);
+				pollFds.clear();
+				polled.clear();
+
+				for(auto & connection : m_connections) {
+					if(Connection::State::Idle == connection.state()) {
+						if(connection.due() > now) {
+							wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(connection.due() - now));
+							continue;
+						}
+
+						startRequest(connection);
+
+						if(Connection::State::Idle == connection.state()) {
+							continue;
+						}
+					}
+
+					if(m_options.timeout < std::chrono::duration_cast<std::chrono::milliseconds>(now - connection.sentAt()).count()) {
+						++m_results.timeouts;
+						connection.close();
+						scheduleNext(connection, now);
+						continue;
+					}
+
+					pollFds.push_back({connection.fd(), static_cast<short>(Connection::State::Reading == connection.state() ? POLLIN : POLLOUT), 0});
+					polled.push_back(&connection);
+				}
+
+				if(-1 == ::poll(pollFds.data(), pollFds.size(), static_cast<int>(std::max<int64_t>(0, wait.count())))) {
+					if(EINTR == errno) {
+						continue;
+					}
+
+					std::cerr << "poll() failed: " << std::strerror(errno) << "\n";
+					return;
+				}
+
+				for(std::size_t idx = 0; idx < pollFds.size(); ++idx) {
+					if(0 != pollFds[idx].revents) {
+						service(*polled[idx]);
+					}
+				}
+			}
+
+			// requests still in flight when the time is up are not counted
+			for(auto & connection : m_connections) {
+				connection.close();
+			}
+		}
+
+	private:
+		void startRequest(Connection & connection) {
+			const auto * request = &m_requests[m_choose(m_random)];
+
+			if(!connection.start(m_address, request, m_results)) {
+				++m_results.connectErrors;
+				scheduleNext(connection, Clock::now());
+			}
+		}
+
+		// the due time of a request that is retried or that fails stays as it was, so the
+		// time lost counts against whatever the connection does next
+		void scheduleNext(Connection & connection, Clock::time_point now) {
+			if(0.0 < m_options.rate) {
+				connection.setDue(connection.due() + m_interval);
+			}
+			else {
+				connection.setDue(now);
+			}
+		}
+
+		void service(Connection & connection) {
+			switch(connection.state()) {
+				case Connection::State::Connecting:
+					if(!connection.connected()) {
+						++m_results.connectErrors;
+						scheduleNext(connection, Clock::now());
+						return;
+					}
+
+					[[fallthrough]];
+
+				case Connection::State::Writing:
+					if(!connection.write()) {
+						if(!retry(connection)) {
+							++m_results.writeErrors;
+						}
+					}
+
+					return;
+
+				case Connection::State::Reading:
+					read(connection);
+					return;
+
+				case Connection::State::Idle:
+					return;
+			}
+		}
+
+		// the server may have closed a kept-alive connection just as the request was sent
+		bool retry(Connection & connection) {
+			const auto wasReused = connection.isReused() && !connection.response().hasStarted();
+			connection.close();
+
+			if(wasReused) {
+				startRequest(connection);
+				return true;
+			}
+
+			scheduleNext(connection, Clock::now());
+			return false;
+		}
+
+		void read(Connection & connection) {
+			while(true) {
+				const auto received = ::recv(connection.fd(), m_buffer.data(), m_buffer.size(), 0);
+
+				if(-1 == received) {
+					if(EAGAIN == errno || EWOULDBLOCK == errno) {
+						return;
+					}
+
+					if(!retry(connection)) {
+						++m_results.readErrors;
+					}
+
+					return;
+				}
+
+				if(0 == received) {
+					if(!connection.response().hasStarted()) {
+						if(!retry(connection)) {
+							++m_results.readErrors;
+						}
+
+						return;
+					}
+
+					if(ResponseParser::Result::Complete == connection.response().finish()) {
+						complete(connection, false);
+					}
+					else {
+						++m_results.invalidResponses;
+						connection.close();
+						scheduleNext(connection, Clock::now());
+					}
+
+					return;
+				}
+
+				countBytes(connection, static_cast<uint64_t>(received));
+
+				switch(connection.response().feed(m_buffer.data(), static_cast<std::size_t>(received))) {
+					case ResponseParser::Result::NeedMore:
+						break;
+
+					case ResponseParser::Result::Complete:
+						complete(connection, m_options.keepAlive && connection.response().keepAlive());
+						return;
+
+					case ResponseParser::Result::Invalid:
+						++m_results.invalidResponses;
+						connection.close();
+						scheduleNext(connection, Clock::now());
+						return;
+				}
+			}
+		}
+
+		inline void countBytes(const Connection & connection, uint64_t bytes) noexcept {
+			if(connection.due() >= m_measureFrom) {
+				m_results.bytesReceived += bytes;
+			}
+		}
+
+		void complete(Connection & connection, bool keepOpen) {
+			const auto now = Clock::now();
+
+			if(connection.due() >= m_measureFrom) {
+				++m_results.completed;
+				++m_results.statusClasses[connection.response().status() / 100];
+				m_results.latency.record(microseconds(now - connection.due()));
+				m_results.serviceTime.record(microseconds(now - connection.sentAt()));
+			}
+
+			if(keepOpen) {
+				connection.finish();
+			}
+			else {
+				connection.close();
+			}
+
+			scheduleNext(connection, now);
+		}
+
+		const Options & m_options;
+		const addrinfo & m_address;
+		const std::vector<std::string> & m_requests;
+		int m_firstConnection;
+		std::mt19937 m_random;
+		std::discrete_distribution<std::size_t> m_choose;
+		std::vector<Connection> m_connections;
+		std::vector<char> m_buffer;
+		Clock::duration m_interval = Clock::duration::zero();
+		Clock::time_point m_measureFrom;
+		Results m_results;
+	};
+
+
+	void usage(const char * program) {
+		std::cerr << "Usage: " << program << " [options] http://host[:port][/path]\n"
+					 "\n"
+					 "  -t, --threads N       client threads (default 2)\n"
+					 "  -c, --connections N   connections, shared between the threads (default 10)\n"
+					 "  -d, --duration SEC    how long to measure for (default 10)\n"
+					 "  -w, --warmup SEC      run for this long first without measuring (default 0)\n"
+					 "  -r, --rate N          send N requests/sec in total on a fixed schedule\n"
+					 "                        (open loop); without this each connection sends its\n"
+					 "                        next request as soon as it has a response (closed loop)\n"
+					 "  -k, --keep-alive      reuse connections the server keeps open (default)\n"
+					 "  -n, --no-keep-alive   use a new connection for every request\n"
+					 "  -u, --urls FILE       request the paths in FILE, one per line as \"[weight] path\",\n"
+					 "                        instead of the URL's path\n"
+					 "  -H, --header HEADER   add \"Name: value\" to every request\n"
+					 "      --timeout MSEC    give up on a response after this long (default 10000)\n"
+					 "      --seed N          seed for choosing paths from the URL mix (default 1)\n"
+					 "      --json            report as a single line of JSON\n";
+	}
+
+
+	std::optional<Url> parseUrl(const std::string & str) {
+		static const std::string scheme = "http://";
+
+		if(!starts_with(str, scheme)) {
+			return {};
+		}
+
+		Url url;
+		auto authority = str.substr(scheme.size());
+
+		if(const auto slash = authority.find('/'); std::string::npos != slash) {
+			url.path = authority.substr(slash);
+			authority.resize(slash);
+		}
+
+		if(!authority.empty() && '[' == authority.front()) {
+			const auto close = authority.find(']');
+
+			if(std::string::npos == close) {
+				return {};
+			}
+
+			url.host = authority.substr(1, close - 1);
+
+			if(close + 1 < authority.size()) {
+				if(':' != authority[close + 1]) {
+					return {};
+				}
+
+				url.port = authority.substr(close + 2);
+			}
+		}
+		else if(const auto colon = authority.find(':'); std::string::npos != colon) {
+			url.host = authority.substr(0, colon);
+			url.port = authority.substr(colon + 1);
+		}
+		else {
+			url.host = authority;
+		}
+
+		if(url.host.empty() || !parse_uint<uint16_t>(url.port.c_str())) {
+			return {};
+		}
+
+		return url;
+	}
+
+
+	std::optional<std::vector<Target>> readUrlMix(const std::string & fileName) {
+		std::ifstream file(fileName);
+
+		if(!file) {
+			std::cerr << "failed to open URL mix \"" << fileName << "\"\n";
+			return {};
+		}
+
+		std::vector<Target> targets;
+		std::string line;
+		int lineNumber = 0;
+
+		while(std::getline(file, line)) {
+			++lineNumber;
+			std::istringstream fields(line);
+			std::string first;
+			std::string second;
+
+			if(!(fields >> first) || '#' == first.front()) {
+				continue;
+			}
+
+			Target target = {first, 1.0};
+
+			if(fields >> second) {
+				char * end;
+				target.weight = std::strtod(first.c_str(), &end);
+
+				if('\0' != *end || !(0.0 < target.weight)) {
+					std::cerr << fileName << ":" << lineNumber << ": invalid weight \"" << first << "\"\n";
+					return {};
+				}
+
+				target.path = second;
+			}
+
+			if('/' != target.path.front()) {
+				std::cerr << fileName << ":" << lineNumber << ": path \"" << target.path << "\" does not start with /\n";
+				return {};
+			}
+
+			targets.push_back(std::move(target));
+		}
+
+		if(targets.empty()) {
+			std::cerr << "URL mix \"" << fileName << "\" has no paths\n";
+			return {};
+		}
+
+		return targets;
+	}
+
+
+	// the value of an option given either as "-xvalue" or as "-x value"/"--long value".
+	// nullptr if the value is missing
+	const char * optionValue(int argc, char ** argv, int & idx, const std::string & longOption) {
+		const std::string arg = argv[idx];
+
+		if(2 < arg.size() && longOption != arg && !starts_with(arg, std::string("--"))) {
+			return argv[idx] + 2;
+		}
+
+		++idx;
+
+		if(idx >= argc) {
+			return nullptr;
+		}
+
+		return argv[idx];
+	}
+
+
+	std::optional<double> parseSeconds(const char * value) {
+		if(!value) {
+			return {};
+		}
+
+		char * end;
+		const auto seconds = std::strtod(value, &end);
+
+		if(value == end || '\0' != *end || !(0.0 <= seconds)) {
+			return {};
+		}
+
+		return seconds;
+	}
+
+
+	std::optional<Options> parseCommandLine(int argc, char ** argv) {
+		Options options;
+		std::optional<std::string> urlMix;
+		std::optional<Url> url;
+
+		for(int idx = 1; idx < argc; ++idx) {
+			const std::string arg = argv[idx];
+
+			auto matches = [&arg](const char * shortOption, const char * longOption) {
+				return arg == longOption || (*shortOption && starts_with(arg, std::string(shortOption)));
+			};
+
+			if(matches("-t", "--threads")) {
+				const auto * value = optionValue(argc, argv, idx, "--threads");
+				const auto threads = (value ? parse_uint<uint16_t>(value) : std::nullopt);
+
+				if(!threads || 0 == *threads) {
+					std::cerr << arg << " needs a number of threads\n";
+					return {};
+				}
+
+				options.threads = *threads;
+			}
+			else if(matches("-c", "--connections")) {
+				const auto * value = optionValue(argc, argv, idx, "--connections");
+				const auto connections = (value ? parse_uint<uint16_t>(value) : std::nullopt);
+
+				if(!connections || 0 == *connections) {
+					std::cerr << arg << " needs a number of connections\n";
+					return {};
+				}
+
+				options.connections = *connections;
+			}
+			else if(matches("-d", "--duration")) {
+				const auto duration = parseSeconds(optionValue(argc, argv, idx, "--duration"));
+
+				if(!duration || 0.0 == *duration) {
+					std::cerr << arg << " needs a number of seconds\n";
+					return {};
+				}
+
+				options.duration = *duration;
+			}
+			else if(matches("-w", "--warmup")) {
+				const auto warmup = parseSeconds(optionValue(argc, argv, idx, "--warmup"));
+
+				if(!warmup) {
+					std::cerr << arg << " needs a number of seconds\n";
+					return {};
+				}
+
+				options.warmup = *warmup;
+			}
+			else if(matches("-r", "--rate")) {
+				const auto rate = parseSeconds(optionValue(argc, argv, idx, "--rate"));
+
+				if(!rate) {
+					std::cerr << arg << " needs a number of requests/sec\n";
+					return {};
+				}
+
+				options.rate = *rate;
+			}
+			else if("-k" == arg || "--keep-alive" == arg) {
+				options.keepAlive = true;
+			}
+			else if("-n" == arg || "--no-keep-alive" == arg) {
+				options.keepAlive = false;
+			}
+			else if(matches("-u", "--urls")) {
+				const auto * value = optionValue(argc, argv, idx, "--urls");
+
+				if(!value) {
+					std::cerr << arg << " needs a file name\n";
+					return {};
+				}
+
+				urlMix = value;
+			}
+			else if(matches("-H", "--header")) {
+				const auto * value = optionValue(argc, argv, idx, "--header");
+
+				if(!value || !std::strchr(value, ':')) {
+					std::cerr << arg << " needs a header as \"Name: value\"\n";
+					return {};
+				}
+
+				options.headers.emplace_back(value);
+			}
+			else if("--timeout" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--timeout");
+				const auto timeout = (value ? parse_uint<uint32_t>(value) : std::nullopt);
+
+				if(!timeout || 0 == *timeout) {
+					std::cerr << arg << " needs a number of msec\n";
+					return {};
+				}
+
+				options.timeout = static_cast<int>(std::min<uint32_t>(*timeout, 3600000));
+			}
+			else if("--seed" == arg) {
+				const auto * value = optionValue(argc, argv, idx, "--seed");
+				const auto seed = (value ? parse_uint<uint32_t>(value) : std::nullopt);
+
+				if(!seed) {
+					std::cerr << arg << " needs a number\n";
+					return {};
+				}
+
+				options.seed = *seed;
+			}
+			else if("--json" == arg) {
+				options.json = true;
+			}
+			else if("-h" == arg || "--help" == arg) {
+				return {};
+			}
+			else if(!url && '-' != arg.front()) {
+				url = parseUrl(arg);
+
+				if(!url) {
+					std::cerr << "invalid URL: " << arg << "\n";
+					return {};
+				}
+			}
+			else {
+				std::cerr << "unexpected argument: " << arg << "\n";
+				return {};
+			}
+		}
+
+		if(!url) {
+			return {};
+		}
+
+		options.url = *url;
+		options.threads = std::min(options.threads, options.connections);
+
+		if(urlMix) {
+			auto targets = readUrlMix(*urlMix);
+
+			if(!targets) {
+				return {};
+			}
+
+			options.targets = std::move(*targets);
+		}
+		else {
+			options.targets.push_back({options.url.path, 1.0});
+		}
+
+		return options;
+	}
+
+
+	std::string formatMiB(double bytes) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.2f", bytes / (1024.0 * 1024.0));
+		return buffer;
+	}
+
+
+	std::string formatRate(double value) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+		return buffer;
+	}
+
+
+	static constexpr const double ReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+
+
+	void reportText(const Options & options, const Results & results, const LatencyHistogram & latency, double elapsed) {
+		std::cout << "anansi-bench: http://" << options.url.host << ":" << options.url.port << " for " << formatRate(options.duration) << "s, "
+				  << options.threads << " thread(s), " << options.connections << " connection(s), "
+				  << (options.keepAlive ? "keep-alive" : "no keep-alive") << ", ";
+
+		if(0.0 < options.rate) {
+			std::cout << "open loop at " << formatRate(options.rate) << " requests/sec\n";
+		}
+		else {
+			std::cout << "closed loop\n";
+		}
+
+		std::cout << "  requests:     " << results.completed << " (" << formatRate(static_cast<double>(results.completed) / elapsed) << "/sec)\n"
+				  << "  received:     " << formatMiB(static_cast<double>(results.bytesReceived)) << " MiB (" << formatMiB(static_cast<double>(results.bytesReceived) / elapsed) << " MiB/sec)\n"
+				  << "  connections:  " << results.connects << "\n"
+				  << "  responses:    1xx " << results.statusClasses[1] << ", 2xx " << results.statusClasses[2] << ", 3xx " << results.statusClasses[3] << ", 4xx " << results.statusClasses[4] << ", 5xx " << results.statusClasses[5] << "\n"
+				  << "  errors:       connect " << results.connectErrors << ", read " << results.readErrors << ", write " << results.writeErrors << ", timeout " << results.timeouts << ", invalid response " << results.invalidResponses << "\n"
+				  << "  latency (usec, corrected for coordinated omission):\n"
+				  << "    ";
+
+		for(const auto percentile : ReportedPercentiles) {
+			std::cout << "p" << percentile << " " << latency.percentile(percentile) << "  ";
+		}
+
+		std::cout << "max " << latency.max() << "  mean " << formatRate(latency.mean()) << "\n"
+				  << "  service time (usec, from when each request was actually sent):\n"
+				  << "    ";
+
+		for(const auto percentile : ReportedPercentiles) {
+			std::cout << "p" << percentile << " " << results.serviceTime.percentile(percentile) << "  ";
+		}
+
+		std::cout << "max " << results.serviceTime.max() << "  mean " << formatRate(results.serviceTime.mean()) << "\n";
+	}
+
+
+	void writeJsonPercentiles(const LatencyHistogram & histogram) {
+		std::cout << "{";
+
+		for(const auto percentile : ReportedPercentiles) {
+			std::cout << "\"p" << percentile << "\":" << histogram.percentile(percentile) << ",";
+		}
+
+		std::cout << "\"max\":" << histogram.max() << ",\"mean\":" << formatRate(histogram.mean()) << "}";
+	}
+
+
+	void reportJson(const Options & options, const Results & results, const LatencyHistogram & latency, double elapsed) {
+		std::cout << "{\"threads\":" << options.threads
+				  << ",\"connections\":" << options.connections
+				  << ",\"duration\":" << elapsed
+				  << ",\"rate\":" << options.rate
+				  << ",\"keepAlive\":" << (options.keepAlive ? "true" : "false")
+				  << ",\"requests\":" << results.completed
+				  << ",\"requestsPerSec\":" << formatRate(static_cast<double>(results.completed) / elapsed)
+				  << ",\"bytes\":" << results.bytesReceived
+				  << ",\"bytesPerSec\":" << static_cast<uint64_t>(static_cast<double>(results.bytesReceived) / elapsed)
+				  << ",\"connects\":" << results.connects
+				  << ",\"status\":{\"1xx\":" << results.statusClasses[1] << ",\"2xx\":" << results.statusClasses[2] << ",\"3xx\":" << results.statusClasses[3] << ",\"4xx\":" << results.statusClasses[4] << ",\"5xx\":" << results.statusClasses[5] << "}"
+				  << ",\"errors\":{\"connect\":" << results.connectErrors << ",\"read\":" << results.readErrors << ",\"write\":" << results.writeErrors << ",\"timeout\":" << results.timeouts << ",\"invalid\":" << results.invalidResponses << "}"
+				  << ",\"latency\":";
+		writeJsonPercentiles(latency);
+		std::cout << ",\"serviceTime\":";
+		writeJsonPercentiles(results.serviceTime);
+		std::cout << "}\n";
+	}
+
+
+}  // namespace
+
+
+int main(int argc, char ** argv) {
+	const auto options = parseCommandLine(argc, argv);
+
+	if(!options) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	::signal(SIGPIPE, SIG_IGN);
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo * addresses = nullptr;
+
+	if(const auto err = ::getaddrinfo(options->url.host.c_str(), options->url.port.c_str(), &hints, &addresses); 0 != err) {
+		std::cerr << "can't resolve " << options->url.host << ": " << ::gai_strerror(err) << "\n";
+		return 1;
+	}
+
+	// every request is built up front so the threads only have to send them
+	std::string commonHeaders = "Host: " + options->url.host + ("80" == options->url.port ? std::string() : ":" + options->url.port) + "\r\nUser-Agent: anansi-bench\r\n";
+
+	if(!options->keepAlive) {
+		commonHeaders += "Connection: close\r\n";
+	}
+
+	for(const auto & header : options->headers) {
+		commonHeaders += header + "\r\n";
+	}
+
+	std::vector<std::string> requests;
+
+	for(const auto & target : options->targets) {
+		requests.push_back("GET " + target.path + " HTTP/1.1\r\n" + commonHeaders + "\r\n");
+	}
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	int firstConnection = 0;
+
+	for(int idx = 0; idx < options->threads; ++idx) {
+		const auto connectionCount = options->connections / options->threads + (idx < options->connections % options->threads ? 1 : 0);
+		workers.push_back(std::make_unique<Worker>(*options, *addresses, requests, firstConnection, connectionCount, options->seed + static_cast<uint32_t>(idx)));
+		firstConnection += connectionCount;
+	}
+
+	const auto start = Clock::now();
+	const auto measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options->warmup));
+	const auto end = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options->duration));
+	std::vector<std::thread> threads;
+
+	for(auto & worker : workers) {
+		threads.emplace_back(&Worker::run, worker.get(), start, measureFrom, end);
+	}
+
+	for(auto & thread : threads) {
+		thread.join();
+	}
+
+	::freeaddrinfo(addresses);
+	const auto elapsed = std::chrono::duration<double>(Clock::now() - measureFrom).count();
+	Results results;
+
+	for(const auto & worker : workers) {
+		results.add(worker->results());
+	}
+
+	// in open loop the latencies are already measured from when each request was due. in
+	// closed loop each connection would have sent a request every (duration * connections
+	// / requests) usec on average had the server not held it up
+	auto latency = results.latency;
+
+	if(0.0 >= options->rate && 0 < results.completed) {
+		latency = results.latency.correctedForCoordinatedOmission(static_cast<uint64_t>(elapsed * 1000000.0 * options->connections / static_cast<double>(results.completed)));
+	}
+
+	if(options->json) {
+		reportJson(*options, results, latency, elapsed);
+	}
+	else {
+		reportText(*options, results, latency, elapsed);
+	}
+
+	return (0 < results.completed ? 0 : 1);
+}
@@ -0,0 +1,216 @@
+#! /bin/bash
+
+# Measures a fixed set of scenarios with anansi-bench against a freshly started anansid,
+# so that results can be compared from one commit to the next.
+#
+# Usage: tools/bench/scenarios.sh BUILDDIR [SCENARIO...]
+#
+# BUILDDIR is a CMake build directory containing anansid, anansi-bench and hello-cgi.
+# The scenarios are:
+# - small: a 1 KiB HTML file;
+# - large: a 1 GiB file (sparse, so it needs little disk space);
+# - gzip: a 256 KiB text file, requested with Accept-Encoding: gzip;
+# - listing: a directory listing of 500 files;
+# - cgi: the hello-cgi program from modules/hello.
+# All of them are run if none are named. The document root and configuration are
+# created in a temporary directory that is removed afterwards.
+#
+# Settings are taken from the environment:
+# - PORT: the port anansid listens on (default 18080);
+# - THREADS, CONNECTIONS, DURATION, WARMUP: passed to anansi-bench (defaults 2, 16, 10
+#   and 2; the large file scenario uses at most 4 connections);
+# - RATE: requests/sec for an open-loop run (default closed loop);
+# - KEEPALIVE: 0 to use a new connection for every request (default 1);
+# - OUTDIR: if set, each scenario's report is also saved there as SCENARIO.json.
+
+set -o pipefail
+
+BUILDDIR="${1:?usage: $0 BUILDDIR [SCENARIO...]}"
+shift
+
+if [ 0 -eq $# ]; then
+	set -- small large gzip listing cgi
+fi
+
+PORT="${PORT:-18080}"
+THREADS="${THREADS:-2}"
+CONNECTIONS="${CONNECTIONS:-16}"
+DURATION="${DURATION:-10}"
+WARMUP="${WARMUP:-2}"
+RATE="${RATE:-}"
+KEEPALIVE="${KEEPALIVE:-1}"
+
+for PROGRAM in anansid anansi-bench hello-cgi; do
+	if [ ! -x "${BUILDDIR}/${PROGRAM}" ]; then
+		echo "${BUILDDIR}/${PROGRAM} not found - build it first" >&2
+		exit 1
+	fi
+done
+
+case "$(uname -s)" in
+	Linux) PLATFORM=linux ;;
+	Darwin) PLATFORM=osx ;;
+	FreeBSD) PLATFORM=freebsd ;;
+	SunOS) PLATFORM=solaris ;;
+	*) PLATFORM=unix ;;
+esac
+
+WORKDIR=$(mktemp -d "${TMPDIR:-/tmp}/anansi-bench.XXXXXX") || exit 1
+DOCROOT="${WORKDIR}/docroot"
+SERVERPID=
+
+cleanup() {
+	if [ -n "${SERVERPID}" ]; then
+		kill "${SERVERPID}" 2>/dev/null
+		wait "${SERVERPID}" 2>/dev/null
+	fi
+
+	rm -rf "${WORKDIR}"
+}
+
+trap cleanup EXIT
+
+# the content is the same every time so runs are comparable
+mkdir -p "${DOCROOT}/listing" "${DOCROOT}/cgi-bin"
+head -c 1024 /dev/zero | tr '\0' 'a' > "${DOCROOT}/small.html"
+dd if=/dev/zero of="${DOCROOT}/large.bin" bs=1 count=0 seek=1073741824 2>/dev/null
+
+for LINE in $(seq 1 4096); do
+	echo "Line ${LINE} of a text file that compresses about as well as typical HTML does."
+done | head -c 262144 > "${DOCROOT}/text.txt"
+
+for FILE in $(seq 1 500); do
+	: > "${DOCROOT}/listing/file-${FILE}.html"
+done
+
+cp "${BUILDDIR}/hello-cgi" "${DOCROOT}/cgi-bin/hello.cgi"
+
+cat > "${WORKDIR}/bench.awcx" <<EOF
+<?xml version="1.0" encoding="UTF-8"?>
+<webserver>
+    <documentroot platform="${PLATFORM}">${DOCROOT}</documentroot>
+    <bindaddress>127.0.0.1</bindaddress>
+    <bindport>${PORT}</bindport>
+    <cgibin platform="${PLATFORM}">${DOCROOT}/cgi-bin</cgibin>
+    <defaultconnectionpolicy>
+        <connectionpolicy>Accept</connectionpolicy>
+    </defaultconnectionpolicy>
+    <allowdirectorylistings>true</allowdirectorylistings>
+    <loglevel>Error</loglevel>
+    <extensionmediatypelist>
+        <extensionmediatype>
+            <extension>html</extension>
+            <mediatype>text/html</mediatype>
+        </extensionmediatype>
+        <extensionmediatype>
+            <extension>txt</extension>
+            <mediatype>text/plain</mediatype>
+        </extensionmediatype>
+        <extensionmediatype>
+            <extension>bin</extension>
+            <mediatype>application/octet-stream</mediatype>
+        </extensionmediatype>
+        <extensionmediatype>
+            <extension>cgi</extension>
+            <mediatype>application/x-cgi</mediatype>
+        </extensionmediatype>
+    </extensionmediatypelist>
+    <mediatypeactionlist>
+        <mediatypeaction>
+            <mediatype>text/html</mediatype>
+            <webserveraction>Serve</webserveraction>
+        </mediatypeaction>
+        <mediatypeaction>
+            <mediatype>text/plain</mediatype>
+            <webserveraction>Serve</webserveraction>
+        </mediatypeaction>
+        <mediatypeaction>
+            <mediatype>application/octet-stream</mediatype>
+            <webserveraction>Serve</webserveraction>
+        </mediatypeaction>
+        <mediatypeaction>
+            <mediatype>application/x-cgi</mediatype>
+            <webserveraction>CGI</webserveraction>
+        </mediatypeaction>
+    </mediatypeactionlist>
+</webserver>
+EOF
+
+"${BUILDDIR}/anansid" -c "${WORKDIR}/bench.awcx" &
+SERVERPID=$!
+
+# give it a moment to start listening
+for ATTEMPT in $(seq 1 50); do
+	if (exec 3<>"/dev/tcp/127.0.0.1/${PORT}") 2>/dev/null; then
+		break
+	fi
+
+	if ! kill -0 "${SERVERPID}" 2>/dev/null; then
+		echo "anansid failed to start" >&2
+		SERVERPID=
+		exit 1
+	fi
+
+	sleep 0.1
+done
+
+BASEURL="http://127.0.0.1:${PORT}"
+STATUS=0
+
+for SCENARIO in "$@"; do
+	SCENARIOCONNECTIONS="${CONNECTIONS}"
+	ARGS=(-t "${THREADS}" -d "${DURATION}" -w "${WARMUP}")
+
+	if [ -n "${RATE}" ]; then
+		ARGS+=(-r "${RATE}")
+	fi
+
+	if [ "0" == "${KEEPALIVE}" ]; then
+		ARGS+=(-n)
+	fi
+
+	case "${SCENARIO}" in
+		small)
+			URLPATH=/small.html
+			;;
+
+		large)
+			URLPATH=/large.bin
+			SCENARIOCONNECTIONS="$((CONNECTIONS < 4 ? CONNECTIONS : 4))"
+			ARGS+=(--timeout 120000)
+			;;
+
+		gzip)
+			URLPATH=/text.txt
+			ARGS+=(-H "Accept-Encoding: gzip")
+			;;
+
+		listing)
+			URLPATH=/listing/
+			;;
+
+		cgi)
+			URLPATH=/cgi-bin/hello.cgi
+			;;
+
+		*)
+			echo "unknown scenario: ${SCENARIO}" >&2
+			STATUS=1
+			continue
+			;;
+	esac
+
+	ARGS+=(-c "${SCENARIOCONNECTIONS}")
+	echo "${SCENARIO} (${URLPATH}):"
+
+	if [ -n "${OUTDIR}" ]; then
+		mkdir -p "${OUTDIR}"
+		"${BUILDDIR}/anansi-bench" "${ARGS[@]}" --json "${BASEURL}${URLPATH}" | tee "${OUTDIR}/${SCENARIO}.json" || STATUS=1
+	else
+		"${BUILDDIR}/anansi-bench" "${ARGS[@]}" "${BASEURL}${URLPATH}" || STATUS=1
+	fi
+
+	echo
+done
+
+exit ${STATUS}
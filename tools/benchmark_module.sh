@@ -0,0 +1,37 @@
+#! /bin/bash
+
+# Compares the sample hello handler module with the same response from CGI.
+#
+# The running server needs to be set up so that MODULEPATH is handled by the hello
+# module (build target anansi-hello) and CGIPATH runs the hello-cgi program, e.g.
+# - a file extension "hello" mapped to a media type whose action is Module, with
+#   the media type's module set to anansi-hello.so; and
+# - hello-cgi copied into the cgi-bin directory.
+#
+# ApacheBench (ab) does the measuring.
+
+BASEURL="${1:-http://127.0.0.1:8080}"
+MODULEPATH="${MODULEPATH:-/index.hello}"
+CGIPATH="${CGIPATH:-/cgi-bin/hello-cgi}"
+REQUESTS="${REQUESTS:-10000}"
+CONCURRENCY="${CONCURRENCY:-8}"
+
+if ! command -v ab >/dev/null; then
+	echo "ab (ApacheBench) is required" >&2
+	exit 1
+fi
+
+for TARGET in "module ${MODULEPATH}" "CGI ${CGIPATH}"; do
+	NAME="${TARGET%% *}"
+	URLPATH="${TARGET#* }"
+
+	# make sure it actually works before timing it
+	if ! CHECK=$(ab -q -n 1 "${BASEURL}${URLPATH}" 2>&1) || grep -q "^Non-2xx responses" <<< "${CHECK}"; then
+		echo "${NAME}: ${BASEURL}${URLPATH} does not respond with success" >&2
+		exit 1
+	fi
+
+	echo "${NAME} (${URLPATH}):"
+	ab -q -n "${REQUESTS}" -c "${CONCURRENCY}" "${BASEURL}${URLPATH}" | grep -E "^(Requests per second|Time per request|Failed requests|Transfer rate)"
+	echo
+done